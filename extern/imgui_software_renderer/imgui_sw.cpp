@@ -14,10 +14,22 @@
 #include <vector>
 #include <SDL.h>
 
+#if !defined(TA_BIG_ENDIAN) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2))
+#include <emmintrin.h>
+#define IMGUI_SW_SSE2
+#endif
+
+// the frame is split into tiles which are painted independently (possibly in parallel).
+// a tile is only repainted if the primitives touching it changed since the last frame.
+#define SW_TILE_SIZE 64
+
+struct SwRenderState;
+
 struct ImGui_ImplSW_Data
 {
     SDL_Window*  Window;
     SWTexture*   FontTexture;
+    SwRenderState* State;
 
     ImGui_ImplSW_Data() { memset((void*)this, 0, sizeof(*this)); }
 };
@@ -38,6 +50,8 @@ struct PaintTarget
   uint32_t *pixels;
   int width;
   int height;
+  // region which may be painted (usually a tile)
+  int minX, minY, maxX, maxY;
 };
 
 // ----------------------------------------------------------------------------
@@ -94,6 +108,44 @@ static inline uint32_t blend(const ColorInt &target, const ColorInt &source)
   );
 }
 
+// ----------------------------------------------------------------------------
+// Span filling. The SSE2 path gives the same results as blend().
+
+static inline void fill_span(uint32_t *dst, int count, uint32_t color)
+{
+  std::fill_n(dst, count, color);
+}
+
+static void blend_span(uint32_t *dst, int count, const ColorInt &color)
+{
+  if (count <= 0 || color.a == 0) return;
+  if (color.a == 255) {
+    fill_span(dst, count, color.u32);
+    return;
+  }
+  const unsigned short ia = 255 - color.a;
+#ifdef IMGUI_SW_SSE2
+  // lanes are b, g, r, a. alpha is multiplied by 256 so that the target alpha is kept.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mul = _mm_set_epi16(256, ia, ia, ia, 256, ia, ia, ia);
+  const short sr = color.r * color.a + 255;
+  const short sg = color.g * color.a + 255;
+  const short sb = color.b * color.a + 255;
+  const __m128i add = _mm_set_epi16(0, sr, sg, sb, 0, sr, sg, sb);
+  for (; count >= 4; count -= 4, dst += 4) {
+    __m128i px = _mm_loadu_si128((const __m128i*)dst);
+    __m128i lo = _mm_unpacklo_epi8(px, zero);
+    __m128i hi = _mm_unpackhi_epi8(px, zero);
+    lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, mul), add), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, mul), add), 8);
+    _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; count > 0; count--, dst++) {
+    *dst = blend(*(const ColorInt*)dst, color);
+  }
+}
+
 // ----------------------------------------------------------------------------
 // Used for interpolating vertex attributes (color and texture coordinates) in a triangle.
 
@@ -225,40 +277,14 @@ static void paint_uniform_rectangle(const PaintTarget &target,
   int max_y_i = (int)(max_f.y + 0.5f);
 
   // Clamp to render target:
-  min_x_i = std::max(min_x_i, 0);
-  min_y_i = std::max(min_y_i, 0);
-  max_x_i = std::min(max_x_i, target.width);
-  max_y_i = std::min(max_y_i, target.height);
+  min_x_i = std::max(min_x_i, target.minX);
+  min_y_i = std::max(min_y_i, target.minY);
+  max_x_i = std::min(max_x_i, target.maxX);
+  max_y_i = std::min(max_y_i, target.maxY);
+  if (min_x_i >= max_x_i) return;
 
-  if (color.a==255) {
-    // fast path if alpha blending is not necessary
-    for (int y = min_y_i; y < max_y_i; ++y) {
-      uint32_t* target_pixel = &target.pixels[y * target.width + min_x_i - 1];
-      for (int x = min_x_i; x < max_x_i; ++x) {
-        ++target_pixel;
-        *target_pixel = color.u32;
-      }
-    }
-  } else {
-    // We often blend the same colors over and over again, so optimize for this (saves 25% total cpu):
-    uint32_t last_target_pixel = target.pixels[min_y_i * target.width + min_x_i];
-    const ColorInt* lastColorRef = (const ColorInt*)(&last_target_pixel);
-    uint32_t last_output = blend(*lastColorRef, color);
-
-    for (int y = min_y_i; y < max_y_i; ++y) {
-      uint32_t* target_pixel = &target.pixels[y * target.width + min_x_i - 1];
-      for (int x = min_x_i; x < max_x_i; ++x) {
-        ++target_pixel;
-        if (*target_pixel == last_target_pixel) {
-          *target_pixel = last_output;
-          continue;
-        }
-        last_target_pixel = *target_pixel;
-        const ColorInt* colorRef = (const ColorInt*)(target_pixel);
-        *target_pixel = blend(*colorRef, color);
-        last_output = *target_pixel;
-      }
-    }
+  for (int y = min_y_i; y < max_y_i; ++y) {
+    blend_span(&target.pixels[y * target.width + min_x_i], max_x_i - min_x_i, color);
   }
 }
 
@@ -299,6 +325,11 @@ static void paint_uniform_textured_rectangle(const PaintTarget &target,
   max_x_i = std::min(max_x_i, target.width);
   max_y_i = std::min(max_y_i, target.height);
 
+  // Texels are stepped through one pixel at a time from the top left corner of the
+  // whole rectangle, so that the result doesn't depend on the tile being painted.
+  const int skip_x = std::max(target.minX - min_x_i, 0);
+  const int skip_y = std::max(target.minY - min_y_i, 0);
+
   const auto topleft = ImVec2(min_x_i + 0.5f, min_y_i + 0.5f);
   const ImVec2 delta_uv_per_pixel = {
     (max_v.uv.x - min_v.uv.x) / distanceX,
@@ -317,12 +348,20 @@ static void paint_uniform_textured_rectangle(const PaintTarget &target,
   if (startY<0) startY=0;
   if (startY>texture.height-1) startY=texture.height-1;
 
-  int currentX = startX;
-  int currentY = startY * texture.width;
-
   float deltaX = delta_uv_per_pixel.x * texture.width;
   float deltaY = delta_uv_per_pixel.y * texture.height;
 
+  if (deltaX != 0) startX = std::min(startX + skip_x, texture.width - 1);
+  if (deltaY != 0) startY = std::min(startY + skip_y, texture.height - 1);
+
+  min_x_i = std::max(min_x_i, target.minX);
+  min_y_i = std::max(min_y_i, target.minY);
+  max_x_i = std::min(max_x_i, target.maxX);
+  max_y_i = std::min(max_y_i, target.maxY);
+
+  int currentX = startX;
+  int currentY = startY * texture.width;
+
   const ColorInt colorRef = ColorInt::bgra(min_v.col);
 
   for (int y = min_y_i; y < max_y_i; ++y) {
@@ -402,10 +441,10 @@ static void paint_triangle(const PaintTarget &target,
   int max_y_i = (int)(max_y_f + 1.0f);
 
   // Clip against render target:
-  min_x_i = std::max(min_x_i, 0);
-  min_y_i = std::max(min_y_i, 0);
-  max_x_i = std::min(max_x_i, target.width);
-  max_y_i = std::min(max_y_i, target.height);
+  min_x_i = std::max(min_x_i, target.minX);
+  min_y_i = std::max(min_y_i, target.minY);
+  max_x_i = std::min(max_x_i, target.maxX);
+  max_y_i = std::min(max_y_i, target.maxY);
 
   // ------------------------------------------------------------------------
   // Set up interpolation of barycentric coordinates:
@@ -458,11 +497,24 @@ static void paint_triangle(const PaintTarget &target,
   const ColorInt c1 = ColorInt::bgra(v1.col);
   const ColorInt c2 = ColorInt::bgra(v2.col);
 
-  // We often blend the same colors over and over again, so optimize for this (saves 10% total cpu):
-  uint32_t last_target_pixel = 0;
-  const ColorInt* lastColorRef = (const ColorInt*)(&last_target_pixel);
-  const ColorInt colorRef = ColorInt::bgra(v0.col);
-  uint32_t last_output = blend(*lastColorRef, colorRef);
+  auto is_inside = [&](int x, int y) {
+    const auto p = Point{ kFixedBias * x + kFixedBias / 2, kFixedBias * y + kFixedBias / 2 };
+    return (sign * orient2d(p1i, p2i, p) + bias0i) >= 0
+      && (sign * orient2d(p2i, p0i, p) + bias1i) >= 0
+      && (sign * orient2d(p0i, p1i, p) + bias2i) >= 0;
+  };
+
+  if (has_uniform_color && !texture) {
+    // The covered part of a row is contiguous, so find it and fill it in one go:
+    for (int y = min_y_i; y < max_y_i; ++y) {
+      int x = min_x_i;
+      while (x < max_x_i && !is_inside(x, y)) ++x;
+      const int span_start = x;
+      while (x < max_x_i && is_inside(x, y)) ++x;
+      blend_span(&target.pixels[y * target.width + span_start], x - span_start, c0);
+    }
+    return;
+  }
 
   for (int y = min_y_i; y < max_y_i; ++y) {
     auto bary = bary_current_row;
@@ -479,33 +531,15 @@ static void paint_triangle(const PaintTarget &target,
 
       ++target_pixel;
 
-      {
-        // Inside/outside test:
-        const auto p = Point{ kFixedBias * x + kFixedBias / 2, kFixedBias * y + kFixedBias / 2 };
-        const auto w0i = sign * orient2d(p1i, p2i, p) + bias0i;
-        const auto w1i = sign * orient2d(p2i, p0i, p) + bias1i;
-        const auto w2i = sign * orient2d(p0i, p1i, p) + bias2i;
-        if (w0i < 0 || w1i < 0 || w2i < 0) {
-          if (has_been_inside_this_row) {
-            break;// Gives a nice 10% speedup
-          } else {
-            continue;
-          }
-        }
-      }
-      has_been_inside_this_row = true;
-
-
-      if (has_uniform_color && !texture) {
-        if (*target_pixel == last_target_pixel) {
-          *target_pixel = last_output;
+      // Inside/outside test:
+      if (!is_inside(x, y)) {
+        if (has_been_inside_this_row) {
+          break;// Gives a nice 10% speedup
+        } else {
           continue;
         }
-        last_target_pixel = *target_pixel;
-        *target_pixel = blend(*lastColorRef, colorRef);
-        last_output = *target_pixel;
-        continue;
       }
+      has_been_inside_this_row = true;
 
       ColorInt src_color;
 
@@ -539,7 +573,176 @@ static void paint_triangle(const PaintTarget &target,
   }
 }
 
-static void paint_draw_cmd(const PaintTarget &target,
+// ----------------------------------------------------------------------------
+// Draw commands are split into primitives, which are then binned into the tiles they touch.
+
+enum SwPrimType
+{
+  SW_PRIM_TRIANGLE,
+  SW_PRIM_RECT,
+  SW_PRIM_TEXTURED_RECT
+};
+
+struct SwPrim
+{
+  SwPrimType type;
+  const SWTexture *texture;// NULL for untextured triangles
+  ImVec4 clip_rect;
+  ImDrawVert v0, v1, v2;// textured rectangles use v0 (min) and v1 (max)
+  ImVec2 min, max;// uniform rectangles (already clipped)
+  ColorInt color;
+};
+
+struct SwTile
+{
+  std::vector<int> prims;
+  uint64_t hash, last_hash;
+
+  SwTile():
+    hash(0),
+    last_hash(0) {}
+};
+
+struct SwRenderState;
+
+struct SwTileJob
+{
+  SwRenderState *state;
+  int tile;
+};
+
+struct SwRenderState
+{
+  std::vector<SwPrim> prims;
+  std::vector<SwTile> tiles;
+  std::vector<SwTileJob> jobs;
+  int tiles_x, tiles_y;
+  PaintTarget target;
+
+  // what the window surface looked like after the last frame
+  uint32_t *last_pixels;
+  int last_width, last_height;
+  uint32_t clear_color, last_clear_color;
+  bool invalidate;
+
+  ImGui_ImplSW_ParallelFor parallel_for;
+  void *parallel_user;
+
+  SwRenderState():
+    tiles_x(0),
+    tiles_y(0),
+    target{ nullptr, 0, 0, 0, 0, 0, 0 },
+    last_pixels(nullptr),
+    last_width(0),
+    last_height(0),
+    clear_color(0),
+    last_clear_color(0),
+    invalidate(true),
+    parallel_for(nullptr),
+    parallel_user(nullptr) {}
+};
+
+static const uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+static inline uint64_t hash_data(uint64_t h, const void *data, size_t len)
+{
+  const unsigned char *p = (const unsigned char*)data;
+  for (; len >= 4; len -= 4, p += 4) {
+    uint32_t word;
+    memcpy(&word, p, 4);
+    h = (h ^ word) * 0x100000001b3ULL;
+  }
+  for (; len; len--, p++) {
+    h = (h ^ *p) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static uint64_t hash_prim(const SwPrim &prim)
+{
+  uint64_t h = kHashSeed;
+  h = hash_data(h, &prim.type, sizeof(prim.type));
+  h = hash_data(h, &prim.texture, sizeof(prim.texture));
+  if (prim.texture) h = hash_data(h, &prim.texture->revision, sizeof(prim.texture->revision));
+  switch (prim.type) {
+    case SW_PRIM_TRIANGLE:
+      h = hash_data(h, &prim.clip_rect, sizeof(prim.clip_rect));
+      h = hash_data(h, &prim.v0, sizeof(ImDrawVert));
+      h = hash_data(h, &prim.v1, sizeof(ImDrawVert));
+      h = hash_data(h, &prim.v2, sizeof(ImDrawVert));
+      break;
+    case SW_PRIM_RECT:
+      h = hash_data(h, &prim.min, sizeof(prim.min));
+      h = hash_data(h, &prim.max, sizeof(prim.max));
+      h = hash_data(h, &prim.color.u32, sizeof(prim.color.u32));
+      break;
+    case SW_PRIM_TEXTURED_RECT:
+      h = hash_data(h, &prim.clip_rect, sizeof(prim.clip_rect));
+      h = hash_data(h, &prim.v0, sizeof(ImDrawVert));
+      h = hash_data(h, &prim.v1, sizeof(ImDrawVert));
+      break;
+  }
+  return h;
+}
+
+// Integer bounding box [min, max) of the pixels a primitive may touch.
+// This uses the same math as the paint functions.
+static bool prim_bounds(const SwPrim &prim, int width, int height, int &x0, int &y0, int &x1, int &y1)
+{
+  if (prim.type == SW_PRIM_RECT) {
+    x0 = (int)(prim.min.x + 0.5f);
+    y0 = (int)(prim.min.y + 0.5f);
+    x1 = (int)(prim.max.x + 0.5f);
+    y1 = (int)(prim.max.y + 0.5f);
+  } else {
+    float min_x_f, min_y_f, max_x_f, max_y_f;
+    if (prim.type == SW_PRIM_TRIANGLE) {
+      min_x_f = min3(prim.v0.pos.x, prim.v1.pos.x, prim.v2.pos.x);
+      min_y_f = min3(prim.v0.pos.y, prim.v1.pos.y, prim.v2.pos.y);
+      max_x_f = max3(prim.v0.pos.x, prim.v1.pos.x, prim.v2.pos.x);
+      max_y_f = max3(prim.v0.pos.y, prim.v1.pos.y, prim.v2.pos.y);
+    } else {
+      min_x_f = prim.v0.pos.x;
+      min_y_f = prim.v0.pos.y;
+      max_x_f = prim.v1.pos.x;
+      max_y_f = prim.v1.pos.y;
+    }
+    min_x_f = std::max(min_x_f, prim.clip_rect.x);
+    min_y_f = std::max(min_y_f, prim.clip_rect.y);
+    max_x_f = std::min(max_x_f, prim.clip_rect.z - 0.5f);
+    max_y_f = std::min(max_y_f, prim.clip_rect.w - 0.5f);
+    x0 = (int)(min_x_f);
+    y0 = (int)(min_y_f);
+    x1 = (int)(max_x_f + 1.0f);
+    y1 = (int)(max_y_f + 1.0f);
+  }
+
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, width);
+  y1 = std::min(y1, height);
+  return x0 < x1 && y0 < y1;
+}
+
+static void add_prim(SwRenderState &st, const SwPrim &prim)
+{
+  int x0, y0, x1, y1;
+  if (!prim_bounds(prim, st.target.width, st.target.height, x0, y0, x1, y1)) return;
+
+  const int index = (int)st.prims.size();
+  st.prims.push_back(prim);
+
+  const uint64_t h = hash_prim(prim);
+  for (int ty = y0 / SW_TILE_SIZE; ty <= (y1 - 1) / SW_TILE_SIZE; ++ty) {
+    for (int tx = x0 / SW_TILE_SIZE; tx <= (x1 - 1) / SW_TILE_SIZE; ++tx) {
+      SwTile &tile = st.tiles[ty * st.tiles_x + tx];
+      tile.prims.push_back(index);
+      tile.hash = hash_data(tile.hash, &h, sizeof(h));
+    }
+  }
+}
+
+static void bin_draw_cmd(SwRenderState &st,
   const ImDrawVert *vertices,
   const ImDrawIdx *idx_buffer,
   const ImDrawCmd &pcmd,
@@ -549,6 +752,10 @@ static void paint_draw_cmd(const PaintTarget &target,
   const SWTexture* texture = (const SWTexture*)(pcmd.TextureId);
   IM_ASSERT(texture);
 
+  SwPrim prim;
+  prim.texture = texture;
+  prim.clip_rect = pcmd.ClipRect;
+
   for (unsigned int i = 0; i + 3 <= pcmd.ElemCount;) {
     ImDrawVert v0 = vertices[idx_buffer[i + 0]];
     ImDrawVert v1 = vertices[idx_buffer[i + 1]];
@@ -567,7 +774,11 @@ static void paint_draw_cmd(const PaintTarget &target,
         const bool has_texture = v0.uv != white_uv || v1.uv != white_uv || v2.uv != white_uv || v3.uv != white_uv;
 
         if (has_uniform_color && has_texture) {
-          paint_uniform_textured_rectangle(target, *texture, pcmd.ClipRect, v0, v2);
+          prim.type = SW_PRIM_TEXTURED_RECT;
+          prim.texture = texture;
+          prim.v0 = v0;
+          prim.v1 = v2;
+          add_prim(st, prim);
           i += 6;
           continue;
         }
@@ -610,8 +821,13 @@ static void paint_draw_cmd(const PaintTarget &target,
         }// Completely clipped
 
         if (has_uniform_color) {
-          const ColorInt colorRef = ColorInt::bgra(v0.col);
-          paint_uniform_rectangle(target, min, max, colorRef);
+          prim.type = SW_PRIM_RECT;
+          prim.texture = nullptr;
+          prim.min = min;
+          prim.max = max;
+          prim.color = ColorInt::bgra(v0.col);
+          // Don't if our rectangle is transparent
+          if (prim.color.a != 0) add_prim(st, prim);
           i += 6;
           continue;
         }
@@ -619,12 +835,17 @@ static void paint_draw_cmd(const PaintTarget &target,
     }
 
     const bool has_texture = (v0.uv != white_uv || v1.uv != white_uv || v2.uv != white_uv);
-    paint_triangle(target, has_texture ? texture : nullptr, pcmd.ClipRect, v0, v1, v2);
+    prim.type = SW_PRIM_TRIANGLE;
+    prim.texture = has_texture ? texture : nullptr;
+    prim.v0 = v0;
+    prim.v1 = v1;
+    prim.v2 = v2;
+    add_prim(st, prim);
     i += 3;
   }
 }
 
-static void paint_draw_list(const PaintTarget &target, const ImDrawList *cmd_list, const SwOptions &options)
+static void bin_draw_list(SwRenderState &st, const ImDrawList *cmd_list, const SwOptions &options)
 {
   const ImDrawIdx *idx_buffer = &cmd_list->IdxBuffer[0];
   const ImDrawVert *vertices = cmd_list->VtxBuffer.Data;
@@ -633,23 +854,98 @@ static void paint_draw_list(const PaintTarget &target, const ImDrawList *cmd_lis
   for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.size(); cmd_i++) {
     const ImDrawCmd &pcmd = cmd_list->CmdBuffer[cmd_i];
     if (pcmd.UserCallback) {
-      pcmd.UserCallback(cmd_list, &pcmd);
+      // Callbacks run on this thread, before anything is painted.
+      if (pcmd.UserCallback != ImDrawCallback_ResetRenderState) pcmd.UserCallback(cmd_list, &pcmd);
     } else {
-      paint_draw_cmd(target, vertices, idx_buffer, pcmd, options, white_uv);
+      bin_draw_cmd(st, vertices, idx_buffer, pcmd, options, white_uv);
     }
     idx_buffer += pcmd.ElemCount;
   }
+}
+
+static void paint_prim(const PaintTarget &target, const SwPrim &prim)
+{
+  switch (prim.type) {
+    case SW_PRIM_TRIANGLE:
+      paint_triangle(target, prim.texture, prim.clip_rect, prim.v0, prim.v1, prim.v2);
+      break;
+    case SW_PRIM_RECT:
+      paint_uniform_rectangle(target, prim.min, prim.max, prim.color);
+      break;
+    case SW_PRIM_TEXTURED_RECT:
+      paint_uniform_textured_rectangle(target, *prim.texture, prim.clip_rect, prim.v0, prim.v1);
+      break;
   }
+}
 
-static void paint_imgui(uint32_t *pixels, ImDrawData *drawData, int fb_width, int fb_height, const SwOptions &options = {})
+// Clears a tile and paints the primitives which touch it, in order.
+static void paint_tile(void *arg)
+{
+  const SwTileJob *job = (const SwTileJob*)arg;
+  const SwRenderState &st = *job->state;
+
+  PaintTarget target = st.target;
+  target.minX = (job->tile % st.tiles_x) * SW_TILE_SIZE;
+  target.minY = (job->tile / st.tiles_x) * SW_TILE_SIZE;
+  target.maxX = std::min(target.minX + SW_TILE_SIZE, target.width);
+  target.maxY = std::min(target.minY + SW_TILE_SIZE, target.height);
+
+  for (int y = target.minY; y < target.maxY; ++y) {
+    fill_span(&target.pixels[y * target.width + target.minX], target.maxX - target.minX, st.clear_color);
+  }
+  for (int i: st.tiles[job->tile].prims) {
+    paint_prim(target, st.prims[i]);
+  }
+}
+
+static void paint_imgui(SwRenderState &st, uint32_t *pixels, ImDrawData *drawData, int fb_width, int fb_height, const SwOptions &options = {})
 {
   if (fb_width <= 0 || fb_height <= 0) return;
 
-  PaintTarget target{ pixels, fb_width, fb_height };
+  st.target = PaintTarget{ pixels, fb_width, fb_height, 0, 0, fb_width, fb_height };
+
+  // Anything left over from the last frame is useless if the surface changed.
+  if (pixels != st.last_pixels || fb_width != st.last_width || fb_height != st.last_height
+      || st.clear_color != st.last_clear_color) {
+    st.invalidate = true;
+  }
+
+  st.tiles_x = (fb_width + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+  st.tiles_y = (fb_height + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+  st.tiles.resize(st.tiles_x * st.tiles_y);
+  for (SwTile &tile: st.tiles) {
+    tile.prims.clear();
+    tile.hash = kHashSeed;
+  }
+  st.prims.clear();
 
   for (int i = 0; i < drawData->CmdListsCount; ++i) {
-    paint_draw_list(target, drawData->CmdLists[i], options);
+    bin_draw_list(st, drawData->CmdLists[i], options);
+  }
+
+  // Only repaint the tiles which changed.
+  st.jobs.clear();
+  for (int i = 0; i < (int)st.tiles.size(); ++i) {
+    SwTile &tile = st.tiles[i];
+    if (st.invalidate || tile.hash != tile.last_hash) {
+      st.jobs.push_back(SwTileJob{ &st, i });
+    }
+    tile.last_hash = tile.hash;
   }
+
+  if (st.parallel_for && st.jobs.size() > 1) {
+    st.parallel_for(paint_tile, st.jobs.data(), sizeof(SwTileJob), st.jobs.size(), st.parallel_user);
+  } else {
+    for (SwTileJob &job: st.jobs) {
+      paint_tile(&job);
+    }
+  }
+
+  st.last_pixels = pixels;
+  st.last_width = fb_width;
+  st.last_height = fb_height;
+  st.last_clear_color = st.clear_color;
+  st.invalidate = false;
 }
 
 /// NEW STUFF
@@ -664,6 +960,7 @@ bool ImGui_ImplSW_Init(SDL_Window* win) {
 
   ImGui_ImplSW_Data* bd = IM_NEW(ImGui_ImplSW_Data)();
   bd->Window = win;
+  bd->State = IM_NEW(SwRenderState)();
   io.BackendRendererUserData = (void*)bd;
   io.BackendRendererName = "imgui_sw";
 
@@ -678,9 +975,32 @@ void ImGui_ImplSW_Shutdown() {
   ImGui_ImplSW_DestroyDeviceObjects();
   io.BackendRendererName = nullptr;
   io.BackendRendererUserData = nullptr;
+  IM_DELETE(bd->State);
   IM_DELETE(bd);
 }
 
+void ImGui_ImplSW_SetParallelFor(ImGui_ImplSW_ParallelFor func, void* user) {
+  ImGui_ImplSW_Data* bd = ImGui_ImplSW_GetBackendData();
+  IM_ASSERT(bd != nullptr);
+
+  bd->State->parallel_for = func;
+  bd->State->parallel_user = user;
+}
+
+void ImGui_ImplSW_SetClearColor(uint32_t color) {
+  ImGui_ImplSW_Data* bd = ImGui_ImplSW_GetBackendData();
+  if (bd == nullptr) return;
+
+  bd->State->clear_color = color;
+}
+
+void ImGui_ImplSW_Invalidate() {
+  ImGui_ImplSW_Data* bd = ImGui_ImplSW_GetBackendData();
+  if (bd == nullptr) return;
+
+  bd->State->invalidate = true;
+}
+
 bool ImGui_ImplSW_NewFrame() {
   ImGui_ImplSW_Data* bd = ImGui_ImplSW_GetBackendData();
   IM_ASSERT(bd != nullptr);
@@ -701,7 +1021,7 @@ void ImGui_ImplSW_RenderDrawData(ImDrawData* draw_data) {
   if (mustLock) {
     if (SDL_LockSurface(surf)!=0) return;
   }
-  paint_imgui((uint32_t*)surf->pixels,draw_data,surf->w,surf->h);
+  paint_imgui(*bd->State,(uint32_t*)surf->pixels,draw_data,surf->w,surf->h);
   // 0xAARRGGBB
   if (mustLock) {
     SDL_UnlockSurface(surf);
@@ -721,6 +1041,7 @@ bool ImGui_ImplSW_CreateFontsTexture() {
   SWTexture* texture = new SWTexture((uint32_t*)tex_data,font_width,font_height,true);
   io.Fonts->SetTexID(texture);
   bd->FontTexture = texture;
+  bd->State->invalidate = true;
 
   return true;
 }
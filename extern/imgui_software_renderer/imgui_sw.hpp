@@ -25,18 +25,22 @@ struct SWTexture
   int width;
   int height;
   bool managed, isAlpha;
+  // must be incremented whenever the pixels change
+  unsigned int revision;
 
   SWTexture(uint32_t* pix, int w, int h, bool a=false):
     pixels(pix),
     width(w),
     height(h),
     managed(false),
-    isAlpha(a) {}
+    isAlpha(a),
+    revision(0) {}
   SWTexture(int w, int h, bool a=false):
     width(w),
     height(h),
     managed(true),
-    isAlpha(a) {
+    isAlpha(a),
+    revision(0) {
     pixels=new uint32_t[width*height];
   }
   ~SWTexture() {
@@ -49,6 +53,16 @@ IMGUI_IMPL_API void     ImGui_ImplSW_Shutdown();
 IMGUI_IMPL_API bool     ImGui_ImplSW_NewFrame();
 IMGUI_IMPL_API void     ImGui_ImplSW_RenderDrawData(ImDrawData* draw_data);
 
+// Runs func on count arguments (args, args+stride, ...) and returns once all of them are done.
+typedef void (*ImGui_ImplSW_ParallelFor)(void (*func)(void*), void* args, size_t stride, size_t count, void* user);
+
+// Tiles are painted in parallel using this function if set.
+IMGUI_IMPL_API void     ImGui_ImplSW_SetParallelFor(ImGui_ImplSW_ParallelFor func, void* user);
+// Sets the color (0xAARRGGBB) tiles are cleared to before painting.
+IMGUI_IMPL_API void     ImGui_ImplSW_SetClearColor(uint32_t color);
+// Forces the whole frame to be repainted next time (e.g. after drawing to the surface directly).
+IMGUI_IMPL_API void     ImGui_ImplSW_Invalidate();
+
 // Called by Init/NewFrame/Shutdown
 IMGUI_IMPL_API bool     ImGui_ImplSW_CreateFontsTexture();
 IMGUI_IMPL_API void     ImGui_ImplSW_DestroyFontsTexture();
@@ -20,12 +20,14 @@
 #include "taAudio.h"
 #include "../ta-log.h"
 
-void TAAudio::setSampleRateChangeCallback(void (*callback)(SampleRateChangeEvent)) {
+void TAAudio::setSampleRateChangeCallback(void (*callback)(void*,SampleRateChangeEvent), void* user) {
   sampleRateChanged=callback;
+  sampleRateChangedUser=user;
 }
 
-void TAAudio::setBufferSizeChangeCallback(void (*callback)(BufferSizeChangeEvent)) {
+void TAAudio::setBufferSizeChangeCallback(void (*callback)(void*,BufferSizeChangeEvent), void* user) {
   bufferSizeChanged=callback;
+  bufferSizeChangedUser=user;
 }
 
 void TAAudio::setCallback(void (*callback)(void*,float**,float**,int,int,unsigned int), void* user) {
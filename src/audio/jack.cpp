@@ -41,13 +41,13 @@ int taJACKProcess(jack_nframes_t nframes, void* inst) {
 
 void TAAudioJACK::onSampleRate(jack_nframes_t rate) {
   if (sampleRateChanged!=NULL) {
-    sampleRateChanged(SampleRateChangeEvent(rate));
+    sampleRateChanged(sampleRateChangedUser,SampleRateChangeEvent(rate));
   }
 }
 
 void TAAudioJACK::onBufferSize(jack_nframes_t bufsize) {
   if (bufferSizeChanged!=NULL) {
-    bufferSizeChanged(BufferSizeChangeEvent(bufsize));
+    bufferSizeChanged(bufferSizeChangedUser,BufferSizeChangeEvent(bufsize));
   }
 }
 
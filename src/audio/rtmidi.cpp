@@ -17,6 +17,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <chrono>
 #include "rtmidi.h"
 #include "../ta-log.h"
 #include "taAudio.h"
@@ -46,14 +47,26 @@ String sanitizePortName(const String& name) {
 bool TAMidiInRtMidi::gather() {
   std::vector<unsigned char> msg;
   if (port==NULL) return false;
+  // RtMidi gives us the time since the previous message.
+  // accumulate it and map it to the steady clock using the smallest observed offset (the one
+  // with the least delivery delay), which slowly creeps up to follow clock drift.
+  double now=std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  if (timeValid) timeOffset+=(now-lastGather)*0.001;
+  lastGather=now;
   try {
     while (true) {
       TAMidiMessage m;
       double t=port->getMessage(&msg);
       if (msg.empty()) break;
 
+      msgTime+=t;
+      if (!timeValid || now-msgTime<timeOffset) {
+        timeOffset=now-msgTime;
+        timeValid=true;
+      }
+
       // parse message
-      m.time=t;
+      m.time=MIN(msgTime+timeOffset,now);
       m.type=msg[0];
       if (m.type!=TA_MIDI_SYSEX && msg.size()>1) {
         memcpy(m.data,msg.data()+1,MIN(msg.size()-1,7));
@@ -113,6 +126,10 @@ bool TAMidiInRtMidi::openDevice(String name) {
       }
     }
     isOpen=portOpen;
+    msgTime=0.0;
+    timeOffset=0.0;
+    lastGather=0.0;
+    timeValid=false;
     if (!portOpen) logW("could not find MIDI in device...");
     return portOpen;
   } catch (RtMidiError& e) {
@@ -23,6 +23,8 @@
 class TAMidiInRtMidi: public TAMidiIn {
   RtMidiIn* port;
   bool isOpen;
+  double msgTime, timeOffset, lastGather;
+  bool timeValid;
   public:
     bool gather();
     bool isDeviceOpen();
@@ -33,7 +35,11 @@ class TAMidiInRtMidi: public TAMidiIn {
     bool init();
     TAMidiInRtMidi():
       port(NULL),
-      isOpen(false) {}
+      isOpen(false),
+      msgTime(0.0),
+      timeOffset(0.0),
+      lastGather(0.0),
+      timeValid(false) {}
 };
 
 class TAMidiOutRtMidi: public TAMidiOut {
@@ -94,6 +94,7 @@ enum TAMidiMessageTypes {
 };
 
 struct TAMidiMessage {
+  // time at which the message was received in seconds (steady clock), or 0 if unknown
   double time;
   unsigned char type;
   unsigned char data[7];
@@ -162,13 +163,15 @@ class TAAudio {
     float** outBufs;
     void (*audioProcCallback)(void*,float**,float**,int,int,unsigned int);
     void* audioProcCallbackUser;
-    void (*sampleRateChanged)(SampleRateChangeEvent);
-    void (*bufferSizeChanged)(BufferSizeChangeEvent);
+    void (*sampleRateChanged)(void*,SampleRateChangeEvent);
+    void (*bufferSizeChanged)(void*,BufferSizeChangeEvent);
+    void* sampleRateChangedUser;
+    void* bufferSizeChangedUser;
   public:
     TAMidiIn* midiIn;
     TAMidiOut* midiOut;
-    void setSampleRateChangeCallback(void (*callback)(SampleRateChangeEvent));
-    void setBufferSizeChangeCallback(void (*callback)(BufferSizeChangeEvent));
+    void setSampleRateChangeCallback(void (*callback)(void*,SampleRateChangeEvent), void* user);
+    void setBufferSizeChangeCallback(void (*callback)(void*,BufferSizeChangeEvent), void* user);
 
     void setCallback(void (*callback)(void*,float**,float**,int,int,unsigned int), void* user);
 
@@ -190,6 +193,8 @@ class TAAudio {
       audioProcCallbackUser(NULL),
       sampleRateChanged(NULL),
       bufferSizeChanged(NULL),
+      sampleRateChangedUser(NULL),
+      bufferSizeChangedUser(NULL),
       midiIn(NULL),
       midiOut(NULL) {}
 
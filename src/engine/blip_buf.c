@@ -7,6 +7,17 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define BLIP_AVX2 1
+#elif defined(__SSE4_1__)
+	#include <smmintrin.h>
+	#define BLIP_SSE41 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define BLIP_NEON 1
+#endif
+
 /* Library Copyright (C) 2003-2009 Shay Green. This library is free software;
 you can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -350,3 +361,242 @@ void blip_add_delta_fast( blip_t* m, unsigned time, int delta )
 	out [7] += delta * delta_unit - delta2;
 	out [8] += delta2;
 }
+
+/* (tildearrow) batched versions of the above. the 16-tap step is done using
+32-bit integer vector multiplies, so the result is bit-exact with
+blip_add_delta(). at high clock rates many deltas land on the same output
+sample, so steps are accumulated in registers and only written back to the
+buffer when the output position changes. */
+
+#if defined(BLIP_AVX2)
+typedef struct { __m256i lo, hi; } step_acc_t;
+
+static void step_begin( step_acc_t* acc, buf_t* out )
+{
+	(void) out;
+	acc->lo = _mm256_setzero_si256();
+	acc->hi = _mm256_setzero_si256();
+}
+
+static void step_add( step_acc_t* acc, int phase, int delta, int delta2 )
+{
+	short const* in  = bl_step [phase];
+	short const* rev = bl_step [phase_count - phase];
+	__m256i const vDelta  = _mm256_set1_epi32( delta );
+	__m256i const vDelta2 = _mm256_set1_epi32( delta2 );
+	__m256i const vRev    = _mm256_setr_epi32( 7, 6, 5, 4, 3, 2, 1, 0 );
+	
+	/* in [0..7], in [8..15] (next phase) */
+	__m256i a = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) in ) );
+	__m256i b = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) (in + half_width) ) );
+	/* rev [7..0], rev [-1..-8] (previous phase) */
+	__m256i c = _mm256_permutevar8x32_epi32( _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) rev ) ), vRev );
+	__m256i d = _mm256_permutevar8x32_epi32( _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) (rev - half_width) ) ), vRev );
+	
+	acc->lo = _mm256_add_epi32( acc->lo, _mm256_add_epi32( _mm256_mullo_epi32( a, vDelta ), _mm256_mullo_epi32( b, vDelta2 ) ) );
+	acc->hi = _mm256_add_epi32( acc->hi, _mm256_add_epi32( _mm256_mullo_epi32( c, vDelta ), _mm256_mullo_epi32( d, vDelta2 ) ) );
+}
+
+static void step_flush( step_acc_t const* acc, buf_t* out )
+{
+	_mm256_storeu_si256( (__m256i*) out, _mm256_add_epi32( _mm256_loadu_si256( (__m256i const*) out ), acc->lo ) );
+	_mm256_storeu_si256( (__m256i*) (out + 8), _mm256_add_epi32( _mm256_loadu_si256( (__m256i const*) (out + 8) ), acc->hi ) );
+}
+#elif defined(BLIP_SSE41)
+typedef struct { __m128i v [4]; } step_acc_t;
+
+static void step_begin( step_acc_t* acc, buf_t* out )
+{
+	(void) out;
+	acc->v [0] = acc->v [1] = acc->v [2] = acc->v [3] = _mm_setzero_si128();
+}
+
+static void step_add( step_acc_t* acc, int phase, int delta, int delta2 )
+{
+	short const* in  = bl_step [phase];
+	short const* rev = bl_step [phase_count - phase];
+	__m128i const vDelta  = _mm_set1_epi32( delta );
+	__m128i const vDelta2 = _mm_set1_epi32( delta2 );
+	int i;
+	
+	for ( i = 0; i < 2; i++ )
+	{
+		__m128i a = _mm_cvtepi16_epi32( _mm_loadl_epi64( (__m128i const*) (in + i*4) ) );
+		__m128i b = _mm_cvtepi16_epi32( _mm_loadl_epi64( (__m128i const*) (in + half_width + i*4) ) );
+		__m128i c = _mm_shuffle_epi32( _mm_cvtepi16_epi32( _mm_loadl_epi64( (__m128i const*) (rev + 4 - i*4) ) ), _MM_SHUFFLE( 0, 1, 2, 3 ) );
+		__m128i d = _mm_shuffle_epi32( _mm_cvtepi16_epi32( _mm_loadl_epi64( (__m128i const*) (rev + 4 - i*4 - half_width) ) ), _MM_SHUFFLE( 0, 1, 2, 3 ) );
+		
+		acc->v [i]     = _mm_add_epi32( acc->v [i],     _mm_add_epi32( _mm_mullo_epi32( a, vDelta ), _mm_mullo_epi32( b, vDelta2 ) ) );
+		acc->v [i + 2] = _mm_add_epi32( acc->v [i + 2], _mm_add_epi32( _mm_mullo_epi32( c, vDelta ), _mm_mullo_epi32( d, vDelta2 ) ) );
+	}
+}
+
+static void step_flush( step_acc_t const* acc, buf_t* out )
+{
+	int i;
+	for ( i = 0; i < 4; i++ )
+		_mm_storeu_si128( (__m128i*) (out + i*4), _mm_add_epi32( _mm_loadu_si128( (__m128i const*) (out + i*4) ), acc->v [i] ) );
+}
+#elif defined(BLIP_NEON)
+typedef struct { int32x4_t v [4]; } step_acc_t;
+
+static void step_begin( step_acc_t* acc, buf_t* out )
+{
+	(void) out;
+	acc->v [0] = acc->v [1] = acc->v [2] = acc->v [3] = vdupq_n_s32( 0 );
+}
+
+static int32x4_t reverse_s32( int32x4_t x )
+{
+	x = vrev64q_s32( x );
+	return vcombine_s32( vget_high_s32( x ), vget_low_s32( x ) );
+}
+
+static void step_add( step_acc_t* acc, int phase, int delta, int delta2 )
+{
+	short const* in  = bl_step [phase];
+	short const* rev = bl_step [phase_count - phase];
+	int i;
+	
+	for ( i = 0; i < 2; i++ )
+	{
+		int32x4_t a = vmovl_s16( vld1_s16( in + i*4 ) );
+		int32x4_t b = vmovl_s16( vld1_s16( in + half_width + i*4 ) );
+		int32x4_t c = reverse_s32( vmovl_s16( vld1_s16( rev + 4 - i*4 ) ) );
+		int32x4_t d = reverse_s32( vmovl_s16( vld1_s16( rev + 4 - i*4 - half_width ) ) );
+		
+		acc->v [i]     = vmlaq_n_s32( vmlaq_n_s32( acc->v [i], a, delta ), b, delta2 );
+		acc->v [i + 2] = vmlaq_n_s32( vmlaq_n_s32( acc->v [i + 2], c, delta ), d, delta2 );
+	}
+}
+
+static void step_flush( step_acc_t const* acc, buf_t* out )
+{
+	int i;
+	for ( i = 0; i < 4; i++ )
+		vst1q_s32( out + i*4, vaddq_s32( vld1q_s32( out + i*4 ), acc->v [i] ) );
+}
+#else
+/* no registers to spare here, so add to the buffer directly */
+typedef struct { buf_t* out; } step_acc_t;
+
+static void step_begin( step_acc_t* acc, buf_t* out )
+{
+	acc->out = out;
+}
+
+static void step_add( step_acc_t* acc, int phase, int delta, int delta2 )
+{
+	short const* in  = bl_step [phase];
+	short const* rev = bl_step [phase_count - phase];
+	buf_t* out = acc->out;
+	
+	out [0] += in[0]*delta + in[half_width+0]*delta2;
+	out [1] += in[1]*delta + in[half_width+1]*delta2;
+	out [2] += in[2]*delta + in[half_width+2]*delta2;
+	out [3] += in[3]*delta + in[half_width+3]*delta2;
+	out [4] += in[4]*delta + in[half_width+4]*delta2;
+	out [5] += in[5]*delta + in[half_width+5]*delta2;
+	out [6] += in[6]*delta + in[half_width+6]*delta2;
+	out [7] += in[7]*delta + in[half_width+7]*delta2;
+	
+	in = rev;
+	out [ 8] += in[7]*delta + in[7-half_width]*delta2;
+	out [ 9] += in[6]*delta + in[6-half_width]*delta2;
+	out [10] += in[5]*delta + in[5-half_width]*delta2;
+	out [11] += in[4]*delta + in[4-half_width]*delta2;
+	out [12] += in[3]*delta + in[3-half_width]*delta2;
+	out [13] += in[2]*delta + in[2-half_width]*delta2;
+	out [14] += in[1]*delta + in[1-half_width]*delta2;
+	out [15] += in[0]*delta + in[0-half_width]*delta2;
+}
+
+static void step_flush( step_acc_t const* acc, buf_t* out )
+{
+	(void) acc;
+	(void) out;
+}
+#endif
+
+int blip_add_deltas( blip_t* m, unsigned time, short const* in, int count, int last )
+{
+	buf_t* const buf = SAMPLES( m ) + m->avail;
+	buf_t* cur = NULL;
+	int const phase_shift = frac_bits - phase_bits;
+	step_acc_t acc;
+	int i;
+	
+	step_begin( &acc, buf );
+	
+	for ( i = 0; i < count; i++ )
+	{
+		unsigned fixed;
+		buf_t* out;
+		int phase, interp, delta, delta2;
+		
+		if ( in [i] == last )
+			continue;
+		
+		delta = in [i] - last;
+		last = in [i];
+		
+		fixed = (unsigned) (((time + i) * m->factor + m->offset) >> pre_shift);
+		out = buf + (fixed >> frac_bits);
+		
+		phase = fixed >> phase_shift & (phase_count - 1);
+		interp = fixed >> (phase_shift - delta_bits) & (delta_unit - 1);
+		delta2 = (delta * interp) >> delta_bits;
+		delta -= delta2;
+		
+		/* Fails if buffer size was exceeded */
+		assert( out <= &SAMPLES( m ) [m->size + end_frame_extra] );
+		
+		if ( out != cur )
+		{
+			if ( cur != NULL )
+				step_flush( &acc, cur );
+			step_begin( &acc, out );
+			cur = out;
+		}
+		
+		step_add( &acc, phase, delta, delta2 );
+	}
+	
+	if ( cur != NULL )
+		step_flush( &acc, cur );
+	
+	return last;
+}
+
+int blip_add_deltas_fast( blip_t* m, unsigned time, short const* in, int count, int last )
+{
+	buf_t* const buf = SAMPLES( m ) + m->avail;
+	int i;
+	
+	for ( i = 0; i < count; i++ )
+	{
+		unsigned fixed;
+		buf_t* out;
+		int interp, delta, delta2;
+		
+		if ( in [i] == last )
+			continue;
+		
+		delta = in [i] - last;
+		last = in [i];
+		
+		fixed = (unsigned) (((time + i) * m->factor + m->offset) >> pre_shift);
+		out = buf + (fixed >> frac_bits);
+		
+		interp = fixed >> (frac_bits - delta_bits) & (delta_unit - 1);
+		delta2 = delta * interp;
+		
+		/* Fails if buffer size was exceeded */
+		assert( out <= &SAMPLES( m ) [m->size + end_frame_extra] );
+		
+		out [7] += delta * delta_unit - delta2;
+		out [8] += delta2;
+	}
+	
+	return last;
+}
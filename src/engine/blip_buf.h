@@ -7,6 +7,7 @@ Sample buffer that resamples from input clock rate to output sample rate */
 
 // MODIFIED by tildearrow:
 // - add option to disable high-pass filter
+// - add blip_add_deltas() and blip_add_deltas_fast() (batched, vectorized)
 
 #ifdef __cplusplus
 	extern "C" {
@@ -41,6 +42,15 @@ void blip_add_delta( blip_t*, unsigned int clock_time, int delta );
 /** Same as blip_add_delta(), but uses faster, lower-quality synthesis. */
 void blip_add_delta_fast( blip_t*, unsigned int clock_time, int delta );
 
+/** (tildearrow) Adds a run of 'count' samples starting at clock_time, one
+sample per clock. 'last' is the previous sample value. A delta is added for
+every sample which differs from the one before it. Returns the last sample
+value. Output is identical to calling blip_add_delta() for each change. */
+int blip_add_deltas( blip_t*, unsigned int clock_time, short const* in, int count, int last );
+
+/** (tildearrow) Same as blip_add_deltas(), but uses blip_add_delta_fast(). */
+int blip_add_deltas_fast( blip_t*, unsigned int clock_time, short const* in, int count, int last );
+
 /** Length of time frame, in clocks, needed to make sample_count additional
 samples available. */
 int blip_clocks_needed( const blip_t*, int sample_count );
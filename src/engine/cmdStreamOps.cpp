@@ -19,6 +19,10 @@
 
 #include "engine.h"
 #include "../ta-log.h"
+#include <errno.h>
+#include <limits.h>
+#include <algorithm>
+#include <unordered_map>
 
 #define WRITE_TICK(x) \
   if (!wroteTick[x]) { \
@@ -198,7 +202,307 @@ void writePackedCommandValues(SafeWriter* w, const DivCommand& c) {
   }
 }
 
-SafeWriter* DivEngine::saveCommand() {
+// subroutine compression
+// repeated runs of tokens (commands and delays with their arguments) within
+// and across channels are moved into subroutines which end in ret (f9).
+// candidates are found with a suffix array over all channels and chosen greedily
+// by the number of bytes they save. this is repeated until nothing is gained,
+// which allows subroutines to call other subroutines.
+
+#define CS_CALL_SIZE 3
+#define CS_MAX_CALL_DEPTH 8
+#define CS_MAX_PASSES 64
+#define CS_MAX_CANDIDATES 256
+
+struct DivCSCandidate {
+  long long gain;
+  int len, lb, rb;
+  DivCSCandidate(long long g, int l, int b, int e):
+    gain(g),
+    len(l),
+    lb(b),
+    rb(e) {}
+};
+
+struct DivCSCompressor {
+  // literal tokens
+  std::vector<String> tokData;
+  std::unordered_map<String,int> tokID;
+  int stopTok;
+  // token sequences. negative values are calls to subroutine -(x+1).
+  std::vector<std::vector<int>> chans;
+  std::vector<std::vector<int>> subs;
+  std::vector<int> subHeight;
+
+  int addToken(const unsigned char* data, size_t len);
+  size_t tokenLen(int tok);
+  int tokenHeight(int tok);
+  bool pass();
+  size_t write(SafeWriter* w, unsigned int* chanOff);
+  DivCSCompressor():
+    stopTok(-1) {}
+};
+
+int DivCSCompressor::addToken(const unsigned char* data, size_t len) {
+  String tok((const char*)data,len);
+  auto it=tokID.find(tok);
+  if (it!=tokID.end()) return it->second;
+  int ret=tokData.size();
+  tokData.push_back(tok);
+  tokID[tok]=ret;
+  if (len==1 && data[0]==0xff) stopTok=ret;
+  return ret;
+}
+
+size_t DivCSCompressor::tokenLen(int tok) {
+  if (tok<0) return CS_CALL_SIZE;
+  return tokData[tok].size();
+}
+
+int DivCSCompressor::tokenHeight(int tok) {
+  if (tok<0) return subHeight[-(tok+1)];
+  return 0;
+}
+
+// Fenwick tree over claimed run starts
+static void csClaimAdd(std::vector<int>& tree, int pos) {
+  for (pos++; pos<=(int)tree.size(); pos+=pos&(-pos)) tree[pos-1]++;
+}
+
+static int csClaimCount(std::vector<int>& tree, int pos) {
+  int ret=0;
+  for (; pos>0; pos-=pos&(-pos)) ret+=tree[pos-1];
+  return ret;
+}
+
+bool DivCSCompressor::pass() {
+  // concatenate channels, separated by unique symbols so that no match crosses them
+  std::vector<int> text;
+  std::vector<int> chanBase;
+  int sep=INT_MIN;
+  for (std::vector<int>& i: chans) {
+    chanBase.push_back(text.size());
+    for (int j: i) {
+      // never factor out the stop command
+      text.push_back((j==stopTok)?(sep++):j);
+    }
+    text.push_back(sep++);
+  }
+  int n=text.size();
+  if (n<2) return false;
+
+  std::vector<size_t> bytePos(n+1);
+  bytePos[0]=0;
+  for (int i=0; i<n; i++) {
+    bytePos[i+1]=bytePos[i]+((text[i]<-(int)subs.size())?0:tokenLen(text[i]));
+  }
+
+  // suffix array (prefix doubling)
+  std::vector<int> sa(n), rank(n), tmp(n);
+  std::vector<int> vals(text);
+  std::sort(vals.begin(),vals.end());
+  vals.erase(std::unique(vals.begin(),vals.end()),vals.end());
+  for (int i=0; i<n; i++) {
+    sa[i]=i;
+    rank[i]=std::lower_bound(vals.begin(),vals.end(),text[i])-vals.begin();
+  }
+  for (int k=1; ; k<<=1) {
+    auto cmp=[&rank,k,n](int a, int b) {
+      if (rank[a]!=rank[b]) return rank[a]<rank[b];
+      int ra=(a+k<n)?rank[a+k]:-1;
+      int rb=(b+k<n)?rank[b+k]:-1;
+      return ra<rb;
+    };
+    std::sort(sa.begin(),sa.end(),cmp);
+    tmp[sa[0]]=0;
+    for (int i=1; i<n; i++) {
+      tmp[sa[i]]=tmp[sa[i-1]]+(cmp(sa[i-1],sa[i])?1:0);
+    }
+    rank.swap(tmp);
+    if (rank[sa[n-1]]==n-1) break;
+  }
+
+  // longest common prefixes (Kasai)
+  std::vector<int> lcp(n+1,0);
+  for (int i=0, h=0; i<n; i++) {
+    if (rank[i]>0) {
+      int j=sa[rank[i]-1];
+      while (i+h<n && j+h<n && text[i+h]==text[j+h]) h++;
+      lcp[rank[i]]=h;
+      if (h>0) h--;
+    } else {
+      h=0;
+    }
+  }
+
+  // every LCP interval is a run which occurs at least twice
+  std::vector<DivCSCandidate> cands;
+  std::vector<std::pair<int,int>> stack;
+  stack.push_back(std::pair<int,int>(0,0));
+  for (int i=1; i<=n; i++) {
+    int lb=i-1;
+    while (lcp[i]<stack.back().first) {
+      std::pair<int,int> top=stack.back();
+      stack.pop_back();
+      lb=top.second;
+      long long count=i-lb;
+      long long bytes=bytePos[sa[lb]+top.first]-bytePos[sa[lb]];
+      long long gain=count*bytes-(count*CS_CALL_SIZE+bytes+1);
+      if (gain>0) cands.push_back(DivCSCandidate(gain,top.first,lb,i-1));
+    }
+    if (lcp[i]>stack.back().first) stack.push_back(std::pair<int,int>(lcp[i],lb));
+  }
+  if (cands.empty()) return false;
+
+  std::sort(cands.begin(),cands.end(),[](const DivCSCandidate& a, const DivCSCandidate& b) {
+    return a.gain>b.gain;
+  });
+  if (cands.size()>CS_MAX_CANDIDATES) cands.erase(cands.begin()+CS_MAX_CANDIDATES,cands.end());
+
+  std::vector<bool> claimed(n,false);
+  std::vector<int> claimStarts(n,0);
+  std::vector<int> replSub(n,-1);
+  std::vector<int> occ, picked;
+  bool ret=false;
+
+  for (DivCSCandidate& i: cands) {
+    int height=0;
+    for (int j=sa[i.lb]; j<sa[i.lb]+i.len; j++) {
+      height=MAX(height,tokenHeight(text[j]));
+    }
+    if (height>=CS_MAX_CALL_DEPTH) continue;
+
+    // pick non-overlapping occurrences which don't collide with earlier picks
+    occ.assign(sa.begin()+i.lb,sa.begin()+i.rb+1);
+    std::sort(occ.begin(),occ.end());
+    picked.clear();
+    int lastEnd=0;
+    for (int j: occ) {
+      if (j<lastEnd) continue;
+      if (claimed[j]) continue;
+      if (csClaimCount(claimStarts,j+i.len)-csClaimCount(claimStarts,j+1)>0) continue;
+      picked.push_back(j);
+      lastEnd=j+i.len;
+    }
+    if (picked.size()<2) continue;
+
+    long long count=picked.size();
+    long long bytes=bytePos[picked[0]+i.len]-bytePos[picked[0]];
+    if (count*bytes-(count*CS_CALL_SIZE+bytes+1)<=0) continue;
+
+    int sub=subs.size();
+    subs.push_back(std::vector<int>(text.begin()+picked[0],text.begin()+picked[0]+i.len));
+    subHeight.push_back(height+1);
+    for (int j: picked) {
+      for (int k=j; k<j+i.len; k++) claimed[k]=true;
+      csClaimAdd(claimStarts,j);
+      replSub[j]=sub;
+    }
+    ret=true;
+  }
+
+  // replace picked runs with calls
+  for (size_t i=0; i<chans.size(); i++) {
+    std::vector<int> newChan;
+    for (size_t j=0; j<chans[i].size();) {
+      int sub=replSub[chanBase[i]+j];
+      if (sub>=0) {
+        newChan.push_back(-(sub+1));
+        j+=subs[sub].size();
+      } else {
+        newChan.push_back(chans[i][j++]);
+      }
+    }
+    chans[i].swap(newChan);
+  }
+
+  return ret;
+}
+
+size_t DivCSCompressor::write(SafeWriter* w, unsigned int* chanOff) {
+  size_t seqCount=chans.size()+subs.size();
+  std::vector<std::vector<int>*> seqs;
+  for (std::vector<int>& i: chans) seqs.push_back(&i);
+  for (std::vector<int>& i: subs) seqs.push_back(&i);
+
+  // lay out channels followed by subroutines.
+  // calls use a 16-bit offset when possible and a 32-bit one otherwise.
+  // calls only ever grow, so this converges.
+  std::vector<std::vector<unsigned char>> callSize(seqCount);
+  std::vector<unsigned int> seqOff(seqCount);
+  for (size_t i=0; i<seqCount; i++) {
+    callSize[i].resize(seqs[i]->size(),CS_CALL_SIZE);
+  }
+  size_t base=w->tell();
+  bool changed=true;
+  while (changed) {
+    changed=false;
+    size_t pos=base;
+    for (size_t i=0; i<seqCount; i++) {
+      seqOff[i]=pos;
+      for (size_t j=0; j<seqs[i]->size(); j++) {
+        int tok=(*seqs[i])[j];
+        pos+=(tok<0)?callSize[i][j]:tokenLen(tok);
+      }
+      // ret
+      if (i>=chans.size()) pos++;
+    }
+    for (size_t i=0; i<seqCount; i++) {
+      pos=seqOff[i];
+      for (size_t j=0; j<seqs[i]->size(); j++) {
+        int tok=(*seqs[i])[j];
+        if (tok<0) {
+          if (callSize[i][j]==CS_CALL_SIZE) {
+            long long rel=(long long)seqOff[chans.size()-(tok+1)]-(long long)(pos+2);
+            if (rel<-32768 || rel>32767) {
+              callSize[i][j]=5;
+              changed=true;
+            }
+          }
+          pos+=callSize[i][j];
+        } else {
+          pos+=tokenLen(tok);
+        }
+      }
+    }
+  }
+
+  for (size_t i=0; i<seqCount; i++) {
+    if (i<chans.size()) chanOff[i]=seqOff[i];
+    for (size_t j=0; j<seqs[i]->size(); j++) {
+      int tok=(*seqs[i])[j];
+      if (tok<0) {
+        unsigned int target=seqOff[chans.size()-(tok+1)];
+        unsigned int pos=w->tell();
+        if (callSize[i][j]==CS_CALL_SIZE) {
+          w->writeC(0xf8);
+          w->writeS((short)(target-(pos+2)));
+        } else {
+          w->writeC(0xf6);
+          w->writeI((int)(target-(pos+4)));
+        }
+      } else {
+        w->write(tokData[tok].data(),tokData[tok].size());
+      }
+    }
+    if (i>=chans.size()) w->writeC(0xf9);
+  }
+
+  return w->tell()-base;
+}
+
+SafeWriter* DivEngine::saveCommand(const char* path) {
+  SafeWriter* w=new SafeWriter;
+  if (path!=NULL) {
+    if (!w->initFile(path)) {
+      lastError=fmt::sprintf("could not open file! (%s)",strerror(errno));
+      delete w;
+      return NULL;
+    }
+  } else {
+    w->init();
+  }
+
   stop();
   repeatPattern=false;
   shallStop=false;
@@ -232,9 +536,6 @@ SafeWriter* DivEngine::saveCommand() {
   memset(sortedCmd,0,16);
   memset(sortedDelay,0,16);
 
-  SafeWriter* w=new SafeWriter;
-  w->init();
-
   // write header
   w->write("FCS",4);
   w->writeI(chans);
@@ -346,6 +647,10 @@ SafeWriter* DivEngine::saveCommand() {
     sortPos++;
   }
 
+  DivCSCompressor comp;
+  std::vector<size_t> tokStart;
+  size_t sizeBefore=0;
+
   for (int i=0; i<chans; i++) {
     chanStream[i]->writeC(0xff);
     // optimize stream
@@ -353,10 +658,12 @@ SafeWriter* DivEngine::saveCommand() {
     SafeReader* reader=oldStream->toReader();
     chanStream[i]=new SafeWriter;
     chanStream[i]->init();
+    tokStart.clear();
 
     while (1) {
       try {
         unsigned char next=reader->readC();
+        tokStart.push_back(chanStream[i]->tell());
         switch (next) {
           case 0xb8: // instrument
           case 0xc0: // pre porta
@@ -457,16 +764,30 @@ SafeWriter* DivEngine::saveCommand() {
 
     oldStream->finish();
     delete oldStream;
-  }
 
-  for (int i=0; i<chans; i++) {
-    chanStreamOff[i]=w->tell();
-    logI("- %d: off %x size %ld",i,chanStreamOff[i],chanStream[i]->size());
-    w->write(chanStream[i]->getFinalBuf(),chanStream[i]->size());
+    // split into tokens for compression
+    std::vector<int> chanToks;
+    unsigned char* buf=chanStream[i]->getFinalBuf();
+    for (size_t j=0; j<tokStart.size(); j++) {
+      size_t tokEnd=(j+1<tokStart.size())?tokStart[j+1]:chanStream[i]->size();
+      chanToks.push_back(comp.addToken(buf+tokStart[j],tokEnd-tokStart[j]));
+    }
+    comp.chans.push_back(chanToks);
+    sizeBefore+=chanStream[i]->size();
+    logD("- %d: size %ld",i,chanStream[i]->size());
     chanStream[i]->finish();
     delete chanStream[i];
   }
 
+  for (int i=0; i<CS_MAX_PASSES; i++) {
+    if (!comp.pass()) break;
+  }
+  size_t sizeAfter=comp.write(w,chanStreamOff);
+  for (int i=0; i<chans; i++) {
+    logD("- %d: off %x",i,chanStreamOff[i]);
+  }
+  logI("command stream: %d bytes before compression, %d after (%d subroutines)",(int)sizeBefore,(int)sizeAfter,(int)comp.subs.size());
+
   w->seek(8,SEEK_SET);
   for (int i=0; i<chans; i++) {
     w->writeI(chanStreamOff[i]);
@@ -130,6 +130,7 @@ bool DivEngine::getConfBool(String key, bool fallback) {
 }
 
 int DivEngine::getConfInt(String key, int fallback) {
+  if (confReadLog!=NULL) confReadLog->push_back(key);
   return conf.getInt(key,fallback);
 }
 
@@ -28,8 +28,9 @@
 
 // in-pattern
 #define DIV_MAX_ROWS 256
-#define DIV_MAX_COLS 32
 #define DIV_MAX_EFFECTS 8
+// note, octave, instrument, volume and effects
+#define DIV_MAX_COLS (4+DIV_MAX_EFFECTS*2)
 
 // sample related
 #define DIV_MAX_SAMPLE_TYPE 4
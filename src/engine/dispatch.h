@@ -628,18 +628,34 @@ class DivDispatch {
     virtual int getRegisterPoolDepth();
 
     /**
-     * get this dispatch's state. DO NOT IMPLEMENT YET.
-     * @return a pointer to the dispatch's state. must be deallocated manually!
+     * get this dispatch's state. this is used by the seek keyframe cache.
+     * only the playback state needs to be saved (channels, macros and so on).
+     * chip state is not necessary since register writes are skipped while seeking
+     * and forceIns() is called afterwards.
+     * @return a pointer to the dispatch's state, or NULL if this dispatch does
+     * not support state saves. must be deallocated using freeState()!
      */
     virtual void* getState();
 
     /**
-     * set this dispatch's state. DO NOT IMPLEMENT YET.
-     * @param state a pointer to a state pertaining to this dispatch,
-     * or NULL if this dispatch does not support state saves.
+     * set this dispatch's state. this is called after reset().
+     * @param state a pointer to a state returned by getState().
      */
     virtual void setState(void* state);
 
+    /**
+     * overwrite a state returned by getState() with this dispatch's current state.
+     * this must not allocate, as it is called from the audio thread in pipelined rendering.
+     * @param state the state.
+     */
+    virtual void saveState(void* state);
+
+    /**
+     * free a state returned by getState().
+     * @param state the state.
+     */
+    virtual void freeState(void* state);
+
     /**
      * mute a channel.
      * @param ch the channel to mute.
@@ -93,6 +93,7 @@
 #include "platform/dummy.h"
 #include "../ta-log.h"
 #include "song.h"
+#include <chrono>
 
 void DivDispatchContainer::setRates(double gotRate) {
   int outs=dispatch->getOutputCount();
@@ -102,6 +103,7 @@ void DivDispatchContainer::setRates(double gotRate) {
     blip_set_rates(bb[i],dispatch->rate,gotRate);
   }
   rateMemory=gotRate;
+  if (bufSizeMemory>0) prepare(bufSizeMemory);
 }
 
 void DivDispatchContainer::setQuality(bool lowQual, bool dcHiPass) {
@@ -148,6 +150,21 @@ void DivDispatchContainer::grow(size_t size) {
   } \
   if (mustClear) clear(); \
 
+void DivDispatchContainer::prepare(size_t bufSize) {
+  if (dispatch==NULL) return;
+  bufSizeMemory=bufSize;
+  CHECK_MISSING_BUFS;
+
+  // make sure nextBuf() won't have to grow the input buffers
+  if (rateMemory>0.0) {
+    size_t needed=(size_t)ceil(dispatch->rate*(double)bufSize/rateMemory)+256;
+    if (needed>bbInLen) {
+      logV("growing bbIn to %d",needed);
+      grow(needed);
+    }
+  }
+}
+
 void DivDispatchContainer::acquire(size_t offset, size_t count) {
   CHECK_MISSING_BUFS;
 
@@ -162,7 +179,10 @@ void DivDispatchContainer::acquire(size_t offset, size_t count) {
       }
     }
   }
+  std::chrono::steady_clock::time_point ts_begin;
+  if (profile) ts_begin=std::chrono::steady_clock::now();
   dispatch->acquire(bbInMapped,count);
+  if (profile) perfAcquire+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-ts_begin).count();
 }
 
 void DivDispatchContainer::flush(size_t count) {
@@ -176,6 +196,8 @@ void DivDispatchContainer::flush(size_t count) {
 
 void DivDispatchContainer::fillBuf(size_t runtotal, size_t offset, size_t size) {
   CHECK_MISSING_BUFS;
+  std::chrono::steady_clock::time_point ts_begin;
+  if (profile) ts_begin=std::chrono::steady_clock::now();
 
   if (dcOffCompensation && runtotal>0) {
     dcOffCompensation=false;
@@ -186,28 +208,15 @@ void DivDispatchContainer::fillBuf(size_t runtotal, size_t offset, size_t size)
       }
     }
   }
-  if (lowQuality) {
-    for (int i=0; i<outs; i++) {
-      if (bbIn[i]==NULL) continue;
-      if (bb[i]==NULL) continue;
-      for (size_t j=0; j<runtotal; j++) {
-        if (bbIn[i][j]==temp[i]) continue;
-        temp[i]=bbIn[i][j];
-        blip_add_delta_fast(bb[i],j,temp[i]-prevSample[i]);
-        prevSample[i]=temp[i];
-      }
-    }
-  } else {
-    for (int i=0; i<outs; i++) {
-      if (bbIn[i]==NULL) continue;
-      if (bb[i]==NULL) continue;
-      for (size_t j=0; j<runtotal; j++) {
-        if (bbIn[i][j]==temp[i]) continue;
-        temp[i]=bbIn[i][j];
-        blip_add_delta(bb[i],j,temp[i]-prevSample[i]);
-        prevSample[i]=temp[i];
-      }
+  for (int i=0; i<outs; i++) {
+    if (bbIn[i]==NULL) continue;
+    if (bb[i]==NULL) continue;
+    if (lowQuality) {
+      prevSample[i]=blip_add_deltas_fast(bb[i],0,bbIn[i],runtotal,prevSample[i]);
+    } else {
+      prevSample[i]=blip_add_deltas(bb[i],0,bbIn[i],runtotal,prevSample[i]);
     }
+    temp[i]=prevSample[i];
   }
 
   for (int i=0; i<outs; i++) {
@@ -216,6 +225,7 @@ void DivDispatchContainer::fillBuf(size_t runtotal, size_t offset, size_t size)
     blip_end_frame(bb[i],runtotal);
     blip_read_samples(bb[i],bbOut[i]+offset,size,0);
   }
+  if (profile) perfFill+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-ts_begin).count();
   /*if (totalRead<(int)size && totalRead>0) {
     for (size_t i=totalRead; i<size; i++) {
       bbOut[0][i]=bbOut[0][totalRead-1];//bbOut[0][totalRead];
@@ -235,11 +245,55 @@ void DivDispatchContainer::clear() {
   }
 }
 
-void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, const DivConfig& flags, bool isRender) {
-  // quit if we already initialized
-  if (dispatch!=NULL) return;
+thread_local float DivDispatchContainer::pipeHz=0.0f;
+
+void DivDispatchContainer::pipeBegin() {
+  if (shadow==NULL || pipelined) return;
+  // bring the shadow up to date and let the sequencer talk to it.
+  // the real dispatch gets the same calls later in pipeRender().
+  dispatch->saveState(pipeState);
+  shadow->setState(pipeState);
+  shadow->setSkipRegisterWrites(true);
+
+  DivDispatch* real=dispatch;
+  dispatch=shadow;
+  shadow=real;
+  pipeEvents.clear();
+  pipelined=true;
+}
+
+void DivDispatchContainer::pipeEnd() {
+  if (!pipelined) return;
+  DivDispatch* real=shadow;
+  shadow=dispatch;
+  dispatch=real;
+  pipelined=false;
+}
+
+void DivDispatchContainer::pipeRender() {
+  for (size_t j=0; j<pipeEvents.size(); j++) {
+    DivPipeEvent& i=pipeEvents[j];
+    switch (i.type) {
+      case DIV_PIPE_ACQUIRE:
+        acquire(i.offset,i.len);
+        break;
+      case DIV_PIPE_COMMAND:
+        pipeHz=i.hz;
+        dispatch->dispatch(i.cmd);
+        break;
+      case DIV_PIPE_TICK:
+        pipeHz=i.hz;
+        dispatch->tick(i.sysTick);
+        break;
+    }
+  }
+  pipeHz=0.0f;
+  pipeEvents.clear();
+}
+
+static DivDispatch* newDispatch(DivSystem sys, DivEngine* eng, bool isRender) {
+  DivDispatch* dispatch=NULL;
 
-  // initialize chip
   switch (sys) {
     case DIV_SYSTEM_YMU759:
       dispatch=new DivPlatformOPL;
@@ -768,8 +822,28 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
       dispatch=new DivPlatformDummy;
       break;
   }
+  return dispatch;
+}
+
+void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, const DivConfig& flags, bool isRender) {
+  // quit if we already initialized
+  if (dispatch!=NULL) return;
+
+  // initialize chip
+  dispatch=newDispatch(sys,eng,isRender);
   dispatch->init(eng,chanCount,gotRate,flags);
 
+  // create a copy for pipelined rendering if the chip can save its state
+  // (currently PCE, SN76489, Game Boy, OPM, OPN2 and OPL)
+  if (eng->getConfInt("renderPipeline",0)) {
+    pipeState=dispatch->getState();
+    if (pipeState!=NULL) {
+      shadow=newDispatch(sys,eng,isRender);
+      shadow->init(eng,chanCount,gotRate,flags);
+      shadow->setSkipRegisterWrites(true);
+    }
+  }
+
   // initialize output buffers
   int outs=dispatch->getOutputCount();
   bbInLen=32768;
@@ -791,9 +865,21 @@ void DivDispatchContainer::init(DivSystem sys, DivEngine* eng, int chanCount, do
 
 void DivDispatchContainer::quit() {
   if (dispatch==NULL) return;
+  if (pipelined) pipeEnd();
+  if (pipeState!=NULL) {
+    dispatch->freeState(pipeState);
+    pipeState=NULL;
+  }
   dispatch->quit();
   delete dispatch;
   dispatch=NULL;
+  sampleKey=0;
+  if (shadow!=NULL) {
+    shadow->quit();
+    delete shadow;
+    shadow=NULL;
+  }
+  pipeEvents.clear();
 
   for (int i=0; i<DIV_MAX_OUTPUTS; i++) {
     if (bbOut[i]!=NULL) {
@@ -810,4 +896,5 @@ void DivDispatchContainer::quit() {
     }
   }
   bbInLen=0;
+  bufSizeMemory=0;
 }
@@ -42,7 +42,20 @@
 #include <fmt/printf.h>
 
 void process(void* u, float** in, float** out, int inChans, int outChans, unsigned int size) {
+  divNoAllocBegin();
   ((DivEngine*)u)->nextBuf(in,out,inChans,outChans,size);
+  divNoAllocEnd();
+}
+
+void bufferSizeChanged(void* u, BufferSizeChangeEvent ev) {
+  ((DivEngine*)u)->changeBufSize(ev.bufsize);
+}
+
+void DivEngine::changeBufSize(unsigned int size) {
+  logV("buffer size changed to %d",size);
+  BUSY_BEGIN;
+  prepareBuffers(size);
+  BUSY_END;
 }
 
 const char* DivEngine::getEffectDesc(unsigned char effect, int chan, bool notNull) {
@@ -195,7 +208,7 @@ void DivEngine::walkSong(int& loopOrder, int& loopRow, int& loopEnd) {
   int nextRow=0;
   int effectVal=0;
   int lastSuspectedLoopEnd=-1;
-  DivPattern* pat[DIV_MAX_CHANS];
+  const DivPattern* pat[DIV_MAX_CHANS];
   unsigned char wsWalked[8192];
   memset(wsWalked,0,8192);
   for (int i=0; i<curSubSong->ordersLen; i++) {
@@ -274,6 +287,7 @@ double DivEngine::benchmarkPlayback() {
   curOrder=0;
   prevOrder=0;
   remainingLoops=1;
+  prepareBuffers(EXPORT_BUFSIZE);
   playSub(false);
 
   std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
@@ -295,6 +309,8 @@ double DivEngine::benchmarkPlayback() {
 
 double DivEngine::benchmarkSeek() {
   double t[20];
+  bool oldSeekCache=seekCache;
+  seekCache=false;
   curOrder=curSubSong->ordersLen-1;
   prevOrder=curSubSong->ordersLen-1;
 
@@ -318,9 +334,552 @@ double DivEngine::benchmarkSeek() {
   tAvg/=20.0;
 
   printf("[RESULT] min %fs max %fs average %fs\n",tMin,tMax,tAvg);
+
+  // now with seek keyframes (first seek is cold, the rest are warm)
+  seekCache=true;
+  clearSeekCache();
+  for (int i=0; i<20; i++) {
+    curOrder=curSubSong->ordersLen-1;
+    std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+    playSub(false);
+    std::chrono::high_resolution_clock::time_point timeEnd=std::chrono::high_resolution_clock::now();
+    t[i]=(double)(std::chrono::duration_cast<std::chrono::microseconds>(timeEnd-timeStart).count())/1000000.0;
+    printf("[#%d keyframes] %fs\n",i+1,t[i]);
+  }
+
+  if (seekCacheUnsupported) {
+    printf("[RESULT] keyframes: not supported by one or more chips in this song\n");
+  } else {
+    double wMin=DBL_MAX;
+    double wMax=0.0;
+    double wAvg=0.0;
+    for (int i=1; i<20; i++) {
+      if (t[i]<wMin) wMin=t[i];
+      if (t[i]>wMax) wMax=t[i];
+      wAvg+=t[i];
+    }
+    wAvg/=19.0;
+    printf("[RESULT] keyframes: %d cold %fs warm min %fs max %fs average %fs\n",(int)seekKeyframes.size(),t[0],wMin,wMax,wAvg);
+  }
+
+  clearSeekCache();
+  seekCache=oldSeekCache;
   return tAvg;
 }
 
+#define BLIP_BENCH_RATE 7670453.0
+#define BLIP_BENCH_SIZE 2048
+#define BLIP_BENCH_ROUNDS 2000
+
+double DivEngine::benchmarkBlip() {
+  // OPN2-like clock rate, one output sample per 174 input samples
+  // tested twice: every sample changing (worst case) and 1 in 8 changing
+  blip_buffer_t* bb=blip_new(BLIP_BENCH_SIZE);
+  short* outBuf=new short[BLIP_BENCH_SIZE];
+  double ret=0;
+
+  blip_set_rates(bb,BLIP_BENCH_RATE,44100);
+  int len=blip_clocks_needed(bb,BLIP_BENCH_SIZE/2);
+  short* inBuf=new short[len];
+
+  for (int density=0; density<2; density++) {
+    unsigned int x=1;
+    short val=0;
+    for (int i=0; i<len; i++) {
+      x=x*1103515245+12345;
+      if (density==0 || (x&0x70000)==0) val=(short)(x>>16);
+      inBuf[i]=val;
+    }
+
+    double times[4];
+    for (int mode=0; mode<4; mode++) {
+      int last=0;
+      blip_clear(bb);
+      std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+      for (int j=0; j<BLIP_BENCH_ROUNDS; j++) {
+        switch (mode) {
+          case 0:
+            for (int i=0; i<len; i++) {
+              if (inBuf[i]==last) continue;
+              blip_add_delta(bb,i,inBuf[i]-last);
+              last=inBuf[i];
+            }
+            break;
+          case 1:
+            for (int i=0; i<len; i++) {
+              if (inBuf[i]==last) continue;
+              blip_add_delta_fast(bb,i,inBuf[i]-last);
+              last=inBuf[i];
+            }
+            break;
+          case 2:
+            last=blip_add_deltas(bb,0,inBuf,len,last);
+            break;
+          case 3:
+            last=blip_add_deltas_fast(bb,0,inBuf,len,last);
+            break;
+        }
+        blip_end_frame(bb,len);
+        blip_read_samples(bb,outBuf,BLIP_BENCH_SIZE,0);
+      }
+      std::chrono::high_resolution_clock::time_point timeEnd=std::chrono::high_resolution_clock::now();
+      times[mode]=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/((double)BLIP_BENCH_ROUNDS*len);
+    }
+
+    printf("[RESULT] %s: blip_add_delta %fns blip_add_delta_fast %fns blip_add_deltas %fns blip_add_deltas_fast %fns per input sample\n",density?"sparse":"dense",times[0],times[1],times[2],times[3]);
+    if (density==0) ret=times[2];
+  }
+
+  delete[] inBuf;
+  delete[] outBuf;
+  blip_delete(bb);
+  return ret;
+}
+
+#define RESAMPLE_BENCH_LEN 1048576
+#define RESAMPLE_BENCH_FREQ 997.0
+
+struct DivResampleBenchCase {
+  const char* name;
+  double sRate, tRate;
+};
+
+// resample a sine with every filter at a few ratios.
+// quality is measured as the ratio between the sine and everything else in
+// the output (fitted to the expected frequency, so that delay doesn't matter).
+double DivEngine::benchmarkResample() {
+  const char* filterNames[]={
+    "none", "linear", "cubic", "blep", "sinc", "best", "poly-fast", "poly", "poly-hq"
+  };
+  const DivResampleBenchCase cases[]={
+    {"32000->44100 (up)", 32000.0, 44100.0},
+    {"44100->22050 (down 2:1)", 44100.0, 22050.0},
+    {"44100->8000 (down)", 44100.0, 8000.0},
+    {"44100->31250.5 (irrational)", 44100.0, 31250.5}
+  };
+  double ret=0;
+
+  for (const DivResampleBenchCase& c: cases) {
+    for (int filter=DIV_RESAMPLE_NONE; filter<=DIV_RESAMPLE_POLYPHASE_HQ; filter++) {
+      DivSample* sample=new DivSample;
+      sample->depth=DIV_SAMPLE_DEPTH_16BIT;
+      sample->init(RESAMPLE_BENCH_LEN);
+      for (int i=0; i<RESAMPLE_BENCH_LEN; i++) {
+        sample->data16[i]=16384.0*sin(2.0*M_PI*RESAMPLE_BENCH_FREQ*(double)i/c.sRate);
+      }
+
+      std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+      bool result=sample->resample(c.sRate,c.tRate,filter);
+      std::chrono::high_resolution_clock::time_point timeEnd=std::chrono::high_resolution_clock::now();
+      double nsPerSample=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/(double)RESAMPLE_BENCH_LEN;
+
+      if (!result) {
+        printf("[RESULT] %s %s: failed\n",c.name,filterNames[filter]);
+        delete sample;
+        continue;
+      }
+
+      // fit a sine at the test frequency, away from the edges
+      double w=2.0*M_PI*RESAMPLE_BENCH_FREQ/c.tRate;
+      int begin=1024;
+      int end=(int)sample->samples-1024;
+      double sinSum=0, cosSum=0;
+      for (int i=begin; i<end; i++) {
+        sinSum+=sample->data16[i]*sin(w*i);
+        cosSum+=sample->data16[i]*cos(w*i);
+      }
+      double a=2.0*sinSum/(double)(end-begin);
+      double b=2.0*cosSum/(double)(end-begin);
+      double signal=0, noise=0;
+      for (int i=begin; i<end; i++) {
+        double fit=a*sin(w*i)+b*cos(w*i);
+        double err=sample->data16[i]-fit;
+        signal+=fit*fit;
+        noise+=err*err;
+      }
+      double snr=(noise>0)?(10.0*log10(signal/noise)):INFINITY;
+
+      printf("[RESULT] %s %s: %fns per sample, SNR %.1fdB\n",c.name,filterNames[filter],nsPerSample,snr);
+      if (filter==DIV_RESAMPLE_POLYPHASE) ret+=nsPerSample;
+      delete sample;
+    }
+  }
+  return ret/(double)(sizeof(cases)/sizeof(cases[0]));
+}
+
+// length of audio rendered for every chip/core combination
+#define CORE_BENCH_SECONDS 5
+
+// quote and escape a string for the JSON outputs below
+static String jsonString(const char* str) {
+  String ret="\"";
+  for (const char* i=str; *i; i++) {
+    unsigned char c=*i;
+    if (c=='"' || c=='\\') {
+      ret+='\\';
+      ret+=c;
+    } else if (c<0x20) {
+      ret+=fmt::sprintf("\\u%.4x",c);
+    } else {
+      ret+=c;
+    }
+  }
+  ret+='"';
+  return ret;
+}
+
+struct DivCoreBenchDef {
+  const char* key;
+  int count;
+  const char* names[4];
+};
+
+// selectable emulation cores (see settings.cpp)
+static const DivCoreBenchDef coreBenchDefs[]={
+  {"arcadeCore",2,{"ymfm","Nuked-OPM"}},
+  {"ym2612Core",3,{"Nuked-OPN2","ymfm","YMF276-LLE"}},
+  {"snCore",2,{"MAME","Nuked-PSG Mod"}},
+  {"nesCore",2,{"puNES","NSFplay"}},
+  {"fdsCore",2,{"puNES","NSFplay"}},
+  {"c64Core",3,{"reSID","reSIDfp","dSID"}},
+  {"pokeyCore",2,{"Atari800","ASAP"}},
+  {"opn1Core",3,{"ymfm","Nuked-OPN2+ymfm","YM2608-LLE"}},
+  {"opnaCore",3,{"ymfm","Nuked-OPN2+ymfm","YM2608-LLE"}},
+  {"opnbCore",3,{"ymfm","Nuked-OPN2+ymfm","YM2608-LLE"}},
+  {"opl2Core",3,{"Nuked-OPL3","ymfm","YM3812-LLE"}},
+  {"opl3Core",3,{"Nuked-OPL3","ymfm","YMF262-LLE"}},
+  {"esfmCore",2,{"ESFMu","ESFMu (fast)"}},
+  {"opllCore",2,{"Nuked-OPLL","emu2413"}},
+  {"ayCore",2,{"MAME","AtomicSSG"}},
+  {NULL,0,{NULL}}
+};
+
+struct DivCoreBenchResult {
+  DivSystem sys;
+  const char* key;
+  int value;
+  const char* coreName;
+  double samplesPerSec, realtime;
+};
+
+void DivEngine::setupBenchSong(DivSystem sys) {
+  quitDispatch();
+  BUSY_BEGIN;
+  saveLock.lock();
+  song.unload();
+  song=DivSong();
+  changeSong(0);
+
+  song.system[0]=sys;
+  song.systemVol[0]=1.0f;
+  song.systemPan[0]=0.0f;
+  song.systemPanFR[0]=0.0f;
+  song.systemFlags[0].clear();
+  song.systemLen=1;
+  song.systemName=getSystemName(sys);
+
+  DivInstrument* ins=new DivInstrument;
+  ins->type=sysDefs[sys]->chanInsType[0][0];
+  song.ins.push_back(ins);
+  song.insLen=1;
+
+  // a note every 8 rows on every channel
+  for (int i=0; i<sysDefs[sys]->channels; i++) {
+    DivPattern* pat=curSubSong->pat[i].getPattern(0,true);
+    for (int j=0; j<curSubSong->patLen; j+=8) {
+      pat->data[j][0]=1+((j/8+i*3)%12);
+      pat->data[j][1]=3;
+      pat->data[j][2]=0;
+    }
+  }
+
+  recalcChans();
+  saveLock.unlock();
+  BUSY_END;
+}
+
+bool DivEngine::benchmarkCores(const char* jsonPath) {
+  std::vector<DivCoreBenchResult> results;
+  float* outBuf[2];
+  outBuf[0]=new float[EXPORT_BUFSIZE];
+  outBuf[1]=new float[EXPORT_BUFSIZE];
+  size_t target=got.rate*CORE_BENCH_SECONDS;
+
+  for (int i=0; i<DIV_MAX_CHIP_DEFS; i++) {
+    if (sysDefs[i]==NULL) continue;
+    if (sysDefs[i]->isCompound) continue;
+    DivSystem sys=(DivSystem)i;
+
+    // find out which core settings this chip uses
+    std::vector<String> readKeys;
+    std::vector<const DivCoreBenchDef*> defs;
+    setupBenchSong(sys);
+    confReadLog=&readKeys;
+    initDispatch();
+    confReadLog=NULL;
+    for (const DivCoreBenchDef* j=coreBenchDefs; j->key!=NULL; j++) {
+      for (String& k: readKeys) {
+        if (k==j->key) {
+          defs.push_back(j);
+          break;
+        }
+      }
+    }
+
+    // one run per core (or a single run if there's only one)
+    std::vector<std::pair<const DivCoreBenchDef*,int>> variants;
+    if (defs.empty()) {
+      variants.push_back(std::pair<const DivCoreBenchDef*,int>(NULL,0));
+    } else {
+      for (const DivCoreBenchDef* j: defs) {
+        for (int k=0; k<j->count; k++) {
+          variants.push_back(std::pair<const DivCoreBenchDef*,int>(j,k));
+        }
+      }
+    }
+
+    for (auto& j: variants) {
+      bool hadKey=false;
+      int oldValue=0;
+      if (j.first!=NULL) {
+        hadKey=conf.has(j.first->key);
+        oldValue=conf.getInt(j.first->key,0);
+        conf.set(j.first->key,j.second);
+      }
+
+      quitDispatch();
+      initDispatch();
+      prepareBuffers(EXPORT_BUFSIZE);
+      BUSY_BEGIN;
+      renderSamples();
+      BUSY_END;
+
+      curOrder=0;
+      prevOrder=0;
+      remainingLoops=-1;
+      playSub(false);
+
+      size_t rendered=0;
+      std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+      while (playing && rendered<target) {
+        nextBuf(NULL,outBuf,0,2,EXPORT_BUFSIZE);
+        rendered+=EXPORT_BUFSIZE;
+      }
+      std::chrono::high_resolution_clock::time_point timeEnd=std::chrono::high_resolution_clock::now();
+      stop();
+
+      double t=(double)(std::chrono::duration_cast<std::chrono::microseconds>(timeEnd-timeStart).count())/1000000.0;
+      if (t<=0.0) t=0.000001;
+
+      DivCoreBenchResult r;
+      r.sys=sys;
+      r.key=(j.first==NULL)?NULL:j.first->key;
+      r.value=j.second;
+      r.coreName=(j.first==NULL)?NULL:j.first->names[j.second];
+      r.samplesPerSec=(double)rendered/t;
+      r.realtime=r.samplesPerSec/(double)got.rate;
+      results.push_back(r);
+
+      if (r.coreName==NULL) {
+        printf("[RESULT] %s: %.0f samples/s (%.2fx realtime)\n",getSystemName(sys),r.samplesPerSec,r.realtime);
+      } else {
+        printf("[RESULT] %s (%s): %.0f samples/s (%.2fx realtime)\n",getSystemName(sys),r.coreName,r.samplesPerSec,r.realtime);
+      }
+
+      if (j.first!=NULL) {
+        if (hadKey) {
+          conf.set(j.first->key,oldValue);
+        } else {
+          conf.remove(j.first->key);
+        }
+      }
+    }
+    quitDispatch();
+  }
+
+  delete[] outBuf[0];
+  delete[] outBuf[1];
+
+  if (jsonPath==NULL) return true;
+
+  FILE* f=ps_fopen(jsonPath,"wb");
+  if (f==NULL) {
+    logE("could not open benchmark output file! (%s)",strerror(errno));
+    return false;
+  }
+  fprintf(f,"{\n  \"version\": %s,\n  \"rate\": %d,\n  \"seconds\": %d,\n  \"bufsize\": %d,\n  \"results\": [\n",jsonString(DIV_VERSION).c_str(),(int)got.rate,CORE_BENCH_SECONDS,EXPORT_BUFSIZE);
+  for (size_t i=0; i<results.size(); i++) {
+    DivCoreBenchResult& r=results[i];
+    fprintf(f,"    {\"system\": %s, \"id\": %d, ",jsonString(getSystemName(r.sys)).c_str(),sysDefs[r.sys]->id);
+    if (r.key==NULL) {
+      fprintf(f,"\"setting\": null, \"value\": null, \"core\": null, ");
+    } else {
+      fprintf(f,"\"setting\": %s, \"value\": %d, \"core\": %s, ",jsonString(r.key).c_str(),r.value,jsonString(r.coreName).c_str());
+    }
+    fprintf(f,"\"samplesPerSec\": %.0f, \"realtime\": %.4f}%s\n",r.samplesPerSec,r.realtime,(i<results.size()-1)?",":"");
+  }
+  fprintf(f,"  ]\n}\n");
+  fclose(f);
+  logI("results written to %s.",jsonPath);
+  return true;
+}
+
+DivPerfStats DivEngine::getPerfStats(DivPerfPhases phase, int chip) {
+  if (phase<0 || phase>=DIV_PERF_MAX) return DivPerfStats();
+  if (chip<0) return perf[phase].getStats();
+  if (chip>=DIV_MAX_CHIPS) return DivPerfStats();
+  switch (phase) {
+    case DIV_PERF_ACQUIRE:
+      return perfChip[chip][0].getStats();
+    case DIV_PERF_FILLBUF:
+      return perfChip[chip][1].getStats();
+    default:
+      break;
+  }
+  return DivPerfStats();
+}
+
+void DivEngine::resetPerfStats() {
+  for (int i=0; i<DIV_PERF_MAX; i++) {
+    perf[i].reset();
+  }
+  for (int i=0; i<DIV_MAX_CHIPS; i++) {
+    perfChip[i][0].reset();
+    perfChip[i][1].reset();
+  }
+}
+
+void DivEngine::setProfiling(bool enable) {
+  perfProfiling=enable;
+}
+
+bool DivEngine::getProfiling() {
+  return perfProfiling;
+}
+
+void DivEngine::setPerfTrace(bool enable) {
+  BUSY_BEGIN;
+  perfTrace=enable;
+  perfFrames.clear();
+  perfFramesDropped=0;
+  if (enable) {
+    perfFrames.reserve(DIV_PERF_TRACE_MAX);
+  } else {
+    perfFrames.shrink_to_fit();
+  }
+  BUSY_END;
+}
+
+// statistics of a whole trace column
+static DivPerfStats perfTraceStats(std::vector<unsigned int>& vals) {
+  DivPerfStats ret;
+  if (vals.empty()) return ret;
+  uint64_t sum=0;
+  for (unsigned int i: vals) {
+    sum+=i;
+  }
+  ret.count=vals.size();
+  ret.last=vals.back();
+  ret.avg=sum/vals.size();
+  size_t p99Pos=(vals.size()*99)/100;
+  if (p99Pos>=vals.size()) p99Pos=vals.size()-1;
+  std::nth_element(vals.begin(),vals.begin()+p99Pos,vals.end());
+  ret.p99=vals[p99Pos];
+  ret.min=*std::min_element(vals.begin(),vals.end());
+  return ret;
+}
+
+static String perfStatsJSON(const DivPerfStats& s) {
+  return fmt::sprintf("{\"min\": %u, \"avg\": %u, \"p99\": %u}",s.min,s.avg,s.p99);
+}
+
+bool DivEngine::writePerfTrace(const char* path) {
+  FILE* f=ps_fopen(path,"wb");
+  if (f==NULL) {
+    logE("could not open profile file! (%s)",strerror(errno));
+    return false;
+  }
+
+  BUSY_BEGIN;
+  if (perfFramesDropped>0) {
+    logW("the profiling trace is full! %d buffers were not recorded.",perfFramesDropped);
+  }
+  String pathStr=path;
+  bool isJSON=(pathStr.size()>=5 && pathStr.substr(pathStr.size()-5)==".json");
+  int chipCount=song.systemLen;
+
+  if (isJSON) {
+    std::vector<unsigned int> vals;
+    vals.reserve(perfFrames.size());
+
+    fprintf(f,"{\n  \"unit\": \"ns\",\n  \"buffers\": %d,\n  \"chips\": [",(int)perfFrames.size());
+    for (int i=0; i<chipCount; i++) {
+      fprintf(f,"%s%s",(i>0)?", ":"",jsonString(getSystemName(song.system[i])).c_str());
+    }
+    fprintf(f,"],\n  \"summary\": {\n");
+    for (int i=0; i<DIV_PERF_MAX; i++) {
+      vals.clear();
+      for (DivPerfFrame& j: perfFrames) {
+        vals.push_back(j.phase[i]);
+      }
+      fprintf(f,"    \"%s\": %s,\n",getPerfPhaseName((DivPerfPhases)i),perfStatsJSON(perfTraceStats(vals)).c_str());
+    }
+    fprintf(f,"    \"chips\": [\n");
+    for (int i=0; i<chipCount; i++) {
+      fprintf(f,"      {");
+      for (int j=0; j<2; j++) {
+        vals.clear();
+        for (DivPerfFrame& k: perfFrames) {
+          vals.push_back(k.chip[i][j]);
+        }
+        fprintf(f,"%s\"%s\": %s",j?", ":"",j?"fillBuf":"acquire",perfStatsJSON(perfTraceStats(vals)).c_str());
+      }
+      fprintf(f,"}%s\n",(i<chipCount-1)?",":"");
+    }
+    fprintf(f,"    ]\n  },\n");
+
+    // one array per buffer: phases, then acquire/fillBuf of each chip
+    fprintf(f,"  \"frames\": [\n");
+    for (size_t i=0; i<perfFrames.size(); i++) {
+      DivPerfFrame& frame=perfFrames[i];
+      fprintf(f,"    [");
+      for (int j=0; j<DIV_PERF_MAX; j++) {
+        fprintf(f,"%s%u",j?", ":"",frame.phase[j]);
+      }
+      for (int j=0; j<chipCount; j++) {
+        fprintf(f,", %u, %u",frame.chip[j][0],frame.chip[j][1]);
+      }
+      fprintf(f,"]%s\n",(i<perfFrames.size()-1)?",":"");
+    }
+    fprintf(f,"  ]\n}\n");
+  } else {
+    fprintf(f,"buffer");
+    for (int i=0; i<DIV_PERF_MAX; i++) {
+      fprintf(f,",%s",getPerfPhaseName((DivPerfPhases)i));
+    }
+    for (int i=0; i<chipCount; i++) {
+      fprintf(f,",\"%d: %s (acquire)\",\"%d: %s (fillBuf)\"",i,getSystemName(song.system[i]),i,getSystemName(song.system[i]));
+    }
+    fprintf(f,"\n");
+    for (size_t i=0; i<perfFrames.size(); i++) {
+      DivPerfFrame& frame=perfFrames[i];
+      fprintf(f,"%d",(int)i);
+      for (int j=0; j<DIV_PERF_MAX; j++) {
+        fprintf(f,",%u",frame.phase[j]);
+      }
+      for (int j=0; j<chipCount; j++) {
+        fprintf(f,",%u,%u",frame.chip[j][0],frame.chip[j][1]);
+      }
+      fprintf(f,"\n");
+    }
+  }
+  BUSY_END;
+
+  fclose(f);
+  logI("profile written to %s (%d buffers).",path,(int)perfFrames.size());
+  return true;
+}
+
 void DivEngine::notifyInsChange(int ins) {
   BUSY_BEGIN;
   for (int i=0; i<song.systemLen; i++) {
@@ -433,7 +992,7 @@ void DivEngine::renderSamplesP(int whichSample) {
   BUSY_END;
 }
 
-void DivEngine::renderSamples(int whichSample) {
+void DivEngine::renderSamples(int whichSample, bool preRendered) {
   sPreview.sample=-1;
   sPreview.pos=0;
   sPreview.dir=false;
@@ -448,23 +1007,88 @@ void DivEngine::renderSamples(int whichSample) {
     formatMask|=s->sampleFormatMask;
   }
 
-  // step 1: render samples
-  if (whichSample==-1) {
-    for (int i=0; i<song.sampleLen; i++) {
-      song.sample[i]->render(formatMask);
+  // step 1: render samples (unless this was done while loading)
+  // samples which did not change are skipped by render().
+  if (!preRendered) {
+    if (whichSample==-1) {
+      renderSampleFormats(song.sample,formatMask);
+    } else if (whichSample>=0 && whichSample<song.sampleLen) {
+      song.sample[whichSample]->render(formatMask);
     }
-  } else if (whichSample>=0 && whichSample<song.sampleLen) {
-    song.sample[whichSample]->render(formatMask);
   }
 
   // step 2: render samples to dispatch
+  // only chips which see a change are updated.
   for (int i=0; i<song.systemLen; i++) {
     if (disCont[i].dispatch!=NULL) {
+      uint64_t key=getSampleKey(i);
+      if (key==disCont[i].sampleKey) {
+        logV("samples of chip %d did not change",i);
+        continue;
+      }
       disCont[i].dispatch->renderSamples(i);
+      disCont[i].sampleKey=key;
     }
   }
 }
 
+struct DivSampleRenderJob {
+  DivSample* sample;
+  unsigned int formatMask;
+};
+
+void DivEngine::renderSampleFormats(const std::vector<DivSample*>& which, unsigned int formatMask) {
+  if (which.size()<2) {
+    for (DivSample* i: which) {
+      i->render(formatMask);
+    }
+    return;
+  }
+
+  samplePoolLock.lock();
+  if (samplePool==NULL) {
+    unsigned int howManyThreads=std::thread::hardware_concurrency();
+    if (howManyThreads<2) howManyThreads=0;
+    if (howManyThreads>16) howManyThreads=16;
+    samplePool=new DivWorkPool(howManyThreads);
+  }
+
+  std::vector<DivSampleRenderJob> jobs;
+  jobs.reserve(which.size());
+  for (DivSample* i: which) {
+    DivSampleRenderJob job;
+    job.sample=i;
+    job.formatMask=formatMask;
+    jobs.push_back(job);
+  }
+  samplePool->pushBatch([](void* d) {
+    DivSampleRenderJob* job=(DivSampleRenderJob*)d;
+    job->sample->render(job->formatMask);
+  },jobs.data(),sizeof(DivSampleRenderJob),jobs.size());
+  samplePool->wait();
+  samplePoolLock.unlock();
+}
+
+uint64_t DivEngine::getSampleKey(int sysID) {
+  String flags=song.systemFlags[sysID].toString();
+  uint64_t ret=DivBackupJournal::hash((const unsigned char*)flags.c_str(),flags.size());
+  ret=DivBackupJournal::hash((const unsigned char*)&disCont[sysID].dispatch,sizeof(DivDispatch*),ret);
+  SafeWriter w;
+  w.init();
+  for (int i=0; i<song.sampleLen; i++) {
+    DivSample* s=song.sample[i];
+    // parameters, then what the formats were rendered from
+    w.seek(0,SEEK_SET);
+    s->putSampleInfo(&w);
+    w.write(&s,sizeof(DivSample*));
+    w.write(&s->renderHash,sizeof(uint64_t));
+    ret=DivBackupJournal::hash(w.getFinalBuf(),w.tell(),ret);
+  }
+  w.finish();
+  if (ret==0) ret=1;
+  return ret;
+}
+
 String DivEngine::decodeSysDesc(String desc) {
   DivConfig newDesc;
   bool hasVal=false;
@@ -578,6 +1202,22 @@ void DivEngine::initSongWithDesc(const char* description, bool inBase64, bool ol
   song.author=getConfString("defaultAuthorName","");
 }
 
+void DivEngine::swapSong(DivSong& other, bool isRender, bool preRendered) {
+  quitDispatch();
+  BUSY_BEGIN;
+  saveLock.lock();
+  std::swap(song,other);
+  changeSong(0);
+  recalcChans();
+  saveLock.unlock();
+  BUSY_END;
+  initDispatch(isRender);
+  BUSY_BEGIN;
+  renderSamples(-1,preRendered);
+  reset();
+  BUSY_END;
+}
+
 void DivEngine::createNew(const char* description, String sysName, bool inBase64) {
   quitDispatch();
   BUSY_BEGIN;
@@ -695,6 +1335,7 @@ void DivEngine::stompChannel(int ch) {
 
 void DivEngine::changeSong(size_t songIndex) {
   if (songIndex>=song.subsong.size()) return;
+  clearSeekCache();
   curSubSong=song.subsong[songIndex];
   curPat=song.subsong[songIndex]->pat;
   curOrders=&song.subsong[songIndex]->orders;
@@ -847,7 +1488,7 @@ int DivEngine::duplicateSubSong(int index) {
 
     for (int j=0; j<DIV_MAX_PATTERNS; j++) {
       if (theOrig->pat[i].data[j]==NULL) continue;
-      DivPattern* origPat=theOrig->pat[i].getPattern(j,false);
+      const DivPattern* origPat=theOrig->pat[i].getPattern(j,false);
       DivPattern* copyPat=theCopy->pat[i].getPattern(j,true);
       origPat->copyOn(copyPat);
     }
@@ -935,9 +1576,10 @@ void DivEngine::delUnusedIns() {
     for (size_t j=0; j<song.subsong.size(); j++) {
       for (int k=0; k<DIV_MAX_PATTERNS; k++) {
         if (song.subsong[j]->pat[i].data[k]==NULL) continue;
+        const DivPattern* p=song.subsong[j]->pat[i].data[k];
         for (int l=0; l<song.subsong[j]->patLen; l++) {
-          if (song.subsong[j]->pat[i].data[k]->data[l][2]>=0 && song.subsong[j]->pat[i].data[k]->data[l][2]<256) {
-            isUsed[song.subsong[j]->pat[i].data[k]->data[l][2]]=true;
+          if (p->data[l][2]>=0 && p->data[l][2]<256) {
+            isUsed[p->data[l][2]]=true;
           }
         }
       }
@@ -1592,7 +2234,7 @@ DivSample* DivEngine::getSample(int index) {
 
 DivDispatch* DivEngine::getDispatch(int index) {
   if (index<0 || index>=song.systemLen) return NULL;
-  return disCont[index].dispatch;
+  return disCont[index].renderDispatch();
 }
 
 void DivEngine::setLoops(int loops) {
@@ -1627,9 +2269,10 @@ DivChannelModeHints DivEngine::getChanModeHints(int ch) {
 unsigned char* DivEngine::getRegisterPool(int sys, int& size, int& depth) {
   if (sys<0 || sys>=song.systemLen) return NULL;
   if (disCont[sys].dispatch==NULL) return NULL;
-  size=disCont[sys].dispatch->getRegisterPoolSize();
-  depth=disCont[sys].dispatch->getRegisterPoolDepth();
-  return disCont[sys].dispatch->getRegisterPool();
+  DivDispatch* d=disCont[sys].renderDispatch();
+  size=d->getRegisterPoolSize();
+  depth=d->getRegisterPoolDepth();
+  return d->getRegisterPool();
 }
 
 DivMacroInt* DivEngine::getMacroInt(int chan) {
@@ -1639,12 +2282,12 @@ DivMacroInt* DivEngine::getMacroInt(int chan) {
 
 DivSamplePos DivEngine::getSamplePos(int chan) {
   if (chan<0 || chan>=chans) return DivSamplePos();
-  return disCont[dispatchOfChan[chan]].dispatch->getSamplePos(dispatchChanOfChan[chan]);
+  return disCont[dispatchOfChan[chan]].renderDispatch()->getSamplePos(dispatchChanOfChan[chan]);
 }
 
 DivDispatchOscBuffer* DivEngine::getOscBuffer(int chan) {
   if (chan<0 || chan>=chans) return NULL;
-  return disCont[dispatchOfChan[chan]].dispatch->getOscBuffer(dispatchChanOfChan[chan]);
+  return disCont[dispatchOfChan[chan]].renderDispatch()->getOscBuffer(dispatchChanOfChan[chan]);
 }
 
 void DivEngine::enableCommandStream(bool enable) {
@@ -1665,6 +2308,7 @@ void DivEngine::getCommandStream(std::vector<DivCommand>& where) {
 void DivEngine::playSub(bool preserveDrift, int goalRow) {
   logV("playSub() called");
   std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+  pipeFlush();
   for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(false);
   reset();
   if (preserveDrift && curOrder==0) {
@@ -1711,6 +2355,14 @@ void DivEngine::playSub(bool preserveDrift, int goalRow) {
   memset(walked,0,8192);
   for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->setSkipRegisterWrites(true);
   logV("goal: %d goalRow: %d",goal,goalRow);
+  // restore the nearest keyframe if we can
+  bool useSeekCache=(seekCache && !preserveDrift);
+  int seekEvent=0;
+  if (useSeekCache) {
+    if (seekCacheDirty.exchange(false)) clearSeekCache();
+    seekEvent=restoreSeekKeyframe(goal);
+  }
+  int lastSeekOrder=curOrder;
   while (playing && curOrder<goal) {
     if (nextTick(preserveDrift)) {
       skipping=false;
@@ -1725,6 +2377,12 @@ void DivEngine::playSub(bool preserveDrift, int goalRow) {
       runMidiClock(cycles);
       runMidiTime(cycles);
     }
+    // save a keyframe every time we reach a new order
+    if (useSeekCache && curOrder!=lastSeekOrder) {
+      lastSeekOrder=curOrder;
+      if (seekEvent==(int)seekKeyframes.size()) saveSeekKeyframe();
+      seekEvent++;
+    }
   }
   int oldOrder=curOrder;
   while (playing && (curRow<goalRow || ticks>1)) {
@@ -1785,6 +2443,155 @@ void DivEngine::playSub(bool preserveDrift, int goalRow) {
   logV("playSub() took %dµs",std::chrono::duration_cast<std::chrono::microseconds>(timeEnd-timeStart).count());
 }
 
+#define MAX_SEEK_KEYFRAMES 1024
+
+void DivEngine::saveSeekKeyframe() {
+  if (seekCacheUnsupported) return;
+  if (seekKeyframes.size()>=MAX_SEEK_KEYFRAMES) return;
+
+  DivSeekKeyframe* k=new DivSeekKeyframe;
+  for (int i=0; i<song.systemLen; i++) {
+    k->dispatchState[i]=disCont[i].dispatch->getState();
+    if (k->dispatchState[i]==NULL) {
+      logV("%s does not support state saves. seek keyframes disabled.",getSystemName(song.system[i]));
+      for (int j=0; j<i; j++) {
+        disCont[j].dispatch->freeState(k->dispatchState[j]);
+      }
+      delete k;
+      seekCacheUnsupported=true;
+      return;
+    }
+  }
+
+  k->chan.assign(chan,chan+chans);
+  k->speeds=speeds;
+  k->divider=divider;
+  k->clockDrift=clockDrift;
+  k->midiClockDrift=midiClockDrift;
+  k->midiTimeDrift=midiTimeDrift;
+  k->subticks=subticks;
+  k->ticks=ticks;
+  k->curRow=curRow;
+  k->curOrder=curOrder;
+  k->prevRow=prevRow;
+  k->prevOrder=prevOrder;
+  k->totalLoops=totalLoops;
+  k->lastLoopPos=lastLoopPos;
+  k->nextSpeed=nextSpeed;
+  k->elapsedBars=elapsedBars;
+  k->elapsedBeats=elapsedBeats;
+  k->curSpeed=curSpeed;
+  k->cycles=cycles;
+  k->midiClockCycles=midiClockCycles;
+  k->midiTimeCycles=midiTimeCycles;
+  k->stepPlay=stepPlay;
+  k->changeOrd=changeOrd;
+  k->changePos=changePos;
+  k->totalSeconds=totalSeconds;
+  k->totalTicks=totalTicks;
+  k->totalTicksR=totalTicksR;
+  k->curMidiClock=curMidiClock;
+  k->curMidiTime=curMidiTime;
+  k->globalPitch=globalPitch;
+  k->curMidiTimePiece=curMidiTimePiece;
+  k->curMidiTimeCode=curMidiTimeCode;
+  k->virtualTempoN=virtualTempoN;
+  k->virtualTempoD=virtualTempoD;
+  k->tempoAccum=tempoAccum;
+  k->extValue=extValue;
+  k->arpLen=curSubSong->arpLen;
+  k->extValuePresent=extValuePresent;
+  k->endOfSong=endOfSong;
+  k->firstTick=firstTick;
+  memcpy(k->walked,walked,8192);
+
+  seekKeyframes.push_back(k);
+}
+
+int DivEngine::restoreSeekKeyframe(int goal) {
+  // keyframes are stored in playback order, and the first one is past order 0.
+  // find the last one not past the goal, stopping at the first which is
+  // (the song may have jumped over the goal order).
+  if (goal<=0) return 0;
+  int which=-1;
+  for (size_t i=0; i<seekKeyframes.size(); i++) {
+    if (seekKeyframes[i]->curOrder>goal) break;
+    which=i;
+  }
+  if (which<0) return 0;
+
+  DivSeekKeyframe* k=seekKeyframes[which];
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].dispatch->setState(k->dispatchState[i]);
+  }
+  for (size_t i=0; i<k->chan.size(); i++) {
+    chan[i]=k->chan[i];
+  }
+  speeds=k->speeds;
+  divider=k->divider;
+  clockDrift=k->clockDrift;
+  midiClockDrift=k->midiClockDrift;
+  midiTimeDrift=k->midiTimeDrift;
+  subticks=k->subticks;
+  ticks=k->ticks;
+  curRow=k->curRow;
+  curOrder=k->curOrder;
+  prevRow=k->prevRow;
+  prevOrder=k->prevOrder;
+  totalLoops=k->totalLoops;
+  lastLoopPos=k->lastLoopPos;
+  nextSpeed=k->nextSpeed;
+  elapsedBars=k->elapsedBars;
+  elapsedBeats=k->elapsedBeats;
+  curSpeed=k->curSpeed;
+  cycles=k->cycles;
+  midiClockCycles=k->midiClockCycles;
+  midiTimeCycles=k->midiTimeCycles;
+  stepPlay=k->stepPlay;
+  changeOrd=k->changeOrd;
+  changePos=k->changePos;
+  totalSeconds=k->totalSeconds;
+  totalTicks=k->totalTicks;
+  totalTicksR=k->totalTicksR;
+  curMidiClock=k->curMidiClock;
+  curMidiTime=k->curMidiTime;
+  globalPitch=k->globalPitch;
+  curMidiTimePiece=k->curMidiTimePiece;
+  curMidiTimeCode=k->curMidiTimeCode;
+  virtualTempoN=k->virtualTempoN;
+  virtualTempoD=k->virtualTempoD;
+  tempoAccum=k->tempoAccum;
+  extValue=k->extValue;
+  curSubSong->arpLen=k->arpLen;
+  extValuePresent=k->extValuePresent;
+  endOfSong=k->endOfSong;
+  firstTick=k->firstTick;
+  memcpy(walked,k->walked,8192);
+
+  logV("restored seek keyframe %d (order %d)",which,curOrder);
+  return which+1;
+}
+
+void DivEngine::clearSeekCache() {
+  for (DivSeekKeyframe* k: seekKeyframes) {
+    for (int i=0; i<song.systemLen; i++) {
+      if (k->dispatchState[i]!=NULL) disCont[i].dispatch->freeState(k->dispatchState[i]);
+    }
+    delete k;
+  }
+  seekKeyframes.clear();
+  seekCacheUnsupported=false;
+  seekCacheDirty=false;
+}
+
+void DivEngine::invalidateSeekCache() {
+  seekCacheDirty=true;
+}
+
+size_t DivEngine::getSeekKeyframeCount() {
+  return seekKeyframes.size();
+}
+
 /*
 int DivEngine::calcBaseFreq(double clock, double divider, int note, bool period) {
   double base=(period?(song.tuning*0.0625):song.tuning)*pow(2.0,(float)(note+3)/12.0);
@@ -2113,6 +2920,18 @@ void DivEngine::haltWhen(DivHaltPositions when) {
   BUSY_END;
 }
 
+void DivEngine::setRangeEnd(int order, int row) {
+  BUSY_BEGIN;
+  rangeEndOrder=order;
+  rangeEndRow=row;
+  rangeEndPos=-1;
+  BUSY_END;
+}
+
+int DivEngine::getRangeEndPos() {
+  return rangeEndPos;
+}
+
 bool DivEngine::isHalted() {
   return halted;
 }
@@ -2163,6 +2982,7 @@ void DivEngine::recalcChans() {
 }
 
 void DivEngine::reset() {
+  pipeFlush();
   if (output) if (output->midiOut!=NULL) {
     output->midiOut->send(TAMidiMessage(TA_MIDI_MACHINE_STOP,0,0));
     for (int i=0; i<chans; i++) {
@@ -2426,6 +3246,7 @@ float DivEngine::getHz() {
 }
 
 float DivEngine::getCurHz() {
+  if (DivDispatchContainer::pipeHz>0.0f) return DivDispatchContainer::pipeHz;
   return divider;
 }
 
@@ -2684,8 +3505,9 @@ void DivEngine::delInstrumentUnsafe(int index) {
       for (size_t j=0; j<song.subsong.size(); j++) {
         for (int k=0; k<DIV_MAX_PATTERNS; k++) {
           if (song.subsong[j]->pat[i].data[k]==NULL) continue;
+          const DivPattern* p=song.subsong[j]->pat[i].data[k];
           for (int l=0; l<song.subsong[j]->patLen; l++) {
-            if (song.subsong[j]->pat[i].data[k]->data[l][2]>index) {
+            if (p->data[l][2]>index) {
               song.subsong[j]->pat[i].data[k]->data[l][2]--;
             }
           }
@@ -3046,7 +3868,7 @@ void DivEngine::deepCloneOrder(int pos, bool where) {
         order[i]=j;
         DivPattern* oldPat=curPat[i].getPattern(origOrd,false);
         DivPattern* pat=curPat[i].getPattern(j,true);
-        memcpy(pat->data,oldPat->data,DIV_MAX_ROWS*DIV_MAX_COLS*sizeof(short));
+        oldPat->data.copyOn(pat->data);
         logD("found at %d",j);
         didNotFind=false;
         break;
@@ -3151,10 +3973,11 @@ void DivEngine::exchangeIns(int one, int two) {
     for (size_t j=0; j<song.subsong.size(); j++) {
       for (int k=0; k<DIV_MAX_PATTERNS; k++) {
         if (song.subsong[j]->pat[i].data[k]==NULL) continue;
+        const DivPattern* p=song.subsong[j]->pat[i].data[k];
         for (int l=0; l<song.subsong[j]->patLen; l++) {
-          if (song.subsong[j]->pat[i].data[k]->data[l][2]==one) {
+          if (p->data[l][2]==one) {
             song.subsong[j]->pat[i].data[k]->data[l][2]=two;
-          } else if (song.subsong[j]->pat[i].data[k]->data[l][2]==two) {
+          } else if (p->data[l][2]==two) {
             song.subsong[j]->pat[i].data[k]->data[l][2]=one;
           }
         }
@@ -3514,8 +4337,10 @@ void DivEngine::setOrder(unsigned char order) {
 void DivEngine::updateSysFlags(int system, bool restart, bool render) {
   BUSY_BEGIN_SOFT;
   disCont[system].dispatch->setFlags(song.systemFlags[system]);
+  if (disCont[system].shadow!=NULL) disCont[system].shadow->setFlags(song.systemFlags[system]);
   disCont[system].setRates(got.rate);
   if (render) renderSamples();
+  clearSeekCache();
 
   // patchbay
   if (song.patchbayAuto) {
@@ -3539,6 +4364,7 @@ void DivEngine::setSongRate(float hz) {
   saveLock.lock();
   curSubSong->hz=hz;
   divider=curSubSong->hz;
+  clearSeekCache();
   saveLock.unlock();
   BUSY_END;
 }
@@ -3713,6 +4539,7 @@ void DivEngine::initDispatch(bool isRender) {
     disCont[i].setRates(got.rate);
     disCont[i].setQuality(lowQuality,dcHiPass);
   }
+  prepareBuffers(scratchBufSize);
   if (song.patchbayAuto) {
     saveLock.lock();
     autoPatchbay();
@@ -3725,6 +4552,7 @@ void DivEngine::initDispatch(bool isRender) {
 void DivEngine::quitDispatch() {
   BUSY_BEGIN;
   logV("terminating dispatch...");
+  clearSeekCache();
   for (int i=0; i<song.systemLen; i++) {
     disCont[i].quit();
   }
@@ -3805,6 +4633,10 @@ bool DivEngine::initAudioBackend() {
   if (previewVol<0.0f) previewVol=0.0f;
   if (previewVol>1.0f) previewVol=1.0f;
   renderPoolThreads=getConfInt("renderPoolThreads",0);
+  renderPipeline=getConfInt("renderPipeline",0);
+  seekCache=getConfInt("seekCache",0);
+  seekCacheDirty=true;
+  sampleStoreSetMapped(getConfInt("sampleMemMap",0),(configPath+DIR_SEPARATOR_STR+"samples").c_str());
 
   if (lowLatency) logI("using low latency mode.");
 
@@ -3876,6 +4708,7 @@ bool DivEngine::initAudioBackend() {
 
   logV("setting callback");
   output->setCallback(process,this);
+  output->setBufferSizeChangeCallback(bufferSizeChanged,this);
 
   logV("calling init");
   if (!output->init(want,got)) {
@@ -3886,6 +4719,8 @@ bool DivEngine::initAudioBackend() {
     return false;
   }
 
+  prepareBuffers(got.bufsize);
+
   logV("allocating oscBuf...");
   for (int i=0; i<got.outChans; i++) {
     if (oscBuf[i]==NULL) {
@@ -4027,6 +4862,64 @@ void DivEngine::everythingOK() {
   */
 }
 
+void DivEngine::prepareBuffers(size_t bufSize) {
+  if (bufSize<wantedBufSize) bufSize=wantedBufSize;
+  if (bufSize<1) return;
+  logV("preparing buffers for %d samples",bufSize);
+
+  // metroTick and metroBuf
+  if (scratch.reserve(bufSize*(sizeof(unsigned char)+sizeof(float))+32)) {
+    scratchBufSize=bufSize;
+  }
+
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].prepare(bufSize);
+  }
+
+  initRenderPool();
+}
+
+void DivEngine::initRenderPool() {
+  if (renderPool!=NULL) return;
+  unsigned int howManyThreads=song.systemLen;
+  if (howManyThreads<2) howManyThreads=0;
+  if (howManyThreads>renderPoolThreads) howManyThreads=renderPoolThreads;
+  // the render pool runs acquire() and fillBuf(), which must not allocate either
+  renderPool=new DivWorkPool(howManyThreads,true);
+}
+
+bool DivEngine::initBuffers() {
+  logV("creating blip_buf");
+
+  samp_bb=blip_new(32768);
+  if (samp_bb==NULL) {
+    logE("not enough memory!");
+    return false;
+  }
+  blip_set_dc(samp_bb,0);
+
+  samp_bbOut=new short[32768];
+
+  samp_bbIn=new short[32768];
+  samp_bbInLen=32768;
+
+  logV("setting blip rate of samp_bb (%f)",got.rate);
+  
+  blip_set_rates(samp_bb,44100,got.rate);
+
+  for (int i=0; i<64; i++) {
+    vibTable[i]=127*sin(((double)i/64.0)*(2*M_PI));
+  }
+  for (int i=0; i<128; i++) {
+    tremTable[i]=255*0.5*(1.0-cos(((double)i/128.0)*(2*M_PI)));
+  }
+  for (int i=0; i<4096; i++) {
+    reversePitchTable[i]=round(1024.0*pow(2.0,(2048.0-(double)i)/(12.0*128.0)));
+    pitchTable[i]=round(1024.0*pow(2.0,((double)i-2048.0)/(12.0*128.0)));
+  }
+  return true;
+}
+
 bool DivEngine::init() {
   loadSampleROMs();
 
@@ -4062,37 +4955,7 @@ bool DivEngine::init() {
     haveAudio=true;
   }
 
-  logV("creating blip_buf");
-
-  samp_bb=blip_new(32768);
-  if (samp_bb==NULL) {
-    logE("not enough memory!");
-    return false;
-  }
-  blip_set_dc(samp_bb,0);
-
-  samp_bbOut=new short[32768];
-
-  samp_bbIn=new short[32768];
-  samp_bbInLen=32768;
-
-  metroBuf=new float[8192];
-  metroBufLen=8192;
-
-  logV("setting blip rate of samp_bb (%f)",got.rate);
-  
-  blip_set_rates(samp_bb,44100,got.rate);
-
-  for (int i=0; i<64; i++) {
-    vibTable[i]=127*sin(((double)i/64.0)*(2*M_PI));
-  }
-  for (int i=0; i<128; i++) {
-    tremTable[i]=255*0.5*(1.0-cos(((double)i/128.0)*(2*M_PI)));
-  }
-  for (int i=0; i<4096; i++) {
-    reversePitchTable[i]=round(1024.0*pow(2.0,(2048.0-(double)i)/(12.0*128.0)));
-    pitchTable[i]=round(1024.0*pow(2.0,((double)i-2048.0)/(12.0*128.0)));
-  }
+  if (!initBuffers()) return false;
 
   for (int i=0; i<DIV_MAX_CHANS; i++) {
     isMuted[i]=0;
@@ -4120,6 +4983,10 @@ bool DivEngine::init() {
 }
 
 bool DivEngine::quit(bool saveConfig) {
+  if (loadThread!=NULL) {
+    cancelLoad();
+    finishLoadAsync();
+  }
   deinitAudioBackend();
   quitDispatch();
   if (saveConfig) {
@@ -4130,14 +4997,17 @@ bool DivEngine::quit(bool saveConfig) {
   for (int i=0; i<DIV_MAX_OUTPUTS; i++) {
     if (oscBuf[i]!=NULL) delete[] oscBuf[i];
   }
-  if (metroBuf!=NULL) {
-    delete[] metroBuf;
-    metroBuf=NULL;
-    metroBufLen=0;
-  }
+  scratch.free();
+  scratchBufSize=0;
+  metroTick=NULL;
+  metroBuf=NULL;
   if (yrw801ROM!=NULL) delete[] yrw801ROM;
   if (tg100ROM!=NULL) delete[] tg100ROM;
   if (mu5ROM!=NULL) delete[] mu5ROM;
+  if (samplePool!=NULL) {
+    delete samplePool;
+    samplePool=NULL;
+  }
   song.unload();
   return true;
 }
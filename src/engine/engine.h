@@ -27,9 +27,12 @@
 #include "export.h"
 #include "dataErrors.h"
 #include "safeWriter.h"
+#include "journal.h"
 #include "cmdStream.h"
 #include "../audio/taAudio.h"
 #include "blip_buf.h"
+#include "scratch.h"
+#include "profiler.h"
 #include <functional>
 #include <initializer_list>
 #include <thread>
@@ -44,6 +47,14 @@ class DivWorkPool;
     warnings+=(String("\n")+x); \
   }
 
+// loaders use this one, as they may run in the load thread (see DivEngine::loadAsync()).
+#define addLoadWarning(x) \
+  if (loadWarnings.empty()) { \
+    loadWarnings+=x; \
+  } else { \
+    loadWarnings+=(String("\n")+x); \
+  }
+
 #define BUSY_BEGIN softLocked=false; isBusy.lock();
 #define BUSY_BEGIN_SOFT softLocked=true; isBusy.lock();
 #define BUSY_END isBusy.unlock(); softLocked=false;
@@ -114,6 +125,11 @@ struct DivAudioExportOptions {
   int loops;
   double fadeOut;
   int orderBegin, orderEnd;
+  // number of threads used to render stems in per-channel mode (0 = one per core)
+  int threads;
+  // per-channel mode: render one stem made by a worker thread again in the main thread,
+  // and report whether both are identical
+  bool verify;
   bool channelMask[DIV_MAX_CHANS];
   DivAudioExportOptions():
     mode(DIV_EXPORT_MODE_ONE),
@@ -123,13 +139,42 @@ struct DivAudioExportOptions {
     loops(0),
     fadeOut(0.0),
     orderBegin(-1),
-    orderEnd(-1) {
+    orderEnd(-1),
+    threads(0),
+    verify(false) {
     for (int i=0; i<DIV_MAX_CHANS; i++) {
       channelMask[i]=true;
     }
   }
 };
 
+// maximum number of buffers in a profiling trace (preallocated, as it's filled by the audio thread)
+#define DIV_PERF_TRACE_MAX 65536
+
+// one buffer in a profiling trace (times in nanoseconds)
+struct DivPerfFrame {
+  unsigned int phase[DIV_PERF_MAX];
+  // acquire and fillBuf time of each chip
+  unsigned int chip[DIV_MAX_CHIPS][2];
+};
+
+// shared between per-channel export threads
+struct DivStemQueue {
+  std::vector<int> stems;
+  // hash of the audio of every stem, and whether a worker rendered it
+  std::vector<uint64_t> hashes;
+  std::vector<unsigned char> byWorker;
+  std::atomic<size_t> next;
+  std::atomic<bool> failed;
+  const bool* halt;
+  const void* owner;
+  DivStemQueue():
+    next(0),
+    failed(false),
+    halt(NULL),
+    owner(NULL) {}
+};
+
 struct DivChannelState {
   std::vector<DivDelayedCommand> delayed;
   int note, oldNote, lastIns, pitch, portaSpeed, portaNote;
@@ -236,8 +281,84 @@ struct DivNoteEvent {
     fromMIDI(false) {}
 };
 
+// a snapshot of the playback state, taken while seeking.
+// used to speed up subsequent seeks (see playSub()).
+struct DivSeekKeyframe {
+  std::vector<DivChannelState> chan;
+  void* dispatchState[DIV_MAX_CHIPS];
+  DivGroovePattern speeds;
+  double divider, clockDrift, midiClockDrift, midiTimeDrift;
+  int subticks, ticks, curRow, curOrder, prevRow, prevOrder, totalLoops, lastLoopPos, nextSpeed, elapsedBars, elapsedBeats, curSpeed;
+  int cycles, midiClockCycles, midiTimeCycles, stepPlay;
+  int changeOrd, changePos, totalSeconds, totalTicks, totalTicksR, curMidiClock, curMidiTime, globalPitch;
+  int curMidiTimePiece, curMidiTimeCode;
+  short virtualTempoN, virtualTempoD, tempoAccum;
+  unsigned char extValue, arpLen;
+  bool extValuePresent, endOfSong, firstTick;
+  unsigned char walked[8192];
+  DivSeekKeyframe() {
+    memset(dispatchState,0,DIV_MAX_CHIPS*sizeof(void*));
+  }
+};
+
+enum DivPipeEventTypes {
+  DIV_PIPE_ACQUIRE=0,
+  DIV_PIPE_COMMAND,
+  DIV_PIPE_TICK
+};
+
+// maximum number of recorded calls per chip and buffer in pipelined rendering.
+// if a chip runs out of room, the rest of the buffer is rendered normally.
+#define DIV_MAX_PIPE_EVENTS 1024
+
+// a recorded call to a dispatch (see DivDispatchContainer::pipeRender)
+struct DivPipeEvent {
+  DivPipeEventTypes type;
+  bool sysTick;
+  float hz;
+  size_t offset, len;
+  DivCommand cmd;
+  DivPipeEvent(size_t off, size_t l):
+    type(DIV_PIPE_ACQUIRE),
+    sysTick(false),
+    hz(0.0f),
+    offset(off),
+    len(l),
+    cmd(DIV_CMD_NOTE_OFF,0) {}
+  DivPipeEvent(const DivCommand& c, float h):
+    type(DIV_PIPE_COMMAND),
+    sysTick(false),
+    hz(h),
+    offset(0),
+    len(0),
+    cmd(c) {}
+  DivPipeEvent(bool st, float h):
+    type(DIV_PIPE_TICK),
+    sysTick(st),
+    hz(h),
+    offset(0),
+    len(0),
+    cmd(DIV_CMD_NOTE_OFF,0) {}
+  DivPipeEvent():
+    type(DIV_PIPE_ACQUIRE),
+    sysTick(false),
+    hz(0.0f),
+    offset(0),
+    len(0),
+    cmd(DIV_CMD_NOTE_OFF,0) {}
+};
+
 struct DivDispatchContainer {
   DivDispatch* dispatch;
+  // logic-only copy of the dispatch used in pipelined rendering.
+  // while the sequencer runs, this is swapped with dispatch.
+  DivDispatch* shadow;
+  // state used to sync the shadow, allocated once
+  void* pipeState;
+  FixedQueue<DivPipeEvent,DIV_MAX_PIPE_EVENTS> pipeEvents;
+  bool pipelined, pipeFill;
+  // the tick rate at the time of the event being replayed on this thread (0 if none)
+  static thread_local float pipeHz;
   blip_buffer_t* bb[DIV_MAX_OUTPUTS];
   size_t bbInLen, runtotal, runLeft, runPos, lastAvail;
   int temp[DIV_MAX_OUTPUTS], prevSample[DIV_MAX_OUTPUTS];
@@ -246,6 +367,14 @@ struct DivDispatchContainer {
   short* bbOut[DIV_MAX_OUTPUTS];
   bool lowQuality, dcOffCompensation, hiPass;
   double rateMemory;
+  size_t bufSizeMemory;
+  // time spent in acquire() and fillBuf() during the current buffer (in nanoseconds)
+  uint64_t perfAcquire, perfFill;
+  // whether to measure perfAcquire and perfFill (set by nextBuf())
+  bool profile;
+  // state of the samples when they were last uploaded to the chip (0 if never).
+  // the upload is skipped if it didn't change.
+  uint64_t sampleKey;
 
   // used in multi-thread
   int cycles;
@@ -254,14 +383,31 @@ struct DivDispatchContainer {
   void setRates(double gotRate);
   void setQuality(bool lowQual, bool dcHiPass);
   void grow(size_t size);
+  // allocate buffers for rendering up to bufSize output samples at once
+  void prepare(size_t bufSize);
   void acquire(size_t offset, size_t count);
   void flush(size_t count);
   void fillBuf(size_t runtotal, size_t offset, size_t size);
   void clear();
+  // pipelined rendering
+  // returns the dispatch which produces sound (not the shadow)
+  DivDispatch* renderDispatch() {
+    return pipelined?shadow:dispatch;
+  }
+  bool pipeFull() {
+    return pipeEvents.size()>=DIV_MAX_PIPE_EVENTS-1;
+  }
+  void pipeBegin();
+  void pipeEnd();
+  void pipeRender();
   void init(DivSystem sys, DivEngine* eng, int chanCount, double gotRate, const DivConfig& flags, bool isRender=false);
   void quit();
   DivDispatchContainer():
     dispatch(NULL),
+    shadow(NULL),
+    pipeState(NULL),
+    pipelined(false),
+    pipeFill(false),
     bbInLen(0),
     runtotal(0),
     runLeft(0),
@@ -271,6 +417,11 @@ struct DivDispatchContainer {
     dcOffCompensation(false),
     hiPass(true),
     rateMemory(0.0),
+    bufSizeMemory(0),
+    perfAcquire(0),
+    perfFill(0),
+    profile(false),
+    sampleKey(0),
     cycles(0),
     size(0) {
     memset(bb,0,DIV_MAX_OUTPUTS*sizeof(blip_buffer_t*));
@@ -424,6 +575,20 @@ enum DivChanTypes {
   DIV_CH_OP=5
 };
 
+// stages of a background song load (see DivEngine::loadAsync()).
+enum DivLoadStage {
+  DIV_LOAD_IDLE=0,
+  DIV_LOAD_READ,
+  DIV_LOAD_DECOMPRESS,
+  DIV_LOAD_PARSE,
+  DIV_LOAD_INSTRUMENTS,
+  DIV_LOAD_WAVETABLES,
+  DIV_LOAD_SAMPLES,
+  DIV_LOAD_PATTERNS,
+  DIV_LOAD_RENDER_SAMPLES,
+  DIV_LOAD_DONE
+};
+
 extern const char* cmdName[];
 
 class DivEngine {
@@ -432,6 +597,19 @@ class DivEngine {
   TAAudioDesc want, got;
   String exportPath;
   std::thread* exportThread;
+  // background loading
+  std::thread* loadThread;
+  String loadPath;
+  DivSong* pendingSong;
+  std::atomic<int> loadStage;
+  std::atomic<float> loadProgress;
+  std::atomic<bool> loadCancel;
+  // set by the load thread while it runs.
+  bool asyncLoad;
+  // errors and warnings of the load in progress.
+  // load() and finishLoadAsync() copy them to lastError and warnings.
+  String loadError;
+  String loadWarnings;
   int chans;
   bool configLoaded;
   bool active;
@@ -463,6 +641,9 @@ class DivEngine {
   bool midiOutClock;
   bool midiOutTime;
   bool midiOutProgramChange;
+  bool seekCache;
+  bool seekCacheUnsupported;
+  std::atomic<bool> seekCacheDirty;
   int midiOutMode;
   int midiOutTimeRate;
   float midiVolExp;
@@ -486,14 +667,20 @@ class DivEngine {
   short tempoAccum;
   DivStatusView view;
   DivHaltPositions haltOn;
+  // end of a range render and the buffer position at which it was reached (-1 if not yet)
+  int rangeEndOrder, rangeEndRow, rangeEndPos;
   DivChannelState chan[DIV_MAX_CHANS];
   DivAudioEngines audioEngine;
   DivAudioExportModes exportMode;
   DivAudioExportFormats exportFormat;
   double exportFadeOut;
   int exportOutputs;
+  int exportThreads;
+  bool exportVerify;
   bool exportChannelMask[DIV_MAX_CHANS];
   DivConfig conf;
+  // if not NULL, every key read with getConfInt() is added here (used by benchmarkCores())
+  std::vector<String>* confReadLog;
   FixedQueue<DivNoteEvent,8192> pendingNotes;
   // bitfield
   unsigned char walked[8192];
@@ -515,6 +702,8 @@ class DivEngine {
 
   DivCSPlayer* cmdStreamInt;
 
+  std::vector<DivSeekKeyframe*> seekKeyframes;
+
   struct SamplePreview {
     double rate;
     int sample;
@@ -550,10 +739,22 @@ class DivEngine {
   int samp_temp, samp_prevSample;
   short* samp_bbIn;
   short* samp_bbOut;
+  // profiling
+  DivPerfCounter perf[DIV_PERF_MAX];
+  DivPerfCounter perfChip[DIV_MAX_CHIPS][2];
+  // only processTime is measured unless one of these is on
+  bool perfProfiling, perfTrace;
+  std::vector<DivPerfFrame> perfFrames;
+  size_t perfFramesDropped;
+
+  // nextBuf() takes metroTick and metroBuf from here
+  DivScratchArena scratch;
+  size_t scratchBufSize;
+  // set by nextBuf() when it gets a larger buffer than prepared for.
+  // the next prepareBuffers() call takes it into account.
+  std::atomic<size_t> wantedBufSize;
   unsigned char* metroTick;
-  size_t metroTickLen;
   float* metroBuf;
-  size_t metroBufLen;
   float metroFreq, metroPos;
   float metroAmp;
   float metroVol;
@@ -562,7 +763,11 @@ class DivEngine {
   size_t totalProcessed;
 
   unsigned int renderPoolThreads;
+  bool renderPipeline, pipelining;
   DivWorkPool* renderPool;
+  // encodes samples to chip formats. separate from renderPool, which belongs to the audio thread.
+  DivWorkPool* samplePool;
+  std::mutex samplePoolLock;
 
   // MIDI stuff
   std::function<int(const TAMidiMessage&)> midiCallback=[](const TAMidiMessage&) -> int {return -2;};
@@ -571,21 +776,61 @@ class DivEngine {
   void processRow(int i, bool afterDelay);
   void nextOrder();
   void nextRow();
-  void performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, int* pendingFreq, int* playingSample, int* setPos, unsigned int* sampleOff8, unsigned int* sampleLen8, size_t bankOffset, bool directStream);
+  void performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, int* pendingFreq, int* playingSample, int* setPos, unsigned int* sampleOff8, unsigned int* sampleLen8, int* sampleBlock, size_t bankOffset, bool directStream);
   // returns true if end of song.
   bool nextTick(bool noAccum=false, bool inhibitLowLat=false);
+  // apply queued note events (UNSAFE)
+  void processPendingNotes();
+  // handle a message from the MIDI input (UNSAFE)
+  void processMidiIn(const TAMidiMessage& msg);
+  // get the position (in samples) within a buffer of the given size at which a MIDI input message shall be applied
+  int getMidiInPos(const TAMidiMessage& msg, double bufTime, unsigned int size);
   bool perSystemEffect(int ch, unsigned char effect, unsigned char effectVal);
   bool perSystemPostEffect(int ch, unsigned char effect, unsigned char effectVal);
   bool perSystemPreEffect(int ch, unsigned char effect, unsigned char effectVal);
   void recalcChans();
   void reset();
   void playSub(bool preserveDrift, int goalRow=0);
+  // seek keyframe cache (UNSAFE)
+  void saveSeekKeyframe();
+  int restoreSeekKeyframe(int goal);
+  void clearSeekCache();
+  // replay pending pipelined events and leave pipelined mode (UNSAFE)
+  void pipeFlush();
+  // exchange the current song with another one and restart dispatch (used by DivRenderServer)
+  // preRendered skips rendering sample formats (e.g. for songs which were loaded before)
+  void swapSong(DivSong& other, bool isRender, bool preRendered=false);
+  // record the buffer position at which playback first reaches a row at or after order/row.
+  // order -1 disables this.
+  void setRangeEnd(int order, int row);
+  // get the position recorded by setRangeEnd() in the last buffer, or -1 if not reached
+  int getRangeEndPos();
+  // create a song with one chip playing notes on every channel (used by benchmarkCores())
+  void setupBenchSong(DivSystem sys);
+  // record the times of the last buffer
+  void updatePerf(uint64_t total, uint64_t tick, uint64_t mix);
   void runMidiClock(int totalCycles=1);
   void runMidiTime(int totalCycles=1);
   bool shallSwitchCores();
+  // per-channel export
+  DivEngine* createStemWorker();
+  void destroyStemWorker(DivEngine* w);
+  // render the stem of a channel. if toFile is false, only the hash of the audio is computed.
+  bool exportStem(int ch, float** outBuf, float* outBufFinal, const bool& halt, uint64_t& hash, bool toFile=true);
 
   void testFunction();
 
+  // replace the current song with a loaded one.
+  // during a background load, the song is kept aside for finishLoadAsync() instead.
+  void installSong(DivSong& ds);
+  // render sample formats, several samples at once.
+  void renderSampleFormats(const std::vector<DivSample*>& which, unsigned int formatMask);
+  // get the state of the samples as seen by a chip (see DivDispatchContainer::sampleKey).
+  uint64_t getSampleKey(int sysID);
+  // update the background load progress. returns false if the load was cancelled.
+  bool loadStep(DivLoadStage stage, int pos=0, int total=1);
+  // load a file without publishing the errors (see loadError).
+  bool loadFile(unsigned char* f, size_t length, const char* nameHint);
   bool loadDMF(unsigned char* file, size_t len);
   bool loadFur(unsigned char* file, size_t len, int variantID=0);
   bool loadMod(unsigned char* file, size_t len);
@@ -617,6 +862,13 @@ class DivEngine {
   bool initAudioBackend();
   bool deinitAudioBackend(bool dueToSwitchMaster=false);
 
+  // allocate sample preview/metronome buffers and build pitch tables
+  bool initBuffers();
+  // allocate everything nextBuf() needs for buffers of up to bufSize samples.
+  // call with isBusy locked.
+  void prepareBuffers(size_t bufSize);
+  void initRenderPool();
+
   void registerSystems();
   void initSongWithDesc(const char* description, bool inBase64=true, bool oldVol=false);
 
@@ -648,6 +900,7 @@ class DivEngine {
   // add every export method here
   friend class DivROMExport;
   friend class DivExportAmigaValidation;
+  friend class DivRenderServer;
 
   public:
     DivSong song;
@@ -666,9 +919,15 @@ class DivEngine {
     int tickMult;
     int lastNBIns, lastNBOuts, lastNBSize;
     std::atomic<size_t> processTime;
+    // time spent in the mixing/output stage of nextBuf (part of processTime)
+    std::atomic<size_t> processTimeMix;
 
     void runExportThread();
+    void runLoadThread();
+    void runStemExport(DivStemQueue* queue);
     void nextBuf(float** in, float** out, int inChans, int outChans, unsigned int size);
+    // called by the audio backend when the buffer size changes
+    void changeBufSize(unsigned int size);
     DivInstrument* getIns(int index, DivInstrumentType fallbackType=DIV_INS_FM);
     DivWavetable* getWave(int index);
     DivSample* getSample(int index);
@@ -679,7 +938,21 @@ class DivEngine {
     void createNew(const char* description, String sysName, bool inBase64=true);
     void createNewFromDefaults();
     // load a file.
+    // this cancels a background load if there is one.
     bool load(unsigned char* f, size_t length, const char* nameHint=NULL);
+    // load a file in a separate thread.
+    // the current song keeps playing until finishLoadAsync() is called after
+    // isLoading() returns false.
+    bool loadAsync(String path);
+    // whether a background load is still running.
+    bool isLoading();
+    // get the stage and progress (0 to 1) of the background load.
+    DivLoadStage getLoadStage(float* progress=NULL);
+    // cancel the background load.
+    void cancelLoad();
+    // wait for the background load and switch to the loaded song.
+    // returns false if loading failed or was cancelled (see getLastError()).
+    bool finishLoadAsync();
     // play a binary command stream.
     bool playStream(unsigned char* f, size_t length);
     // get the playing stream.
@@ -690,7 +963,9 @@ class DivEngine {
     SafeWriter* saveDMF(unsigned char version);
     // save as .fur.
     // if notPrimary is true then the song will not be altered
-    SafeWriter* saveFur(bool notPrimary=false, bool newPatternFormat=true);
+    // if snap is not NULL, the instruments, wavetables, samples and patterns are put in it
+    // as separate chunks (for backup journals) and only the rest of the file is returned.
+    SafeWriter* saveFur(bool notPrimary=false, bool newPatternFormat=true, DivFurSnapshot* snap=NULL);
     // build a ROM file (TODO).
     // specify system to build ROM for.
     std::vector<DivROMExportOutput> buildROM(DivROMExportOptions sys);
@@ -700,13 +975,19 @@ class DivEngine {
     // - x to add x+1 ticks of trailing
     // - -1 to auto-determine trailing
     // - -2 to add a whole loop of trailing
-    SafeWriter* saveVGM(bool* sysToExport=NULL, bool loop=true, int version=0x171, bool patternHints=false, bool directStream=false, int trailingTicks=-1);
+    // if path is not NULL, the VGM is written straight to that file and the
+    // returned SafeWriter only has to be finished.
+    // if optimize is true, writes which don't change any register are removed
+    // and identical samples share a data block.
+    // if compress is true, the output is gzip-compressed (.vgz). path must not be NULL.
+    SafeWriter* saveVGM(bool* sysToExport=NULL, bool loop=true, int version=0x171, bool patternHints=false, bool directStream=false, int trailingTicks=-1, const char* path=NULL, bool optimize=false, bool compress=false);
     // dump to ZSM.
     SafeWriter* saveZSM(unsigned int zsmrate=60, bool loop=true, bool optimize=true);
     // dump to TIunA.
     SafeWriter* saveTiuna(const bool* sysToExport, const char* baseLabel, int firstBankSize, int otherBankSize);
     // dump command stream.
-    SafeWriter* saveCommand();
+    // if path is not NULL, the stream is written straight to that file.
+    SafeWriter* saveCommand(const char* path=NULL);
     // export to text
     SafeWriter* saveText(bool separatePatterns=true);
     // export to an audio file
@@ -740,6 +1021,34 @@ class DivEngine {
     // benchmark (returns time in seconds)
     double benchmarkPlayback();
     double benchmarkSeek();
+    // work pool benchmark (returns time per round in microseconds)
+    double benchmarkPool();
+    // band-limited synthesis benchmark (returns time per input sample in nanoseconds)
+    double benchmarkBlip();
+    // sample resampling benchmark (returns average time per input sample of DIV_RESAMPLE_POLYPHASE in nanoseconds)
+    double benchmarkResample();
+    // run a synthetic song on every chip with every emulation core.
+    // results are written to jsonPath (if not NULL) in JSON format.
+    // returns whether successful.
+    bool benchmarkCores(const char* jsonPath);
+
+    // get render time statistics for the last buffers.
+    // chip may be -1 (for all chips) or a chip index (only DIV_PERF_ACQUIRE and DIV_PERF_FILLBUF).
+    DivPerfStats getPerfStats(DivPerfPhases phase, int chip=-1);
+    void resetPerfStats();
+    // measure every phase of a buffer for getPerfStats() (off by default)
+    void setProfiling(bool enable);
+    bool getProfiling();
+    // record the time taken by every buffer from now on (up to DIV_PERF_TRACE_MAX)
+    void setPerfTrace(bool enable);
+    // write the recorded buffer times to a file (JSON if path ends in .json, CSV otherwise)
+    bool writePerfTrace(const char* path);
+
+    // notify the engine that the song has changed and seek keyframes are no longer valid
+    void invalidateSeekCache();
+
+    // get number of seek keyframes
+    size_t getSeekKeyframeCount();
 
     // returns the minimum VGM version which may carry the specified system, or 0 if none.
     int minVGMVersion(DivSystem which);
@@ -1171,7 +1480,6 @@ class DivEngine {
 
     // halt on next something
     void haltWhen(DivHaltPositions when);
-
     // is engine halted
     bool isHalted();
 
@@ -1185,7 +1493,8 @@ class DivEngine {
     unsigned int getSampleFormatMask();
 
     // UNSAFE render samples - only execute when locked
-    void renderSamples(int whichSample=-1);
+    // if preRendered is true, sample formats are not rendered again (only the chips are updated).
+    void renderSamples(int whichSample=-1, bool preRendered=false);
 
     // public render samples
     // values for whichSample
@@ -1325,6 +1634,12 @@ class DivEngine {
     DivEngine():
       output(NULL),
       exportThread(NULL),
+      loadThread(NULL),
+      pendingSong(NULL),
+      loadStage(DIV_LOAD_IDLE),
+      loadProgress(0.0f),
+      loadCancel(false),
+      asyncLoad(false),
       chans(0),
       configLoaded(false),
       active(false),
@@ -1356,6 +1671,9 @@ class DivEngine {
       midiOutClock(false),
       midiOutTime(false),
       midiOutProgramChange(false),
+      seekCache(false),
+      seekCacheUnsupported(false),
+      seekCacheDirty(false),
       midiOutMode(DIV_MIDI_MODE_NOTE),
       midiOutTimeRate(0),
       midiVolExp(2.0f), // General MIDI standard
@@ -1404,11 +1722,17 @@ class DivEngine {
       tempoAccum(0),
       view(DIV_STATUS_NOTHING),
       haltOn(DIV_HALT_NONE),
+      rangeEndOrder(-1),
+      rangeEndRow(-1),
+      rangeEndPos(-1),
       audioEngine(DIV_AUDIO_NULL),
       exportMode(DIV_EXPORT_MODE_ONE),
       exportFormat(DIV_EXPORT_FORMAT_S16),
       exportFadeOut(0.0),
       exportOutputs(2),
+      exportThreads(0),
+      exportVerify(false),
+      confReadLog(NULL),
       cmdStreamInt(NULL),
       midiBaseChan(0),
       midiPoly(true),
@@ -1420,10 +1744,13 @@ class DivEngine {
       samp_prevSample(0),
       samp_bbIn(NULL),
       samp_bbOut(NULL),
+      perfProfiling(false),
+      perfTrace(false),
+      perfFramesDropped(0),
+      scratchBufSize(0),
+      wantedBufSize(0),
       metroTick(NULL),
-      metroTickLen(0),
       metroBuf(NULL),
-      metroBufLen(0),
       metroFreq(0),
       metroPos(0),
       metroAmp(0.0f),
@@ -1431,7 +1758,10 @@ class DivEngine {
       previewVol(1.0f),
       totalProcessed(0),
       renderPoolThreads(0),
+      renderPipeline(false),
+      pipelining(false),
       renderPool(NULL),
+      samplePool(NULL),
       curOrders(NULL),
       curPat(NULL),
       tempIns(NULL),
@@ -1443,6 +1773,7 @@ class DivEngine {
       lastNBOuts(0),
       lastNBSize(0),
       processTime(0),
+      processTimeMix(0),
       yrw801ROM(NULL),
       tg100ROM(NULL),
       mu5ROM(NULL) {
@@ -1457,16 +1788,10 @@ class DivEngine {
       memset(reversePitchTable,0,4096*sizeof(int));
       memset(pitchTable,0,4096*sizeof(int));
       memset(effectSlotMap,-1,4096*sizeof(short));
-      memset(sysDefs,0,DIV_MAX_CHIP_DEFS*sizeof(void*));
       memset(walked,0,8192);
       memset(oscBuf,0,DIV_MAX_OUTPUTS*(sizeof(float*)));
       memset(exportChannelMask,1,DIV_MAX_CHANS*sizeof(bool));
 
-      for (int i=0; i<DIV_MAX_CHIP_DEFS; i++) {
-        sysFileMapFur[i]=DIV_SYSTEM_NULL;
-        sysFileMapDMF[i]=DIV_SYSTEM_NULL;
-      }
-
       changeSong(0);
     }
 };
@@ -90,7 +90,7 @@ static double samplePitches[11]={
 
 bool DivEngine::loadDMF(unsigned char* file, size_t len) {
   SafeReader reader=SafeReader(file,len);
-  warnings="";
+  loadWarnings="";
   try {
     DivSong ds;
     unsigned char historicColIns[DIV_MAX_CHANS];
@@ -107,7 +107,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
 
     if (!reader.seek(16,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -115,7 +115,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
     logI("module version %d (0x%.2x)",ds.version,ds.version);
     if (ds.version>0x1b) {
       logE("this version is not supported by Furnace yet!");
-      lastError="this version is not supported by Furnace yet";
+      loadError="this version is not supported by Furnace yet";
       delete[] file;
       return false;
     }
@@ -131,7 +131,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
     }
     if (ds.system[0]==DIV_SYSTEM_NULL) {
       logE("invalid system 0x%.2x!",sys);
-      lastError="system not supported. running old version?";
+      loadError="system not supported. running old version?";
       delete[] file;
       return false;
     }
@@ -286,25 +286,25 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
 
     if (ds.subsong[0]->patLen<0) {
       logE("pattern length is negative!");
-      lastError="pattern lengrh is negative!";
+      loadError="pattern lengrh is negative!";
       delete[] file;
       return false;
     }
     if (ds.subsong[0]->patLen>256) {
       logE("pattern length is too large!");
-      lastError="pattern length is too large!";
+      loadError="pattern length is too large!";
       delete[] file;
       return false;
     }
     if (ds.subsong[0]->ordersLen<0) {
       logE("song length is negative!");
-      lastError="song length is negative!";
+      loadError="song length is negative!";
       delete[] file;
       return false;
     }
     if (ds.subsong[0]->ordersLen>127) {
       logE("song is too long!");
-      lastError="song is too long!";
+      loadError="song is too long!";
       delete[] file;
       return false;
     }
@@ -340,7 +340,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
           break;
       }
       ds.subsong[0]->timeBase=0;
-      addWarning("Yamaha YMU759 emulation is incomplete! please migrate your song to the OPL3 system.");
+      addLoadWarning("Yamaha YMU759 emulation is incomplete! please migrate your song to the OPL3 system.");
     }
 
     logV("%x",reader.tell());
@@ -351,7 +351,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
         ds.subsong[0]->orders.ord[i][j]=reader.readC();
         if (ds.subsong[0]->orders.ord[i][j]>0x7f) {
           logE("order at %d, %d out of range! (%d)",i,j,ds.subsong[0]->orders.ord[i][j]);
-          lastError=fmt::sprintf("order at %d, %d out of range! (%d)",i,j,ds.subsong[0]->orders.ord[i][j]);
+          loadError=fmt::sprintf("order at %d, %d out of range! (%d)",i,j,ds.subsong[0]->orders.ord[i][j]);
           delete[] file;
           return false;
         }
@@ -374,6 +374,11 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
     logI("reading instruments (%d)...",ds.insLen);
     if (ds.insLen>0) ds.ins.reserve(ds.insLen);
     for (int i=0; i<ds.insLen; i++) {
+      if (!loadStep(DIV_LOAD_INSTRUMENTS,i,ds.insLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       DivInstrument* ins=new DivInstrument;
       unsigned char mode=0;
       if (ds.version>0x05) {
@@ -449,7 +454,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
         logD("ALG %d FB %d FMS %d AMS %d OPS %d",ins->fm.alg,ins->fm.fb,ins->fm.fms,ins->fm.ams,ins->fm.ops);
         if (ins->fm.ops!=2 && ins->fm.ops!=4) {
           logE("invalid op count %d. did we read it wrong?",ins->fm.ops);
-          lastError="file is corrupt or unreadable at operators";
+          loadError="file is corrupt or unreadable at operators";
           delete[] file;
           return false;
         }
@@ -715,6 +720,11 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
       logI("reading wavetables (%d)...",ds.waveLen);
       if (ds.waveLen>0) ds.wave.reserve(ds.waveLen);
       for (int i=0; i<ds.waveLen; i++) {
+        if (!loadStep(DIV_LOAD_WAVETABLES,i,ds.waveLen)) {
+          ds.unload();
+          delete[] file;
+          return false;
+        }
         DivWavetable* wave=new DivWavetable;
         wave->len=(unsigned char)reader.readI();
         if (ds.system[0]==DIV_SYSTEM_GB) {
@@ -725,7 +735,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
         }
         if (wave->len>65) {
           logE("invalid wave length %d. are we doing something wrong?",wave->len);
-          lastError="file is corrupt or unreadable at wavetables";
+          loadError="file is corrupt or unreadable at wavetables";
           delete[] file;
           return false;
         }
@@ -760,6 +770,11 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
     logI("reading patterns (%d channels, %d orders)...",getChannelCount(ds.system[0]),ds.subsong[0]->ordersLen);
     for (int i=0; i<getChannelCount(ds.system[0]); i++) {
       DivChannelData& chan=ds.subsong[0]->pat[i];
+        if (!loadStep(DIV_LOAD_PATTERNS,i,getChannelCount(ds.system[0]))) {
+          ds.unload();
+          delete[] file;
+          return false;
+        }
       if (ds.version<0x0a) {
         chan.effectCols=1;
       } else {
@@ -768,7 +783,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
       logD("%d fx rows: %d",i,chan.effectCols);
       if (chan.effectCols>4 || chan.effectCols<1) {
         logE("invalid effect column count %d. are you sure everything is ok?",chan.effectCols);
-        lastError="file is corrupt or unreadable at effect columns";
+        loadError="file is corrupt or unreadable at effect columns";
         delete[] file;
         return false;
       }
@@ -885,6 +900,11 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
     }
     if (ds.sampleLen>0) ds.sample.reserve(ds.sampleLen);
     for (int i=0; i<ds.sampleLen; i++) {
+      if (!loadStep(DIV_LOAD_SAMPLES,i,ds.sampleLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       DivSample* sample=new DivSample;
       int length=reader.readI();
       int cutStart=0;
@@ -895,7 +915,7 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
       unsigned char* adpcmData;
       if (length<0) {
         logE("invalid sample length %d. are we doing something wrong?",length);
-        lastError="file is corrupt or unreadable at samples";
+        loadError="file is corrupt or unreadable at samples";
         delete[] file;
         return false;
       }
@@ -985,19 +1005,19 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
           if (ds.version>=0x1b) {
             if (cutStart<0 || cutStart>scaledLen) {
               logE("cutStart is out of range! (%d, scaledLen: %d)",cutStart,scaledLen);
-              lastError="file is corrupt or unreadable at samples";
+              loadError="file is corrupt or unreadable at samples";
               delete[] file;
               return false;
             }
             if (cutEnd<0 || cutEnd>scaledLen) {
               logE("cutEnd is out of range! (%d, scaledLen: %d)",cutEnd,scaledLen);
-              lastError="file is corrupt or unreadable at samples";
+              loadError="file is corrupt or unreadable at samples";
               delete[] file;
               return false;
             }
             if (cutEnd<cutStart) {
               logE("cutEnd %d is before cutStart %d. what's going on?",cutEnd,cutStart);
-              lastError="file is corrupt or unreadable at samples";
+              loadError="file is corrupt or unreadable at samples";
               delete[] file;
               return false;
             }
@@ -1111,25 +1131,10 @@ bool DivEngine::loadDMF(unsigned char* file, size_t len) {
 
     ds.systemName=getSongSystemLegacyName(ds,!getConfInt("noMultiSystem",0));
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
   } catch (EndOfFileException& e) {
     logE("premature end of file!");
-    lastError="incomplete file";
+    loadError="incomplete file";
     delete[] file;
     return false;
   }
@@ -1573,7 +1578,7 @@ SafeWriter* DivEngine::saveDMF(unsigned char version) {
     w->writeC(curPat[i].effectCols);
 
     for (int j=0; j<curSubSong->ordersLen; j++) {
-      DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][j],false);
+      const DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][j],false);
       for (int k=0; k<curSubSong->patLen; k++) {
         if ((pat->data[k][0]==101 || pat->data[k][0]==102) && pat->data[k][1]==0) {
           w->writeS(100);
@@ -113,7 +113,7 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
   bool success=false;
   char magic[4]={0,0,0,0};
   SafeReader reader=SafeReader(file,len);
-  warnings="";
+  loadWarnings="";
   bool isFC14=false;
   unsigned int patPtr, freqMacroPtr, volMacroPtr, samplePtr, wavePtr;
   unsigned int seqLen, patLen, freqMacroLen, volMacroLen, sampleLen;
@@ -157,7 +157,7 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     // load here
     if (!reader.seek(0,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -272,7 +272,7 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     // patterns
     if (!reader.seek(patPtr,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -293,7 +293,7 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     // freq sequences
     if (!reader.seek(freqMacroPtr,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -309,7 +309,7 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     // vol sequences
     if (!reader.seek(volMacroPtr,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -325,7 +325,7 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     // samples
     if (!reader.seek(samplePtr,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -352,7 +352,7 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     if (isFC14) {
       if (!reader.seek(wavePtr,SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete[] file;
         return false;
       }
@@ -396,6 +396,11 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     ds.waveLen=(int)ds.wave.size();
 
     // convert
+    if (!loadStep(DIV_LOAD_PATTERNS,0,1)) {
+      ds.unload();
+      delete[] file;
+      return false;
+    }
     ds.subsong[0]->ordersLen=seqLen;
     ds.subsong[0]->patLen=32;
     ds.subsong[0]->hz=50;
@@ -679,29 +684,14 @@ bool DivEngine::loadFC(unsigned char* file, size_t len) {
     ds.subsong[0]->optimizePatterns();
     ds.subsong[0]->rearrangePatterns();
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
     success=true;
   } catch (EndOfFileException& e) {
     //logE("premature end of file!");
-    lastError="incomplete file";
+    loadError="incomplete file";
   } catch (InvalidHeaderException& e) {
     //logE("invalid header!");
-    lastError="invalid header!";
+    loadError="invalid header!";
   }
   return success;
 }
@@ -18,13 +18,214 @@
  */
 
 #include "fileOpsCommon.h"
+#include "../../fileutils.h"
+#include <errno.h>
+
+void _runLoadThread(DivEngine* caller) {
+  caller->runLoadThread();
+}
+
+void DivEngine::installSong(DivSong& ds) {
+  // most loaders write every row, so free the ones left empty
+  for (DivSubSong* i: ds.subsong) {
+    i->compactPatterns();
+  }
+  // and macros are filled in place as well, so pack them
+  for (DivInstrument* i: ds.ins) {
+    i->std.compact();
+  }
+
+  if (asyncLoad) {
+    // render sample formats here rather than in the main thread
+    unsigned int formatMask=1U<<16;
+    for (int i=0; i<ds.systemLen; i++) {
+      const DivSysDef* s=getSystemDef(ds.system[i]);
+      if (s==NULL) continue;
+      formatMask|=s->sampleFormatMask;
+    }
+    loadStep(DIV_LOAD_RENDER_SAMPLES);
+    renderSampleFormats(ds.sample,formatMask);
+    pendingSong=new DivSong(ds);
+    return;
+  }
+
+  if (active) quitDispatch();
+  BUSY_BEGIN_SOFT;
+  saveLock.lock();
+  song.unload();
+  song=ds;
+  changeSong(0);
+  recalcChans();
+  saveLock.unlock();
+  BUSY_END;
+  if (active) {
+    initDispatch();
+    BUSY_BEGIN;
+    renderSamples();
+    reset();
+    BUSY_END;
+  }
+}
+
+bool DivEngine::loadStep(DivLoadStage stage, int pos, int total) {
+  loadStage=stage;
+  loadProgress=(total>0)?((float)pos/(float)total):0.0f;
+  if (asyncLoad && loadCancel) {
+    loadError="loading cancelled";
+    return false;
+  }
+  return true;
+}
+
+void DivEngine::runLoadThread() {
+  logI("loading %s in the background...",loadPath);
+  // only this thread reads the flag, and only while it runs
+  asyncLoad=true;
+  loadError="";
+  loadWarnings="";
+  loadStep(DIV_LOAD_READ);
+  FILE* f=ps_fopen(loadPath.c_str(),"rb");
+  if (f==NULL) {
+    loadError=strerror(errno);
+    asyncLoad=false;
+    loadStage=DIV_LOAD_DONE;
+    return;
+  }
+  if (fseek(f,0,SEEK_END)<0) {
+    loadError=fmt::sprintf("on seek: %s",strerror(errno));
+    fclose(f);
+    asyncLoad=false;
+    loadStage=DIV_LOAD_DONE;
+    return;
+  }
+  ssize_t len=ftell(f);
+  if (len<1) {
+    loadError=(len==0)?"file is empty":fmt::sprintf("on tell: %s",strerror(errno));
+    fclose(f);
+    asyncLoad=false;
+    loadStage=DIV_LOAD_DONE;
+    return;
+  }
+  if (fseek(f,0,SEEK_SET)<0) {
+    loadError=fmt::sprintf("on get size: %s",strerror(errno));
+    fclose(f);
+    asyncLoad=false;
+    loadStage=DIV_LOAD_DONE;
+    return;
+  }
+  unsigned char* file=new unsigned char[len];
+  if (fread(file,1,(size_t)len,f)!=(size_t)len) {
+    loadError=fmt::sprintf("on read: %s",strerror(errno));
+    fclose(f);
+    delete[] file;
+    asyncLoad=false;
+    loadStage=DIV_LOAD_DONE;
+    return;
+  }
+  fclose(f);
+
+  if (loadStep(DIV_LOAD_DECOMPRESS)) {
+    loadFile(file,(size_t)len,loadPath.c_str());
+  } else {
+    delete[] file;
+  }
+  asyncLoad=false;
+  loadStage=DIV_LOAD_DONE;
+}
+
+bool DivEngine::loadAsync(String path) {
+  if (loadThread!=NULL) {
+    lastError="a song is already being loaded";
+    return false;
+  }
+  if (!systemsRegistered) registerSystems();
+  loadPath=path;
+  loadCancel=false;
+  loadProgress=0.0f;
+  loadStage=DIV_LOAD_READ;
+  loadThread=new std::thread(_runLoadThread,this);
+  return true;
+}
+
+bool DivEngine::isLoading() {
+  return loadThread!=NULL && loadStage!=DIV_LOAD_DONE;
+}
+
+DivLoadStage DivEngine::getLoadStage(float* progress) {
+  if (progress!=NULL) *progress=loadProgress;
+  return (DivLoadStage)(int)loadStage;
+}
+
+void DivEngine::cancelLoad() {
+  loadCancel=true;
+}
+
+bool DivEngine::finishLoadAsync() {
+  if (loadThread==NULL) return false;
+  loadThread->join();
+  delete loadThread;
+  loadThread=NULL;
+  loadStage=DIV_LOAD_IDLE;
+  bool cancelled=loadCancel;
+  loadCancel=false;
+
+  // publish what the load thread collected
+  warnings=loadWarnings;
+  if (cancelled) {
+    lastError="loading cancelled";
+    if (pendingSong!=NULL) {
+      pendingSong->unload();
+      delete pendingSong;
+      pendingSong=NULL;
+    }
+    return false;
+  }
+  if (pendingSong==NULL) {
+    lastError=loadError;
+    return false;
+  }
+
+  if (active) quitDispatch();
+  BUSY_BEGIN_SOFT;
+  saveLock.lock();
+  song.unload();
+  song=*pendingSong;
+  changeSong(0);
+  recalcChans();
+  saveLock.unlock();
+  BUSY_END;
+  delete pendingSong;
+  pendingSong=NULL;
+  if (active) {
+    initDispatch();
+    BUSY_BEGIN;
+    renderSamples(-1,true);
+    reset();
+    BUSY_END;
+  }
+  return true;
+}
 
 bool DivEngine::load(unsigned char* f, size_t slen, const char* nameHint) {
+  // a synchronous load replaces a background one
+  if (loadThread!=NULL) {
+    cancelLoad();
+    finishLoadAsync();
+  }
+  loadError="";
+  loadWarnings="";
+  bool ret=loadFile(f,slen,nameHint);
+  if (!ret) lastError=loadError;
+  warnings=loadWarnings;
+  return ret;
+}
+
+bool DivEngine::loadFile(unsigned char* f, size_t slen, const char* nameHint) {
   unsigned char* file;
   size_t len;
   if (slen<21) {
     logE("too small!");
-    lastError="file is too small";
+    loadError="file is too small";
     delete[] f;
     return false;
   }
@@ -47,90 +248,24 @@ bool DivEngine::load(unsigned char* f, size_t slen, const char* nameHint) {
   }
 
   // step 1: try loading as a zlib-compressed file
+  // this inflates straight into one buffer, without intermediate blocks.
   logD("trying zlib...");
+  loadStep(DIV_LOAD_DECOMPRESS);
   try {
-    z_stream zl;
-    memset(&zl,0,sizeof(z_stream));
-
-    zl.avail_in=slen;
-    zl.next_in=(Bytef*)f;
-    zl.zalloc=NULL;
-    zl.zfree=NULL;
-    zl.opaque=NULL;
-
-    int nextErr;
-    nextErr=inflateInit(&zl);
-    if (nextErr!=Z_OK) {
-      if (zl.msg==NULL) {
-        logD("zlib error: unknown! %d",nextErr);
-      } else {
-        logD("zlib error: %s",zl.msg);
-      }
-      inflateEnd(&zl);
-      lastError="not a .dmf/.fur song";
-      throw NotZlibException(0);
-    }
-
-    std::vector<InflateBlock*> blocks;
-    while (true) {
-      InflateBlock* ib=new InflateBlock(DIV_READ_SIZE);
-      zl.next_out=ib->buf;
-      zl.avail_out=ib->len;
-
-      nextErr=inflate(&zl,Z_SYNC_FLUSH);
-      if (nextErr!=Z_OK && nextErr!=Z_STREAM_END) {
-        if (zl.msg==NULL) {
-          logD("zlib error: unknown error! %d",nextErr);
-          lastError="unknown decompression error";
-        } else {
-          logD("zlib inflate: %s",zl.msg);
-          lastError=fmt::sprintf("decompression error: %s",zl.msg);
-        }
-        for (InflateBlock* i: blocks) delete i;
-        blocks.clear();
-        delete ib;
-        inflateEnd(&zl);
-        throw NotZlibException(0);
-      }
-      ib->blockSize=ib->len-zl.avail_out;
-      blocks.push_back(ib);
-      if (nextErr==Z_STREAM_END) {
-        break;
-      }
-    }
-    nextErr=inflateEnd(&zl);
-    if (nextErr!=Z_OK) {
-      if (zl.msg==NULL) {
-        logD("zlib end error: unknown error! %d",nextErr);
-        lastError="unknown decompression finish error";
-      } else {
-        logD("zlib end: %s",zl.msg);
-        lastError=fmt::sprintf("decompression finish error: %s",zl.msg);
-      }
-      for (InflateBlock* i: blocks) delete i;
-      blocks.clear();
-      throw NotZlibException(0);
-    }
-
+    SafeReader reader(f,slen);
+    String zlibError;
     size_t finalSize=0;
-    size_t curSeek=0;
-    for (InflateBlock* i: blocks) {
-      finalSize+=i->blockSize;
+    file=reader.readInflated(finalSize,zlibError);
+    if (file==NULL) {
+      loadError=zlibError;
+      throw NotZlibException(0);
     }
     if (finalSize<1) {
       logD("compressed too small!");
-      lastError="file too small";
-      for (InflateBlock* i: blocks) delete i;
-      blocks.clear();
+      loadError="file too small";
+      delete[] file;
       throw NotZlibException(0);
     }
-    file=new unsigned char[finalSize];
-    for (InflateBlock* i: blocks) {
-      memcpy(&file[curSeek],i->buf,i->blockSize);
-      curSeek+=i->blockSize;
-      delete i;
-    }
-    blocks.clear();
     len=finalSize;
     delete[] f;
   } catch (NotZlibException& e) {
@@ -140,6 +275,25 @@ bool DivEngine::load(unsigned char* f, size_t slen, const char* nameHint) {
   }
 
   // step 2: try loading as .fur, .dmf, or another magic-ful format
+  loadStep(DIV_LOAD_PARSE);
+  if (len>=16 && memcmp(file,DIV_JOURNAL_MAGIC,16)==0) {
+    // backup journal. restore the last backup in it
+    logD("loading backup journal...");
+    String replayError;
+    size_t furLen=0;
+    unsigned char* fur=DivBackupJournal::replay(file,len,furLen,replayError);
+    delete[] file;
+    if (fur==NULL) {
+      loadError=replayError;
+      return false;
+    }
+    if (furLen<16 || memcmp(fur,DIV_FUR_MAGIC,16)!=0) {
+      loadError="the journal does not contain a valid song";
+      delete[] fur;
+      return false;
+    }
+    return loadFur(fur,furLen);
+  }
   if (memcmp(file,DIV_DMF_MAGIC,16)==0) {
     return loadDMF(file,len); 
   } else if (memcmp(file,DIV_FTM_MAGIC,18)==0) {
@@ -174,7 +328,7 @@ bool DivEngine::load(unsigned char* f, size_t slen, const char* nameHint) {
   
   // step 4: not a valid file
   logE("not a valid module!");
-  lastError="not a compatible song";
+  loadError="not a compatible song";
   delete[] file;
   return false;
 }
@@ -23,23 +23,6 @@
 #include <zlib.h>
 #include <fmt/printf.h>
 
-#define DIV_READ_SIZE 131072
-
-struct InflateBlock {
-  unsigned char* buf;
-  size_t len;
-  size_t blockSize;
-  InflateBlock(size_t s) {
-    buf=new unsigned char[s];
-    len=s;
-    blockSize=0;
-  }
-  ~InflateBlock() {
-    delete[] buf;
-    len=0;
-  }
-};
-
 struct NotZlibException {
   int what;
   NotZlibException(int w):
@@ -424,7 +424,7 @@ void copyMacro(DivInstrument* ins, DivInstrumentMacro* from, int macro_type, int
 
 bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_sig, bool eft) {
   SafeReader reader = SafeReader(file, len);
-  warnings = "";
+  loadWarnings = "";
   try {
     DivSong ds;
     String blockName;
@@ -465,7 +465,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
     if (!reader.seek((dnft && dnft_sig) ? 21 : 18, SEEK_SET)) {
       logE("premature end of file!");
-      lastError = "incomplete file";
+      loadError = "incomplete file";
       delete[] file;
       return false;
     }
@@ -474,7 +474,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
     if ((ds.version > 0x0450 && !eft) || (eft && ds.version > 0x0460)) {
       logE("incompatible version %x!", ds.version);
-      lastError = "incompatible version";
+      loadError = "incompatible version";
       delete[] file;
       return false;
     }
@@ -490,6 +490,11 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
     unsigned int pal = 0;
 
     while (true) {
+      if (!loadStep(DIV_LOAD_PARSE,(int)reader.tell(),(int)len)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       blockName = reader.readString(3);
       if (blockName == "END") {
         // end of module
@@ -500,7 +505,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
       // not the end
       if (!reader.seek(-3, SEEK_CUR)) {
         logE("couldn't seek back by 3!");
-        lastError = "couldn't seek back by 3";
+        loadError = "couldn't seek back by 3";
         delete[] file;
         return false;
       }
@@ -514,7 +519,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
       for (String& i: encounteredBlocks) {
         if (blockName==i) {
           logE("duplicate block %s!",blockName);
-          lastError = "duplicate block "+blockName;
+          loadError = "duplicate block "+blockName;
           ds.unload();
           delete[] file;
           return false;
@@ -545,7 +550,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
         if (tchans>=DIV_MAX_CHANS) {
           logE("invalid channel count! %d",tchans);
-          lastError = "invalid channel count";
+          loadError = "invalid channel count";
           delete[] file;
           return false;
         }
@@ -606,7 +611,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           n163Chans = reader.readI();
           if (n163Chans<1 || n163Chans>=9) {
             logE("invalid Namco 163 channel count! %d",n163Chans);
-            lastError = "invalid Namco 163 channel count";
+            loadError = "invalid Namco 163 channel count";
             delete[] file;
             return false;
           }
@@ -636,7 +641,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
         logV("split point: %d", speedSplitPoint);
         logV("sweep reset: %d", sweepReset);
 
-        //addWarning("FamiTracker import is experimental.");
+        //addLoadWarning("FamiTracker import is experimental.");
 
         // initialize channels
         int systemID = 0;
@@ -817,14 +822,14 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           if (!eft || (eft && (expansions & 8) == 0)) // ignore since I have no idea how to tell apart E-FT versions which do or do not have PCM chan. Yes, this may lead to all the righer channels to be shifted but at least you still get note data!
           {
             logE("channel counts do not match! %d != %d", tchans, calcChans);
-            lastError = "channel counts do not match";
+            loadError = "channel counts do not match";
             delete[] file;
             return false;
           }
         }
         if (tchans > DIV_MAX_CHANS) {
           logE("too many channels!");
-          lastError = "too many channels";
+          loadError = "too many channels";
           delete[] file;
           return false;
         }
@@ -832,7 +837,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
         {
           if (!reader.seek(2, SEEK_CUR)) {
             logE("could not weird-seek by 2!");
-            lastError = "could not weird-seek by 2";
+            loadError = "could not weird-seek by 2";
             delete[] file;
             return false;
           }
@@ -871,7 +876,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
             if (effectCols>7) {
               logE("too many effect columns!");
-              lastError = "too many effect columns";
+              loadError = "too many effect columns";
               delete[] file;
               return false;
             }
@@ -898,7 +903,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
         ds.insLen = reader.readI();
         if (ds.insLen < 0 || ds.insLen > 256) {
           logE("too many instruments/out of range!");
-          lastError = "too many instruments/out of range";
+          loadError = "too many instruments/out of range";
           delete[] file;
           return false;
         }
@@ -914,7 +919,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int insIndex = reader.readI();
           if (insIndex >= ds.ins.size()) {
             logE("instrument index %d is out of range!",insIndex);
-            lastError="instrument index out of range";
+            loadError="instrument index out of range";
             delete[] file;
             return false;
           }
@@ -945,7 +950,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
               break;
             default: {
               logE("%d: invalid instrument type %d", insIndex, insType);
-              lastError = "invalid instrument type";
+              loadError = "invalid instrument type";
               delete[] file;
               return false;
             }
@@ -957,7 +962,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
               unsigned int totalSeqs = reader.readI();
               if (totalSeqs > 5) {
                 logE("%d: too many sequences!", insIndex);
-                lastError = "too many sequences";
+                loadError = "too many sequences";
                 delete[] file;
                 return false;
               }
@@ -982,7 +987,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
                 }
                 if (note<0 || note>=120) {
                   logE("DPCM note %d out of range!",note);
-                  lastError = "DPCM note out of range";
+                  loadError = "DPCM note out of range";
                   delete[] file;
                   return false;
                 }
@@ -1017,7 +1022,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
               unsigned int totalSeqs = reader.readI();
               if (totalSeqs > 5) {
                 logE("%d: too many sequences!", insIndex);
-                lastError = "too many sequences";
+                loadError = "too many sequences";
                 delete[] file;
                 return false;
               }
@@ -1091,7 +1096,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
               if (!reader.seek(-8, SEEK_CUR)) {
                 logE("couldn't seek back by 8 reading FDS ins");
-                lastError = "couldn't seek back by 8 reading FDS ins";
+                loadError = "couldn't seek back by 8 reading FDS ins";
                 delete[] file;
                 return false;
               }
@@ -1156,7 +1161,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
               unsigned int totalSeqs = reader.readI();
               if (totalSeqs > 5) {
                 logE("%d: too many sequences!", insIndex);
-                lastError = "too many sequences";
+                loadError = "too many sequences";
                 delete[] file;
                 return false;
               }
@@ -1181,7 +1186,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
               if (wave_size>256) {
                 logE("wave size %d out of range",wave_size);
-                lastError = "wave size out of range";
+                loadError = "wave size out of range";
                 delete[] file;
                 return false;
               }
@@ -1222,7 +1227,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
               unsigned int totalSeqs = reader.readI();
               if (totalSeqs > 5) {
                 logE("%d: too many sequences!", insIndex);
-                lastError ="too many sequences";
+                loadError ="too many sequences";
                 delete[] file;
                 return false;
               }
@@ -1351,7 +1356,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
                   seek_amount -= 4;
                   if (totalSeqs > 5) {
                     logE("%d: too many sequences!", insIndex);
-                    lastError = "too many sequences";
+                    loadError = "too many sequences";
                     delete[] file;
                     return false;
                   }
@@ -1368,7 +1373,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
                   // I know right?
                   if (!reader.seek(seek_amount, SEEK_CUR)) {
                     logE("EFT seek fail");
-                    lastError = "EFT seek fail";
+                    loadError = "EFT seek fail";
                     delete[] file;
                     return false;
                   }
@@ -1385,7 +1390,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
               } else {
                 if (!reader.seek(-4, SEEK_CUR)) {
                   logE("EFT -4 seek fail");
-                  lastError = "EFT -4 seek fail";
+                  loadError = "EFT -4 seek fail";
                   delete[] file;
                   return false;
                 }
@@ -1396,7 +1401,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
             default: {
               logE("%d: what's going on here?", insIndex);
-              lastError = "invalid instrument type";
+              loadError = "invalid instrument type";
               delete[] file;
               return false;
             }
@@ -1412,7 +1417,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
         CHECK_BLOCK_VERSION(6);
 
         if (blockVersion < 2) {
-          lastError = "sequences block version is too old";
+          loadError = "sequences block version is too old";
           delete[] file;
           return false;
         }
@@ -1427,7 +1432,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
             if (index>=256 || type>=8) {
               logE("%d: index/type out of range",i);
-              lastError = "sequence index/type out of range";
+              loadError = "sequence index/type out of range";
               delete[] file;
               return false;
             }
@@ -1458,7 +1463,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
             unsigned int index = reader.readI();
             if (index>=128*5) {
               logE("%d: index out of range",i);
-              lastError = "sequence index out of range";
+              loadError = "sequence index out of range";
               delete[] file;
               return false;
             }
@@ -1466,7 +1471,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
             unsigned int type = reader.readI();
             if (type>=128*5) {
               logE("%d: type out of range",i);
-              lastError = "sequence type out of range";
+              loadError = "sequence type out of range";
               delete[] file;
               return false;
             }
@@ -1474,7 +1479,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
             if (index>=256 || type>=8) {
               logE("%d: index/type out of range",i);
-              lastError = "sequence index/type out of range";
+              loadError = "sequence index/type out of range";
               delete[] file;
               return false;
             }
@@ -1605,7 +1610,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           int framesLen=reader.readI();
           if (framesLen<1 || framesLen>256) {
             logE("frames out of range (%d)",framesLen);
-            lastError = "frames out of range";
+            loadError = "frames out of range";
             delete[] file;
             return false;
           }
@@ -1628,7 +1633,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
             int patLen=reader.readI();
             if (patLen<1 || patLen>256) {
               logE("pattern length out of range");
-              lastError = "pattern length out of range";
+              loadError = "pattern length out of range";
               delete[] file;
               return false;
             }
@@ -1639,7 +1644,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
             why = reader.readI();
             if (why<0 || why>=DIV_MAX_CHANS) {
               logE("why out of range!");
-              lastError = "why out of range";
+              loadError = "why out of range";
               delete[] file;
               return false;
             }
@@ -1663,7 +1668,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           int patLenOld = reader.readI();
           if (patLenOld<1 || patLenOld>=256) {
             logE("old pattern length out of range");
-            lastError = "old pattern length out of range";
+            loadError = "old pattern length out of range";
             delete[] file;
             return false;
           }
@@ -1689,31 +1694,31 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
           if (subs<0 || subs>=(int)ds.subsong.size()) {
             logE("subsong out of range!");
-            lastError = "subsong out of range";
+            loadError = "subsong out of range";
             delete[] file;
             return false;
           }
           if (ch<0 || ch>=DIV_MAX_CHANS) {
             logE("channel out of range!");
-            lastError = "channel out of range";
+            loadError = "channel out of range";
             delete[] file;
             return false;
           }
           if (map_channels[ch]>=DIV_MAX_CHANS) {
             logE("mapped channel out of range!");
-            lastError = "mapped channel out of range";
+            loadError = "mapped channel out of range";
             delete[] file;
             return false;
           }
           if (patNum<0 || patNum>=256) {
             logE("pattern number out of range!");
-            lastError = "pattern number out of range";
+            loadError = "pattern number out of range";
             delete[] file;
             return false;
           }
           if (numRows<0) {
             logE("row count is negative!");
-            lastError = "row count is negative";
+            loadError = "row count is negative";
             delete[] file;
             return false;
           }
@@ -1729,7 +1734,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
             if (row>=256) {
               logE("row index out of range");
-              lastError = "row index out of range";
+              loadError = "row index out of range";
               delete[] file;
               return false;
             }
@@ -1977,7 +1982,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
           if (sample_len>=2097152) {
             logE("%d: sample too large! %d",index,sample_len);
-            lastError = "sample too large";
+            loadError = "sample too large";
             delete[] file;
             return false;
           }
@@ -2019,7 +2024,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int index = reader.readI();
           if (index>=128*5) {
             logE("%d: index out of range",i);
-            lastError = "sequence index out of range";
+            loadError = "sequence index out of range";
             delete[] file;
             return false;
           }
@@ -2027,7 +2032,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int type = reader.readI();
           if (type>=128*5) {
             logE("%d: type out of range",i);
-            lastError = "sequence type out of range";
+            loadError = "sequence type out of range";
             delete[] file;
             return false;
           }
@@ -2035,7 +2040,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
           if (index>=256 || type>=8) {
             logE("%d: index/type out of range",i);
-            lastError = "sequence index/type out of range";
+            loadError = "sequence index/type out of range";
             delete[] file;
             return false;
           }
@@ -2137,7 +2142,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int index = reader.readI();
           if (index>=128*5) {
             logE("%d: index out of range",i);
-            lastError = "sequence index out of range";
+            loadError = "sequence index out of range";
             delete[] file;
             return false;
           }
@@ -2145,7 +2150,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int type = reader.readI();
           if (type>=128*5) {
             logE("%d: type out of range",i);
-            lastError = "sequence type out of range";
+            loadError = "sequence type out of range";
             delete[] file;
             return false;
           }
@@ -2153,7 +2158,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
           if (index>=256 || type>=8) {
             logE("%d: index/type out of range",i);
-            lastError = "sequence index/type out of range";
+            loadError = "sequence index/type out of range";
             delete[] file;
             return false;
           }
@@ -2204,7 +2209,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int index = reader.readI();
           if (index>=128*5) {
             logE("%d: index out of range",i);
-            lastError = "sequence index out of range";
+            loadError = "sequence index out of range";
             delete[] file;
             return false;
           }
@@ -2212,7 +2217,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int type = reader.readI();
           if (type>=128*5) {
             logE("%d: type out of range",i);
-            lastError = "sequence type out of range";
+            loadError = "sequence type out of range";
             delete[] file;
             return false;
           }
@@ -2220,7 +2225,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
           if (index>=256 || type>=8) {
             logE("%d: index/type out of range",i);
-            lastError = "sequence index/type out of range";
+            loadError = "sequence index/type out of range";
             delete[] file;
             return false;
           }
@@ -2270,7 +2275,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int index = reader.readI();
           if (index>=128*5) {
             logE("%d: index out of range",i);
-            lastError = "sequence index out of range";
+            loadError = "sequence index out of range";
             delete[] file;
             return false;
           }
@@ -2278,7 +2283,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
           unsigned int type = reader.readI();
           if (type>=128*5) {
             logE("%d: type out of range",i);
-            lastError = "sequence type out of range";
+            loadError = "sequence type out of range";
             delete[] file;
             return false;
           }
@@ -2286,7 +2291,7 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
 
           if (index>=256 || type>=8) {
             logE("%d: index/type out of range",i);
-            lastError = "sequence index/type out of range";
+            loadError = "sequence index/type out of range";
             delete[] file;
             return false;
           }
@@ -2378,14 +2383,14 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
         reader.seek(blockSize, SEEK_CUR);
       } else {
         logE("block %s is unknown!", blockName);
-        lastError = "unknown block " + blockName;
+        loadError = "unknown block " + blockName;
         delete[] file;
         return false;
       }
 
       if ((reader.tell() - blockStart) != blockSize) {
         logE("block %s is incomplete! reader.tell()-blockStart %d blockSize %d", blockName, (reader.tell() - blockStart), blockSize);
-        lastError = "incomplete block " + blockName;
+        loadError = "incomplete block " + blockName;
         delete[] file;
         return false;
       }
@@ -2661,25 +2666,10 @@ bool DivEngine::loadFTM(unsigned char* file, size_t len, bool dnft, bool dnft_si
     ds.sampleLen = ds.sample.size();
     ds.waveLen = ds.wave.size();
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
   } catch (EndOfFileException& e) {
     logE("premature end of file!");
-    lastError = "incomplete file";
+    loadError = "incomplete file";
     delete[] file;
     return false;
   }
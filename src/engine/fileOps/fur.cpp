@@ -703,7 +703,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
   char magic[5];
   memset(magic,0,5);
   SafeReader reader=SafeReader(file,len);
-  warnings="";
+  loadWarnings="";
   assetDirPtr[0]=0;
   assetDirPtr[1]=0;
   assetDirPtr[2]=0;
@@ -713,7 +713,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
     if (!reader.seek(16,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -722,12 +722,12 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
     if (variantID!=DIV_FUR_VARIANT_VANILLA) {
       logW("Furnace variant detected: %d",variantID);
-      addWarning("this module was created with a downstream version of Furnace. certain features may not be compatible.");
+      addLoadWarning("this module was created with a downstream version of Furnace. certain features may not be compatible.");
     }
 
     if (ds.version>DIV_ENGINE_VERSION) {
       logW("this module was created with a more recent version of Furnace!");
-      addWarning("this module was created with a more recent version of Furnace!");
+      addLoadWarning("this module was created with a more recent version of Furnace!");
     }
 
     if (ds.version<37) { // compat flags not stored back then
@@ -871,7 +871,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
     if (!reader.seek(infoSeek,SEEK_SET)) {
       logE("couldn't seek to info header at %d!",infoSeek);
-      lastError="couldn't seek to info header!";
+      loadError="couldn't seek to info header!";
       delete[] file;
       return false;
     }
@@ -880,7 +880,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
     reader.read(magic,4);
     if (strcmp(magic,"INFO")!=0) {
       logE("invalid info header!");
-      lastError="invalid info header!";
+      loadError="invalid info header!";
       delete[] file;
       return false;
     }
@@ -906,49 +906,49 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
     if (subSong->patLen<0) {
       logE("pattern length is negative!");
-      lastError="pattern lengrh is negative!";
+      loadError="pattern lengrh is negative!";
       delete[] file;
       return false;
     }
     if (subSong->patLen>DIV_MAX_ROWS) {
       logE("pattern length is too large!");
-      lastError="pattern length is too large!";
+      loadError="pattern length is too large!";
       delete[] file;
       return false;
     }
     if (subSong->ordersLen<0) {
       logE("song length is negative!");
-      lastError="song length is negative!";
+      loadError="song length is negative!";
       delete[] file;
       return false;
     }
     if (subSong->ordersLen>DIV_MAX_PATTERNS) {
       logE("song is too long!");
-      lastError="song is too long!";
+      loadError="song is too long!";
       delete[] file;
       return false;
     }
     if (ds.insLen<0 || ds.insLen>256) {
       logE("invalid instrument count!");
-      lastError="invalid instrument count!";
+      loadError="invalid instrument count!";
       delete[] file;
       return false;
     }
     if (ds.waveLen<0 || ds.waveLen>256) {
       logE("invalid wavetable count!");
-      lastError="invalid wavetable count!";
+      loadError="invalid wavetable count!";
       delete[] file;
       return false;
     }
     if (ds.sampleLen<0 || ds.sampleLen>256) {
       logE("invalid sample count!");
-      lastError="invalid sample count!";
+      loadError="invalid sample count!";
       delete[] file;
       return false;
     }
     if (numberOfPats<0) {
       logE("invalid pattern count!");
-      lastError="invalid pattern count!";
+      loadError="invalid pattern count!";
       delete[] file;
       return false;
     }
@@ -961,7 +961,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
       logD("- %d: %.2x (%s)",i,sysID,getSystemName(ds.system[i]));
       if (sysID!=0 && systemToFileFur(ds.system[i])==0) {
         logE("unrecognized system ID %.2x",sysID);
-        lastError=fmt::sprintf("unrecognized system ID %.2x!",sysID);
+        loadError=fmt::sprintf("unrecognized system ID %.2x!",sysID);
         delete[] file;
         return false;
       }
@@ -978,7 +978,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
     logV("system len: %d",ds.systemLen);
     if (ds.systemLen<1) {
       logE("zero chips!");
-      lastError="zero chips!";
+      loadError="zero chips!";
       delete[] file;
       return false;
     }
@@ -1165,7 +1165,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
       subSong->pat[i].effectCols=reader.readC();
       if (subSong->pat[i].effectCols<1 || subSong->pat[i].effectCols>DIV_MAX_EFFECTS) {
         logE("channel %d has zero or too many effect columns! (%d)",i,subSong->pat[i].effectCols);
-        lastError=fmt::sprintf("channel %d has too many effect columns! (%d)",i,subSong->pat[i].effectCols);
+        loadError=fmt::sprintf("channel %d has too many effect columns! (%d)",i,subSong->pat[i].effectCols);
         delete[] file;
         return false;
       }
@@ -1458,7 +1458,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
         if (!reader.seek(sysFlagsPtr[i],SEEK_SET)) {
           logE("couldn't seek to chip %d flags!",i+1);
-          lastError=fmt::sprintf("couldn't seek to chip %d flags!",i+1);
+          loadError=fmt::sprintf("couldn't seek to chip %d flags!",i+1);
           ds.unload();
           delete[] file;
           return false;
@@ -1467,7 +1467,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
         reader.read(magic,4);
         if (strcmp(magic,"FLAG")!=0) {
           logE("%d: invalid flag header!",i);
-          lastError="invalid flag header!";
+          loadError="invalid flag header!";
           ds.unload();
           delete[] file;
           return false;
@@ -1490,13 +1490,13 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
       if (!reader.seek(assetDirPtr[0],SEEK_SET)) {
         logE("couldn't seek to ins dir!");
-        lastError=fmt::sprintf("couldn't read instrument directory");
+        loadError=fmt::sprintf("couldn't read instrument directory");
         ds.unload();
         delete[] file;
         return false;
       }
       if (readAssetDirData(reader,ds.insDir)!=DIV_DATA_SUCCESS) {
-        lastError="invalid instrument directory data!";
+        loadError="invalid instrument directory data!";
         ds.unload();
         delete[] file;
         return false;
@@ -1504,13 +1504,13 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
       if (!reader.seek(assetDirPtr[1],SEEK_SET)) {
         logE("couldn't seek to wave dir!");
-        lastError=fmt::sprintf("couldn't read wavetable directory");
+        loadError=fmt::sprintf("couldn't read wavetable directory");
         ds.unload();
         delete[] file;
         return false;
       }
       if (readAssetDirData(reader,ds.waveDir)!=DIV_DATA_SUCCESS) {
-        lastError="invalid wavetable directory data!";
+        loadError="invalid wavetable directory data!";
         ds.unload();
         delete[] file;
         return false;
@@ -1518,13 +1518,13 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
       if (!reader.seek(assetDirPtr[2],SEEK_SET)) {
         logE("couldn't seek to sample dir!");
-        lastError=fmt::sprintf("couldn't read sample directory");
+        loadError=fmt::sprintf("couldn't read sample directory");
         ds.unload();
         delete[] file;
         return false;
       }
       if (readAssetDirData(reader,ds.sampleDir)!=DIV_DATA_SUCCESS) {
-        lastError="invalid sample directory data!";
+        loadError="invalid sample directory data!";
         ds.unload();
         delete[] file;
         return false;
@@ -1538,7 +1538,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
         ds.subsong.push_back(new DivSubSong);
         if (!reader.seek(subSongPtr[i],SEEK_SET)) {
           logE("couldn't seek to subsong %d!",i+1);
-          lastError=fmt::sprintf("couldn't seek to subsong %d!",i+1);
+          loadError=fmt::sprintf("couldn't seek to subsong %d!",i+1);
           ds.unload();
           delete[] file;
           return false;
@@ -1547,7 +1547,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
         reader.read(magic,4);
         if (strcmp(magic,"SONG")!=0) {
           logE("%d: invalid subsong header!",i);
-          lastError="invalid subsong header!";
+          loadError="invalid subsong header!";
           ds.unload();
           delete[] file;
           return false;
@@ -1587,6 +1587,13 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
         for (int i=0; i<tchans; i++) {
           subSong->pat[i].effectCols=reader.readC();
+          if (subSong->pat[i].effectCols<1 || subSong->pat[i].effectCols>DIV_MAX_EFFECTS) {
+            logE("channel %d has zero or too many effect columns! (%d)",i,subSong->pat[i].effectCols);
+            loadError=fmt::sprintf("channel %d has too many effect columns! (%d)",i,subSong->pat[i].effectCols);
+            ds.unload();
+            delete[] file;
+            return false;
+          }
         }
 
         for (int i=0; i<tchans; i++) {
@@ -1624,11 +1631,16 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
     // read instruments
     ds.ins.reserve(ds.insLen);
     for (int i=0; i<ds.insLen; i++) {
+      if (!loadStep(DIV_LOAD_INSTRUMENTS,i,ds.insLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       DivInstrument* ins=new DivInstrument;
       logD("reading instrument %d at %x...",i,insPtr[i]);
       if (!reader.seek(insPtr[i],SEEK_SET)) {
         logE("couldn't seek to instrument %d!",i);
-        lastError=fmt::sprintf("couldn't seek to instrument %d!",i);
+        loadError=fmt::sprintf("couldn't seek to instrument %d!",i);
         ds.unload();
         delete ins;
         delete[] file;
@@ -1636,7 +1648,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
       }
       
       if (ins->readInsData(reader,ds.version)!=DIV_DATA_SUCCESS) {
-        lastError="invalid instrument header/data!";
+        loadError="invalid instrument header/data!";
         ds.unload();
         delete ins;
         delete[] file;
@@ -1649,11 +1661,16 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
     // read wavetables
     ds.wave.reserve(ds.waveLen);
     for (int i=0; i<ds.waveLen; i++) {
+      if (!loadStep(DIV_LOAD_WAVETABLES,i,ds.waveLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       DivWavetable* wave=new DivWavetable;
       logD("reading wavetable %d at %x...",i,wavePtr[i]);
       if (!reader.seek(wavePtr[i],SEEK_SET)) {
         logE("couldn't seek to wavetable %d!",i);
-        lastError=fmt::sprintf("couldn't seek to wavetable %d!",i);
+        loadError=fmt::sprintf("couldn't seek to wavetable %d!",i);
         ds.unload();
         delete wave;
         delete[] file;
@@ -1661,7 +1678,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
       }
 
       if (wave->readWaveData(reader,ds.version)!=DIV_DATA_SUCCESS) {
-        lastError="invalid wavetable header/data!";
+        loadError="invalid wavetable header/data!";
         ds.unload();
         delete wave;
         delete[] file;
@@ -1674,11 +1691,16 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
     // read samples
     ds.sample.reserve(ds.sampleLen);
     for (int i=0; i<ds.sampleLen; i++) {
+      if (!loadStep(DIV_LOAD_SAMPLES,i,ds.sampleLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       DivSample* sample=new DivSample;
 
       if (!reader.seek(samplePtr[i],SEEK_SET)) {
         logE("couldn't seek to sample %d!",i);
-        lastError=fmt::sprintf("couldn't seek to sample %d!",i);
+        loadError=fmt::sprintf("couldn't seek to sample %d!",i);
         ds.unload();
         delete sample;
         delete[] file;
@@ -1686,7 +1708,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
       }
 
       if (sample->readSampleData(reader,ds.version)!=DIV_DATA_SUCCESS) {
-        lastError="invalid sample header/data!";
+        loadError="invalid sample header/data!";
         ds.unload();
         delete sample;
         delete[] file;
@@ -1697,11 +1719,17 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
     }
 
     // read patterns
+    int patIndex=0;
     for (unsigned int i: patPtr) {
+      if (!loadStep(DIV_LOAD_PATTERNS,patIndex++,patPtr.size())) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       bool isNewFormat=false;
       if (!reader.seek(i,SEEK_SET)) {
         logE("couldn't seek to pattern in %x!",i);
-        lastError=fmt::sprintf("couldn't seek to pattern in %x!",i);
+        loadError=fmt::sprintf("couldn't seek to pattern in %x!",i);
         ds.unload();
         delete[] file;
         return false;
@@ -1711,7 +1739,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
       if (strcmp(magic,"PATR")!=0) {
         if (strcmp(magic,"PATN")!=0 || ds.version<157) {
           logE("%x: invalid pattern header!",i);
-          lastError="invalid pattern header!";
+          loadError="invalid pattern header!";
           ds.unload();
           delete[] file;
           return false;
@@ -1730,21 +1758,21 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
         if (chan<0 || chan>=tchans) {
           logE("pattern channel out of range!",i);
-          lastError="pattern channel out of range!";
+          loadError="pattern channel out of range!";
           ds.unload();
           delete[] file;
           return false;
         }
         if (index<0 || index>(DIV_MAX_PATTERNS-1)) {
           logE("pattern index out of range!",i);
-          lastError="pattern index out of range!";
+          loadError="pattern index out of range!";
           ds.unload();
           delete[] file;
           return false;
         }
         if (subs<0 || subs>=(int)ds.subsong.size()) {
           logE("pattern subsong out of range!",i);
-          lastError="pattern subsong out of range!";
+          loadError="pattern subsong out of range!";
           ds.unload();
           delete[] file;
           return false;
@@ -1819,21 +1847,21 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
 
         if (chan<0 || chan>=tchans) {
           logE("pattern channel out of range!",i);
-          lastError="pattern channel out of range!";
+          loadError="pattern channel out of range!";
           ds.unload();
           delete[] file;
           return false;
         }
         if (index<0 || index>(DIV_MAX_PATTERNS-1)) {
           logE("pattern index out of range!",i);
-          lastError="pattern index out of range!";
+          loadError="pattern index out of range!";
           ds.unload();
           delete[] file;
           return false;
         }
         if (subs<0 || subs>=(int)ds.subsong.size()) {
           logE("pattern subsong out of range!",i);
-          lastError="pattern subsong out of range!";
+          loadError="pattern subsong out of range!";
           ds.unload();
           delete[] file;
           return false;
@@ -2096,25 +2124,10 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
       }
     }
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
   } catch (EndOfFileException& e) {
     logE("premature end of file!");
-    lastError="incomplete file";
+    loadError="incomplete file";
     delete[] file;
     return false;
   }
@@ -2122,7 +2135,7 @@ bool DivEngine::loadFur(unsigned char* file, size_t len, int variantID) {
   return true;
 }
 
-SafeWriter* DivEngine::saveFur(bool notPrimary, bool newPatternFormat) {
+SafeWriter* DivEngine::saveFur(bool notPrimary, bool newPatternFormat, DivFurSnapshot* snap) {
   saveLock.lock();
   std::vector<int> subSongPtr;
   std::vector<int> sysFlagsPtr;
@@ -2543,45 +2556,72 @@ SafeWriter* DivEngine::saveFur(bool notPrimary, bool newPatternFormat) {
   assetDirPtr[2]=w->tell();
   putAssetDirData(w,song.sampleDir);
 
+  // in snapshot mode every block below goes into its own chunk.
+  // blockPos is where the block will be in the final file.
+  size_t blockPos=w->tell();
+  auto beginBlock=[&]() -> SafeWriter* {
+    return (snap==NULL)?w:snap->beginChunk();
+  };
+  auto endBlock=[&]() {
+    if (snap==NULL) {
+      blockPos=w->tell();
+    } else {
+      blockPos+=snap->endChunk();
+    }
+  };
+
   /// INSTRUMENT
   insPtr.reserve(song.insLen);
   for (int i=0; i<song.insLen; i++) {
     DivInstrument* ins=song.ins[i];
-    insPtr.push_back(w->tell());
-    ins->putInsData2(w,false);
+    insPtr.push_back(blockPos);
+    ins->putInsData2(beginBlock(),false);
+    endBlock();
   }
 
   /// WAVETABLE
   wavePtr.reserve(song.waveLen);
   for (int i=0; i<song.waveLen; i++) {
     DivWavetable* wave=song.wave[i];
-    wavePtr.push_back(w->tell());
-    wave->putWaveData(w);
+    wavePtr.push_back(blockPos);
+    wave->putWaveData(beginBlock());
+    endBlock();
   }
 
   /// SAMPLE
   samplePtr.reserve(song.sampleLen);
   for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
-    samplePtr.push_back(w->tell());
-    sample->putSampleData(w);
+    samplePtr.push_back(blockPos);
+    if (snap!=NULL) {
+      // don't copy samples which did not change since the last snapshot
+      unsigned int reusedLen=snap->reuseSample(sample);
+      if (reusedLen>0) {
+        blockPos+=reusedLen;
+        continue;
+      }
+    }
+    sample->putSampleData(beginBlock());
+    endBlock();
+    if (snap!=NULL) snap->cacheSample(sample);
   }
 
   /// PATTERN
   patPtr.reserve(patsToWrite.size());
   for (PatToWrite& i: patsToWrite) {
-    DivPattern* pat=song.subsong[i.subsong]->pat[i.chan].getPattern(i.pat,false);
-    patPtr.push_back(w->tell());
+    const DivPattern* pat=song.subsong[i.subsong]->pat[i.chan].getPattern(i.pat,false);
+    patPtr.push_back(blockPos);
+    SafeWriter* bw=beginBlock();
 
     if (newPatternFormat) {
-      w->write("PATN",4);
-      blockStartSeek=w->tell();
-      w->writeI(0);
+      bw->write("PATN",4);
+      blockStartSeek=bw->tell();
+      bw->writeI(0);
 
-      w->writeC(i.subsong);
-      w->writeC(i.chan);
-      w->writeS(i.pat);
-      w->writeString(pat->name,false);
+      bw->writeC(i.subsong);
+      bw->writeC(i.chan);
+      bw->writeS(i.pat);
+      bw->writeString(pat->name,false);
 
       unsigned char emptyRows=0;
 
@@ -2627,83 +2667,84 @@ SafeWriter* DivEngine::saveFur(bool notPrimary, bool newPatternFormat) {
         if (mask==0) {
           emptyRows++;
           if (emptyRows>127) {
-            w->writeC(128|(emptyRows-2));
+            bw->writeC(128|(emptyRows-2));
             emptyRows=0;
           }
         } else {
           if (emptyRows>1) {
-            w->writeC(128|(emptyRows-2));
+            bw->writeC(128|(emptyRows-2));
             emptyRows=0;
           } else if (emptyRows) {
-            w->writeC(0);
+            bw->writeC(0);
             emptyRows=0;
           }
 
-          w->writeC(mask);
+          bw->writeC(mask);
 
-          if (mask&32) w->writeC(effectMask&0xff);
-          if (mask&64) w->writeC((effectMask>>8)&0xff);
+          if (mask&32) bw->writeC(effectMask&0xff);
+          if (mask&64) bw->writeC((effectMask>>8)&0xff);
 
-          if (mask&1) w->writeC(finalNote);
-          if (mask&2) w->writeC(pat->data[j][2]);
-          if (mask&4) w->writeC(pat->data[j][3]);
-          if (mask&8) w->writeC(pat->data[j][4]);
-          if (mask&16) w->writeC(pat->data[j][5]);
+          if (mask&1) bw->writeC(finalNote);
+          if (mask&2) bw->writeC(pat->data[j][2]);
+          if (mask&4) bw->writeC(pat->data[j][3]);
+          if (mask&8) bw->writeC(pat->data[j][4]);
+          if (mask&16) bw->writeC(pat->data[j][5]);
           if (mask&32) {
-            if (effectMask&4) w->writeC(pat->data[j][6]);
-            if (effectMask&8) w->writeC(pat->data[j][7]);
-            if (effectMask&16) w->writeC(pat->data[j][8]);
-            if (effectMask&32) w->writeC(pat->data[j][9]);
-            if (effectMask&64) w->writeC(pat->data[j][10]);
-            if (effectMask&128) w->writeC(pat->data[j][11]);
+            if (effectMask&4) bw->writeC(pat->data[j][6]);
+            if (effectMask&8) bw->writeC(pat->data[j][7]);
+            if (effectMask&16) bw->writeC(pat->data[j][8]);
+            if (effectMask&32) bw->writeC(pat->data[j][9]);
+            if (effectMask&64) bw->writeC(pat->data[j][10]);
+            if (effectMask&128) bw->writeC(pat->data[j][11]);
           }
           if (mask&64) {
-            if (effectMask&256) w->writeC(pat->data[j][12]);
-            if (effectMask&512) w->writeC(pat->data[j][13]);
-            if (effectMask&1024) w->writeC(pat->data[j][14]);
-            if (effectMask&2048) w->writeC(pat->data[j][15]);
-            if (effectMask&4096) w->writeC(pat->data[j][16]);
-            if (effectMask&8192) w->writeC(pat->data[j][17]);
-            if (effectMask&16384) w->writeC(pat->data[j][18]);
-            if (effectMask&32768) w->writeC(pat->data[j][19]);
+            if (effectMask&256) bw->writeC(pat->data[j][12]);
+            if (effectMask&512) bw->writeC(pat->data[j][13]);
+            if (effectMask&1024) bw->writeC(pat->data[j][14]);
+            if (effectMask&2048) bw->writeC(pat->data[j][15]);
+            if (effectMask&4096) bw->writeC(pat->data[j][16]);
+            if (effectMask&8192) bw->writeC(pat->data[j][17]);
+            if (effectMask&16384) bw->writeC(pat->data[j][18]);
+            if (effectMask&32768) bw->writeC(pat->data[j][19]);
           }
         }
       }
 
       // stop
-      w->writeC(0xff);
+      bw->writeC(0xff);
     } else {
-      w->write("PATR",4);
-      blockStartSeek=w->tell();
-      w->writeI(0);
+      bw->write("PATR",4);
+      blockStartSeek=bw->tell();
+      bw->writeI(0);
 
-      w->writeS(i.chan);
-      w->writeS(i.pat);
-      w->writeS(i.subsong);
+      bw->writeS(i.chan);
+      bw->writeS(i.pat);
+      bw->writeS(i.subsong);
 
-      w->writeS(0); // reserved
+      bw->writeS(0); // reserved
 
       for (int j=0; j<song.subsong[i.subsong]->patLen; j++) {
-        w->writeS(pat->data[j][0]); // note
-        w->writeS(pat->data[j][1]); // octave
-        w->writeS(pat->data[j][2]); // instrument
-        w->writeS(pat->data[j][3]); // volume
+        bw->writeS(pat->data[j][0]); // note
+        bw->writeS(pat->data[j][1]); // octave
+        bw->writeS(pat->data[j][2]); // instrument
+        bw->writeS(pat->data[j][3]); // volume
 #ifdef TA_BIG_ENDIAN
         for (int k=0; k<song.subsong[i.subsong]->pat[i.chan].effectCols*2; k++) {
-          w->writeS(pat->data[j][4+k]);
+          bw->writeS(pat->data[j][4+k]);
         }
 #else
-        w->write(&pat->data[j][4],2*song.subsong[i.subsong]->pat[i.chan].effectCols*2); // effects
+        bw->write(&pat->data[j][4],2*song.subsong[i.subsong]->pat[i.chan].effectCols*2); // effects
 #endif
       }
 
-      w->writeString(pat->name,false);
+      bw->writeString(pat->name,false);
     }
 
-    blockEndSeek=w->tell();
-    w->seek(blockStartSeek,SEEK_SET);
-    w->writeI(blockEndSeek-blockStartSeek-4);
-    w->seek(0,SEEK_END);
+    blockEndSeek=bw->tell();
+    bw->seek(blockStartSeek,SEEK_SET);
+    bw->writeI(blockEndSeek-blockStartSeek-4);
+    bw->seek(0,SEEK_END);
+    endBlock();
   }
 
   /// POINTERS
@@ -2746,6 +2787,8 @@ SafeWriter* DivEngine::saveFur(bool notPrimary, bool newPatternFormat) {
     w->writeI(assetDirPtr[i]);
   }
 
+  if (snap!=NULL) snap->head=w;
+
   saveLock.unlock();
   return w;
 }
@@ -51,7 +51,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
   memset(doesArp,0,64*sizeof(bool));
   
   SafeReader reader=SafeReader(file,len);
-  warnings="";
+  loadWarnings="";
 
   memset(chanPan,0,64);
   memset(chanVol,0,64);
@@ -74,7 +74,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
     // load here
     if (!reader.seek(0,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -102,21 +102,21 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
 
     if (ds.insLen<0 || ds.insLen>256) {
       logE("too many instruments!");
-      lastError="too many instruments";
+      loadError="too many instruments";
       delete[] file;
       return false;
     }
 
     if (ds.sampleLen<0 || ds.sampleLen>256) {
       logE("too many samples!");
-      lastError="too many samples";
+      loadError="too many samples";
       delete[] file;
       return false;
     }
 
     if (patCount>256) {
       logE("too many patterns!");
-      lastError="too many patterns";
+      loadError="too many patterns";
       delete[] file;
       return false;
     }
@@ -209,6 +209,11 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
 
     // read instruments
     for (int i=0; i<ds.insLen; i++) {
+      if (!loadStep(DIV_LOAD_INSTRUMENTS,i,ds.insLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       DivInstrument* ins=new DivInstrument;
       ins->type=DIV_INS_ES5506;
 
@@ -220,7 +225,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
       logV("reading instrument %d...",i);
       if (!reader.seek(insPtr[i],SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete ins;
         delete[] file;
         return false;
@@ -230,7 +235,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
 
       if (memcmp(magic,"IMPI",4)!=0) {
         logE("invalid instrument header!");
-        lastError="invalid instrument header";
+        loadError="invalid instrument header";
         delete ins;
         delete[] file;
         return false;
@@ -331,6 +336,11 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
 
     // read samples
     for (int i=0; i<ds.sampleLen; i++) {
+      if (!loadStep(DIV_LOAD_SAMPLES,i,ds.sampleLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       DivSample* s=new DivSample;
 
       if (samplePtr[i]==0) {
@@ -341,7 +351,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
       logV("reading sample %d...",i);
       if (!reader.seek(samplePtr[i],SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete s;
         delete[] file;
         return false;
@@ -351,7 +361,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
 
       if (memcmp(magic,"IMPS",4)!=0) {
         logE("invalid sample header!");
-        lastError="invalid sample header";
+        loadError="invalid sample header";
         delete s;
         delete[] file;
         return false;
@@ -382,7 +392,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
 
       if (flags&8) {
         logE("sample decompression not implemented!");
-        lastError="sample decompression not implemented";
+        loadError="sample decompression not implemented";
         delete s;
         delete[] file;
         return false;
@@ -427,7 +437,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
         logD("seek to %x...",dataPtr);
         if (!reader.seek(dataPtr,SEEK_SET)) {
           logE("premature end of file!");
-          lastError="incomplete file";
+          loadError="incomplete file";
           delete s;
           delete[] file;
           return false;
@@ -500,6 +510,11 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
     // read patterns
     int maxChan=0;
     for (int i=0; i<patCount; i++) {
+      if (!loadStep(DIV_LOAD_PATTERNS,i,patCount)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       unsigned char effectCol[64];
       unsigned char vibStatus[64];
       bool vibStatusChanged[64];
@@ -561,7 +576,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
       logV("reading pattern %d...",i);
       if (!reader.seek(patPtr[i],SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete[] file;
         return false;
       }
@@ -573,7 +588,7 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
 
       if (patRows>DIV_MAX_ROWS) {
         logE("too many rows! %d",patRows);
-        lastError="too many rows";
+        loadError="too many rows";
         delete[] file;
         return false;
       }
@@ -945,29 +960,14 @@ bool DivEngine::loadIT(unsigned char* file, size_t len) {
     // find subsongs
     ds.findSubSongs();    
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
     success=true;
   } catch (EndOfFileException& e) {
     //logE("premature end of file!");
-    lastError="incomplete file";
+    loadError="incomplete file";
   } catch (InvalidHeaderException& e) {
     //logE("invalid header!");
-    lastError="invalid header!";
+    loadError="invalid header!";
   }
   return success;
 }
@@ -31,7 +31,7 @@ bool DivEngine::loadMod(unsigned char* file, size_t len) {
   // 0=arp, 1=pslide, 2=vib, 3=trem, 4=vslide
   bool fxUsage[DIV_MAX_CHANS][5];  
   SafeReader reader=SafeReader(file,len);
-  warnings="";
+  loadWarnings="";
 
   memset(defaultVols,0,31*sizeof(short));
   memset(sampLens,0,31*sizeof(int));
@@ -242,6 +242,10 @@ bool DivEngine::loadMod(unsigned char* file, size_t len) {
     size_t pos=reader.tell();
     logD("reading sample data...");
     for (int i=0; i<insCount; i++) {
+      if (!loadStep(DIV_LOAD_SAMPLES,i,insCount)) {
+        ds.unload();
+        return false;
+      }
       logV("- %d: %d %d %d",i,pos,ds.sample[i]->samples,sampLens[i]);
       if (!reader.seek(pos,SEEK_SET)) {
         logD("%d: couldn't seek to %d",i,pos);
@@ -256,7 +260,7 @@ bool DivEngine::loadMod(unsigned char* file, size_t len) {
     for (int ch=0; ch<=chCount; ch++) {
       unsigned char fxCols=1;
       for (int pat=0; pat<=patMax; pat++) {
-        auto* data=ds.subsong[0]->pat[ch].getPattern(pat,true)->data;
+        DivPatternData& data=ds.subsong[0]->pat[ch].getPattern(pat,true)->data;
         short lastPitchEffect=-1;
         short lastEffectState[5]={-1,-1,-1,-1,-1};
         short setEffectState[5]={-1,-1,-1,-1,-1};
@@ -266,7 +270,7 @@ bool DivEngine::loadMod(unsigned char* file, size_t len) {
           unsigned char curFxCol=0;
           short fxTyp=data[row][4];
           short fxVal=data[row][5];
-          auto writeFxCol=[data,row,&curFxCol](short typ, short val) {
+          auto writeFxCol=[&data,row,&curFxCol](short typ, short val) {
             data[row][4+curFxCol*2]=typ;
             data[row][5+curFxCol*2]=val;
             curFxCol++;
@@ -421,29 +425,14 @@ bool DivEngine::loadMod(unsigned char* file, size_t len) {
     // find subsongs
     ds.findSubSongs();
     
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
     success=true;
   } catch (EndOfFileException& e) {
     //logE("premature end of file!");
-    lastError="incomplete file";
+    loadError="incomplete file";
   } catch (InvalidHeaderException& e) {
     //logE("invalid info header!");
-    lastError="invalid info header!";
+    loadError="invalid info header!";
   }
   return success;
 }
@@ -53,7 +53,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
   bool success=false;
   char magic[4]={0,0,0,0};
   SafeReader reader=SafeReader(file,len);
-  warnings="";
+  loadWarnings="";
 
   unsigned char chanSettings[32];
   unsigned int insPtr[256];
@@ -99,7 +99,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
     // load here
     if (!reader.seek(0x2c,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -112,7 +112,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
     if (!reader.seek(0,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -130,7 +130,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
     if (ordersLen>256) {
       logE("invalid order count!");
-      lastError="invalid order count!";
+      loadError="invalid order count!";
       delete[] file;
       return false;
     }
@@ -140,7 +140,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
     if (ds.insLen<0 || ds.insLen>256) {
       logE("invalid instrument count!");
-      lastError="invalid instrument count!";
+      loadError="invalid instrument count!";
       delete[] file;
       return false;
     }
@@ -151,7 +151,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
     if (patCount>256) {
       logE("invalid pattern count!");
-      lastError="invalid pattern count!";
+      loadError="invalid pattern count!";
       delete[] file;
       return false;
     }
@@ -329,6 +329,11 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
     // load instruments/samples
     ds.ins.reserve(ds.insLen);
     for (int i=0; i<ds.insLen; i++) {
+      if (!loadStep(DIV_LOAD_INSTRUMENTS,i,ds.insLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       logV("reading instrument %d...",i);
       DivInstrument* ins=new DivInstrument;
       if (insPtr[i]==0) {
@@ -341,7 +346,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
       if (!reader.seek(insPtr[i]+0x4c,SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete ins;
         delete[] file;
         return false;
@@ -362,7 +367,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
       if (!reader.seek(insPtr[i],SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete ins;
         delete[] file;
         return false;
@@ -373,7 +378,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
       if (ins->type==DIV_INS_ES5506) {
         if (type>1) {
           logE("invalid instrument type! %d",type);
-          lastError="invalid instrument!";
+          loadError="invalid instrument!";
           delete ins;
           delete[] file;
           return false;
@@ -381,7 +386,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
       } else {
         if (type<2) {
           logE("invalid instrument type! %d",type);
-          lastError="invalid instrument!";
+          loadError="invalid instrument!";
           delete ins;
           delete[] file;
           return false;
@@ -433,7 +438,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
         // read sample data
         if (!reader.seek(memSeg,SEEK_SET)) {
           logE("premature end of file!");
-          lastError="incomplete file";
+          loadError="incomplete file";
           delete ins;
           delete s;
           delete[] file;
@@ -446,7 +451,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
         if (isPacked) {
           logE("ADPCM not supported!");
-          lastError="ADPCM sample";
+          loadError="ADPCM sample";
           delete ins;
           delete s;
           delete[] file;
@@ -587,7 +592,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
       logV("scanning pattern %d...",i);
       if (!reader.seek(patPtr[i],SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         ds.unload();
         delete[] file;
         return false;
@@ -655,6 +660,11 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
 
     // load pattern data
     for (int i=0; i<patCount; i++) {
+      if (!loadStep(DIV_LOAD_PATTERNS,i,patCount)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       unsigned char effectCol[32];
       unsigned char vibStatus[32];
       bool vibStatusChanged[32];
@@ -680,7 +690,7 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
       logV("reading pattern %d...",i);
       if (!reader.seek(patPtr[i],SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         ds.unload();
         delete[] file;
         return false;
@@ -1028,29 +1038,14 @@ bool DivEngine::loadS3M(unsigned char* file, size_t len) {
     // find subsongs
     ds.findSubSongs();    
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
     success=true;
   } catch (EndOfFileException& e) {
     //logE("premature end of file!");
-    lastError="incomplete file";
+    loadError="incomplete file";
   } catch (InvalidHeaderException& e) {
     //logE("invalid header!");
-    lastError="invalid header!";
+    loadError="invalid header!";
   }
   return success;
 }
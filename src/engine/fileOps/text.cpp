@@ -311,7 +311,7 @@ SafeWriter* DivEngine::saveText(bool separatePatterns) {
           w->writeText(fmt::sprintf("%.2X ",k));
 
           for (int l=0; l<chans; l++) {
-            DivPattern* p=s->pat[l].getPattern(s->orders.ord[l][j],false);
+            const DivPattern* p=s->pat[l].getPattern(s->orders.ord[l][j],false);
 
             int note=p->data[k][0];
             int octave=p->data[k][1];
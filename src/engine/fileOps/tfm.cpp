@@ -677,29 +677,19 @@ bool DivEngine::loadTFMv1(unsigned char* file, size_t len) {
     info.patLens=patLens;
     info.reader=&reader;
     info.v2=false;
+    if (!loadStep(DIV_LOAD_PATTERNS,0,1)) {
+      ds.unload();
+      delete[] file;
+      return false;
+    }
     TFMParsePattern(info);
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
     success=true;
   } catch(TFMEndOfFileException& e) {
-    lastError="incomplete file!";
+    loadError="incomplete file!";
   } catch(InvalidHeaderException& e) {
-    lastError="invalid info header!";
+    loadError="invalid info header!";
   }
 
   delete[] file;
@@ -733,7 +723,7 @@ bool DivEngine::loadTFMv2(unsigned char* file, size_t len) {
     // TODO: due to limitations with the groove pattern, only interleave factors up to 8
     // are allowed in furnace
     if (interleaveFactor>8) {
-      addWarning("interleave factor is bigger than 8, speed information may be inaccurate");
+      addLoadWarning("interleave factor is bigger than 8, speed information may be inaccurate");
       interleaveFactor=8;
     }
 
@@ -876,29 +866,19 @@ bool DivEngine::loadTFMv2(unsigned char* file, size_t len) {
     info.patLens=patLens;
     info.reader=&reader;
     info.v2=true;
+    if (!loadStep(DIV_LOAD_PATTERNS,0,1)) {
+      ds.unload();
+      delete[] file;
+      return false;
+    }
     TFMParsePattern(info);
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
     success=true;
   } catch(TFMEndOfFileException& e) {
-    lastError="incomplete file!";
+    loadError="incomplete file!";
   } catch(InvalidHeaderException& e) {
-    lastError="invalid info header!";
+    loadError="invalid info header!";
   }
   
   delete[] file;
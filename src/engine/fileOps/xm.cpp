@@ -25,7 +25,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
   char magic[32];
   unsigned char sampleVol[256][256];
   SafeReader reader=SafeReader(file,len);
-  warnings="";
+  loadWarnings="";
 
   memset(sampleVol,0,256*256);
 
@@ -44,7 +44,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
     // load here
     if (!reader.seek(0,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -85,7 +85,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
 
     if (totalChans>127) {
       logE("invalid channel count!");
-      lastError="invalid channel count";
+      loadError="invalid channel count";
       delete[] file;
       return false;
     }
@@ -111,7 +111,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
 
     if (!reader.seek(headerSeek,SEEK_SET)) {
       logE("premature end of file!");
-      lastError="incomplete file";
+      loadError="incomplete file";
       delete[] file;
       return false;
     }
@@ -119,6 +119,11 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
     // read patterns
     logD("reading patterns...");
     for (unsigned short i=0; i<patCount; i++) {
+      if (!loadStep(DIV_LOAD_PATTERNS,i,patCount)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       logV("pattern %d",i);
       headerSeek=reader.tell();
       headerSeek+=reader.readI();
@@ -126,7 +131,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
       unsigned char packType=reader.readC();
       if (packType!=0) {
         logE("unknown packing type %d!",packType);
-        lastError="unknown packing type";
+        loadError="unknown packing type";
         ds.unload();
         delete[] file;
         return false;
@@ -141,7 +146,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
       logV("seeking to %x...",headerSeek);
       if (!reader.seek(headerSeek,SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete[] file;
         return false;
       }
@@ -214,7 +219,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
       logV("seeking to %x...",packedSeek);
       if (!reader.seek(packedSeek,SEEK_SET)) {
         logE("premature end of file!");
-        lastError="incomplete file";
+        loadError="incomplete file";
         delete[] file;
         return false;
       }
@@ -222,6 +227,11 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
 
     // read instruments
     for (int i=0; i<ds.insLen; i++) {
+      if (!loadStep(DIV_LOAD_INSTRUMENTS,i,ds.insLen)) {
+        ds.unload();
+        delete[] file;
+        return false;
+      }
       unsigned char volEnv[48];
       unsigned char panEnv[48];
 
@@ -239,7 +249,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
       /*
       if (insType!=0) {
         logE("unknown instrument type!");
-        lastError="unknown instrument type";
+        loadError="unknown instrument type";
         delete ins;
         song.unload();
         delete[] file;
@@ -303,7 +313,7 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
 
         if (!reader.seek(headerSeek,SEEK_SET)) {
           logE("premature end of file!");
-          lastError="incomplete file";
+          loadError="incomplete file";
           delete[] file;
           return false;
         }
@@ -373,29 +383,14 @@ bool DivEngine::loadXM(unsigned char* file, size_t len) {
     // find subsongs
     ds.findSubSongs();
 
-    if (active) quitDispatch();
-    BUSY_BEGIN_SOFT;
-    saveLock.lock();
-    song.unload();
-    song=ds;
-    changeSong(0);
-    recalcChans();
-    saveLock.unlock();
-    BUSY_END;
-    if (active) {
-      initDispatch();
-      BUSY_BEGIN;
-      renderSamples();
-      reset();
-      BUSY_END;
-    }
+    installSong(ds);
     success=true;
   } catch (EndOfFileException& e) {
     //logE("premature end of file!");
-    lastError="incomplete file";
+    loadError="incomplete file";
   } catch (InvalidHeaderException& e) {
     //logE("invalid header!");
-    lastError="invalid header!";
+    loadError="invalid header!";
   }
   return success;
 }
@@ -2062,5 +2062,8 @@ std::vector<DivInstrument*> DivEngine::instrumentFromFile(const char* path, bool
   }
 
   delete[] buf; // since we're done with this buffer
+  for (DivInstrument* i: ret) {
+    i->std.compact();
+  }
   return ret;
 }
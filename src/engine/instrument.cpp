@@ -17,6 +17,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <atomic>
 #include "dataErrors.h"
 #include "engine.h"
 #include "instrument.h"
@@ -268,6 +269,120 @@ bool DivInstrumentSID2::operator==(const DivInstrumentSID2& other) {
 
 #undef _C
 
+// 256 values plus 16 of GUI memory
+#define DIV_MACRO_BUF_LEN (256+16)
+
+// macro blocks by hash, so that identical macros share their data
+static std::mutex macroPoolLock;
+static std::unordered_multimap<size_t,std::weak_ptr<const std::vector<int>>> macroPool;
+static size_t macroPoolPruneAt=256;
+
+static std::shared_ptr<const std::vector<int>> getMacroBlock(const int* data, int len) {
+  size_t hash=len;
+  for (int i=0; i<len; i++) {
+    hash=(hash*31)^(unsigned int)data[i];
+  }
+
+  std::lock_guard<std::mutex> lock(macroPoolLock);
+  auto range=macroPool.equal_range(hash);
+  for (auto i=range.first; i!=range.second; i++) {
+    std::shared_ptr<const std::vector<int>> b=i->second.lock();
+    if (!b) continue;
+    if ((int)b->size()==len && memcmp(b->data(),data,len*sizeof(int))==0) return b;
+  }
+
+  // forget blocks which are no longer used
+  if (macroPool.size()>=macroPoolPruneAt) {
+    for (auto i=macroPool.begin(); i!=macroPool.end();) {
+      if (i->second.expired()) {
+        i=macroPool.erase(i);
+      } else {
+        i++;
+      }
+    }
+    macroPoolPruneAt=MAX(256,macroPool.size()*2);
+  }
+
+  std::shared_ptr<const std::vector<int>> ret=std::make_shared<const std::vector<int>>(data,data+len);
+  macroPool.emplace(hash,ret);
+  return ret;
+}
+
+void DivMacroData::setData(const int* newData, int newLen) {
+  // the playback thread may be reading while we're here.
+  // make sure it never sees a length larger than the data it pairs with.
+  dataLen=0;
+  std::atomic_thread_fence(std::memory_order_release);
+  data=newData;
+  std::atomic_thread_fence(std::memory_order_release);
+  dataLen=newLen;
+}
+
+int* DivMacroData::unpack() {
+  if (buf==NULL) {
+    int* newBuf=new int[DIV_MACRO_BUF_LEN];
+    memset(newBuf,0,DIV_MACRO_BUF_LEN*sizeof(int));
+    if (dataLen>0) memcpy(newBuf,data,dataLen*sizeof(int));
+    buf=newBuf;
+    // the block is kept, as the playback thread may still be reading from it
+    setData(buf,256);
+  }
+  return buf;
+}
+
+int* DivMacroData::typeMemory() {
+  return unpack()+256;
+}
+
+void DivMacroData::compact(int len) {
+  if (len>dataLen) len=dataLen;
+  if (len<0) len=0;
+  // trailing zeros read as 0 anyway
+  while (len>0 && data[len-1]==0) len--;
+
+  std::shared_ptr<const std::vector<int>> newBlock;
+  if (len>0) newBlock=getMacroBlock(data,len);
+
+  setData(newBlock?newBlock->data():NULL,len);
+  block=newBlock;
+  delete[] buf;
+  buf=NULL;
+}
+
+DivMacroData& DivMacroData::operator=(const DivMacroData& other) {
+  if (this==&other) return *this;
+  int* oldBuf=buf;
+  if (other.buf!=NULL) {
+    buf=new int[DIV_MACRO_BUF_LEN];
+    memcpy(buf,other.buf,DIV_MACRO_BUF_LEN*sizeof(int));
+    setData(buf,other.dataLen);
+    block=NULL;
+  } else {
+    buf=NULL;
+    setData(other.data,other.dataLen);
+    block=other.block;
+  }
+  delete[] oldBuf;
+  return *this;
+}
+
+DivMacroData::DivMacroData(const DivMacroData& other):
+  buf(NULL),
+  data(NULL),
+  dataLen(0) {
+  *this=other;
+}
+
+DivMacroData::~DivMacroData() {
+  delete[] buf;
+  buf=NULL;
+}
+
+void DivInstrumentMacro::compact() {
+  // ADSR/LFO parameters are in the first 16 values regardless of length
+  val.compact((open&6)?MAX((int)len,16):len);
+}
+
 #define CONSIDER(x,t) \
   case t: \
     return &x; \
@@ -302,6 +417,36 @@ DivInstrumentMacro* DivInstrumentSTD::macroByType(DivMacroType type) {
 
 #undef CONSIDER
 
+void DivInstrumentSTD::compact() {
+  for (int i=0; i<=DIV_MACRO_EX8; i++) {
+    DivInstrumentMacro* m=macroByType((DivMacroType)i);
+    if (m!=NULL) m->compact();
+  }
+  for (int i=0; i<4; i++) {
+    OpMacro& op=opMacros[i];
+    op.amMacro.compact();
+    op.arMacro.compact();
+    op.drMacro.compact();
+    op.multMacro.compact();
+    op.rrMacro.compact();
+    op.slMacro.compact();
+    op.tlMacro.compact();
+    op.dt2Macro.compact();
+    op.rsMacro.compact();
+    op.dtMacro.compact();
+    op.d2rMacro.compact();
+    op.ssgMacro.compact();
+    op.damMacro.compact();
+    op.dvbMacro.compact();
+    op.egtMacro.compact();
+    op.kslMacro.compact();
+    op.susMacro.compact();
+    op.vibMacro.compact();
+    op.wsMacro.compact();
+    op.ksrMacro.compact();
+  }
+}
+
 #define FEATURE_BEGIN(x) \
   w->write(x,2); \
   size_t featStartSeek=w->tell(); \
@@ -701,9 +846,11 @@ size_t DivInstrument::writeFeatureWL(SafeWriter* w, std::vector<int>& list, cons
   bool waveUsed[256];
   memset(waveUsed,0,256*sizeof(bool));
 
+  // read through a const reference so the macro isn't unpacked
+  const DivMacroData& waveVal=std.waveMacro.val;
   for (int i=0; i<std.waveMacro.len; i++) {
-    if (std.waveMacro.val[i]>=0 && std.waveMacro.val[i]<(int)song->wave.size()) {
-      waveUsed[std.waveMacro.val[i]]=true;
+    if (waveVal[i]>=0 && waveVal[i]<(int)song->wave.size()) {
+      waveUsed[waveVal[i]]=true;
     }
   }
 
@@ -2260,7 +2407,7 @@ DivDataErrors DivInstrument::readInsDataNew(SafeReader& reader, short version, b
 
   // <187 C64 cutoff macro compatibility
   if (type==DIV_INS_C64 && volIsCutoff && version<187) {
-    memcpy(&std.algMacro,&std.volMacro,sizeof(DivInstrumentMacro));
+    std.algMacro=std.volMacro;
     std.algMacro.macroType=DIV_MACRO_ALG;
     std.volMacro=DivInstrumentMacro(DIV_MACRO_VOL,true);
 
@@ -3019,7 +3166,7 @@ DivDataErrors DivInstrument::readInsDataOld(SafeReader &reader, short version) {
 
   // <187 C64 cutoff macro compatibility
   if (type==DIV_INS_C64 && volIsCutoff && version<187) {
-    memcpy(&std.algMacro,&std.volMacro,sizeof(DivInstrumentMacro));
+    std.algMacro=std.volMacro;
     std.algMacro.macroType=DIV_MACRO_ALG;
     std.volMacro=DivInstrumentMacro(DIV_MACRO_VOL,true);
 
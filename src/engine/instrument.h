@@ -22,6 +22,7 @@
 #include "safeWriter.h"
 #include "dataErrors.h"
 #include "../ta-utils.h"
+#include <memory>
 #include "../pch.h"
 
 struct DivSong;
@@ -252,8 +253,69 @@ struct DivInstrumentFM {
 };
 
 // this is getting out of hand
+/**
+ * storage for macro values.
+ * macros are kept in a compact block sized to their length, which is shared by all
+ * macros with the same contents. the first write (e.g. from the instrument editor)
+ * unpacks the values into a private buffer of 256 entries (plus GUI memory).
+ * values past the end of the storage read as 0.
+ */
+class DivMacroData {
+  std::shared_ptr<const std::vector<int>> block;
+  int* buf;
+  // what readers walk: either the block or the private buffer
+  const int* data;
+  int dataLen;
+  void setData(const int* newData, int newLen);
+  public:
+    inline int operator[](int pos) const {
+      return ((unsigned int)pos<(unsigned int)dataLen)?data[pos]:0;
+    }
+    inline int& operator[](int pos) {
+      return unpack()[pos];
+    }
+    inline operator int*() {
+      return unpack();
+    }
+
+    /**
+     * get the number of stored values (the rest read as 0).
+     */
+    inline int size() const {
+      return dataLen;
+    }
+
+    /**
+     * get a writable pointer to all 256 values, unpacking them if necessary.
+     */
+    int* unpack();
+
+    /**
+     * get the 16 values of GUI memory used to swap between sequence and ADSR/LFO modes.
+     */
+    int* typeMemory();
+
+    /**
+     * pack the first len values into a shared block and free the private buffer.
+     * this is UNSAFE while the playback thread may be reading this macro.
+     */
+    void compact(int len);
+
+    /**
+     * copy another macro's data. the previous storage is freed, so this is UNSAFE
+     * while the playback thread may be reading this macro.
+     */
+    DivMacroData& operator=(const DivMacroData& other);
+    DivMacroData(const DivMacroData& other);
+    DivMacroData():
+      buf(NULL),
+      data(NULL),
+      dataLen(0) {}
+    ~DivMacroData();
+};
+
 struct DivInstrumentMacro {
-  int val[256];
+  DivMacroData val;
   unsigned int mode;
   unsigned char open;
   unsigned char len, delay, speed, loop, rel;
@@ -263,9 +325,13 @@ struct DivInstrumentMacro {
   
   // the following variables are used by the GUI and not saved in the file
   int vScroll, vZoom;
-  int typeMemory[16];
   unsigned char lenMemory;
 
+  /**
+   * pack the macro data into a shared block (UNSAFE).
+   */
+  void compact();
+
   explicit DivInstrumentMacro(unsigned char initType, bool initOpen=false):
     mode(0),
     open(initOpen),
@@ -278,8 +344,6 @@ struct DivInstrumentMacro {
     vScroll(0),
     vZoom(-1),
     lenMemory(0) {
-    memset(val,0,256*sizeof(int));
-    memset(typeMemory,0,16*sizeof(int));
   }
 };
 
@@ -337,6 +401,12 @@ struct DivInstrumentSTD {
 
   DivInstrumentMacro* macroByType(DivMacroType type);
 
+  /**
+   * pack the data of every macro into shared blocks.
+   * call this after loading, before the instrument is used by playback.
+   */
+  void compact();
+
   DivInstrumentSTD():
     volMacro(DIV_MACRO_VOL,true),
     arpMacro(DIV_MACRO_ARP),
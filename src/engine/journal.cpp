@@ -0,0 +1,335 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include "journal.h"
+#include "sample.h"
+#include "engine.h"
+#include "../ta-log.h"
+#include "../fileutils.h"
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#define JOURNAL_HEADER_SIZE 20
+
+SafeWriter* DivFurSnapshot::beginChunk() {
+  curChunk=new SafeWriter;
+  curChunk->init();
+  return curChunk;
+}
+
+unsigned int DivFurSnapshot::endChunk() {
+  DivJournalChunk c;
+  c.len=curChunk->size();
+  DivBackupJournal::hashChunk(curChunk->getFinalBuf(),c.len,c.hash,c.check);
+  if (journal!=NULL && journal->hasChunk(c.hash,c.check,c.len)) {
+    curChunk->finish();
+  } else {
+    c.data=curChunk->getFinalBuf();
+    curChunk->disown();
+  }
+  delete curChunk;
+  curChunk=NULL;
+  chunks.push_back(c);
+  return c.len;
+}
+
+static uint64_t sampleInfoHash(DivSample* sample) {
+  SafeWriter w;
+  w.init();
+  sample->putSampleInfo(&w);
+  uint64_t ret=DivBackupJournal::hash(w.getFinalBuf(),w.size());
+  w.finish();
+  return ret;
+}
+
+unsigned int DivFurSnapshot::reuseSample(DivSample* sample) {
+  if (journal==NULL) return 0;
+  auto entry=journal->sampleCache.find(sample);
+  if (entry==journal->sampleCache.end()) return 0;
+  if (entry->second.rev!=sample->dataRev) return 0;
+  if (!journal->hasChunk(entry->second.hash,entry->second.check,entry->second.len)) return 0;
+  if (entry->second.infoHash!=sampleInfoHash(sample)) return 0;
+
+  DivJournalChunk c;
+  c.hash=entry->second.hash;
+  c.check=entry->second.check;
+  c.len=entry->second.len;
+  chunks.push_back(c);
+  return c.len;
+}
+
+void DivFurSnapshot::cacheSample(DivSample* sample) {
+  if (journal==NULL || chunks.empty()) return;
+  DivBackupJournal::SampleEntry& entry=journal->sampleCache[sample];
+  entry.rev=sample->dataRev;
+  entry.infoHash=sampleInfoHash(sample);
+  entry.hash=chunks.back().hash;
+  entry.check=chunks.back().check;
+  entry.len=chunks.back().len;
+}
+
+size_t DivFurSnapshot::getFullSize() {
+  size_t ret=(head==NULL)?0:head->size();
+  for (DivJournalChunk& i: chunks) {
+    ret+=i.len;
+  }
+  return ret;
+}
+
+void DivFurSnapshot::clear() {
+  if (head!=NULL) {
+    head->finish();
+    delete head;
+    head=NULL;
+  }
+  if (curChunk!=NULL) {
+    curChunk->finish();
+    delete curChunk;
+    curChunk=NULL;
+  }
+  for (DivJournalChunk& i: chunks) {
+    if (i.data!=NULL) delete[] i.data;
+  }
+  chunks.clear();
+}
+
+DivFurSnapshot::~DivFurSnapshot() {
+  clear();
+}
+
+uint64_t DivBackupJournal::hash(const unsigned char* buf, size_t len, uint64_t seed) {
+  uint64_t ret=seed;
+  for (size_t i=0; i<len; i++) {
+    ret^=buf[i];
+    ret*=0x100000001b3ULL;
+  }
+  return ret;
+}
+
+void DivBackupJournal::hashChunk(const unsigned char* buf, size_t len, uint64_t& hash, uint64_t& check) {
+  uint64_t h=0xcbf29ce484222325ULL;
+  uint64_t c=0x9e3779b97f4a7c15ULL^len;
+  for (size_t i=0; i<len; i++) {
+    h^=buf[i];
+    h*=0x100000001b3ULL;
+    c=(c^buf[i])*0xff51afd7ed558ccdULL;
+    c^=c>>29;
+  }
+  hash=h;
+  check=c;
+}
+
+bool DivBackupJournal::hasChunk(uint64_t hash, uint64_t check, unsigned int len) {
+  auto i=chunkPos.find(hash);
+  if (i==chunkPos.end()) return false;
+  return i->second.check==check && i->second.len==len;
+}
+
+bool DivBackupJournal::open(const char* p, String& error) {
+  close();
+  f=ps_fopen(p,"wb");
+  if (f==NULL) {
+    error=strerror(errno);
+    return false;
+  }
+  path=p;
+
+  // header
+  SafeWriter w;
+  w.init();
+  w.write(DIV_JOURNAL_MAGIC,16);
+  w.writeS(DIV_ENGINE_VERSION);
+  w.writeS(0);
+  if (fwrite(w.getFinalBuf(),1,w.size(),f)!=w.size()) {
+    error=strerror(errno);
+    w.finish();
+    close();
+    return false;
+  }
+  fileSize=w.size();
+  w.finish();
+  return true;
+}
+
+bool DivBackupJournal::append(DivFurSnapshot& snap, String& error) {
+  if (f==NULL) {
+    error="journal not open";
+    return false;
+  }
+  if (snap.head==NULL) {
+    error="empty snapshot";
+    return false;
+  }
+
+  SafeWriter w;
+  w.init();
+  std::vector<size_t> snapPos;
+  snapPos.reserve(snap.chunks.size());
+
+  // new chunks
+  for (DivJournalChunk& i: snap.chunks) {
+    auto pos=chunkPos.find(i.hash);
+    if (pos!=chunkPos.end() && pos->second.check==i.check && pos->second.len==i.len) {
+      snapPos.push_back(pos->second.pos);
+      continue;
+    }
+    if (i.data==NULL) {
+      // this may only happen if the journal was restarted after the snapshot
+      error="snapshot refers to a chunk which is not in the journal";
+      w.finish();
+      return false;
+    }
+    w.write("CHNK",4);
+    w.writeI(i.len+16);
+    w.writeL(i.hash);
+    w.writeL(i.check);
+    size_t dataPos=fileSize+w.size();
+    w.write(i.data,i.len);
+    ChunkPos& newPos=chunkPos[i.hash];
+    newPos.pos=dataPos;
+    newPos.check=i.check;
+    newPos.len=i.len;
+    snapPos.push_back(dataPos);
+  }
+
+  // the snapshot
+  w.write("SNAP",4);
+  w.writeI(8+4+snap.head->size()+4+snap.chunks.size()*12);
+  w.writeL((int64_t)time(NULL));
+  w.writeI(snap.head->size());
+  w.write(snap.head->getFinalBuf(),snap.head->size());
+  w.writeI(snap.chunks.size());
+  for (size_t i=0; i<snap.chunks.size(); i++) {
+    w.writeL(snapPos[i]);
+    w.writeI(snap.chunks[i].len);
+  }
+
+  if (fwrite(w.getFinalBuf(),1,w.size(),f)!=w.size() || fflush(f)!=0) {
+    error=strerror(errno);
+    w.finish();
+    close();
+    return false;
+  }
+  fileSize+=w.size();
+  liveSize=snap.getFullSize();
+  w.finish();
+  return true;
+}
+
+void DivBackupJournal::close() {
+  if (f!=NULL) {
+    fclose(f);
+    f=NULL;
+  }
+  path="";
+  fileSize=0;
+  liveSize=0;
+  chunkPos.clear();
+  sampleCache.clear();
+}
+
+bool DivBackupJournal::isOpen() {
+  return f!=NULL;
+}
+
+const String& DivBackupJournal::getPath() {
+  return path;
+}
+
+size_t DivBackupJournal::size() {
+  return fileSize;
+}
+
+size_t DivBackupJournal::getLiveSize() {
+  return liveSize;
+}
+
+unsigned char* DivBackupJournal::replay(const unsigned char* buf, size_t len, size_t& outLen, String& error) {
+  if (len<JOURNAL_HEADER_SIZE || memcmp(buf,DIV_JOURNAL_MAGIC,16)!=0) {
+    error="not a backup journal";
+    return NULL;
+  }
+
+  // find the last complete snapshot
+  size_t pos=JOURNAL_HEADER_SIZE;
+  size_t lastSnap=0;
+  size_t lastSnapLen=0;
+  while (pos+8<=len) {
+    unsigned int recordLen=buf[pos+4]|(buf[pos+5]<<8)|(buf[pos+6]<<16)|((unsigned int)buf[pos+7]<<24);
+    if (recordLen>len-pos-8) {
+      logW("journal: incomplete record at %x",pos);
+      break;
+    }
+    if (memcmp(&buf[pos],"SNAP",4)==0) {
+      lastSnap=pos+8;
+      lastSnapLen=recordLen;
+    } else if (memcmp(&buf[pos],"CHNK",4)!=0) {
+      logW("journal: unknown record at %x",pos);
+      break;
+    }
+    pos+=8+recordLen;
+  }
+  if (lastSnap==0) {
+    error="the journal does not contain any backup";
+    return NULL;
+  }
+
+  unsigned char* ret=NULL;
+  try {
+    SafeReader reader(buf+lastSnap,lastSnapLen);
+    int64_t snapTime=reader.readL();
+    logD("journal: restoring backup from %d",snapTime);
+    unsigned int headLen=reader.readI();
+    size_t headPos=reader.tell();
+    if (!reader.seek(headLen,SEEK_CUR)) throw EndOfFileException(&reader,lastSnapLen);
+    unsigned int chunkCount=reader.readI();
+
+    std::vector<size_t> chunkPos;
+    std::vector<unsigned int> chunkLen;
+    outLen=headLen;
+    for (unsigned int i=0; i<chunkCount; i++) {
+      size_t p=reader.readL();
+      unsigned int l=reader.readI();
+      if (p>len || l>len-p) {
+        error="the journal is corrupt";
+        return NULL;
+      }
+      chunkPos.push_back(p);
+      chunkLen.push_back(l);
+      outLen+=l;
+    }
+
+    ret=new unsigned char[outLen];
+    memcpy(ret,buf+lastSnap+headPos,headLen);
+    size_t outPos=headLen;
+    for (unsigned int i=0; i<chunkCount; i++) {
+      memcpy(ret+outPos,buf+chunkPos[i],chunkLen[i]);
+      outPos+=chunkLen[i];
+    }
+  } catch (EndOfFileException& e) {
+    error="the journal is corrupt";
+    if (ret!=NULL) delete[] ret;
+    return NULL;
+  }
+  return ret;
+}
+
+DivBackupJournal::~DivBackupJournal() {
+  close();
+}
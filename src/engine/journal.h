@@ -0,0 +1,185 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "safeWriter.h"
+#include "../ta-utils.h"
+
+#define DIV_JOURNAL_MAGIC "-Furnace backup-"
+
+struct DivSample;
+class DivBackupJournal;
+
+/**
+ * a block of a .fur file (instrument, wavetable, sample or pattern).
+ */
+struct DivJournalChunk {
+  uint64_t hash;
+  // second hash, so that a collision of the first one does not merge chunks.
+  uint64_t check;
+  unsigned int len;
+  // NULL if the chunk is already in the journal.
+  unsigned char* data;
+  DivJournalChunk():
+    hash(0),
+    check(0),
+    len(0),
+    data(NULL) {}
+};
+
+/**
+ * a song split in chunks, as written by DivEngine::saveFur().
+ * the head is everything before the first instrument. its pointers already
+ * point to where the chunks will be when they are put after it.
+ * chunks which are already in the journal carry no data.
+ */
+struct DivFurSnapshot {
+  DivBackupJournal* journal;
+  SafeWriter* head;
+  std::vector<DivJournalChunk> chunks;
+  SafeWriter* curChunk;
+
+  /**
+   * start a new chunk. returns the writer to put it in.
+   */
+  SafeWriter* beginChunk();
+
+  /**
+   * finish the current chunk. returns its length.
+   */
+  unsigned int endChunk();
+
+  /**
+   * reuse the chunk of a sample if it has not changed since the last snapshot.
+   * returns its length, or 0 if the sample must be written again.
+   */
+  unsigned int reuseSample(DivSample* sample);
+
+  /**
+   * remember the chunk that was just written for a sample.
+   */
+  void cacheSample(DivSample* sample);
+
+  /**
+   * get the size of the song as a .fur file.
+   */
+  size_t getFullSize();
+
+  void clear();
+
+  DivFurSnapshot(DivBackupJournal* j=NULL):
+    journal(j),
+    head(NULL),
+    curChunk(NULL) {}
+  ~DivFurSnapshot();
+};
+
+/**
+ * an append-only backup file.
+ * it begins with a header and is followed by records:
+ * - CHNK: a chunk (both hashes and data).
+ * - SNAP: a snapshot (time, head and the position and length of each chunk).
+ * only chunks which are not in the file yet are written on every backup, so
+ * unchanged samples, instruments and patterns are stored once.
+ * the last complete snapshot can be turned back into a .fur with replay().
+ */
+class DivBackupJournal {
+  struct ChunkPos {
+    size_t pos;
+    uint64_t check;
+    unsigned int len;
+  };
+  struct SampleEntry {
+    unsigned int rev;
+    uint64_t infoHash;
+    uint64_t hash;
+    uint64_t check;
+    unsigned int len;
+  };
+
+  FILE* f;
+  String path;
+  size_t fileSize;
+  size_t liveSize;
+  std::unordered_map<uint64_t,ChunkPos> chunkPos;
+  std::unordered_map<DivSample*,SampleEntry> sampleCache;
+
+  friend struct DivFurSnapshot;
+
+  public:
+    /**
+     * hash a buffer (64-bit FNV-1a).
+     */
+    static uint64_t hash(const unsigned char* buf, size_t len, uint64_t seed=0xcbf29ce484222325ULL);
+
+    /**
+     * hash a chunk. besides FNV-1a this computes a second, unrelated 64-bit
+     * hash, so chunks are only considered equal if both hashes match.
+     */
+    static void hashChunk(const unsigned char* buf, size_t len, uint64_t& hash, uint64_t& check);
+
+    /**
+     * whether a chunk is already in the journal.
+     */
+    bool hasChunk(uint64_t hash, uint64_t check, unsigned int len);
+
+    /**
+     * create a new journal, replacing any file at path.
+     */
+    bool open(const char* path, String& error);
+
+    /**
+     * append the new chunks of a snapshot and the snapshot itself.
+     * on failure the journal is closed, as its end may be incomplete.
+     */
+    bool append(DivFurSnapshot& snap, String& error);
+
+    void close();
+    bool isOpen();
+    const String& getPath();
+
+    /**
+     * get the size of the journal file.
+     */
+    size_t size();
+
+    /**
+     * get the size of the last snapshot as a .fur file.
+     */
+    size_t getLiveSize();
+
+    /**
+     * build a .fur file out of the last complete snapshot in a journal.
+     * returns NULL on error.
+     */
+    static unsigned char* replay(const unsigned char* buf, size_t len, size_t& outLen, String& error);
+
+    DivBackupJournal():
+      f(NULL),
+      fileSize(0),
+      liveSize(0) {}
+    ~DivBackupJournal();
+};
+
+#endif
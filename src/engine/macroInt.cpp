@@ -38,7 +38,7 @@
 #define LFO_LOOP source.val[14]
 #define LFO_GLOBAL source.val[15]
 
-void DivMacroStruct::prepare(DivInstrumentMacro& source, DivEngine* e) {
+void DivMacroStruct::prepare(const DivInstrumentMacro& source, DivEngine* e) {
   has=had=actualHad=will=true;
   mode=source.mode;
   type=(source.open>>1)&3;
@@ -47,7 +47,7 @@ void DivMacroStruct::prepare(DivInstrumentMacro& source, DivEngine* e) {
   lfoPos=LFO_PHASE;
 }
 
-void DivMacroStruct::doMacro(DivInstrumentMacro& source, bool released, bool tick) {
+void DivMacroStruct::doMacro(const DivInstrumentMacro& source, bool released, bool tick) {
   if (!tick) {
     had=false;
     return;
@@ -507,6 +507,51 @@ void DivMacroInt::notifyInsDeletion(DivInstrument* which) {
   }
 }
 
+DivMacroInt& DivMacroInt::operator=(const DivMacroInt& other) {
+  if (this==&other) return *this;
+  e=other.e;
+  ins=other.ins;
+  macroListLen=other.macroListLen;
+  subTick=other.subTick;
+  released=other.released;
+
+  vol=other.vol;
+  arp=other.arp;
+  duty=other.duty;
+  wave=other.wave;
+  pitch=other.pitch;
+  ex1=other.ex1;
+  ex2=other.ex2;
+  ex3=other.ex3;
+  alg=other.alg;
+  fb=other.fb;
+  fms=other.fms;
+  ams=other.ams;
+  panL=other.panL;
+  panR=other.panR;
+  phaseReset=other.phaseReset;
+  ex4=other.ex4;
+  ex5=other.ex5;
+  ex6=other.ex6;
+  ex7=other.ex7;
+  ex8=other.ex8;
+  for (int i=0; i<4; i++) {
+    op[i]=other.op[i];
+  }
+  hasRelease=other.hasRelease;
+
+  // the sources belong to the instrument, but the list points to ourselves
+  memcpy(macroSource,other.macroSource,128*sizeof(void*));
+  for (int i=0; i<128; i++) {
+    if (other.macroList[i]==NULL) {
+      macroList[i]=NULL;
+      continue;
+    }
+    macroList[i]=(DivMacroStruct*)((unsigned char*)this+((const unsigned char*)other.macroList[i]-(const unsigned char*)&other));
+  }
+  return *this;
+}
+
 #define CONSIDER(x,y) case (y&0x1f): return &x; break;
 
 DivMacroStruct* DivMacroInt::structByType(unsigned char type) {
@@ -30,7 +30,7 @@ struct DivMacroStruct {
   bool has, had, actualHad, finished, will, linger, began, masked, activeRelease;
   unsigned int mode, type;
   unsigned char macroType;
-  void doMacro(DivInstrumentMacro& source, bool released, bool tick);
+  void doMacro(const DivInstrumentMacro& source, bool released, bool tick);
   void init() {
     pos=lastPos=lfoPos=mode=type=delay=0;
     has=had=actualHad=will=false;
@@ -39,7 +39,7 @@ struct DivMacroStruct {
     // TODO: test whether this breaks anything?
     val=0;
   }
-  void prepare(DivInstrumentMacro& source, DivEngine* e);
+  void prepare(const DivInstrumentMacro& source, DivEngine* e);
   DivMacroStruct(unsigned char mType):
     pos(0),
     lastPos(0),
@@ -154,6 +154,17 @@ class DivMacroInt {
      */
     DivMacroStruct* structByType(unsigned char which);
 
+    /**
+     * copy the state of another macro interpreter.
+     * the macro list is rebased so it points to our own macros.
+     */
+    DivMacroInt& operator=(const DivMacroInt& other);
+
+    DivMacroInt(const DivMacroInt& other):
+      DivMacroInt() {
+      *this=other;
+    }
+
     DivMacroInt():
       e(NULL),
       ins(NULL),
@@ -0,0 +1,182 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "mixer.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MIX_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define MIX_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIX_NEON
+#endif
+
+void mixAddShort(float* dest, const short* src, float vol, size_t len) {
+  const float mul=vol/32768.0f;
+  size_t i=0;
+#if defined(MIX_AVX2)
+  const __m256 vMul=_mm256_set1_ps(mul);
+  for (; i+8<=len; i+=8) {
+    __m256 s=_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&src[i])));
+    _mm256_storeu_ps(&dest[i],_mm256_add_ps(_mm256_loadu_ps(&dest[i]),_mm256_mul_ps(s,vMul)));
+  }
+#elif defined(MIX_SSE2)
+  const __m128 vMul=_mm_set1_ps(mul);
+  for (; i+8<=len; i+=8) {
+    __m128i s16=_mm_loadu_si128((const __m128i*)&src[i]);
+    // sign-extend to 32-bit
+    __m128 sLo=_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s16,s16),16));
+    __m128 sHi=_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s16,s16),16));
+    _mm_storeu_ps(&dest[i],_mm_add_ps(_mm_loadu_ps(&dest[i]),_mm_mul_ps(sLo,vMul)));
+    _mm_storeu_ps(&dest[i+4],_mm_add_ps(_mm_loadu_ps(&dest[i+4]),_mm_mul_ps(sHi,vMul)));
+  }
+#elif defined(MIX_NEON)
+  const float32x4_t vMul=vdupq_n_f32(mul);
+  for (; i+8<=len; i+=8) {
+    int16x8_t s16=vld1q_s16(&src[i]);
+    float32x4_t sLo=vcvtq_f32_s32(vmovl_s16(vget_low_s16(s16)));
+    float32x4_t sHi=vcvtq_f32_s32(vmovl_s16(vget_high_s16(s16)));
+    vst1q_f32(&dest[i],vmlaq_f32(vld1q_f32(&dest[i]),sLo,vMul));
+    vst1q_f32(&dest[i+4],vmlaq_f32(vld1q_f32(&dest[i+4]),sHi,vMul));
+  }
+#endif
+  for (; i<len; i++) {
+    dest[i]+=(float)src[i]*mul;
+  }
+}
+
+void mixAddFloat(float* dest, const float* src, float vol, size_t len) {
+  size_t i=0;
+#if defined(MIX_AVX2)
+  const __m256 vMul=_mm256_set1_ps(vol);
+  for (; i+8<=len; i+=8) {
+    _mm256_storeu_ps(&dest[i],_mm256_add_ps(_mm256_loadu_ps(&dest[i]),_mm256_mul_ps(_mm256_loadu_ps(&src[i]),vMul)));
+  }
+#elif defined(MIX_SSE2)
+  const __m128 vMul=_mm_set1_ps(vol);
+  for (; i+4<=len; i+=4) {
+    _mm_storeu_ps(&dest[i],_mm_add_ps(_mm_loadu_ps(&dest[i]),_mm_mul_ps(_mm_loadu_ps(&src[i]),vMul)));
+  }
+#elif defined(MIX_NEON)
+  const float32x4_t vMul=vdupq_n_f32(vol);
+  for (; i+4<=len; i+=4) {
+    vst1q_f32(&dest[i],vmlaq_f32(vld1q_f32(&dest[i]),vld1q_f32(&src[i]),vMul));
+  }
+#endif
+  for (; i<len; i++) {
+    dest[i]+=src[i]*vol;
+  }
+}
+
+void mixMonoClamp(float** out, int chans, size_t len, bool mono, bool clamp) {
+  if (chans<1) return;
+  if (mono && chans<2) mono=false;
+  if (!mono && !clamp) return;
+
+  const float div=1.0f/(float)chans;
+  size_t i=0;
+#if defined(MIX_AVX2)
+  const __m256 vDiv=_mm256_set1_ps(div);
+  const __m256 vMin=_mm256_set1_ps(-1.0f);
+  const __m256 vMax=_mm256_set1_ps(1.0f);
+  for (; i+8<=len; i+=8) {
+    if (mono) {
+      __m256 sum=_mm256_loadu_ps(&out[0][i]);
+      for (int j=1; j<chans; j++) {
+        sum=_mm256_add_ps(sum,_mm256_loadu_ps(&out[j][i]));
+      }
+      sum=_mm256_mul_ps(sum,vDiv);
+      if (clamp) sum=_mm256_min_ps(_mm256_max_ps(sum,vMin),vMax);
+      for (int j=0; j<chans; j++) {
+        _mm256_storeu_ps(&out[j][i],sum);
+      }
+    } else {
+      for (int j=0; j<chans; j++) {
+        _mm256_storeu_ps(&out[j][i],_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&out[j][i]),vMin),vMax));
+      }
+    }
+  }
+#elif defined(MIX_SSE2)
+  const __m128 vDiv=_mm_set1_ps(div);
+  const __m128 vMin=_mm_set1_ps(-1.0f);
+  const __m128 vMax=_mm_set1_ps(1.0f);
+  for (; i+4<=len; i+=4) {
+    if (mono) {
+      __m128 sum=_mm_loadu_ps(&out[0][i]);
+      for (int j=1; j<chans; j++) {
+        sum=_mm_add_ps(sum,_mm_loadu_ps(&out[j][i]));
+      }
+      sum=_mm_mul_ps(sum,vDiv);
+      if (clamp) sum=_mm_min_ps(_mm_max_ps(sum,vMin),vMax);
+      for (int j=0; j<chans; j++) {
+        _mm_storeu_ps(&out[j][i],sum);
+      }
+    } else {
+      for (int j=0; j<chans; j++) {
+        _mm_storeu_ps(&out[j][i],_mm_min_ps(_mm_max_ps(_mm_loadu_ps(&out[j][i]),vMin),vMax));
+      }
+    }
+  }
+#elif defined(MIX_NEON)
+  const float32x4_t vDiv=vdupq_n_f32(div);
+  const float32x4_t vMin=vdupq_n_f32(-1.0f);
+  const float32x4_t vMax=vdupq_n_f32(1.0f);
+  for (; i+4<=len; i+=4) {
+    if (mono) {
+      float32x4_t sum=vld1q_f32(&out[0][i]);
+      for (int j=1; j<chans; j++) {
+        sum=vaddq_f32(sum,vld1q_f32(&out[j][i]));
+      }
+      sum=vmulq_f32(sum,vDiv);
+      if (clamp) sum=vminq_f32(vmaxq_f32(sum,vMin),vMax);
+      for (int j=0; j<chans; j++) {
+        vst1q_f32(&out[j][i],sum);
+      }
+    } else {
+      for (int j=0; j<chans; j++) {
+        vst1q_f32(&out[j][i],vminq_f32(vmaxq_f32(vld1q_f32(&out[j][i]),vMin),vMax));
+      }
+    }
+  }
+#endif
+  for (; i<len; i++) {
+    if (mono) {
+      float sum=out[0][i];
+      for (int j=1; j<chans; j++) {
+        sum+=out[j][i];
+      }
+      sum*=div;
+      if (clamp) {
+        if (sum<-1.0f) sum=-1.0f;
+        if (sum>1.0f) sum=1.0f;
+      }
+      for (int j=0; j<chans; j++) {
+        out[j][i]=sum;
+      }
+    } else {
+      for (int j=0; j<chans; j++) {
+        if (out[j][i]<-1.0f) out[j][i]=-1.0f;
+        if (out[j][i]>1.0f) out[j][i]=1.0f;
+      }
+    }
+  }
+}
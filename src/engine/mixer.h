@@ -0,0 +1,45 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _MIXER_H
+#define _MIXER_H
+
+#include <stddef.h>
+
+// output stage helpers used by DivEngine::nextBuf.
+// these use SSE2/AVX2/NEON if available.
+
+/**
+ * add a chip/preview buffer to an output buffer.
+ * dest[i]+=src[i]*vol/32768
+ */
+void mixAddShort(float* dest, const short* src, float vol, size_t len);
+
+/**
+ * add a float buffer to an output buffer.
+ * dest[i]+=src[i]*vol
+ */
+void mixAddFloat(float* dest, const float* src, float vol, size_t len);
+
+/**
+ * mix all outputs down to mono and/or clamp them to -1.0..1.0.
+ */
+void mixMonoClamp(float** out, int chans, size_t len, bool mono, bool clamp);
+
+#endif
@@ -20,10 +20,133 @@
 #include "engine.h"
 #include "../ta-log.h"
 
+short DivPatternData::emptyRow[DIV_MAX_COLS];
+
+struct DivPatternEmptyRowInit {
+  DivPatternEmptyRowInit() {
+    for (int i=0; i<DIV_MAX_COLS; i++) {
+      DivPatternData::emptyRow[i]=(i<2)?0:-1;
+    }
+  }
+};
+
+static DivPatternEmptyRowInit emptyRowInit;
 static DivPattern emptyPat;
 
+#define BLOCK_SIZE (DIV_PATTERN_BLOCK_ROWS*DIV_MAX_COLS)
+
+static void fillEmpty(short* b) {
+  for (int i=0; i<DIV_PATTERN_BLOCK_ROWS; i++) {
+    memcpy(&b[i*DIV_MAX_COLS],DivPatternData::emptyRow,DIV_MAX_COLS*sizeof(short));
+  }
+}
+
+static bool isEmpty(const short* b) {
+  for (int i=0; i<DIV_PATTERN_BLOCK_ROWS; i++) {
+    if (memcmp(&b[i*DIV_MAX_COLS],DivPatternData::emptyRow,DIV_MAX_COLS*sizeof(short))!=0) return false;
+  }
+  return true;
+}
+
+short* DivPatternData::allocBlock(int which) {
+  short* b=new short[BLOCK_SIZE];
+  fillEmpty(b);
+  // publish the block only after it's been filled
+  block[which].store(b,std::memory_order_release);
+  return b;
+}
+
+void DivPatternData::clear() {
+  for (int i=0; i<DIV_PATTERN_BLOCKS; i++) {
+    if (block[i]!=NULL) fillEmpty(block[i]);
+  }
+}
+
+void DivPatternData::compact() {
+  for (int i=0; i<DIV_PATTERN_BLOCKS; i++) {
+    if (block[i]==NULL) continue;
+    if (isEmpty(block[i])) {
+      delete[] block[i];
+      block[i]=NULL;
+    }
+  }
+}
+
+void DivPatternData::copyOn(DivPatternData& dest) const {
+  copyRowsOn(dest,0,DIV_MAX_ROWS-1);
+}
+
+void DivPatternData::copyRowsOn(DivPatternData& dest, int begin, int end) const {
+  if (&dest==this) return;
+  if (begin<0) begin=0;
+  if (end>=DIV_MAX_ROWS) end=DIV_MAX_ROWS-1;
+  if (begin>end) return;
+  for (int i=begin/DIV_PATTERN_BLOCK_ROWS; i<=end/DIV_PATTERN_BLOCK_ROWS; i++) {
+    if (block[i]==NULL) {
+      if (dest.block[i]!=NULL) fillEmpty(dest.block[i]);
+    } else {
+      short* b=dest.block[i];
+      if (b==NULL) {
+        b=new short[BLOCK_SIZE];
+        memcpy(b,block[i],BLOCK_SIZE*sizeof(short));
+        dest.block[i].store(b,std::memory_order_release);
+      } else {
+        memcpy(b,block[i],BLOCK_SIZE*sizeof(short));
+      }
+    }
+  }
+}
+
+bool DivPatternData::equals(const DivPatternData& other) const {
+  for (int i=0; i<DIV_PATTERN_BLOCKS; i++) {
+    if (block[i]==NULL && other.block[i]==NULL) continue;
+    if (block[i]==NULL) {
+      if (!isEmpty(other.block[i])) return false;
+    } else if (other.block[i]==NULL) {
+      if (!isEmpty(block[i])) return false;
+    } else {
+      if (memcmp(block[i],other.block[i],BLOCK_SIZE*sizeof(short))!=0) return false;
+    }
+  }
+  return true;
+}
+
+size_t DivPatternData::getMemUsage() const {
+  size_t ret=0;
+  for (int i=0; i<DIV_PATTERN_BLOCKS; i++) {
+    if (block[i]!=NULL) ret+=BLOCK_SIZE*sizeof(short);
+  }
+  return ret;
+}
+
+DivPatternData::DivPatternData() {
+  for (int i=0; i<DIV_PATTERN_BLOCKS; i++) {
+    block[i]=NULL;
+  }
+}
+
+DivPatternData::DivPatternData(const DivPatternData& other) {
+  for (int i=0; i<DIV_PATTERN_BLOCKS; i++) {
+    block[i]=NULL;
+  }
+  other.copyOn(*this);
+}
+
+DivPatternData& DivPatternData::operator=(const DivPatternData& other) {
+  other.copyOn(*this);
+  return *this;
+}
+
+DivPatternData::~DivPatternData() {
+  for (int i=0; i<DIV_PATTERN_BLOCKS; i++) {
+    if (block[i]!=NULL) {
+      delete[] block[i];
+      block[i]=NULL;
+    }
+  }
+}
+
 DivPattern::DivPattern() {
-  clear();
 }
 
 DivPattern* DivChannelData::getPattern(int index, bool create) {
@@ -39,13 +162,14 @@ DivPattern* DivChannelData::getPattern(int index, bool create) {
 
 std::vector<std::pair<int,int>> DivChannelData::optimize() {
   std::vector<std::pair<int,int>> ret;
+  compact();
   for (int i=0; i<DIV_MAX_PATTERNS; i++) {
     if (data[i]!=NULL) {
       // compare
       for (int j=0; j<DIV_MAX_PATTERNS; j++) {
         if (j==i) continue;
         if (data[j]==NULL) continue;
-        if (memcmp(data[i]->data,data[j]->data,DIV_MAX_ROWS*DIV_MAX_COLS*sizeof(short))==0) {
+        if (data[i]->data.equals(data[j]->data)) {
           delete data[j];
           data[j]=NULL;
           logV("%d == %d",i,j);
@@ -75,6 +199,12 @@ std::vector<std::pair<int,int>> DivChannelData::rearrange() {
   return ret;
 }
 
+void DivChannelData::compact() {
+  for (int i=0; i<DIV_MAX_PATTERNS; i++) {
+    if (data[i]!=NULL) data[i]->compact();
+  }
+}
+
 void DivChannelData::wipePatterns() {
   for (int i=0; i<DIV_MAX_PATTERNS; i++) {
     if (data[i]!=NULL) {
@@ -84,17 +214,17 @@ void DivChannelData::wipePatterns() {
   }
 }
 
-void DivPattern::copyOn(DivPattern* dest) {
+void DivPattern::copyOn(DivPattern* dest) const {
   dest->name=name;
-  memcpy(dest->data,data,sizeof(data));
+  data.copyOn(dest->data);
 }
 
 void DivPattern::clear() {
-  memset(data,-1,DIV_MAX_ROWS*DIV_MAX_COLS*sizeof(short));
-  for (int i=0; i<DIV_MAX_ROWS; i++) {
-    data[i][0]=0;
-    data[i][1]=0;
-  }
+  data.clear();
+}
+
+void DivPattern::compact() {
+  data.compact();
 }
 
 DivChannelData::DivChannelData():
@@ -19,21 +19,101 @@
 
 #include "safeReader.h"
 #include "../pch.h"
+#include <atomic>
+
+// rows are allocated in blocks of this many rows. must be a power of two.
+#define DIV_PATTERN_BLOCK_ROWS 8
+#define DIV_PATTERN_BLOCKS (DIV_MAX_ROWS/DIV_PATTERN_BLOCK_ROWS)
+
+/**
+ * pattern data storage, accessed as data[ROW][COL].
+ * rows are allocated in blocks when accessed for writing. blocks that were
+ * never written to take no memory and read back as empty rows.
+ * read-only code should access this through a const DivPattern* so that
+ * nothing is allocated (e.g. during playback).
+ * a block is published with a release store after it's filled, so playback may
+ * read while the GUI thread allocates.
+ */
+class DivPatternData {
+  std::atomic<short*> block[DIV_PATTERN_BLOCKS];
+
+  short* allocBlock(int which);
+
+  public:
+    // contents of an empty row
+    static short emptyRow[DIV_MAX_COLS];
+
+    inline short* operator[](int row) {
+      short* b=block[row/DIV_PATTERN_BLOCK_ROWS].load(std::memory_order_acquire);
+      if (b==NULL) b=allocBlock(row/DIV_PATTERN_BLOCK_ROWS);
+      return b+(row&(DIV_PATTERN_BLOCK_ROWS-1))*DIV_MAX_COLS;
+    }
+
+    inline const short* operator[](int row) const {
+      const short* b=block[row/DIV_PATTERN_BLOCK_ROWS].load(std::memory_order_acquire);
+      if (b==NULL) return emptyRow;
+      return b+(row&(DIV_PATTERN_BLOCK_ROWS-1))*DIV_MAX_COLS;
+    }
+
+    /**
+     * empty all rows.
+     * memory is kept (see compact()).
+     */
+    void clear();
+
+    /**
+     * free blocks which only contain empty rows.
+     * not thread-safe! do not call during playback.
+     */
+    void compact();
+
+    /**
+     * copy all rows to another DivPatternData.
+     */
+    void copyOn(DivPatternData& dest) const;
+
+    /**
+     * copy the blocks containing rows begin to end (inclusive) to another
+     * DivPatternData. other blocks in dest are left untouched.
+     */
+    void copyRowsOn(DivPatternData& dest, int begin, int end) const;
+
+    /**
+     * check whether two DivPatternData have the same contents.
+     */
+    bool equals(const DivPatternData& other) const;
+
+    /**
+     * get the amount of memory used by allocated blocks in bytes.
+     */
+    size_t getMemUsage() const;
+
+    DivPatternData();
+    DivPatternData(const DivPatternData& other);
+    DivPatternData& operator=(const DivPatternData& other);
+    ~DivPatternData();
+};
 
 struct DivPattern {
   String name;
-  short data[DIV_MAX_ROWS][DIV_MAX_COLS];
+  DivPatternData data;
 
   /**
    * clear the pattern.
    */
   void clear();
 
+  /**
+   * free memory used by empty rows.
+   * not thread-safe! do not call during playback.
+   */
+  void compact();
+
   /**
    * copy this pattern to another.
    * @param dest the destination pattern.
    */
-  void copyOn(DivPattern* dest);
+  void copyOn(DivPattern* dest) const;
   DivPattern();
 };
 
@@ -71,6 +151,12 @@ struct DivChannelData {
    */
   std::vector<std::pair<int,int>> rearrange();
 
+  /**
+   * free memory used by empty rows in all patterns.
+   * not thread-safe! use a mutex!
+   */
+  void compact();
+
   /**
    * destroy all patterns on this DivChannelData.
    */
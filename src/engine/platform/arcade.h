@@ -54,6 +54,11 @@ class DivPlatformArcade: public DivPlatformOPM {
 
     bool isMuted[8];
 
+    struct State {
+      Channel chan[8];
+      unsigned char amDepth, pmDepth;
+    };
+
     int octave(int freq);
     int toFreq(int freq);
     void commitState(int ch, DivInstrument* ins);
@@ -70,6 +75,10 @@ class DivPlatformArcade: public DivPlatformOPM {
     DivDispatchOscBuffer* getOscBuffer(int chan);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
+    void* getState();
+    void setState(void* state);
+    void saveState(void* state);
+    void freeState(void* state);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
@@ -77,6 +77,13 @@ class DivPlatformGB: public DivDispatch {
   GB_gameboy_t* gb;
   GB_model_t model;
   unsigned char regPool[128];
+  struct State {
+    Channel chan[4];
+    DivWaveSynth ws;
+    unsigned char lastPan;
+    bool doubleWave, lastDoubleWave;
+    int antiClickPeriodCount, antiClickWavePos;
+  };
   
   unsigned char procMute();
   void updateWave();  
@@ -91,6 +98,10 @@ class DivPlatformGB: public DivDispatch {
     DivDispatchOscBuffer* getOscBuffer(int chan);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
+    void* getState();
+    void setState(void* state);
+    void saveState(void* state);
+    void freeState(void* state);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
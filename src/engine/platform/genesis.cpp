@@ -1596,6 +1596,34 @@ int DivPlatformGenesis::getRegisterPoolSize() {
   return 512;
 }
 
+void* DivPlatformGenesis::getState() {
+  State* s=new State;
+  saveState(s);
+  return s;
+}
+
+void DivPlatformGenesis::saveState(void* state) {
+  State* s=(State*)state;
+  for (int i=0; i<10; i++) {
+    s->chan[i]=chan[i];
+  }
+  s->lfoValue=lfoValue;
+  s->extMode=extMode;
+}
+
+void DivPlatformGenesis::setState(void* state) {
+  State* s=(State*)state;
+  for (int i=0; i<10; i++) {
+    chan[i]=s->chan[i];
+  }
+  lfoValue=s->lfoValue;
+  extMode=s->extMode;
+}
+
+void DivPlatformGenesis::freeState(void* state) {
+  delete (State*)state;
+}
+
 float DivPlatformGenesis::getPostAmp() {
   return 2.0f;
 }
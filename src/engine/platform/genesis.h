@@ -98,6 +98,12 @@ class DivPlatformGenesis: public DivPlatformOPN {
     int dacShifter, o_lro, o_bco;
   
     unsigned char dacVolTable[128];
+
+    struct State {
+      Channel chan[10];
+      unsigned char lfoValue;
+      bool extMode;
+    };
   
     friend void putDispatchChip(void*,int);
     friend void putDispatchChan(void*,int,int);
@@ -123,6 +129,10 @@ class DivPlatformGenesis: public DivPlatformOPN {
     virtual int mapVelocity(int ch, float vel);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
+    void* getState();
+    void setState(void* state);
+    void saveState(void* state);
+    void freeState(void* state);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
@@ -821,6 +821,34 @@ int DivPlatformGenesisExt::mapVelocity(int ch, float vel) {
   return DivPlatformGenesis::mapVelocity(ch,vel);
 }
 
+void* DivPlatformGenesisExt::getState() {
+  ExtState* s=new ExtState;
+  saveState(s);
+  return s;
+}
+
+void DivPlatformGenesisExt::saveState(void* state) {
+  ExtState* s=(ExtState*)state;
+  DivPlatformGenesis::saveState(s);
+  for (int i=0; i<4; i++) {
+    s->opChan[i]=opChan[i];
+  }
+  s->lastExtChPan=lastExtChPan;
+}
+
+void DivPlatformGenesisExt::setState(void* state) {
+  ExtState* s=(ExtState*)state;
+  DivPlatformGenesis::setState(s);
+  for (int i=0; i<4; i++) {
+    opChan[i]=s->opChan[i];
+  }
+  lastExtChPan=s->lastExtChPan;
+}
+
+void DivPlatformGenesisExt::freeState(void* state) {
+  delete (ExtState*)state;
+}
+
 void DivPlatformGenesisExt::reset() {
   DivPlatformGenesis::reset();
 
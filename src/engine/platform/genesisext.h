@@ -27,6 +27,10 @@
 class DivPlatformGenesisExt: public DivPlatformGenesis {
   OPNOpChannelStereo opChan[4];
   bool isOpMuted[4];
+  struct ExtState: public State {
+    OPNOpChannelStereo opChan[4];
+    unsigned char lastExtChPan;
+  };
   friend void putDispatchChip(void*,int);
   friend void putDispatchChan(void*,int,int);
   inline void commitStateExt(int ch, DivInstrument* ins);
@@ -37,6 +41,10 @@ class DivPlatformGenesisExt: public DivPlatformGenesis {
     unsigned short getPan(int chan);
     DivDispatchOscBuffer* getOscBuffer(int chan);
     int mapVelocity(int ch, float vel);
+    void* getState();
+    void setState(void* state);
+    void saveState(void* state);
+    void freeState(void* state);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
@@ -2148,6 +2148,55 @@ int DivPlatformOPL::getRegisterPoolSize() {
   return (oplType<3)?256:512;
 }
 
+void* DivPlatformOPL::getState() {
+  State* s=new State;
+  saveState(s);
+  return s;
+}
+
+void DivPlatformOPL::saveState(void* state) {
+  State* s=(State*)state;
+  for (int i=0; i<20; i++) {
+    s->chan[i]=chan[i];
+  }
+  s->slots=slots;
+  s->chanMap=chanMap;
+  s->melodicChans=melodicChans;
+  s->totalChans=totalChans;
+  s->sampleBank=sampleBank;
+  s->drumState=drumState;
+  s->lfoValue=lfoValue;
+  memcpy(s->drumVol,drumVol,5);
+  s->properDrums=properDrums;
+  s->dam=dam;
+  s->dvb=dvb;
+  s->update4OpMask=update4OpMask;
+}
+
+void DivPlatformOPL::setState(void* state) {
+  State* s=(State*)state;
+  for (int i=0; i<20; i++) {
+    chan[i]=s->chan[i];
+  }
+  slots=s->slots;
+  chanMap=s->chanMap;
+  melodicChans=s->melodicChans;
+  totalChans=s->totalChans;
+  sampleBank=s->sampleBank;
+  iface.sampleBank=sampleBank;
+  drumState=s->drumState;
+  lfoValue=s->lfoValue;
+  memcpy(drumVol,s->drumVol,5);
+  properDrums=s->properDrums;
+  dam=s->dam;
+  dvb=s->dvb;
+  update4OpMask=s->update4OpMask;
+}
+
+void DivPlatformOPL::freeState(void* state) {
+  delete (State*)state;
+}
+
 void DivPlatformOPL::reset() {
   while (!writes.empty()) writes.pop();
   memset(regPool,0,512);
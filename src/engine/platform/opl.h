@@ -118,6 +118,16 @@ class DivPlatformOPL: public DivDispatch {
     short oldWrites[512];
     short pendingWrites[512];
 
+    struct State {
+      Channel chan[20];
+      const unsigned char** slots;
+      const unsigned short* chanMap;
+      int melodicChans, totalChans, sampleBank;
+      unsigned char drumState, lfoValue;
+      unsigned char drumVol[5];
+      bool properDrums, dam, dvb, update4OpMask;
+    };
+
     // chips
     opl3_chip fm;
     ymfm::ym3526* fm_ymfm1;
@@ -156,6 +166,10 @@ class DivPlatformOPL: public DivDispatch {
     int mapVelocity(int ch, float vel);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
+    void* getState();
+    void setState(void* state);
+    void saveState(void* state);
+    void freeState(void* state);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
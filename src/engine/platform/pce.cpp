@@ -583,6 +583,40 @@ int DivPlatformPCE::getRegisterPoolSize() {
   return 112;
 }
 
+void* DivPlatformPCE::getState() {
+  State* s=new State;
+  saveState(s);
+  return s;
+}
+
+void DivPlatformPCE::saveState(void* state) {
+  State* s=(State*)state;
+  for (int i=0; i<6; i++) {
+    s->chan[i]=chan[i];
+  }
+  s->lastPan=lastPan;
+  s->sampleBank=sampleBank;
+  s->lfoMode=lfoMode;
+  s->lfoSpeed=lfoSpeed;
+  s->updateLFO=updateLFO;
+}
+
+void DivPlatformPCE::setState(void* state) {
+  State* s=(State*)state;
+  for (int i=0; i<6; i++) {
+    chan[i]=s->chan[i];
+  }
+  lastPan=s->lastPan;
+  sampleBank=s->sampleBank;
+  lfoMode=s->lfoMode;
+  lfoSpeed=s->lfoSpeed;
+  updateLFO=s->updateLFO;
+}
+
+void DivPlatformPCE::freeState(void* state) {
+  delete (State*)state;
+}
+
 void DivPlatformPCE::reset() {
   writes.clear();
   memset(regPool,0,128);
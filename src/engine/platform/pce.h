@@ -76,6 +76,11 @@ class DivPlatformPCE: public DivDispatch {
   int coreQuality;
   PCE_PSG* pce;
   unsigned char regPool[128];
+  struct State {
+    Channel chan[6];
+    unsigned char lastPan, sampleBank, lfoMode, lfoSpeed;
+    bool updateLFO;
+  };
   void updateWave(int ch);
   friend void putDispatchChip(void*,int);
   friend void putDispatchChan(void*,int,int);
@@ -92,6 +97,10 @@ class DivPlatformPCE: public DivDispatch {
     int mapVelocity(int ch, float vel);
     unsigned char* getRegisterPool();
     int getRegisterPoolSize();
+    void* getState();
+    void setState(void* state);
+    void saveState(void* state);
+    void freeState(void* state);
     void reset();
     void forceIns();
     void tick(bool sysTick=true);
@@ -23,6 +23,7 @@
 #include "dispatch.h"
 #include "engine.h"
 #include "workPool.h"
+#include "mixer.h"
 #include "../ta-log.h"
 #include <math.h>
 
@@ -389,6 +390,14 @@ int DivEngine::dispatchCmd(DivCommand c) {
 
   c.chan=dispatchChanOfChan[c.dis];
 
+  if (pipelining) {
+    // out of room: render what we have and continue without pipelining
+    if (disCont[dispatchOfChan[c.dis]].pipeFull()) pipeFlush();
+  }
+  if (pipelining) {
+    disCont[dispatchOfChan[c.dis]].pipeEvents.push_back(DivPipeEvent(c,divider));
+  }
+
   return disCont[dispatchOfChan[c.dis]].dispatch->dispatch(c);
 }
 
@@ -449,7 +458,7 @@ bool DivEngine::perSystemPreEffect(int ch, unsigned char effect, unsigned char e
 void DivEngine::processRowPre(int i) {
   int whatOrder=curOrder;
   int whatRow=curRow;
-  DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][whatOrder],false);
+  const DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][whatOrder],false);
   for (int j=0; j<curPat[i].effectCols; j++) {
     short effect=pat->data[whatRow][4+(j<<1)];
     short effectVal=pat->data[whatRow][5+(j<<1)];
@@ -463,7 +472,7 @@ void DivEngine::processRowPre(int i) {
 void DivEngine::processRow(int i, bool afterDelay) {
   int whatOrder=afterDelay?chan[i].delayOrder:curOrder;
   int whatRow=afterDelay?chan[i].delayRow:curRow;
-  DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][whatOrder],false);
+  const DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][whatOrder],false);
   // pre effects
   if (!afterDelay) {
     bool returnAfterPre=false;
@@ -1207,6 +1216,12 @@ void DivEngine::nextRow() {
   static char pb1[4096];
   static char pb2[4096];
   static char pb3[4096];
+  // nothing of this row has been rendered yet
+  if (rangeEndOrder>=0 && rangeEndPos<0 && !skipping) {
+    if (curOrder>rangeEndOrder || (curOrder==rangeEndOrder && curRow>=rangeEndRow)) {
+      rangeEndPos=bufferPos>>MASTER_CLOCK_PREC;
+    }
+  }
   if (view==DIV_STATUS_PATTERN && !skipping) {
     strcpy(pb1,"");
     strcpy(pb3,"");
@@ -1214,7 +1229,7 @@ void DivEngine::nextRow() {
       snprintf(pb,4095," %.2x",curOrders->ord[i][curOrder]);
       strcat(pb1,pb);
       
-      DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][curOrder],false);
+      const DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][curOrder],false);
       snprintf(pb2,4095,"\x1b[37m %s",
               formatNote(pat->data[curRow][0],pat->data[curRow][1]));
       strcat(pb3,pb2);
@@ -1343,7 +1358,7 @@ void DivEngine::nextRow() {
 
   // post row details
   for (int i=0; i<chans; i++) {
-    DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][curOrder],false);
+    const DivPattern* pat=curPat[i].getPattern(curOrders->ord[i][curOrder],false);
     if (!(pat->data[curRow][0]==0 && pat->data[curRow][1]==0)) {
       if (pat->data[curRow][0]!=100 && pat->data[curRow][0]!=101 && pat->data[curRow][0]!=102) {
         if (!chan[i].legato) {
@@ -1422,24 +1437,7 @@ void DivEngine::nextRow() {
   firstTick=true;
 }
 
-bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
-  bool ret=false;
-  if (divider<1) divider=1;
-
-  if (lowLatency && !skipping && !inhibitLowLat) {
-    tickMult=1000/divider;
-    if (tickMult<1) tickMult=1;
-  } else {
-    tickMult=1;
-  }
-  
-  cycles=got.rate*pow(2,MASTER_CLOCK_PREC)/(divider*tickMult);
-  clockDrift+=fmod(got.rate*pow(2,MASTER_CLOCK_PREC),(double)(divider*tickMult));
-  if (clockDrift>=(divider*tickMult)) {
-    clockDrift-=(divider*tickMult);
-    cycles++;
-  }
-
+void DivEngine::processPendingNotes() {
   if (!pendingNotes.empty()) {
     bool isOn[DIV_MAX_CHANS];
     memset(isOn,0,DIV_MAX_CHANS*sizeof(bool));
@@ -1496,6 +1494,27 @@ bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
     }
     pendingNotes.pop_front();
   }
+}
+
+bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
+  bool ret=false;
+  if (divider<1) divider=1;
+
+  if (lowLatency && !skipping && !inhibitLowLat) {
+    tickMult=1000/divider;
+    if (tickMult<1) tickMult=1;
+  } else {
+    tickMult=1;
+  }
+  
+  cycles=got.rate*pow(2,MASTER_CLOCK_PREC)/(divider*tickMult);
+  clockDrift+=fmod(got.rate*pow(2,MASTER_CLOCK_PREC),(double)(divider*tickMult));
+  if (clockDrift>=(divider*tickMult)) {
+    clockDrift-=(divider*tickMult);
+    cycles++;
+  }
+
+  processPendingNotes();
 
   if (!freelance) {
     if (--subticks<=0) {
@@ -1744,6 +1763,7 @@ bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
     ret=true;
     shallStop=false;
     shallStopSched=false;
+    pipeFlush();
     // reset all chan oscs
     for (int i=0; i<chans; i++) {
       DivDispatchOscBuffer* buf=disCont[dispatchOfChan[i]].dispatch->getOscBuffer(dispatchChanOfChan[i]);
@@ -1757,7 +1777,11 @@ bool DivEngine::nextTick(bool noAccum, bool inhibitLowLat) {
   }
 
   // system tick
-  for (int i=0; i<song.systemLen; i++) disCont[i].dispatch->tick(subticks==tickMult);
+  for (int i=0; i<song.systemLen; i++) {
+    if (pipelining && disCont[i].pipeFull()) pipeFlush();
+    if (pipelining) disCont[i].pipeEvents.push_back(DivPipeEvent(subticks==tickMult,divider));
+    disCont[i].dispatch->tick(subticks==tickMult);
+  }
 
   if (!freelance) {
     if (stepPlay!=1) {
@@ -1935,6 +1959,126 @@ void _runDispatch2(void* d) {
 
 }
 
+void DivEngine::pipeFlush() {
+  if (!pipelining) return;
+  pipelining=false;
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].pipeEnd();
+  }
+  renderPool->pushBatch([](void* d) {
+    DivDispatchContainer* dc=(DivDispatchContainer*)d;
+    dc->pipeRender();
+  },disCont,sizeof(DivDispatchContainer),song.systemLen);
+  renderPool->wait();
+}
+
+void DivEngine::updatePerf(uint64_t total, uint64_t tick, uint64_t mix) {
+  uint64_t acquireTotal=0;
+  uint64_t fillTotal=0;
+  DivPerfFrame* frame=NULL;
+
+  if (perfTrace) {
+    // the trace is preallocated. don't grow it here
+    if (perfFrames.size()<perfFrames.capacity()) {
+      perfFrames.push_back(DivPerfFrame());
+      frame=&perfFrames.back();
+      memset(frame,0,sizeof(DivPerfFrame));
+    } else {
+      perfFramesDropped++;
+    }
+  }
+
+  for (int i=0; i<song.systemLen; i++) {
+    perfChip[i][0].add(disCont[i].perfAcquire);
+    perfChip[i][1].add(disCont[i].perfFill);
+    acquireTotal+=disCont[i].perfAcquire;
+    fillTotal+=disCont[i].perfFill;
+    if (frame!=NULL) {
+      frame->chip[i][0]=disCont[i].perfAcquire;
+      frame->chip[i][1]=disCont[i].perfFill;
+    }
+  }
+
+  perf[DIV_PERF_TOTAL].add(total);
+  perf[DIV_PERF_TICK].add(tick);
+  perf[DIV_PERF_ACQUIRE].add(acquireTotal);
+  perf[DIV_PERF_FILLBUF].add(fillTotal);
+  perf[DIV_PERF_MIX].add(mix);
+
+  if (frame!=NULL) {
+    frame->phase[DIV_PERF_TOTAL]=total;
+    frame->phase[DIV_PERF_TICK]=tick;
+    frame->phase[DIV_PERF_ACQUIRE]=acquireTotal;
+    frame->phase[DIV_PERF_FILLBUF]=fillTotal;
+    frame->phase[DIV_PERF_MIX]=mix;
+  }
+}
+
+int DivEngine::getMidiInPos(const TAMidiMessage& msg, double bufTime, unsigned int size) {
+  // no time stamp
+  if (msg.time<=0.0) return 0;
+  double pos=(double)size+(msg.time-bufTime)*got.rate;
+  if (pos<0.0) return 0;
+  if (pos>=(double)size) return size-1;
+  return (int)pos;
+}
+
+void DivEngine::processMidiIn(const TAMidiMessage& msg) {
+  if (midiDebug) {
+    if (msg.type==TA_MIDI_SYSEX) {
+      logD("MIDI debug: %.2X SysEx",msg.type);
+    } else {
+      logD("MIDI debug: %.2X %.2X %.2X",msg.type,msg.data[0],msg.data[1]);
+    }
+  }
+  int ins=-1;
+  if ((ins=midiCallback(msg))!=-2) {
+    int chan=msg.type&15;
+    switch (msg.type&0xf0) {
+      case TA_MIDI_NOTE_OFF: {
+        if (midiIsDirect) {
+          if (chan<0 || chan>=chans) break;
+          pendingNotes.push_back(DivNoteEvent(chan,-1,-1,-1,false,false,true));
+        } else {
+          autoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
+        }
+        if (!playing) {
+          reset();
+          freelance=true;
+          playing=true;
+        }
+        break;
+      }
+      case TA_MIDI_NOTE_ON: {
+        if (msg.data[1]==0) {
+          if (midiIsDirect) {
+            if (chan<0 || chan>=chans) break;
+            pendingNotes.push_back(DivNoteEvent(chan,-1,-1,-1,false,false,true));
+          } else {
+            autoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
+          }
+        } else {
+          if (midiIsDirect) {
+            if (chan<0 || chan>=chans) break;
+            pendingNotes.push_back(DivNoteEvent(chan,ins,msg.data[0]-12,msg.data[1],true,false,true));
+          } else {
+            autoNoteOn(msg.type&15,ins,msg.data[0]-12,msg.data[1]);
+          }
+        }
+        break;
+      }
+      case TA_MIDI_PROGRAM: {
+        if (midiIsDirect && midiIsDirectProgram) {
+          pendingNotes.push_back(DivNoteEvent(chan,msg.data[0],0,0,false,true,true));
+        }
+        break;
+      }
+    }
+  } else if (midiDebug) {
+    logD("callback wants ignore");
+  }
+}
+
 void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsigned int size) {
   lastNBIns=inChans;
   lastNBOuts=outChans;
@@ -1944,6 +2088,23 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
     logW("nextBuf called with size 0!");
     return;
   }
+
+  // the buffer size grew without notice. render in pieces of the prepared size rather than allocate here,
+  // and remember the size for the next prepareBuffers() call.
+  size_t preparedSize=scratchBufSize;
+  if (size>preparedSize && preparedSize>0 && outChans<=DIV_MAX_OUTPUTS) {
+    if (size>wantedBufSize) wantedBufSize=size;
+    float* outPart[DIV_MAX_OUTPUTS];
+    for (unsigned int pos=0; pos<size; pos+=preparedSize) {
+      if (out!=NULL) {
+        for (int i=0; i<outChans; i++) {
+          outPart[i]=out[i]+pos;
+        }
+      }
+      nextBuf(in,(out==NULL)?NULL:outPart,inChans,outChans,MIN(preparedSize,size-pos));
+    }
+    return;
+  }
   lastLoopPos=-1;
 
   if (out!=NULL) {
@@ -1962,73 +2123,46 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
   }
   got.bufsize=size;
 
-  std::chrono::steady_clock::time_point ts_processBegin=std::chrono::steady_clock::now();
+  // get temporary buffers
+  // these are allocated by prepareBuffers(), never here. if it wasn't called, output silence.
+  if (size>scratchBufSize || renderPool==NULL) {
+    if (size>wantedBufSize) wantedBufSize=size;
+    isBusy.unlock();
+    return;
+  }
+  scratch.reset();
+  metroTick=(unsigned char*)scratch.alloc(size);
+  metroBuf=(float*)scratch.alloc(size*sizeof(float));
+  if (metroTick==NULL || metroBuf==NULL) {
+    logE("no scratch memory!");
+    isBusy.unlock();
+    return;
+  }
 
-  if (renderPool==NULL) {
-    unsigned int howManyThreads=song.systemLen;
-    if (howManyThreads<2) howManyThreads=0;
-    if (howManyThreads>renderPoolThreads) howManyThreads=renderPoolThreads;
-    renderPool=new DivWorkPool(howManyThreads);
+  std::chrono::steady_clock::time_point ts_processBegin=std::chrono::steady_clock::now();
+  uint64_t tickTime=0;
+  bool profiling=(perfProfiling || perfTrace);
+  for (int i=0; i<song.systemLen; i++) {
+    disCont[i].perfAcquire=0;
+    disCont[i].perfFill=0;
+    disCont[i].profile=profiling;
   }
 
-  // process MIDI events (TODO: everything)
-  if (output) if (output->midiIn) while (!output->midiIn->queue.empty()) {
-    TAMidiMessage& msg=output->midiIn->queue.front();
-    if (midiDebug) {
-      if (msg.type==TA_MIDI_SYSEX) {
-        logD("MIDI debug: %.2X SysEx",msg.type);
-      } else {
-        logD("MIDI debug: %.2X %.2X %.2X",msg.type,msg.data[0],msg.data[1]);
-      }
-    }
-    int ins=-1;
-    if ((ins=midiCallback(msg))!=-2) {
-      int chan=msg.type&15;
-      switch (msg.type&0xf0) {
-        case TA_MIDI_NOTE_OFF: {
-          if (midiIsDirect) {
-            if (chan<0 || chan>=chans) break;
-            pendingNotes.push_back(DivNoteEvent(chan,-1,-1,-1,false,false,true));
-          } else {
-            autoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
-          }
-          if (!playing) {
-            reset();
-            freelance=true;
-            playing=true;
-          }
-          break;
-        }
-        case TA_MIDI_NOTE_ON: {
-          if (msg.data[1]==0) {
-            if (midiIsDirect) {
-              if (chan<0 || chan>=chans) break;
-              pendingNotes.push_back(DivNoteEvent(chan,-1,-1,-1,false,false,true));
-            } else {
-              autoNoteOff(msg.type&15,msg.data[0]-12,msg.data[1]);
-            }
-          } else {
-            if (midiIsDirect) {
-              if (chan<0 || chan>=chans) break;
-              pendingNotes.push_back(DivNoteEvent(chan,ins,msg.data[0]-12,msg.data[1],true,false,true));
-            } else {
-              autoNoteOn(msg.type&15,ins,msg.data[0]-12,msg.data[1]);
-            }
-          }
-          break;
-        }
-        case TA_MIDI_PROGRAM: {
-          if (midiIsDirect && midiIsDirectProgram) {
-            pendingNotes.push_back(DivNoteEvent(chan,msg.data[0],0,0,false,true,true));
-          }
-          break;
-        }
-      }
-    } else if (midiDebug) {
-      logD("callback wants ignore");
+  // process MIDI events
+  // these are scheduled within the buffer by the time they arrived at (one buffer late), so that
+  // timing doesn't depend on when the buffer starts. if we aren't playing (or are halted), handle them now,
+  // as the render loop below won't run.
+  double bufTime=std::chrono::duration<double>(ts_processBegin.time_since_epoch()).count();
+  int midiInLeft=0;
+  int midiInPos=0;
+  if (output) if (output->midiIn) {
+    if (playing && !halted) {
+      midiInLeft=output->midiIn->queue.size();
+      if (midiInLeft>0) midiInPos=getMidiInPos(output->midiIn->queue.front(),bufTime,size);
+    } else while (!output->midiIn->queue.empty()) {
+      processMidiIn(output->midiIn->queue.front());
+      output->midiIn->queue.pop();
     }
-    //logD("%.2x",msg.type);
-    output->midiIn->queue.pop();
   }
   
   // process sample/wave preview
@@ -2194,6 +2328,7 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
         disCont[i].runtotal=blip_clocks_needed(disCont[i].bb[0],size-disCont[i].lastAvail);
       }
       if (disCont[i].runtotal>disCont[i].bbInLen) {
+        // this allocates (prepare() should have been called)
         logD("growing dispatch %d bbIn to %d",i,disCont[i].runtotal+256);
         disCont[i].grow(disCont[i].runtotal+256);
       }
@@ -2201,17 +2336,31 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
       disCont[i].runPos=0;
     }
 
-    if (metroTickLen<size) {
-      if (metroTick!=NULL) delete[] metroTick;
-      metroTick=new unsigned char[size];
-      metroTickLen=size;
-    }
-
     memset(metroTick,0,size);
 
+    // pipelined rendering: run the sequencer for the whole buffer first and
+    // record what each chip has to do, then let every chip render on its own.
+    // this only works if every chip has a shadow copy (see pipeBegin()).
+    if (renderPipeline && song.systemLen>0) {
+      pipelining=true;
+      for (int i=0; i<song.systemLen; i++) {
+        if (disCont[i].shadow==NULL) {
+          pipelining=false;
+          break;
+        }
+      }
+      if (pipelining) {
+        for (int i=0; i<song.systemLen; i++) {
+          disCont[i].pipeBegin();
+        }
+      }
+    }
+
     int attempts=0;
+    // every MIDI input event may split the buffer once more
+    int attemptLimit=size+midiInLeft;
     int runLeftG=size<<MASTER_CLOCK_PREC;
-    while (++attempts<(int)size) {
+    while (++attempts<attemptLimit) {
       // -1. set bufferPos
       bufferPos=(size<<MASTER_CLOCK_PREC)-runLeftG;
 
@@ -2220,10 +2369,26 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
       // 1. check whether we are done with all buffers
       if (runLeftG<=0) break;
 
+      // 1.5. apply MIDI input events which are due
+      if (midiInLeft>0 && (size_t)(midiInPos<<MASTER_CLOCK_PREC)<=bufferPos) {
+        while (midiInLeft>0 && (size_t)(midiInPos<<MASTER_CLOCK_PREC)<=bufferPos) {
+          processMidiIn(output->midiIn->queue.front());
+          output->midiIn->queue.pop();
+          if (--midiInLeft>0) {
+            midiInPos=MAX(midiInPos,getMidiInPos(output->midiIn->queue.front(),bufTime,size));
+          }
+        }
+        processPendingNotes();
+      }
+
       // 2. check whether we gonna tick
       if (cycles<=0) {
         // we have to tick
-        if (nextTick()) {
+        std::chrono::steady_clock::time_point ts_tickBegin;
+        if (profiling) ts_tickBegin=std::chrono::steady_clock::now();
+        bool looped=nextTick();
+        if (profiling) tickTime+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-ts_tickBegin).count();
+        if (looped) {
           /*totalTicks=0;
           totalSeconds=0;*/
           lastLoopPos=size-(runLeftG>>MASTER_CLOCK_PREC);
@@ -2248,46 +2413,76 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
           pendingMetroTick=0;
         }
       } else {
+        // stop at the next MIDI input event
+        int runCycles=cycles;
+        if (midiInLeft>0) {
+          runCycles=MIN(runCycles,(midiInPos<<MASTER_CLOCK_PREC)-(int)bufferPos);
+        }
+
         // 3. run MIDI clock
-        int midiTotal=MIN(cycles,runLeftG);
+        int midiTotal=MIN(runCycles,runLeftG);
         runMidiClock(midiTotal);
 
         // 4. run MIDI timecode
         runMidiTime(midiTotal);
 
         // 5. tick the clock and fill buffers as needed
-        if (cycles<runLeftG) {
+        if (pipelining) {
+          for (int i=0; i<song.systemLen; i++) {
+            if (disCont[i].pipeFull()) {
+              pipeFlush();
+              break;
+            }
+          }
+        }
+        if (runCycles<runLeftG && pipelining) {
           for (int i=0; i<song.systemLen; i++) {
-            disCont[i].cycles=cycles;
+            DivDispatchContainer* dc=&disCont[i];
+            int total=(runCycles*dc->runtotal)/(size<<MASTER_CLOCK_PREC);
+            dc->pipeEvents.push_back(DivPipeEvent(dc->runPos,total));
+            dc->runLeft-=total;
+            dc->runPos+=total;
+          }
+          runLeftG-=runCycles;
+          cycles-=runCycles;
+        } else if (runCycles<runLeftG) {
+          for (int i=0; i<song.systemLen; i++) {
+            disCont[i].cycles=runCycles;
             disCont[i].size=size;
-            renderPool->push([](void* d) {
-              DivDispatchContainer* dc=(DivDispatchContainer*)d;
-              int total=(dc->cycles*dc->runtotal)/(dc->size<<MASTER_CLOCK_PREC);
-              dc->acquire(dc->runPos,total);
-              dc->runLeft-=total;
-              dc->runPos+=total;
-            },&disCont[i]);
           }
+          renderPool->pushBatch([](void* d) {
+            DivDispatchContainer* dc=(DivDispatchContainer*)d;
+            int total=(dc->cycles*dc->runtotal)/(dc->size<<MASTER_CLOCK_PREC);
+            dc->acquire(dc->runPos,total);
+            dc->runLeft-=total;
+            dc->runPos+=total;
+          },disCont,sizeof(DivDispatchContainer),song.systemLen);
           renderPool->wait();
-          runLeftG-=cycles;
-          cycles=0;
+          runLeftG-=runCycles;
+          cycles-=runCycles;
         } else {
           cycles-=runLeftG;
           runLeftG=0;
-          for (int i=0; i<song.systemLen; i++) {
-            renderPool->push([](void* d) {
+          if (pipelining) {
+            for (int i=0; i<song.systemLen; i++) {
+              DivDispatchContainer* dc=&disCont[i];
+              dc->pipeEvents.push_back(DivPipeEvent(dc->runPos,dc->runLeft));
+              dc->runLeft=0;
+            }
+          } else {
+            renderPool->pushBatch([](void* d) {
               DivDispatchContainer* dc=(DivDispatchContainer*)d;
               dc->acquire(dc->runPos,dc->runLeft);
               dc->runLeft=0;
-            },&disCont[i]);
+            },disCont,sizeof(DivDispatchContainer),song.systemLen);
+            renderPool->wait();
           }
-          renderPool->wait();
         }
       }
     }
 
     //logD("attempts: %d",attempts);
-    if (attempts>=(int)(size+10)) {
+    if (attempts>=attemptLimit+10) {
       logE("hang detected! stopping! at %d seconds %d micro (%d>=%d)",totalSeconds,totalTicks,attempts,(int)size);
       freelance=false;
       playing=false;
@@ -2295,28 +2490,44 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
     }
     totalProcessed=size-(runLeftG>>MASTER_CLOCK_PREC);
 
-    for (int i=0; i<song.systemLen; i++) {
-      if (size<disCont[i].lastAvail) {
-        logW("%d: size<lastAvail! %d<%d",i,size,disCont[i].lastAvail);
-        continue;
+    if (pipelining) {
+      // render everything at once (one barrier for the whole buffer)
+      pipelining=false;
+      for (int i=0; i<song.systemLen; i++) {
+        disCont[i].pipeEnd();
+        disCont[i].pipeFill=(size>=disCont[i].lastAvail);
+        if (!disCont[i].pipeFill) {
+          logW("%d: size<lastAvail! %d<%d",i,size,disCont[i].lastAvail);
+        }
+        disCont[i].size=size;
       }
-      disCont[i].size=size;
-      renderPool->push([](void* d) {
+      renderPool->pushBatch([](void* d) {
         DivDispatchContainer* dc=(DivDispatchContainer*)d;
-        dc->fillBuf(dc->runtotal,dc->lastAvail,dc->size-dc->lastAvail);
-      },&disCont[i]);
+        dc->pipeRender();
+        if (dc->pipeFill) dc->fillBuf(dc->runtotal,dc->lastAvail,dc->size-dc->lastAvail);
+      },disCont,sizeof(DivDispatchContainer),song.systemLen);
+      renderPool->wait();
+    } else {
+      for (int i=0; i<song.systemLen; i++) {
+        if (size<disCont[i].lastAvail) {
+          logW("%d: size<lastAvail! %d<%d",i,size,disCont[i].lastAvail);
+          continue;
+        }
+        disCont[i].size=size;
+        renderPool->push([](void* d) {
+          DivDispatchContainer* dc=(DivDispatchContainer*)d;
+          dc->fillBuf(dc->runtotal,dc->lastAvail,dc->size-dc->lastAvail);
+        },&disCont[i]);
+      }
+      renderPool->wait();
     }
-    renderPool->wait();
   }
 
-  // process metronome
-  if (metroBufLen<size || metroBuf==NULL) {
-    if (metroBuf!=NULL) delete[] metroBuf;
-    metroBuf=new float[size];
-    metroBufLen=size;
-  }
+  std::chrono::steady_clock::time_point ts_mixBegin;
+  if (profiling) ts_mixBegin=std::chrono::steady_clock::now();
 
-  memset(metroBuf,0,metroBufLen*sizeof(float));
+  // process metronome
+  memset(metroBuf,0,size*sizeof(float));
 
   if (mustPlay && metronome) {
     for (size_t i=0; i<size; i++) {
@@ -2378,20 +2589,14 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
               break;
           }
 
-          for (size_t j=0; j<size; j++) {
-            out[destSubPort][j]+=((float)disCont[srcPortSet].bbOut[srcSubPort][j]/32768.0)*vol;
-          }
+          mixAddShort(out[destSubPort],disCont[srcPortSet].bbOut[srcSubPort],vol,size);
         }
       } else if (srcPortSet==0xffd) {
         // sample preview
-        for (size_t j=0; j<size; j++) {
-          out[destSubPort][j]+=previewVol*(samp_bbOut[j]/32768.0);
-        }
+        mixAddShort(out[destSubPort],samp_bbOut,previewVol,size);
       } else if (srcPortSet==0xffe && playing && !halted) {
         // metronome
-        for (size_t j=0; j<size; j++) {
-          out[destSubPort][j]+=metroBuf[j];
-        }
+        mixAddFloat(out[destSubPort],metroBuf,1.0f,size);
       }
 
       // nothing/invalid
@@ -2400,42 +2605,28 @@ void DivEngine::nextBuf(float** in, float** out, int inChans, int outChans, unsi
     // nothing/invalid
   }
 
-  // dump to oscillator buffer
-  for (unsigned int i=0; i<size; i++) {
+  // dump to oscillator buffer (in up to two pieces due to wrap-around)
+  if (size>0) {
+    unsigned int oscFirst=MIN((unsigned int)size,(unsigned int)(32768-oscWritePos));
+    unsigned int oscSecond=MIN((unsigned int)size-oscFirst,32768);
     for (int j=0; j<outChans; j++) {
       if (oscBuf[j]==NULL) continue;
-      oscBuf[j][oscWritePos]=out[j][i];
+      memcpy(&oscBuf[j][oscWritePos],out[j],oscFirst*sizeof(float));
+      if (oscSecond>0) memcpy(oscBuf[j],&out[j][oscFirst],oscSecond*sizeof(float));
     }
-    if (++oscWritePos>=32768) oscWritePos=0;
+    oscWritePos=(oscWritePos+size)&32767;
   }
   oscSize=size;
 
-  // force mono audio (if enabled)
-  if (forceMono && outChans>1) {
-    for (size_t i=0; i<size; i++) {
-      float chanSum=out[0][i];
-      for (int j=1; j<outChans; j++) {
-        chanSum+=out[j][i];
-      }
-      out[0][i]=chanSum/outChans;
-      for (int j=1; j<outChans; j++) {
-        out[j][i]=out[0][i];
-      }
-    }
-  }
-
-  // clamp output (if enabled)
-  if (clampSamples) {
-    for (size_t i=0; i<size; i++) {
-      for (int j=0; j<outChans; j++) {
-        if (out[j][i]<-1.0) out[j][i]=-1.0;
-        if (out[j][i]>1.0) out[j][i]=1.0;
-      }
-    }
-  }
-  isBusy.unlock();
+  // force mono audio and clamp output (if enabled)
+  mixMonoClamp(out,outChans,size,forceMono,clampSamples);
 
   std::chrono::steady_clock::time_point ts_processEnd=std::chrono::steady_clock::now();
 
   processTime=std::chrono::duration_cast<std::chrono::nanoseconds>(ts_processEnd-ts_processBegin).count();
+  if (profiling) {
+    processTimeMix=std::chrono::duration_cast<std::chrono::nanoseconds>(ts_processEnd-ts_mixBegin).count();
+    updatePerf(processTime,tickTime,processTimeMix);
+  }
+  isBusy.unlock();
 }
@@ -0,0 +1,82 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "profiler.h"
+#include <algorithm>
+
+static const char* perfPhaseNames[DIV_PERF_MAX]={
+  "total",
+  "tick",
+  "acquire",
+  "fillBuf",
+  "mix"
+};
+
+void DivPerfCounter::add(uint64_t ns) {
+  unsigned int p=pos.load(std::memory_order_relaxed);
+  hist[p].store((ns>0xffffffff)?0xffffffff:(unsigned int)ns,std::memory_order_relaxed);
+  pos.store((p+1)&(DIV_PERF_HISTORY-1),std::memory_order_relaxed);
+  if (count.load(std::memory_order_relaxed)<DIV_PERF_HISTORY) {
+    count.fetch_add(1,std::memory_order_relaxed);
+  }
+}
+
+DivPerfStats DivPerfCounter::getStats() {
+  DivPerfStats ret;
+  unsigned int vals[DIV_PERF_HISTORY];
+  unsigned int p=pos.load(std::memory_order_relaxed);
+  unsigned int n=count.load(std::memory_order_relaxed);
+  if (n==0) return ret;
+
+  // copy from oldest to newest
+  uint64_t sum=0;
+  for (unsigned int i=0; i<n; i++) {
+    vals[i]=hist[(p+DIV_PERF_HISTORY-n+i)&(DIV_PERF_HISTORY-1)].load(std::memory_order_relaxed);
+    sum+=vals[i];
+  }
+  ret.last=vals[n-1];
+  ret.avg=sum/n;
+  ret.count=n;
+
+  unsigned int p99Pos=(n*99)/100;
+  if (p99Pos>=n) p99Pos=n-1;
+  std::nth_element(vals,vals+p99Pos,vals+n);
+  ret.p99=vals[p99Pos];
+  ret.min=*std::min_element(vals,vals+n);
+
+  return ret;
+}
+
+void DivPerfCounter::reset() {
+  count.store(0,std::memory_order_relaxed);
+  pos.store(0,std::memory_order_relaxed);
+}
+
+DivPerfCounter::DivPerfCounter():
+  pos(0),
+  count(0) {
+  for (int i=0; i<DIV_PERF_HISTORY; i++) {
+    hist[i]=0;
+  }
+}
+
+const char* getPerfPhaseName(DivPerfPhases phase) {
+  if (phase<0 || phase>=DIV_PERF_MAX) return "???";
+  return perfPhaseNames[phase];
+}
@@ -0,0 +1,75 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <atomic>
+#include <stdint.h>
+
+// number of buffers kept for statistics
+#define DIV_PERF_HISTORY 256
+
+enum DivPerfPhases {
+  // the whole nextBuf() call
+  DIV_PERF_TOTAL=0,
+  // sequencer (nextTick())
+  DIV_PERF_TICK,
+  // chip emulation (acquire())
+  DIV_PERF_ACQUIRE,
+  // band-limited resampling (fillBuf())
+  DIV_PERF_FILLBUF,
+  // patchbay and output stage
+  DIV_PERF_MIX,
+
+  DIV_PERF_MAX
+};
+
+// all times in nanoseconds
+struct DivPerfStats {
+  unsigned int last, min, avg, p99;
+  // number of buffers these statistics are from
+  unsigned int count;
+  DivPerfStats():
+    last(0),
+    min(0),
+    avg(0),
+    p99(0),
+    count(0) {}
+};
+
+/**
+ * keeps the time spent in something for the last DIV_PERF_HISTORY buffers.
+ * add() must only be called from one thread, but getStats() may be called
+ * from any thread.
+ */
+class DivPerfCounter {
+  std::atomic<unsigned int> hist[DIV_PERF_HISTORY];
+  std::atomic<unsigned int> pos, count;
+
+  public:
+    void add(uint64_t ns);
+    DivPerfStats getStats();
+    void reset();
+    DivPerfCounter();
+};
+
+const char* getPerfPhaseName(DivPerfPhases phase);
+
+#endif
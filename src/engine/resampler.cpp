@@ -0,0 +1,259 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define _USE_MATH_DEFINES
+#include "resampler.h"
+#include "workPool.h"
+#include "../ta-log.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RESAMPLE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define RESAMPLE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLE_NEON
+#endif
+
+// phases of the kernel table when the ratio is not rational
+#define RESAMPLE_PHASES 1024
+// largest number of phases for the exact (rational) path
+#define RESAMPLE_MAX_EXACT_PHASES 4096
+#define RESAMPLE_MAX_TAPS 512
+// outputs per parallel job
+#define RESAMPLE_CHUNK 65536
+// don't bother with threads below this many outputs
+#define RESAMPLE_THREAD_MIN 262144
+
+struct PolyphaseKernel {
+  float* coeffs;
+  int taps, phases;
+  // exact mode: output i reads input position i*den/num
+  bool exact;
+  uint64_t num, den;
+  // interpolated mode: input samples per output sample
+  double step;
+};
+
+struct PolyphaseJob {
+  const PolyphaseKernel* kernel;
+  const float* in;
+  size_t inLen;
+  float* out;
+  size_t start, end;
+};
+
+// taps must be a multiple of 8
+static inline float firDot(const float* x, const float* h, int taps) {
+#if defined(RESAMPLE_AVX2)
+  __m256 acc=_mm256_setzero_ps();
+  for (int j=0; j<taps; j+=8) {
+    acc=_mm256_add_ps(acc,_mm256_mul_ps(_mm256_loadu_ps(&x[j]),_mm256_loadu_ps(&h[j])));
+  }
+  __m128 sum=_mm_add_ps(_mm256_castps256_ps128(acc),_mm256_extractf128_ps(acc,1));
+  sum=_mm_add_ps(sum,_mm_movehl_ps(sum,sum));
+  sum=_mm_add_ss(sum,_mm_shuffle_ps(sum,sum,1));
+  return _mm_cvtss_f32(sum);
+#elif defined(RESAMPLE_SSE2)
+  __m128 acc0=_mm_setzero_ps();
+  __m128 acc1=_mm_setzero_ps();
+  for (int j=0; j<taps; j+=8) {
+    acc0=_mm_add_ps(acc0,_mm_mul_ps(_mm_loadu_ps(&x[j]),_mm_loadu_ps(&h[j])));
+    acc1=_mm_add_ps(acc1,_mm_mul_ps(_mm_loadu_ps(&x[j+4]),_mm_loadu_ps(&h[j+4])));
+  }
+  __m128 sum=_mm_add_ps(acc0,acc1);
+  sum=_mm_add_ps(sum,_mm_movehl_ps(sum,sum));
+  sum=_mm_add_ss(sum,_mm_shuffle_ps(sum,sum,1));
+  return _mm_cvtss_f32(sum);
+#elif defined(RESAMPLE_NEON)
+  float32x4_t acc0=vdupq_n_f32(0.0f);
+  float32x4_t acc1=vdupq_n_f32(0.0f);
+  for (int j=0; j<taps; j+=8) {
+    acc0=vmlaq_f32(acc0,vld1q_f32(&x[j]),vld1q_f32(&h[j]));
+    acc1=vmlaq_f32(acc1,vld1q_f32(&x[j+4]),vld1q_f32(&h[j+4]));
+  }
+  float32x4_t sum=vaddq_f32(acc0,acc1);
+  return vgetq_lane_f32(sum,0)+vgetq_lane_f32(sum,1)+vgetq_lane_f32(sum,2)+vgetq_lane_f32(sum,3);
+#else
+  float acc[8];
+  memset(acc,0,8*sizeof(float));
+  for (int j=0; j<taps; j+=8) {
+    for (int k=0; k<8; k++) {
+      acc[k]+=x[j+k]*h[j+k];
+    }
+  }
+  return ((acc[0]+acc[4])+(acc[1]+acc[5]))+((acc[2]+acc[6])+(acc[3]+acc[7]));
+#endif
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b) {
+  while (b!=0) {
+    uint64_t t=a%b;
+    a=b;
+    b=t;
+  }
+  return a;
+}
+
+// fc is the cutoff relative to the input Nyquist frequency
+static void buildKernel(PolyphaseKernel& k, double fc) {
+  int rows=k.exact?k.phases:(k.phases+1);
+  int half=k.taps/2;
+  k.coeffs=new float[rows*k.taps];
+  for (int p=0; p<rows; p++) {
+    double frac=(double)p/(double)k.phases;
+    float* row=&k.coeffs[p*k.taps];
+    double sum=0.0;
+    for (int j=0; j<k.taps; j++) {
+      // distance between this tap and the output position, in input samples
+      double x=(double)(j-(half-1))-frac;
+      double t=x/(double)half;
+      double h=0.0;
+      if (t>-1.0 && t<1.0) {
+        double s=(x==0.0)?1.0:(sin(M_PI*fc*x)/(M_PI*fc*x));
+        // Blackman window
+        double w=0.42+0.5*cos(M_PI*t)+0.08*cos(2.0*M_PI*t);
+        h=s*w;
+      }
+      row[j]=h;
+      sum+=h;
+    }
+    // unity gain at DC
+    if (sum!=0.0) {
+      for (int j=0; j<k.taps; j++) {
+        row[j]/=sum;
+      }
+    }
+  }
+}
+
+static void resampleChunk(void* d) {
+  PolyphaseJob* job=(PolyphaseJob*)d;
+  const PolyphaseKernel& k=*job->kernel;
+  // the input is padded by taps samples on each side
+  const float* in=job->in+k.taps-(k.taps/2-1);
+
+  if (k.exact) {
+    for (size_t i=job->start; i<job->end; i++) {
+      uint64_t pos=(uint64_t)i*k.den;
+      size_t base=pos/k.num;
+      if (base>job->inLen) {
+        job->out[i]=0.0f;
+        continue;
+      }
+      job->out[i]=firDot(&in[base],&k.coeffs[(pos%k.num)*k.taps],k.taps);
+    }
+  } else {
+    for (size_t i=job->start; i<job->end; i++) {
+      double pos=(double)i*k.step;
+      size_t base=(size_t)pos;
+      if (base>job->inLen) {
+        job->out[i]=0.0f;
+        continue;
+      }
+      double phase=(pos-(double)base)*(double)k.phases;
+      int p=(int)phase;
+      if (p>=k.phases) p=k.phases-1;
+      float frac=phase-(double)p;
+      float s0=firDot(&in[base],&k.coeffs[p*k.taps],k.taps);
+      float s1=firDot(&in[base],&k.coeffs[(p+1)*k.taps],k.taps);
+      job->out[i]=s0+(s1-s0)*frac;
+    }
+  }
+}
+
+void resamplePolyphase(const float* in, size_t inLen, float* out, size_t outLen, double sRate, double tRate, int taps) {
+  if (outLen==0) return;
+  if (inLen==0 || sRate<=0.0 || tRate<=0.0) {
+    memset(out,0,outLen*sizeof(float));
+    return;
+  }
+
+  PolyphaseKernel k;
+  double fc=1.0;
+  if (tRate<sRate) {
+    // lower the cutoff to the output Nyquist frequency and widen the kernel to match
+    fc=tRate/sRate;
+    taps=(int)ceil((double)taps/fc);
+  }
+  taps=(taps+7)&(~7);
+  if (taps<8) taps=8;
+  if (taps>RESAMPLE_MAX_TAPS) taps=RESAMPLE_MAX_TAPS;
+  k.taps=taps;
+
+  // integer rates with a small ratio get one phase per output position
+  k.exact=false;
+  k.num=1;
+  k.den=1;
+  k.step=sRate/tRate;
+  k.phases=RESAMPLE_PHASES;
+  if (sRate==floor(sRate) && tRate==floor(tRate) && sRate<4294967296.0 && tRate<4294967296.0) {
+    uint64_t s=(uint64_t)sRate;
+    uint64_t t=(uint64_t)tRate;
+    uint64_t g=gcd(s,t);
+    if (t/g<=RESAMPLE_MAX_EXACT_PHASES) {
+      k.exact=true;
+      k.num=t/g;
+      k.den=s/g;
+      k.phases=k.num;
+    }
+  }
+  buildKernel(k,fc);
+  logV("resampling: %d taps, %d phases (%s)",k.taps,k.phases,k.exact?"exact":"interpolated");
+
+  // padded copy of the input, so that the kernel never reads out of bounds
+  float* padded=new float[inLen+2*taps];
+  memset(padded,0,taps*sizeof(float));
+  memcpy(&padded[taps],in,inLen*sizeof(float));
+  memset(&padded[taps+inLen],0,taps*sizeof(float));
+
+  std::vector<PolyphaseJob> jobs;
+  for (size_t i=0; i<outLen; i+=RESAMPLE_CHUNK) {
+    PolyphaseJob job;
+    job.kernel=&k;
+    job.in=padded;
+    job.inLen=inLen;
+    job.out=out;
+    job.start=i;
+    job.end=(i+RESAMPLE_CHUNK>outLen)?outLen:(i+RESAMPLE_CHUNK);
+    jobs.push_back(job);
+  }
+
+  unsigned int howManyThreads=std::thread::hardware_concurrency();
+  if (outLen>=RESAMPLE_THREAD_MIN && jobs.size()>1 && howManyThreads>1) {
+    if (howManyThreads>jobs.size()) howManyThreads=jobs.size();
+    DivWorkPool* pool=new DivWorkPool(howManyThreads);
+    pool->pushBatch(resampleChunk,jobs.data(),sizeof(PolyphaseJob),jobs.size());
+    pool->wait();
+    delete pool;
+  } else {
+    for (PolyphaseJob& i: jobs) {
+      resampleChunk(&i);
+    }
+  }
+
+  delete[] padded;
+  delete[] k.coeffs;
+}
@@ -0,0 +1,46 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _RESAMPLER_H
+#define _RESAMPLER_H
+
+#include <stddef.h>
+
+// polyphase windowed-sinc resampler used by DivSample::resample().
+// the FIR kernels use SSE2/AVX2/NEON if available, and long buffers are
+// split in chunks which are resampled in parallel.
+
+// kernel lengths of the quality presets
+#define DIV_RESAMPLE_TAPS_FAST 8
+#define DIV_RESAMPLE_TAPS_NORMAL 32
+#define DIV_RESAMPLE_TAPS_HQ 64
+
+/**
+ * resample a buffer.
+ * if the rates are integers with a small ratio between them, an exact set of
+ * phases is used. otherwise the kernel is interpolated between phases.
+ * when downsampling, the cutoff is lowered and the kernel made longer.
+ * @param in the input (inLen samples).
+ * @param out the output (outLen samples).
+ * @param sRate the input rate.
+ * @param tRate the output rate.
+ * @param taps the kernel length when not downsampling (a multiple of 8).
+ */
+void resamplePolyphase(const float* in, size_t inLen, float* out, size_t outLen, double sRate, double tRate, int taps);
+
+#endif
@@ -19,6 +19,12 @@
 
 #include "safeReader.h"
 #include "../ta-log.h"
+#include <zlib.h>
+#include <fmt/printf.h>
+#include <new>
+
+#define READER_INFLATE_MIN_SIZE 131072
+#define READER_INFLATE_FIRST_SIZE 4096
 
 //#define READ_DEBUG
 
@@ -298,3 +304,112 @@ String SafeReader::readStringToken() {
   // This will strip LHS whitespace and only return contents after it.
   return readStringToken(' ', true);
 }
+
+static void setInflateError(z_stream& zl, int nextErr, String& error) {
+  if (zl.msg==NULL) {
+    logD("zlib error: unknown error! %d",nextErr);
+    error="unknown decompression error";
+  } else {
+    logD("zlib inflate: %s",zl.msg);
+    error=fmt::sprintf("decompression error: %s",zl.msg);
+  }
+}
+
+unsigned char* SafeReader::readInflated(size_t& outLen, String& error, size_t sizeHint) {
+  // check the zlib header first (deflate, window size and check bits)
+  if (len-curSeek<2) {
+    error="not a zlib stream";
+    return NULL;
+  }
+  unsigned char cmf=buf[curSeek];
+  unsigned char flg=buf[curSeek+1];
+  if ((cmf&15)!=8 || (cmf>>4)>7 || (((unsigned int)cmf<<8)|flg)%31!=0) {
+    error="not a zlib stream";
+    return NULL;
+  }
+
+  z_stream zl;
+  memset(&zl,0,sizeof(z_stream));
+  zl.avail_in=len-curSeek;
+  zl.next_in=(Bytef*)(buf+curSeek);
+
+  int nextErr=inflateInit(&zl);
+  if (nextErr!=Z_OK) {
+    if (zl.msg==NULL) {
+      logD("zlib error: unknown! %d",nextErr);
+    } else {
+      logD("zlib error: %s",zl.msg);
+    }
+    inflateEnd(&zl);
+    error="not a zlib stream";
+    return NULL;
+  }
+
+  // decompress the beginning into a small buffer.
+  // a file which only looks like a zlib stream fails here, before the output buffer is allocated.
+  unsigned char first[READER_INFLATE_FIRST_SIZE];
+  zl.next_out=first;
+  zl.avail_out=READER_INFLATE_FIRST_SIZE;
+  nextErr=inflate(&zl,Z_SYNC_FLUSH);
+  if (nextErr!=Z_OK && nextErr!=Z_STREAM_END) {
+    setInflateError(zl,nextErr,error);
+    inflateEnd(&zl);
+    return NULL;
+  }
+  size_t firstLen=zl.total_out;
+
+  // songs usually compress to about a fourth of their size
+  size_t cap=sizeHint;
+  if (cap==0) cap=(len-curSeek)*4;
+  if (cap<READER_INFLATE_MIN_SIZE) cap=READER_INFLATE_MIN_SIZE;
+  unsigned char* out=NULL;
+  try {
+    out=new unsigned char[cap];
+    memcpy(out,first,firstLen);
+    zl.next_out=out+firstLen;
+    zl.avail_out=cap-firstLen;
+
+    while (nextErr!=Z_STREAM_END) {
+      if (zl.avail_out==0) {
+        unsigned char* newOut=new unsigned char[cap<<1];
+        memcpy(newOut,out,cap);
+        delete[] out;
+        out=newOut;
+        zl.next_out=out+cap;
+        zl.avail_out=cap;
+        cap<<=1;
+      }
+
+      nextErr=inflate(&zl,Z_SYNC_FLUSH);
+      if (nextErr!=Z_OK && nextErr!=Z_STREAM_END) {
+        setInflateError(zl,nextErr,error);
+        inflateEnd(&zl);
+        delete[] out;
+        return NULL;
+      }
+    }
+  } catch (std::bad_alloc& e) {
+    logE("out of memory while decompressing! (%d bytes)",cap);
+    error="out of memory";
+    inflateEnd(&zl);
+    if (out!=NULL) delete[] out;
+    return NULL;
+  }
+
+  outLen=zl.total_out;
+  curSeek=len-zl.avail_in;
+
+  nextErr=inflateEnd(&zl);
+  if (nextErr!=Z_OK) {
+    if (zl.msg==NULL) {
+      logD("zlib end error: unknown error! %d",nextErr);
+      error="unknown decompression finish error";
+    } else {
+      logD("zlib end: %s",zl.msg);
+      error=fmt::sprintf("decompression finish error: %s",zl.msg);
+    }
+    delete[] out;
+    return NULL;
+  }
+  return out;
+}
@@ -71,6 +71,12 @@ class SafeReader {
     String readStringToken();
     inline bool isEOF() { return curSeek >= len; };
 
+    // inflate the zlib stream starting at the current position into a new
+    // buffer (to be freed using delete[]).
+    // the buffer starts at sizeHint bytes (estimated if 0) and grows geometrically.
+    // returns NULL and sets error on failure.
+    unsigned char* readInflated(size_t& outLen, String& error, size_t sizeHint=0);
+
     SafeReader(const void* b, size_t l):
       buf((const unsigned char*)b),
       len(l),
@@ -19,28 +19,34 @@
 
 #include "safeWriter.h"
 #include "../ta-log.h"
+#include "../fileutils.h"
+#include <zlib.h>
+#include <errno.h>
+#include <string.h>
 
 #define WRITER_BUF_SIZE 16384
+#define WRITER_FILE_BUF_SIZE 262144
+#define WRITER_DEFLATE_SIZE 131072
 
 unsigned char* SafeWriter::getFinalBuf() {
   return buf;
 }
 
 void SafeWriter::checkSize(size_t amount) {
-  while ((curSeek+amount)>=bufLen) {
-    size_t newSize=WRITER_BUF_SIZE*(1+((curSeek+amount)/WRITER_BUF_SIZE));
-    if (newSize<(bufLen+WRITER_BUF_SIZE)) {
-      logE("REPORT NOW: newSize is too small! case 1... %d<%d",(int)newSize,(int)(bufLen+WRITER_BUF_SIZE));
-    }
-    if (newSize<(curSeek+amount)) {
-      logE("REPORT NOW: newSize is too small! case 2... %d<%d",(int)newSize,(int)(curSeek+amount));
-    }
-    unsigned char* newBuf=new unsigned char[newSize];
-    memcpy(newBuf,buf,bufLen);
-    delete[] buf;
-    buf=newBuf;
-    bufLen=newSize;
+  if ((curSeek+amount)<bufLen) return;
+
+  // grow geometrically, so that the total amount of copying stays linear
+  size_t newSize=WRITER_BUF_SIZE*(1+((curSeek+amount)/WRITER_BUF_SIZE));
+  if (newSize<(bufLen<<1)) newSize=bufLen<<1;
+  if (newSize<(curSeek+amount)) {
+    logE("REPORT NOW: newSize is too small! %d<%d",(int)newSize,(int)(curSeek+amount));
   }
+
+  unsigned char* newBuf=new unsigned char[newSize];
+  memcpy(newBuf,buf,len);
+  delete[] buf;
+  buf=newBuf;
+  bufLen=newSize;
 }
 
 bool SafeWriter::seek(ssize_t where, int whence) {
@@ -74,6 +80,26 @@ size_t SafeWriter::size() {
 
 int SafeWriter::write(const void* what, size_t count) {
   if (!operative) return 0;
+  if (file!=NULL) {
+    if (fileError) return 0;
+    if (filePos!=curSeek) {
+      if (fseek(file,curSeek,SEEK_SET)!=0) {
+        logE("SafeWriter: could not seek!");
+        fileError=true;
+        return 0;
+      }
+      filePos=curSeek;
+    }
+    if (fwrite(what,1,count,file)!=count) {
+      logE("SafeWriter: could not write!");
+      fileError=true;
+      return 0;
+    }
+    curSeek+=count;
+    filePos=curSeek;
+    if (curSeek>len) len=curSeek;
+    return count;
+  }
   checkSize(count);
   memcpy(buf+curSeek,what,count);
   curSeek+=count;
@@ -217,19 +243,90 @@ void SafeWriter::init() {
   operative=true;
 }
 
+bool SafeWriter::initFile(const char* path) {
+  if (operative) return false;
+  file=ps_fopen(path,"wb");
+  if (file==NULL) return false;
+  setvbuf(file,NULL,_IOFBF,WRITER_FILE_BUF_SIZE);
+  buf=NULL;
+  bufLen=0;
+  len=0;
+  curSeek=0;
+  filePos=0;
+  fileError=false;
+  operative=true;
+  return true;
+}
+
+bool SafeWriter::isFileBacked() {
+  return file!=NULL;
+}
+
 SafeReader* SafeWriter::toReader() {
+  if (file!=NULL) {
+    logE("SafeWriter: can't make a reader out of a file-backed writer!");
+    return NULL;
+  }
   return new SafeReader(buf,len);
 }
 
-void SafeWriter::finish() {
-  if (!operative) return;
+int SafeWriter::writeCompressed(FILE* f, int level, bool gzip) {
+  if (!operative || file!=NULL) return 2;
+  unsigned char zbuf[WRITER_DEFLATE_SIZE];
+  z_stream zl;
+  memset(&zl,0,sizeof(z_stream));
+  // 16 selects the gzip header
+  if (deflateInit2(&zl,level,Z_DEFLATED,gzip?(15+16):15,8,Z_DEFAULT_STRATEGY)!=Z_OK) {
+    logE("zlib error!");
+    return 2;
+  }
+  zl.avail_in=len;
+  zl.next_in=buf;
+
+  int ret=Z_OK;
+  while (ret!=Z_STREAM_END) {
+    zl.avail_out=WRITER_DEFLATE_SIZE;
+    zl.next_out=zbuf;
+    // feeding everything at once and finishing straight away lets zlib
+    // produce output a block at a time without buffering the whole stream
+    ret=deflate(&zl,Z_FINISH);
+    if (ret==Z_STREAM_ERROR) {
+      logE("zlib stream error!");
+      deflateEnd(&zl);
+      return 2;
+    }
+    size_t amount=WRITER_DEFLATE_SIZE-zl.avail_out;
+    if (amount>0) {
+      if (fwrite(zbuf,1,amount,f)!=amount) {
+        logE("did not write entirely: %s!",strerror(errno));
+        deflateEnd(&zl);
+        return 1;
+      }
+    }
+  }
+  deflateEnd(&zl);
+  return 0;
+}
+
+bool SafeWriter::finish() {
+  if (!operative) return false;
+  operative=false;
+  if (file!=NULL) {
+    if (fclose(file)!=0) fileError=true;
+    file=NULL;
+    return !fileError;
+  }
   delete[] buf;
   buf=NULL;
-  operative=false;
+  return true;
 }
 
 void SafeWriter::disown() {
   if (!operative) return;
+  if (file!=NULL) {
+    finish();
+    return;
+  }
   buf=NULL;
   operative=false;
 }
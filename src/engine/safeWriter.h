@@ -33,9 +33,15 @@ class SafeWriter {
 
   size_t curSeek;
 
+  // file-backed mode
+  FILE* file;
+  size_t filePos;
+  bool fileError;
+
   void checkSize(size_t amount);
 
   public:
+    // returns NULL in file-backed mode.
     unsigned char* getFinalBuf();
 
     bool seek(ssize_t where, int whence);
@@ -60,8 +66,18 @@ class SafeWriter {
     int writeText(String val);
 
     void init();
+    // write straight to a file instead of memory. seeking is still possible.
+    // returns false if the file could not be opened.
+    bool initFile(const char* path);
+    bool isFileBacked();
     SafeReader* toReader();
-    void finish();
+    // compress the contents using zlib and write them to a file, a block at a time.
+    // level is a zlib compression level (0-9, or -1 for the default).
+    // if gzip is true, a gzip stream is written instead of a zlib one.
+    // returns 0 on success, 1 on write error or 2 on compression error.
+    int writeCompressed(FILE* f, int level=-1, bool gzip=false);
+    // in file-backed mode this closes the file and returns false if writing failed.
+    bool finish();
     void disown();
 
     SafeWriter():
@@ -69,7 +85,10 @@ class SafeWriter {
       buf(NULL),
       bufLen(0),
       len(0),
-      curSeek(0) {}
+      curSeek(0),
+      file(NULL),
+      filePos(0),
+      fileError(false) {}
 };
 
 #endif
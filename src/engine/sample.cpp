@@ -22,10 +22,12 @@
 #include "../fileutils.h"
 #include <math.h>
 #include <string.h>
+#include <atomic>
 #ifdef HAVE_SNDFILE
 #include "sfWrapper.h"
 #endif
 #include "filter.h"
+#include "resampler.h"
 #include "bsr.h"
 
 extern "C" {
@@ -40,6 +42,7 @@ extern "C" {
 
 DivSampleHistory::~DivSampleHistory() {
   if (data!=NULL) delete[] data;
+  sampleFreeSnapshot(snap);
 }
 
 void DivSample::putSampleData(SafeWriter* w) {
@@ -49,24 +52,7 @@ void DivSample::putSampleData(SafeWriter* w) {
   blockStartSeek=w->tell();
   w->writeI(0);
 
-  w->writeString(name,false);
-  w->writeI(samples);
-  w->writeI(rate);
-  w->writeI(centerRate);
-  w->writeC(depth);
-  w->writeC(loopMode);
-  w->writeC(brrEmphasis);
-  w->writeC((dither?1:0)|(brrNoFilter?2:0));
-  w->writeI(loop?loopStart:-1);
-  w->writeI(loop?loopEnd:-1);
-
-  for (int i=0; i<DIV_MAX_SAMPLE_TYPE; i++) {
-    unsigned int out=0;
-    for (int j=0; j<DIV_MAX_CHIPS; j++) {
-      if (renderOn[i][j]) out|=1<<j;
-    }
-    w->writeI(out);
-  }
+  putSampleInfo(w);
 
 #ifdef TA_BIG_ENDIAN
   // store 16-bit samples as little-endian
@@ -90,6 +76,27 @@ void DivSample::putSampleData(SafeWriter* w) {
   w->seek(0,SEEK_END);
 }
 
+void DivSample::putSampleInfo(SafeWriter* w) {
+  w->writeString(name,false);
+  w->writeI(samples);
+  w->writeI(rate);
+  w->writeI(centerRate);
+  w->writeC(depth);
+  w->writeC(loopMode);
+  w->writeC(brrEmphasis);
+  w->writeC((dither?1:0)|(brrNoFilter?2:0));
+  w->writeI(loop?loopStart:-1);
+  w->writeI(loop?loopEnd:-1);
+
+  for (int i=0; i<DIV_MAX_SAMPLE_TYPE; i++) {
+    unsigned int out=0;
+    for (int j=0; j<DIV_MAX_CHIPS; j++) {
+      if (renderOn[i][j]) out|=1<<j;
+    }
+    w->writeI(out);
+  }
+}
+
 // Delek why
 static double samplePitchesSD[11]={
   0.1666666666, 0.2, 0.25, 0.333333333, 0.5,
@@ -527,90 +534,77 @@ bool DivSample::initInternal(DivSampleDepth d, int count) {
   logV("initInternal(%d,%d)",(int)d,count);
   switch (d) {
     case DIV_SAMPLE_DEPTH_1BIT: // 1-bit
-      if (data1!=NULL) delete[] data1;
+      sampleFree(data1);
       length1=(count+7)/8;
-      data1=new unsigned char[length1];
-      memset(data1,0,length1);
+      data1=(unsigned char*)sampleAlloc(length1);
       break;
     case DIV_SAMPLE_DEPTH_1BIT_DPCM: // DPCM
-      if (dataDPCM!=NULL) delete[] dataDPCM;
+      sampleFree(dataDPCM);
       lengthDPCM=1+((((count-1)/8)+15)&(~15));
-      dataDPCM=new unsigned char[lengthDPCM];
+      dataDPCM=(unsigned char*)sampleAlloc(lengthDPCM);
       memset(dataDPCM,0xaa,lengthDPCM);
       break;
     case DIV_SAMPLE_DEPTH_YMZ_ADPCM: // YMZ ADPCM
-      if (dataZ!=NULL) delete[] dataZ;
+      sampleFree(dataZ);
       lengthZ=(count+1)/2;
       // for padding AICA sample
-      dataZ=new unsigned char[(lengthZ+3)&(~0x03)];
-      memset(dataZ,0,(lengthZ+3)&(~0x03));
+      dataZ=(unsigned char*)sampleAlloc((lengthZ+3)&(~0x03));
       break;
     case DIV_SAMPLE_DEPTH_QSOUND_ADPCM: // QSound ADPCM
-      if (dataQSoundA!=NULL) delete[] dataQSoundA;
+      sampleFree(dataQSoundA);
       lengthQSoundA=(count+1)/2;
-      dataQSoundA=new unsigned char[lengthQSoundA];
-      memset(dataQSoundA,0,lengthQSoundA);
+      dataQSoundA=(unsigned char*)sampleAlloc(lengthQSoundA);
       break;
     case DIV_SAMPLE_DEPTH_ADPCM_A: // ADPCM-A
-      if (dataA!=NULL) delete[] dataA;
+      sampleFree(dataA);
       lengthA=(count+1)/2;
-      dataA=new unsigned char[(lengthA+255)&(~0xff)];
-      memset(dataA,0,(lengthA+255)&(~0xff));
+      dataA=(unsigned char*)sampleAlloc((lengthA+255)&(~0xff));
       break;
     case DIV_SAMPLE_DEPTH_ADPCM_B: // ADPCM-B
-      if (dataB!=NULL) delete[] dataB;
+      sampleFree(dataB);
       lengthB=(count+1)/2;
-      dataB=new unsigned char[(lengthB+255)&(~0xff)];
-      memset(dataB,0,(lengthB+255)&(~0xff));
+      dataB=(unsigned char*)sampleAlloc((lengthB+255)&(~0xff));
       break;
     case DIV_SAMPLE_DEPTH_ADPCM_K: // K05 ADPCM
-      if (dataK!=NULL) delete[] dataK;
+      sampleFree(dataK);
       lengthK=(count+1)/2;
-      dataK=new unsigned char[(lengthK+255)&(~0xff)];
-      memset(dataK,0,(lengthK+255)&(~0xff));
+      dataK=(unsigned char*)sampleAlloc((lengthK+255)&(~0xff));
       break;
     case DIV_SAMPLE_DEPTH_8BIT: // 8-bit
-      if (data8!=NULL) delete[] data8;
+      sampleFree(data8);
       length8=count;
       // for padding X1-010 sample
-      data8=new signed char[(count+4095)&(~0xfff)];
-      memset(data8,0,(count+4095)&(~0xfff));
+      data8=(signed char*)sampleAlloc((count+4095)&(~0xfff));
       break;
     case DIV_SAMPLE_DEPTH_BRR: // BRR
-      if (dataBRR!=NULL) delete[] dataBRR;
+      sampleFree(dataBRR);
       lengthBRR=9*((count+15)/16);
-      dataBRR=new unsigned char[lengthBRR+9];
-      memset(dataBRR,0,lengthBRR+9);
+      dataBRR=(unsigned char*)sampleAlloc(lengthBRR+9);
       break;
     case DIV_SAMPLE_DEPTH_VOX: // VOX
-      if (dataVOX!=NULL) delete[] dataVOX;
+      sampleFree(dataVOX);
       lengthVOX=(count+1)/2;
-      dataVOX=new unsigned char[lengthVOX];
-      memset(dataVOX,0,lengthVOX);
+      dataVOX=(unsigned char*)sampleAlloc(lengthVOX);
       break;
     case DIV_SAMPLE_DEPTH_MULAW: // 8-bit µ-law
-      if (dataMuLaw!=NULL) delete[] dataMuLaw;
+      sampleFree(dataMuLaw);
       lengthMuLaw=count;
-      dataMuLaw=new unsigned char[(count+4095)&(~0xfff)];
-      memset(dataMuLaw,0,(count+4095)&(~0xfff));
+      dataMuLaw=(unsigned char*)sampleAlloc((count+4095)&(~0xfff));
       break;
     case DIV_SAMPLE_DEPTH_C219: // 8-bit C219 "μ-law"
-      if (dataC219!=NULL) delete[] dataC219;
+      sampleFree(dataC219);
       lengthC219=count;
-      dataC219=new unsigned char[(count+4095)&(~0xfff)];
-      memset(dataC219,0,(count+4095)&(~0xfff));
+      dataC219=(unsigned char*)sampleAlloc((count+4095)&(~0xfff));
       break;
     case DIV_SAMPLE_DEPTH_IMA_ADPCM: // IMA ADPCM
-      if (dataIMA!=NULL) delete[] dataIMA;
+      sampleFree(dataIMA);
       lengthIMA=4+((count+1)/2);
-      dataIMA=new unsigned char[lengthIMA];
-      memset(dataIMA,0,lengthIMA);
+      dataIMA=(unsigned char*)sampleAlloc(lengthIMA);
       break;
     case DIV_SAMPLE_DEPTH_16BIT: // 16-bit
-      if (data16!=NULL) delete[] data16;
+      sampleFree(data16);
       length16=count*2;
-      data16=new short[(count+511)&(~0x1ff)];
-      memset(data16,0,((count+511)&(~0x1ff))*sizeof(short));
+      data16=(short*)sampleAlloc(((count+511)&(~0x1ff))*sizeof(short));
       break;
     default:
       return false;
@@ -631,10 +625,11 @@ bool DivSample::resize(unsigned int count) {
       data8=NULL;
       initInternal(DIV_SAMPLE_DEPTH_8BIT,count);
       memcpy(data8,oldData8,MIN(count,samples));
-      delete[] oldData8;
+      sampleFree(oldData8);
     } else {
       initInternal(DIV_SAMPLE_DEPTH_8BIT,count);
     }
+    invalidatePeaks(MIN(count,samples));
     setSampleCount(count);
     return true;
   } else if (depth==DIV_SAMPLE_DEPTH_16BIT) {
@@ -643,10 +638,11 @@ bool DivSample::resize(unsigned int count) {
       data16=NULL;
       initInternal(DIV_SAMPLE_DEPTH_16BIT,count);
       memcpy(data16,oldData16,sizeof(short)*MIN(count,samples));
-      delete[] oldData16;
+      sampleFree(oldData16);
     } else {
       initInternal(DIV_SAMPLE_DEPTH_16BIT,count);
     }
+    invalidatePeaks(MIN(count,samples));
     setSampleCount(count);
     return true;
   }
@@ -696,11 +692,12 @@ bool DivSample::strip(unsigned int begin, unsigned int end) {
       if (samples-end>0) {
         memcpy(data8+begin,oldData8+end,samples-end);
       }
-      delete[] oldData8;
+      sampleFree(oldData8);
     } else {
       // do nothing
       return true;
     }
+    invalidatePeaks(begin);
     setSampleCount(count);
     return true;
   } else if (depth==DIV_SAMPLE_DEPTH_16BIT) {
@@ -714,11 +711,12 @@ bool DivSample::strip(unsigned int begin, unsigned int end) {
       if (samples-end>0) {
         memcpy(&(data16[begin]),&(oldData16[end]),sizeof(short)*(samples-end));
       }
-      delete[] oldData16;
+      sampleFree(oldData16);
     } else {
       // do nothing
       return true;
     }
+    invalidatePeaks(begin);
     setSampleCount(count);
     return true;
   }
@@ -745,11 +743,12 @@ bool DivSample::trim(unsigned int begin, unsigned int end) {
       data8=NULL;
       initInternal(DIV_SAMPLE_DEPTH_8BIT,count);
       memcpy(data8,oldData8+begin,count);
-      delete[] oldData8;
+      sampleFree(oldData8);
     } else {
       // do nothing
       return true;
     }
+    invalidatePeaks();
     setSampleCount(count);
     return true;
   } else if (depth==DIV_SAMPLE_DEPTH_16BIT) {
@@ -758,11 +757,12 @@ bool DivSample::trim(unsigned int begin, unsigned int end) {
       data16=NULL;
       initInternal(DIV_SAMPLE_DEPTH_16BIT,count);
       memcpy(data16,&(oldData16[begin]),sizeof(short)*count);
-      delete[] oldData16;
+      sampleFree(oldData16);
     } else {
       // do nothing
       return true;
     }
+    invalidatePeaks();
     setSampleCount(count);
     return true;
   }
@@ -782,10 +782,11 @@ bool DivSample::insert(unsigned int pos, unsigned int length) {
       if (count-pos-length>0) {
         memcpy(data8+pos+length,oldData8+pos,count-pos-length);
       }
-      delete[] oldData8;
+      sampleFree(oldData8);
     } else {
       initInternal(DIV_SAMPLE_DEPTH_8BIT,count);
     }
+    invalidatePeaks(pos);
     setSampleCount(count);
     return true;
   } else if (depth==DIV_SAMPLE_DEPTH_16BIT) {
@@ -799,10 +800,11 @@ bool DivSample::insert(unsigned int pos, unsigned int length) {
       if (count-pos-length>0) {
         memcpy(&(data16[pos+length]),&(oldData16[pos]),sizeof(short)*(count-pos-length));
       }
-      delete[] oldData16;
+      sampleFree(oldData16);
     } else {
       initInternal(DIV_SAMPLE_DEPTH_16BIT,count);
     }
+    invalidatePeaks(pos);
     setSampleCount(count);
     return true;
   }
@@ -812,6 +814,7 @@ bool DivSample::insert(unsigned int pos, unsigned int length) {
 void DivSample::convert(DivSampleDepth newDepth, unsigned int formatMask) {
   render(formatMask|(1U<<newDepth));
   depth=newDepth;
+  invalidatePeaks();
   switch (depth) {
     case DIV_SAMPLE_DEPTH_1BIT:
       setSampleCount((samples+7)&(~7));
@@ -876,9 +879,9 @@ void DivSample::convert(DivSampleDepth newDepth, unsigned int formatMask) {
   rate=(int)((double)rate*(tRate/sRate)); \
   samples=finalCount; \
   if (depth==DIV_SAMPLE_DEPTH_16BIT) { \
-    delete[] oldData16; \
+    sampleFree(oldData16); \
   } else if (depth==DIV_SAMPLE_DEPTH_8BIT) { \
-    delete[] oldData8; \
+    sampleFree(oldData8); \
   }
 
 bool DivSample::resampleNone(double sRate, double tRate) {
@@ -1152,8 +1155,42 @@ bool DivSample::resampleSinc(double sRate, double tRate) {
   return true;
 }
 
+bool DivSample::resamplePolyphase(double sRate, double tRate, int taps) {
+  RESAMPLE_BEGIN;
+
+  float* inFloat=new float[samples];
+  float* outFloat=new float[finalCount];
+  if (depth==DIV_SAMPLE_DEPTH_16BIT) {
+    for (unsigned int i=0; i<samples; i++) {
+      inFloat[i]=oldData16[i];
+    }
+  } else {
+    for (unsigned int i=0; i<samples; i++) {
+      inFloat[i]=oldData8[i];
+    }
+  }
+
+  ::resamplePolyphase(inFloat,samples,outFloat,finalCount,sRate,tRate,taps);
+
+  if (depth==DIV_SAMPLE_DEPTH_16BIT) {
+    for (int i=0; i<finalCount; i++) {
+      data16[i]=CLAMP(round(outFloat[i]),-32768,32767);
+    }
+  } else {
+    for (int i=0; i<finalCount; i++) {
+      data8[i]=CLAMP(round(outFloat[i]),-128,127);
+    }
+  }
+  delete[] inFloat;
+  delete[] outFloat;
+
+  RESAMPLE_END;
+  return true;
+}
+
 bool DivSample::resample(double sRate, double tRate, int filter) {
   if (depth!=DIV_SAMPLE_DEPTH_8BIT && depth!=DIV_SAMPLE_DEPTH_16BIT) return false;
+  invalidatePeaks();
   switch (filter) {
     case DIV_RESAMPLE_NONE:
       return resampleNone(sRate,tRate);
@@ -1177,6 +1214,15 @@ bool DivSample::resample(double sRate, double tRate, int filter) {
         return resampleBlep(sRate,tRate);
       }
       break;
+    case DIV_RESAMPLE_POLYPHASE_FAST:
+      return resamplePolyphase(sRate,tRate,DIV_RESAMPLE_TAPS_FAST);
+      break;
+    case DIV_RESAMPLE_POLYPHASE:
+      return resamplePolyphase(sRate,tRate,DIV_RESAMPLE_TAPS_NORMAL);
+      break;
+    case DIV_RESAMPLE_POLYPHASE_HQ:
+      return resamplePolyphase(sRate,tRate,DIV_RESAMPLE_TAPS_HQ);
+      break;
   }
   return false;
 }
@@ -1219,10 +1265,50 @@ signed char adpcmKTable[16]={
   0, 1, 2, 4, 8, 16, 32, 64, -128, -64, -32, -16, -8, -4, -2, -1
 };
 
+uint64_t DivSample::getRenderHash() {
+  uint64_t ret=0xcbf29ce484222325ULL;
+  // parameters
+  ret=(ret^(uint64_t)depth)*0x100000001b3ULL;
+  ret=(ret^(uint64_t)samples)*0x100000001b3ULL;
+  ret=(ret^(uint64_t)(loop?loopStart:-1))*0x100000001b3ULL;
+  ret=(ret^(uint64_t)(loop?loopEnd:-1))*0x100000001b3ULL;
+  ret=(ret^(uint64_t)((brrEmphasis?1:0)|(brrNoFilter?2:0)|(dither?4:0)))*0x100000001b3ULL;
+
+  // data, 8 bytes at a time
+  const unsigned char* buf=(const unsigned char*)getCurBuf();
+  size_t len=getCurBufLen();
+  if (buf==NULL) return ret;
+  size_t i=0;
+  for (; i+8<=len; i+=8) {
+    uint64_t next;
+    memcpy(&next,&buf[i],8);
+    ret=(ret^next)*0x100000001b3ULL;
+    ret^=ret>>29;
+  }
+  for (; i<len; i++) {
+    ret=(ret^buf[i])*0x100000001b3ULL;
+  }
+  return ret;
+}
+
 void DivSample::render(unsigned int formatMask) {
+  // formats which were rendered from the same data are kept
+  uint64_t hash=getRenderHash();
+  bool upToDate=(hash==renderHash);
+  if (upToDate) {
+    formatMask&=~renderMask;
+    if (formatMask==0) return;
+  } else {
+    touchData();
+    renderMask=0;
+  }
+  // not valid until rendering finishes
+  renderHash=0;
+
   // step 1: convert to 16-bit if needed
-  if (depth!=DIV_SAMPLE_DEPTH_16BIT) {
+  if (depth!=DIV_SAMPLE_DEPTH_16BIT && !(upToDate && data16!=NULL)) {
     if (!initInternal(DIV_SAMPLE_DEPTH_16BIT,samples)) return;
+    if (depth!=DIV_SAMPLE_DEPTH_8BIT) invalidatePeaks();
     switch (depth) {
       case DIV_SAMPLE_DEPTH_1BIT: // 1-bit
         for (unsigned int i=0; i<samples; i++) {
@@ -1482,6 +1568,9 @@ void DivSample::render(unsigned int formatMask) {
       adpcm_free_context(codec);
     }
   }
+
+  renderHash=hash;
+  renderMask|=formatMask;
 }
 
 void* DivSample::getCurBuf() {
@@ -1556,17 +1645,186 @@ unsigned int DivSample::getCurBufLen() {
   return 0;
 }
 
+// shared by all samples, so that a revision is never reused by another sample
+static std::atomic<unsigned int> sampleDataRev(0);
+
+void DivSample::touchData() {
+  dataRev=++sampleDataRev;
+}
+
+void DivSample::invalidatePeaks(unsigned int begin, unsigned int end) {
+  if (begin>=end) return;
+  touchData();
+  if (peakDirtyBegin>=peakDirtyEnd) {
+    peakDirtyBegin=begin;
+    peakDirtyEnd=end;
+  } else {
+    if (begin<peakDirtyBegin) peakDirtyBegin=begin;
+    if (end>peakDirtyEnd) peakDirtyEnd=end;
+  }
+}
+
+void DivSample::updatePeaks() {
+  bool is8=(depth==DIV_SAMPLE_DEPTH_8BIT);
+  if (is8?(data8==NULL):(data16==NULL)) {
+    peakMin.clear();
+    peakMax.clear();
+    peakSamples=0;
+    peakDirtyBegin=0;
+    peakDirtyEnd=0;
+    return;
+  }
+
+  // a different buffer is shown after a depth change
+  if ((peakDepth==DIV_SAMPLE_DEPTH_8BIT)!=is8) {
+    invalidatePeaks();
+  }
+  peakDepth=depth;
+
+  if (peakSamples!=samples) {
+    invalidatePeaks(MIN(peakSamples,samples));
+    peakSamples=samples;
+
+    // resize levels. entries before the invalidated area are kept
+    size_t levelLen=(samples+DIV_SAMPLE_PEAK_BLOCK-1)/DIV_SAMPLE_PEAK_BLOCK;
+    size_t levels=0;
+    while (levelLen>0) {
+      if (levels>=peakMin.size()) {
+        peakMin.push_back(std::vector<short>());
+        peakMax.push_back(std::vector<short>());
+      }
+      peakMin[levels].resize(levelLen);
+      peakMax[levels].resize(levelLen);
+      levels++;
+      if (levelLen==1) break;
+      levelLen=(levelLen+1)>>1;
+    }
+    peakMin.resize(levels);
+    peakMax.resize(levels);
+  }
+
+  if (peakDirtyBegin>=peakDirtyEnd) return;
+  if (peakMin.empty()) {
+    peakDirtyBegin=0;
+    peakDirtyEnd=0;
+    return;
+  }
+
+  // level 0: scan sample data
+  size_t lo=peakDirtyBegin/DIV_SAMPLE_PEAK_BLOCK;
+  size_t hi=(MIN(peakDirtyEnd,samples)+DIV_SAMPLE_PEAK_BLOCK-1)/DIV_SAMPLE_PEAK_BLOCK;
+  if (hi>peakMin[0].size()) hi=peakMin[0].size();
+  for (size_t i=lo; i<hi; i++) {
+    unsigned int pos=i*DIV_SAMPLE_PEAK_BLOCK;
+    unsigned int posEnd=MIN(pos+DIV_SAMPLE_PEAK_BLOCK,samples);
+    short candMin, candMax;
+    if (is8) {
+      candMin=candMax=data8[pos];
+      for (unsigned int j=pos+1; j<posEnd; j++) {
+        if (candMin>data8[j]) candMin=data8[j];
+        if (candMax<data8[j]) candMax=data8[j];
+      }
+    } else {
+      candMin=candMax=data16[pos];
+      for (unsigned int j=pos+1; j<posEnd; j++) {
+        if (candMin>data16[j]) candMin=data16[j];
+        if (candMax<data16[j]) candMax=data16[j];
+      }
+    }
+    peakMin[0][i]=candMin;
+    peakMax[0][i]=candMax;
+  }
+
+  // next levels: combine pairs of entries from the previous one
+  for (size_t level=1; level<peakMin.size() && lo<hi; level++) {
+    const std::vector<short>& prevMin=peakMin[level-1];
+    const std::vector<short>& prevMax=peakMax[level-1];
+    lo>>=1;
+    hi=(hi+1)>>1;
+    for (size_t i=lo; i<hi; i++) {
+      size_t a=i<<1;
+      size_t b=a+1;
+      if (b<prevMin.size()) {
+        peakMin[level][i]=MIN(prevMin[a],prevMin[b]);
+        peakMax[level][i]=MAX(prevMax[a],prevMax[b]);
+      } else {
+        peakMin[level][i]=prevMin[a];
+        peakMax[level][i]=prevMax[a];
+      }
+    }
+  }
+
+  peakDirtyBegin=0;
+  peakDirtyEnd=0;
+}
+
+bool DivSample::getPeaks(unsigned int begin, unsigned int end, int& min, int& max) {
+  updatePeaks();
+  if (end>samples) end=samples;
+  if (begin>=end || peakMin.empty()) return false;
+
+  bool is8=(depth==DIV_SAMPLE_DEPTH_8BIT);
+  int candMin=32767;
+  int candMax=-32768;
+
+#define PEAK_SAMPLE(x) \
+  if (is8) { \
+    if (candMin>data8[x]) candMin=data8[x]; \
+    if (candMax<data8[x]) candMax=data8[x]; \
+  } else { \
+    if (candMin>data16[x]) candMin=data16[x]; \
+    if (candMax<data16[x]) candMax=data16[x]; \
+  }
+
+  // unaligned edges are read from sample data
+  while (begin<end && (begin%DIV_SAMPLE_PEAK_BLOCK)!=0) {
+    PEAK_SAMPLE(begin);
+    begin++;
+  }
+  // the last block may be partial, so it counts as aligned
+  while (end>begin && end<samples && (end%DIV_SAMPLE_PEAK_BLOCK)!=0) {
+    end--;
+    PEAK_SAMPLE(end);
+  }
+
+#undef PEAK_SAMPLE
+
+  // the rest is covered by the cache
+  size_t lo=begin/DIV_SAMPLE_PEAK_BLOCK;
+  size_t hi=(begin<end)?((end+DIV_SAMPLE_PEAK_BLOCK-1)/DIV_SAMPLE_PEAK_BLOCK):lo;
+  for (size_t level=0; level<peakMin.size() && lo<hi; level++) {
+    if (lo&1) {
+      if (candMin>peakMin[level][lo]) candMin=peakMin[level][lo];
+      if (candMax<peakMax[level][lo]) candMax=peakMax[level][lo];
+      lo++;
+    }
+    if (hi&1) {
+      hi--;
+      if (candMin>peakMin[level][hi]) candMin=peakMin[level][hi];
+      if (candMax<peakMax[level][hi]) candMax=peakMax[level][hi];
+    }
+    lo>>=1;
+    hi>>=1;
+  }
+
+  min=candMin;
+  max=candMax;
+  return true;
+}
+
 DivSampleHistory* DivSample::prepareUndo(bool data, bool doNotPush) {
   DivSampleHistory* h;
   if (data) {
-    unsigned char* duplicate;
-    if (getCurBuf()==NULL) {
-      duplicate=NULL;
-    } else {
+    invalidatePeaks();
+    unsigned char* duplicate=NULL;
+    // mapped sample data is shared with the snapshot rather than copied
+    DivSampleSnapshot* snap=sampleSnapshot(getCurBuf());
+    if (getCurBuf()!=NULL && snap==NULL) {
       duplicate=new unsigned char[getCurBufLen()];
       memcpy(duplicate,getCurBuf(),getCurBufLen());
     }
     h=new DivSampleHistory(duplicate,getCurBufLen(),samples,depth,rate,centerRate,loopStart,loopEnd,loop,brrEmphasis,brrNoFilter,dither,loopMode);
+    h->snap=snap;
   } else {
     h=new DivSampleHistory(depth,rate,centerRate,loopStart,loopEnd,loop,brrEmphasis,brrNoFilter,dither,loopMode);
   }
@@ -1585,6 +1843,7 @@ DivSampleHistory* DivSample::prepareUndo(bool data, bool doNotPush) {
 #define applyHistory \
   depth=h->depth; \
   if (h->hasSample) { \
+    invalidatePeaks(); \
     initInternal(h->depth,h->samples); \
     samples=h->samples; \
 \
@@ -1592,8 +1851,12 @@ DivSampleHistory* DivSample::prepareUndo(bool data, bool doNotPush) {
 \
     void* buf=getCurBuf(); \
 \
-    if (buf!=NULL && h->data!=NULL) { \
-      memcpy(buf,h->data,h->length); \
+    if (buf!=NULL) { \
+      if (h->snap!=NULL) { \
+        if (!sampleRestore(buf,h->length,h->snap)) logE("could not restore sample data!"); \
+      } else if (h->data!=NULL) { \
+        memcpy(buf,h->data,h->length); \
+      } \
     } \
   } \
   rate=h->rate; \
@@ -1648,18 +1911,18 @@ DivSample::~DivSample() {
     delete h;
     redoHist.pop_back();
   }
-  if (data8) delete[] data8;
-  if (data16) delete[] data16;
-  if (data1) delete[] data1;
-  if (dataDPCM) delete[] dataDPCM;
-  if (dataZ) delete[] dataZ;
-  if (dataQSoundA) delete[] dataQSoundA;
-  if (dataA) delete[] dataA;
-  if (dataB) delete[] dataB;
-  if (dataK) delete[] dataK;
-  if (dataBRR) delete[] dataBRR;
-  if (dataVOX) delete[] dataVOX;
-  if (dataMuLaw) delete[] dataMuLaw;
-  if (dataC219) delete[] dataC219;
-  if (dataIMA) delete[] dataIMA;
+  sampleFree(data8);
+  sampleFree(data16);
+  sampleFree(data1);
+  sampleFree(dataDPCM);
+  sampleFree(dataZ);
+  sampleFree(dataQSoundA);
+  sampleFree(dataA);
+  sampleFree(dataB);
+  sampleFree(dataK);
+  sampleFree(dataBRR);
+  sampleFree(dataVOX);
+  sampleFree(dataMuLaw);
+  sampleFree(dataC219);
+  sampleFree(dataIMA);
 }
@@ -24,7 +24,12 @@
 #include "defines.h"
 #include "safeWriter.h"
 #include "dataErrors.h"
+#include "sampleStore.h"
 #include "../fixedQueue.h"
+#include <vector>
+
+// number of samples covered by each entry in the first level of the peak cache
+#define DIV_SAMPLE_PEAK_BLOCK 32
 
 enum DivSampleLoopMode: unsigned char {
   DIV_SAMPLE_LOOP_FORWARD=0,
@@ -57,11 +62,17 @@ enum DivResampleFilters {
   DIV_RESAMPLE_CUBIC,
   DIV_RESAMPLE_BLEP,
   DIV_RESAMPLE_SINC,
-  DIV_RESAMPLE_BEST
+  DIV_RESAMPLE_BEST,
+  // polyphase windowed sinc (see resampler.h), from fastest to best
+  DIV_RESAMPLE_POLYPHASE_FAST,
+  DIV_RESAMPLE_POLYPHASE,
+  DIV_RESAMPLE_POLYPHASE_HQ
 };
 
 struct DivSampleHistory {
   unsigned char* data;
+  // used instead of data if the sample data is memory-mapped
+  DivSampleSnapshot* snap;
   unsigned int length, samples;
   DivSampleDepth depth;
   int rate, centerRate, loopStart, loopEnd;
@@ -70,6 +81,7 @@ struct DivSampleHistory {
   bool hasSample;
   DivSampleHistory(void* d, unsigned int l, unsigned int s, DivSampleDepth de, int r, int cr, int ls, int le, bool lp, bool be, bool bf, bool di, DivSampleLoopMode lm):
     data((unsigned char*)d),
+    snap(NULL),
     length(l),
     samples(s),
     depth(de),
@@ -85,6 +97,7 @@ struct DivSampleHistory {
     hasSample(true) {}
   DivSampleHistory(DivSampleDepth de, int r, int cr, int ls, int le, bool lp, bool be, bool bf, bool di, DivSampleLoopMode lm):
     data(NULL),
+    snap(NULL),
     length(0),
     samples(0),
     depth(de),
@@ -152,12 +165,34 @@ struct DivSample {
   FixedQueue<DivSampleHistory*,128> undoHist;
   FixedQueue<DivSampleHistory*,128> redoHist;
 
+  // min/max peak cache of data8/data16 for drawing (see getPeaks()).
+  // level 0 holds the peaks of every DIV_SAMPLE_PEAK_BLOCK samples, and each
+  // level after it holds the peaks of two entries of the previous level.
+  std::vector<std::vector<short>> peakMin, peakMax;
+  unsigned int peakSamples, peakDirtyBegin, peakDirtyEnd;
+  DivSampleDepth peakDepth;
+
+  // changes whenever the sample data may have changed. unique across samples.
+  // used by backups to skip unchanged samples.
+  unsigned int dataRev;
+
+  // hash of what the rendered formats were made from, and which formats were rendered.
+  // render() skips formats which are already up to date.
+  uint64_t renderHash;
+  unsigned int renderMask;
+
   /**
    * put sample data.
    * @param w a SafeWriter.
    */
   void putSampleData(SafeWriter* w);
 
+  /**
+   * put sample parameters (everything in the sample block but the data).
+   * @param w a SafeWriter.
+   */
+  void putSampleInfo(SafeWriter* w);
+
   /**
    * read sample data.
    * @param reader the reader.
@@ -209,6 +244,7 @@ struct DivSample {
   bool resampleCubic(double sRate, double tRate);
   bool resampleBlep(double sRate, double tRate);
   bool resampleSinc(double sRate, double tRate);
+  bool resamplePolyphase(double sRate, double tRate, int taps);
 
   /**
    * save this sample to a file.
@@ -294,9 +330,46 @@ struct DivSample {
 
   /**
    * initialize the rest of sample formats for this sample.
+   * formats which were already rendered from the same data are not rendered again.
    */
   void render(unsigned int formatMask=0xffffffff);
 
+  /**
+   * hash the sample data and the parameters which affect rendering.
+   */
+  uint64_t getRenderHash();
+
+  /**
+   * mark part of the peak cache as outdated.
+   * call this after writing to data8/data16 directly.
+   * @param begin the first changed sample.
+   * @param end the sample after the last changed one.
+   */
+  void invalidatePeaks(unsigned int begin=0, unsigned int end=0xffffffff);
+
+  /**
+   * give the sample data a new revision.
+   */
+  void touchData();
+
+  /**
+   * @warning DO NOT USE - internal function
+   * bring the outdated parts of the peak cache up to date.
+   */
+  void updatePeaks();
+
+  /**
+   * get the lowest and highest values in a range of samples, using the peak cache.
+   * this only looks at data8 (8-bit samples) or data16 (everything else), and
+   * runs in logarithmic time.
+   * @param begin the first sample.
+   * @param end the sample after the last one.
+   * @param min the lowest value.
+   * @param max the highest value.
+   * @return whether the range contained any samples.
+   */
+  bool getPeaks(unsigned int begin, unsigned int end, int& min, int& max);
+
   /**
    * get the sample data for the current depth.
    * @return the sample data, or NULL if not created.
@@ -311,6 +384,8 @@ struct DivSample {
 
   /**
    * prepare an undo step for this sample.
+   * if data is true, the peak cache is invalidated as the sample data is
+   * assumed to be modified next.
    * @param data whether to include sample data.
    * @param doNotPush if this is true, don't push the DivSampleHistory to the undo history.
    * @return the undo step.
@@ -370,7 +445,14 @@ struct DivSample {
     lengthMuLaw(0),
     lengthC219(0),
     lengthIMA(0),
-    samples(0) {
+    samples(0),
+    peakSamples(0),
+    peakDirtyBegin(0),
+    peakDirtyEnd(0),
+    peakDepth(DIV_SAMPLE_DEPTH_MAX),
+    renderHash(0),
+    renderMask(0) {
+    touchData();
     for (int i=0; i<DIV_MAX_CHIPS; i++) {
       for (int j=0; j<DIV_MAX_SAMPLE_TYPE; j++) {
         renderOn[j][i]=true;
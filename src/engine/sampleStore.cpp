@@ -0,0 +1,421 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "sampleStore.h"
+#include "../ta-utils.h"
+#include "../ta-log.h"
+#include "../fileutils.h"
+#include <string.h>
+#include <mutex>
+#include <map>
+#include <iterator>
+#include <unordered_map>
+#ifdef _WIN32
+#include "../utfutils.h"
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+// part of the backing file.
+// referenced by the buffer which owns it, and by undo snapshots and the
+// buffers which map it privately.
+struct DivSampleMapRange {
+  size_t offset, size;
+  int refs;
+  DivSampleMapRange(size_t o, size_t s):
+    offset(o),
+    size(s),
+    refs(1) {}
+};
+
+struct DivSampleMapping {
+  DivSampleMapRange* range;
+  // if true, writes go to the backing file (the range is only referenced by
+  // this buffer). otherwise written pages become private copies.
+  bool shared;
+};
+
+struct DivSampleStore {
+  std::mutex lock;
+  bool mapped;
+  String dir;
+#ifdef _WIN32
+  HANDLE file;
+#else
+  int fd;
+#endif
+  size_t fileSize, usedSize;
+  // unused parts of the backing file (offset -> size)
+  std::map<size_t,size_t> freeRanges;
+  std::unordered_map<void*,DivSampleMapping> mappings;
+
+  bool isOpen();
+  bool open();
+  bool resizeFile(size_t size);
+  DivSampleMapRange* allocRange(size_t size, bool& reused);
+  void releaseRange(DivSampleMapRange* range);
+  void* map(DivSampleMapRange* range, bool shared, void* at);
+  void unmap(void* ptr, size_t size);
+  bool write(DivSampleMapRange* range, const void* data, size_t len);
+  bool read(DivSampleMapRange* range, void* data, size_t len);
+
+  DivSampleStore():
+    mapped(false),
+#ifdef _WIN32
+    file(INVALID_HANDLE_VALUE),
+#else
+    fd(-1),
+#endif
+    fileSize(0),
+    usedSize(0) {}
+};
+
+// never destroyed, as samples may still be freed while exiting.
+static DivSampleStore& getStore() {
+  static DivSampleStore* store=new DivSampleStore;
+  return *store;
+}
+
+bool DivSampleStore::isOpen() {
+#ifdef _WIN32
+  return file!=INVALID_HANDLE_VALUE;
+#else
+  return fd>=0;
+#endif
+}
+
+// the backing file is deleted as soon as it is created (or closed on Windows),
+// so it does not stay behind after a crash.
+bool DivSampleStore::open() {
+#ifdef _WIN32
+  String path=fmt::sprintf("%s\\furnace-samples-%d.bin",dir,(int)GetCurrentProcessId());
+  file=CreateFileW(utf8To16(path.c_str()).c_str(),GENERIC_READ|GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_TEMPORARY|FILE_FLAG_DELETE_ON_CLOSE,NULL);
+  if (file==INVALID_HANDLE_VALUE) {
+    logE("could not create sample backing file %s! (%d)",path,(int)GetLastError());
+    return false;
+  }
+#else
+  String path=dir+"/furnace-samples-XXXXXX";
+  fd=mkstemp(&path[0]);
+  if (fd<0) {
+    logE("could not create sample backing file in %s! (%s)",dir,strerror(errno));
+    return false;
+  }
+  unlink(path.c_str());
+#endif
+  logI("sample backing file created.");
+  return true;
+}
+
+bool DivSampleStore::resizeFile(size_t size) {
+#ifdef _WIN32
+  LARGE_INTEGER pos;
+  pos.QuadPart=size;
+  if (!SetFilePointerEx(file,pos,NULL,FILE_BEGIN)) return false;
+  return SetEndOfFile(file);
+#else
+  return ftruncate(fd,size)==0;
+#endif
+}
+
+DivSampleMapRange* DivSampleStore::allocRange(size_t size, bool& reused) {
+  size_t offset=fileSize;
+  reused=false;
+  for (std::map<size_t,size_t>::iterator i=freeRanges.begin(); i!=freeRanges.end(); i++) {
+    if (i->second<size) continue;
+    offset=i->first;
+    size_t rest=i->second-size;
+    freeRanges.erase(i);
+    if (rest>0) freeRanges[offset+size]=rest;
+    reused=true;
+    break;
+  }
+  if (!reused) {
+    if (!resizeFile(fileSize+size)) {
+      logE("could not grow sample backing file!");
+      return NULL;
+    }
+    fileSize+=size;
+  }
+  usedSize+=size;
+  return new DivSampleMapRange(offset,size);
+}
+
+void DivSampleStore::releaseRange(DivSampleMapRange* range) {
+  if (--range->refs>0) return;
+  size_t offset=range->offset;
+  size_t size=range->size;
+  usedSize-=size;
+  delete range;
+
+  // merge with neighboring free parts
+  std::map<size_t,size_t>::iterator next=freeRanges.lower_bound(offset);
+  if (next!=freeRanges.end() && offset+size==next->first) {
+    size+=next->second;
+    next=freeRanges.erase(next);
+  }
+  if (next!=freeRanges.begin()) {
+    std::map<size_t,size_t>::iterator prev=std::prev(next);
+    if (prev->first+prev->second==offset) {
+      offset=prev->first;
+      size+=prev->second;
+      freeRanges.erase(prev);
+    }
+  }
+
+  if (offset+size==fileSize) {
+    if (resizeFile(offset)) {
+      fileSize=offset;
+      return;
+    }
+  }
+  freeRanges[offset]=size;
+#ifdef FALLOC_FL_PUNCH_HOLE
+  // give the disk space back
+  fallocate(fd,FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE,offset,size);
+#endif
+}
+
+// at must be NULL on Windows.
+void* DivSampleStore::map(DivSampleMapRange* range, bool shared, void* at) {
+#ifdef _WIN32
+  ULARGE_INTEGER end, start;
+  end.QuadPart=range->offset+range->size;
+  start.QuadPart=range->offset;
+  HANDLE m=CreateFileMappingW(file,NULL,PAGE_READWRITE,end.HighPart,end.LowPart,NULL);
+  if (m==NULL) return NULL;
+  void* ret=MapViewOfFile(m,shared?FILE_MAP_WRITE:FILE_MAP_COPY,start.HighPart,start.LowPart,range->size);
+  // the view keeps the mapping alive
+  CloseHandle(m);
+  return ret;
+#else
+  void* ret=mmap(at,range->size,PROT_READ|PROT_WRITE,(shared?MAP_SHARED:MAP_PRIVATE)|(at?MAP_FIXED:0),fd,range->offset);
+  if (ret==MAP_FAILED) return NULL;
+  return ret;
+#endif
+}
+
+void DivSampleStore::unmap(void* ptr, size_t size) {
+#ifdef _WIN32
+  UnmapViewOfFile(ptr);
+#else
+  munmap(ptr,size);
+#endif
+}
+
+bool DivSampleStore::write(DivSampleMapRange* range, const void* data, size_t len) {
+  const unsigned char* d=(const unsigned char*)data;
+  size_t pos=0;
+  while (pos<len) {
+#ifdef _WIN32
+    OVERLAPPED o;
+    ULARGE_INTEGER off;
+    DWORD written=0;
+    memset(&o,0,sizeof(OVERLAPPED));
+    off.QuadPart=range->offset+pos;
+    o.Offset=off.LowPart;
+    o.OffsetHigh=off.HighPart;
+    if (!WriteFile(file,d+pos,(DWORD)MIN(len-pos,1U<<30),&written,&o) || written==0) return false;
+#else
+    ssize_t written=pwrite(fd,d+pos,len-pos,range->offset+pos);
+    if (written<0 && errno==EINTR) continue;
+    if (written<=0) return false;
+#endif
+    pos+=written;
+  }
+  return true;
+}
+
+bool DivSampleStore::read(DivSampleMapRange* range, void* data, size_t len) {
+  unsigned char* d=(unsigned char*)data;
+  size_t pos=0;
+  while (pos<len) {
+#ifdef _WIN32
+    OVERLAPPED o;
+    ULARGE_INTEGER off;
+    DWORD got=0;
+    memset(&o,0,sizeof(OVERLAPPED));
+    off.QuadPart=range->offset+pos;
+    o.Offset=off.LowPart;
+    o.OffsetHigh=off.HighPart;
+    if (!ReadFile(file,d+pos,(DWORD)MIN(len-pos,1U<<30),&got,&o) || got==0) return false;
+#else
+    ssize_t got=pread(fd,d+pos,len-pos,range->offset+pos);
+    if (got<0 && errno==EINTR) continue;
+    if (got<=0) return false;
+#endif
+    pos+=got;
+  }
+  return true;
+}
+
+void sampleStoreSetMapped(bool enable, const char* dir) {
+  DivSampleStore& s=getStore();
+  std::lock_guard<std::mutex> lock(s.lock);
+  if (enable==s.mapped) return;
+  s.mapped=enable;
+  if (enable) {
+    // the backing file stays where it is once created
+    if (!s.isOpen()) {
+      s.dir=dir;
+      if (!dirExists(dir)) {
+        if (!makeDir(dir)) logW("could not create %s!",dir);
+      }
+    }
+    logI("using memory-mapped sample storage.");
+  }
+}
+
+size_t sampleStoreGetMappedSize() {
+  DivSampleStore& s=getStore();
+  std::lock_guard<std::mutex> lock(s.lock);
+  return s.usedSize;
+}
+
+void* sampleAlloc(size_t len) {
+  if (len>=DIV_SAMPLE_MAP_MIN) {
+    DivSampleStore& s=getStore();
+    std::lock_guard<std::mutex> lock(s.lock);
+    if (s.mapped) {
+      if (!s.isOpen()) {
+        if (!s.open()) {
+          // don't try again
+          s.mapped=false;
+        }
+      }
+    }
+    if (s.mapped) {
+      size_t size=(len+DIV_SAMPLE_MAP_MIN-1)&(~(size_t)(DIV_SAMPLE_MAP_MIN-1));
+      bool reused=false;
+      DivSampleMapRange* range=s.allocRange(size,reused);
+      if (range!=NULL) {
+        void* ret=s.map(range,true,NULL);
+        if (ret!=NULL) {
+          // new parts of the file are zero already
+          if (reused) memset(ret,0,size);
+          s.mappings[ret]=DivSampleMapping{range,true};
+          return ret;
+        }
+        logW("could not map sample data! using memory instead.");
+        s.releaseRange(range);
+      }
+    }
+  }
+  unsigned char* ret=new unsigned char[len];
+  memset(ret,0,len);
+  return ret;
+}
+
+void sampleFree(void* ptr) {
+  if (ptr==NULL) return;
+  {
+    DivSampleStore& s=getStore();
+    std::lock_guard<std::mutex> lock(s.lock);
+    std::unordered_map<void*,DivSampleMapping>::iterator i=s.mappings.find(ptr);
+    if (i!=s.mappings.end()) {
+      s.unmap(ptr,i->second.range->size);
+      s.releaseRange(i->second.range);
+      s.mappings.erase(i);
+      return;
+    }
+  }
+  delete[] (unsigned char*)ptr;
+}
+
+DivSampleSnapshot* sampleSnapshot(void* ptr) {
+  if (ptr==NULL) return NULL;
+  DivSampleStore& s=getStore();
+  std::lock_guard<std::mutex> lock(s.lock);
+  std::unordered_map<void*,DivSampleMapping>::iterator i=s.mappings.find(ptr);
+  if (i==s.mappings.end()) return NULL;
+  DivSampleMapping& m=i->second;
+  size_t size=m.range->size;
+
+#ifndef _WIN32
+  if (m.shared) {
+    // the data is in the file already, so the snapshot may use it as is.
+    // map it privately to keep further writes out of the file.
+    if (s.map(m.range,false,ptr)==NULL) {
+      logE("could not remap sample data! (%s)",strerror(errno));
+      return NULL;
+    }
+    m.shared=false;
+    m.range->refs++;
+    return new DivSampleSnapshot{m.range,size};
+  }
+#endif
+
+  // the buffer has been written to since, so write it to a new range.
+  bool reused=false;
+  DivSampleMapRange* range=s.allocRange(size,reused);
+  if (range==NULL) return NULL;
+  if (!s.write(range,ptr,size)) {
+    logE("could not write sample snapshot!");
+    s.releaseRange(range);
+    return NULL;
+  }
+#ifndef _WIN32
+  // and continue from it, dropping the private copies of the old range
+  if (s.map(range,false,ptr)!=NULL) {
+    s.releaseRange(m.range);
+    m.range=range;
+    range->refs++;
+  }
+#endif
+  return new DivSampleSnapshot{range,size};
+}
+
+bool sampleRestore(void* ptr, size_t len, DivSampleSnapshot* snap) {
+  if (ptr==NULL || snap==NULL) return false;
+  DivSampleStore& s=getStore();
+  std::lock_guard<std::mutex> lock(s.lock);
+  if (snap->range==NULL) return false;
+
+#ifndef _WIN32
+  std::unordered_map<void*,DivSampleMapping>::iterator i=s.mappings.find(ptr);
+  if (i!=s.mappings.end() && i->second.range->size==snap->size) {
+    // take over the snapshot's range
+    DivSampleMapping& m=i->second;
+    bool shared=(snap->range->refs==1);
+    if (s.map(snap->range,shared,ptr)!=NULL) {
+      s.releaseRange(m.range);
+      m.range=snap->range;
+      m.shared=shared;
+      snap->range=NULL;
+      return true;
+    }
+  }
+#endif
+
+  return s.read(snap->range,ptr,MIN(len,snap->size));
+}
+
+void sampleFreeSnapshot(DivSampleSnapshot* snap) {
+  if (snap==NULL) return;
+  if (snap->range!=NULL) {
+    DivSampleStore& s=getStore();
+    std::lock_guard<std::mutex> lock(s.lock);
+    s.releaseRange(snap->range);
+  }
+  delete snap;
+}
@@ -0,0 +1,96 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SAMPLE_STORE_H
+#define _SAMPLE_STORE_H
+
+#include <stddef.h>
+
+// storage for sample data (see DivSample::initInternal()).
+// normally sample data lives on the heap. when memory mapping is enabled,
+// large buffers are placed in a memory-mapped backing file instead, so the
+// system only keeps the pages in use resident and may write the rest to disk.
+// undo snapshots of mapped buffers refer to parts of the backing file as well.
+// on POSIX systems the snapshot is shared with the live buffer (copy-on-write),
+// while on Windows it is written to the backing file.
+
+// buffers smaller than this are always allocated on the heap.
+// this is also the alignment of buffers within the backing file.
+#define DIV_SAMPLE_MAP_MIN 65536
+
+struct DivSampleMapRange;
+
+struct DivSampleSnapshot {
+  DivSampleMapRange* range;
+  size_t size;
+};
+
+/**
+ * enable or disable memory-mapped sample storage.
+ * only affects buffers allocated afterwards.
+ * @param enable whether to enable it.
+ * @param dir the directory where the backing file is placed.
+ */
+void sampleStoreSetMapped(bool enable, const char* dir);
+
+/**
+ * get the amount of sample data in the backing file.
+ * @return the size in bytes.
+ */
+size_t sampleStoreGetMappedSize();
+
+/**
+ * allocate a zero-filled sample data buffer.
+ * @param len the size in bytes.
+ * @return the buffer, or NULL on failure.
+ */
+void* sampleAlloc(size_t len);
+
+/**
+ * free a buffer allocated with sampleAlloc().
+ * @param ptr the buffer.
+ */
+void sampleFree(void* ptr);
+
+/**
+ * take a snapshot of a mapped buffer for undo.
+ * @param ptr the buffer.
+ * @return the snapshot, or NULL if the buffer is not mapped (copy it instead).
+ */
+DivSampleSnapshot* sampleSnapshot(void* ptr);
+
+/**
+ * restore a snapshot into a buffer.
+ * if both are mapped and have the same size, the buffer takes over the
+ * snapshot's data without copying. otherwise up to len bytes are copied.
+ * the snapshot can be restored only once.
+ * @param ptr the buffer.
+ * @param len the buffer size.
+ * @param snap the snapshot.
+ * @return whether it was successful.
+ */
+bool sampleRestore(void* ptr, size_t len, DivSampleSnapshot* snap);
+
+/**
+ * free a snapshot.
+ * @param snap the snapshot.
+ */
+void sampleFreeSnapshot(DivSampleSnapshot* snap);
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scratch.h"
+#include "../ta-log.h"
+#include <stdlib.h>
+#include <new>
+
+#define SCRATCH_ALIGN 16
+
+bool DivScratchArena::reserve(size_t size) {
+  size=(size+SCRATCH_ALIGN-1)&(~(size_t)(SCRATCH_ALIGN-1));
+  used=0;
+  if (size<=capacity) return true;
+  free();
+  try {
+    data=new unsigned char[size];
+  } catch (std::bad_alloc& e) {
+    logE("could not allocate scratch memory!");
+    data=NULL;
+    return false;
+  }
+  capacity=size;
+  return true;
+}
+
+void* DivScratchArena::alloc(size_t size) {
+  size=(size+SCRATCH_ALIGN-1)&(~(size_t)(SCRATCH_ALIGN-1));
+  if (data==NULL || size>capacity-used) return NULL;
+  void* ret=&data[used];
+  used+=size;
+  return ret;
+}
+
+void DivScratchArena::reset() {
+  used=0;
+}
+
+void DivScratchArena::free() {
+  if (data!=NULL) {
+    delete[] data;
+    data=NULL;
+  }
+  capacity=0;
+  used=0;
+}
+
+size_t DivScratchArena::getCapacity() {
+  return capacity;
+}
+
+DivScratchArena::DivScratchArena():
+  data(NULL),
+  capacity(0),
+  used(0) {}
+
+DivScratchArena::~DivScratchArena() {
+  free();
+}
+
+#ifdef DIV_DEBUG_ALLOC
+// replace the global allocation functions so that allocating within a
+// no-alloc section is caught.
+
+static thread_local int noAllocDepth=0;
+
+static void checkAlloc(const char* what) {
+  if (noAllocDepth>0) {
+    // logging allocates
+    noAllocDepth=0;
+    logE("%s on the audio thread or in a render task!",what);
+    abort();
+  }
+}
+
+void divNoAllocBegin() {
+  noAllocDepth++;
+}
+
+void divNoAllocEnd() {
+  noAllocDepth--;
+}
+
+void* operator new(size_t size) {
+  checkAlloc("memory allocation");
+  void* ret=malloc(size?size:1);
+  if (ret==NULL) throw std::bad_alloc();
+  return ret;
+}
+
+void* operator new[](size_t size) {
+  checkAlloc("memory allocation");
+  void* ret=malloc(size?size:1);
+  if (ret==NULL) throw std::bad_alloc();
+  return ret;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  checkAlloc("memory allocation");
+  return malloc(size?size:1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  checkAlloc("memory allocation");
+  return malloc(size?size:1);
+}
+
+void operator delete(void* ptr) noexcept {
+  if (ptr!=NULL) checkAlloc("memory deallocation");
+  ::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  if (ptr!=NULL) checkAlloc("memory deallocation");
+  ::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  if (ptr!=NULL) checkAlloc("memory deallocation");
+  ::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  if (ptr!=NULL) checkAlloc("memory deallocation");
+  ::free(ptr);
+}
+#else
+void divNoAllocBegin() {
+}
+
+void divNoAllocEnd() {
+}
+#endif
@@ -0,0 +1,76 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SCRATCH_H
+#define _SCRATCH_H
+
+#include <stddef.h>
+
+/**
+ * bump allocator for temporary buffers used during audio processing.
+ * memory is only allocated in reserve(), which must not be called from the
+ * audio thread.
+ */
+class DivScratchArena {
+  unsigned char* data;
+  size_t capacity, used;
+
+  public:
+    /**
+     * make sure the arena can hold at least the specified amount of bytes.
+     * contents are not preserved.
+     * @return whether successful.
+     */
+    bool reserve(size_t size);
+
+    /**
+     * get a block of memory from the arena (aligned to 16 bytes).
+     * @return pointer to block, or NULL if there isn't enough space.
+     */
+    void* alloc(size_t size);
+
+    /**
+     * release all blocks.
+     */
+    void reset();
+
+    /**
+     * free the arena's memory.
+     */
+    void free();
+
+    size_t getCapacity();
+
+    DivScratchArena();
+    ~DivScratchArena();
+};
+
+/**
+ * begin a section in which memory allocation is not allowed on this thread.
+ * if built with DIV_DEBUG_ALLOC, allocating within this section aborts.
+ * otherwise this does nothing.
+ */
+void divNoAllocBegin();
+
+/**
+ * end a section started by divNoAllocBegin().
+ */
+void divNoAllocEnd();
+
+#endif
@@ -0,0 +1,553 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "server.h"
+#include "../ta-log.h"
+#include "../fileutils.h"
+#include <sys/stat.h>
+#include <fmt/printf.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define SERVER_LINE_SIZE 4096
+
+bool DivRenderServer::sendFrame(DivServerFrameTypes type, const void* data, unsigned int len) {
+  unsigned char header[DIV_SERVER_HEADER_SIZE];
+  header[0]='F';
+  header[1]='U';
+  header[2]='R';
+  header[3]='S';
+  header[4]=type;
+  header[5]=(type==DIV_SERVER_FRAME_AUDIO)?format:0;
+  header[6]=(type==DIV_SERVER_FRAME_AUDIO)?(outChans&0xff):0;
+  header[7]=(type==DIV_SERVER_FRAME_AUDIO)?(outChans>>8):0;
+  header[8]=len&0xff;
+  header[9]=(len>>8)&0xff;
+  header[10]=(len>>16)&0xff;
+  header[11]=(len>>24)&0xff;
+
+  if (fwrite(header,1,DIV_SERVER_HEADER_SIZE,out)!=DIV_SERVER_HEADER_SIZE) return false;
+  if (len>0) {
+    if (fwrite(data,1,len,out)!=len) return false;
+  }
+  // only flush when the client is waiting for a reply
+  if (type!=DIV_SERVER_FRAME_AUDIO) {
+    if (fflush(out)!=0) return false;
+  }
+  return true;
+}
+
+bool DivRenderServer::sendText(DivServerFrameTypes type, const String& text) {
+  return sendFrame(type,text.c_str(),text.size());
+}
+
+bool DivRenderServer::sendAudio(unsigned int len) {
+  if (format==DIV_SERVER_FORMAT_F32) {
+    float* fb=(float*)frameBuf;
+    for (unsigned int i=0; i<len; i++) {
+      for (int j=0; j<outChans; j++) {
+        *(fb++)=outBuf[j][i];
+      }
+    }
+    return sendFrame(DIV_SERVER_FRAME_AUDIO,frameBuf,len*outChans*sizeof(float));
+  }
+
+  short* sb=(short*)frameBuf;
+  for (unsigned int i=0; i<len; i++) {
+    for (int j=0; j<outChans; j++) {
+      float s=outBuf[j][i];
+      if (s<-1.0f) s=-1.0f;
+      if (s>1.0f) s=1.0f;
+      *(sb++)=s*32767.0f;
+    }
+  }
+  return sendFrame(DIV_SERVER_FRAME_AUDIO,frameBuf,len*outChans*sizeof(short));
+}
+
+bool DivRenderServer::validPos(int order, int row) {
+  if (order<0 || order>=e->curSubSong->ordersLen) return false;
+  if (row<0 || row>=e->curSubSong->patLen) return false;
+  return true;
+}
+
+void DivRenderServer::start() {
+  e->stop();
+  e->setOrder(seekOrder);
+  e->playToRow(seekRow);
+  e->remainingLoops=-1;
+  e->totalLoops=0;
+}
+
+bool DivRenderServer::render(size_t maxLen, int endOrder, int endRow) {
+  size_t total=0;
+  if (!e->playing) start();
+
+  if (maxLen==0 && endOrder<0) {
+    e->remainingLoops=loops+1;
+  } else {
+    e->remainingLoops=-1;
+  }
+  e->setRangeEnd(endOrder,endRow);
+  // nextBuf() doesn't allocate, so the buffers must be ready for our size
+  if (e->scratchBufSize<DIV_SERVER_BUFSIZE || e->renderPool==NULL) {
+    e->prepareBuffers(DIV_SERVER_BUFSIZE);
+  }
+
+  bool ret=true;
+  while (e->playing) {
+    unsigned int size=DIV_SERVER_BUFSIZE;
+    if (maxLen>0 && maxLen-total<size) size=maxLen-total;
+    int loopsBefore=e->totalLoops;
+
+    e->nextBuf(NULL,outBuf,0,outChans,size);
+    if (e->totalProcessed>size) {
+      logE("error: total processed is bigger than buffer size! %d>%d",e->totalProcessed,size);
+      e->totalProcessed=size;
+    }
+    unsigned int len=e->totalProcessed;
+    bool done=false;
+    if (endOrder>=0) {
+      // stop exactly where the end position was reached or the song looped
+      if (e->getRangeEndPos()>=0) {
+        len=MIN(len,(unsigned int)e->getRangeEndPos());
+        done=true;
+      }
+      if (e->totalLoops!=loopsBefore) {
+        if (e->lastLoopPos>=0) len=MIN(len,(unsigned int)e->lastLoopPos);
+        done=true;
+      }
+    }
+    if (!sendAudio(len)) {
+      ret=false;
+      break;
+    }
+    total+=len;
+
+    if (done) break;
+    if (maxLen>0 && total>=maxLen) break;
+  }
+  e->setRangeEnd(-1,-1);
+  if (!ret) return false;
+
+  return sendText(DIV_SERVER_FRAME_END,fmt::sprintf("%d",(int)total));
+}
+
+void DivRenderServer::trimCache() {
+  while (cache.size()>cacheSize) {
+    size_t oldest=0;
+    for (size_t i=1; i<cache.size(); i++) {
+      if (cache[i]->lastUse<cache[oldest]->lastUse) oldest=i;
+    }
+    logD("removing %s from the cache",cache[oldest]->path);
+    cache[oldest]->song.unload();
+    delete cache[oldest];
+    cache.erase(cache.begin()+oldest);
+  }
+}
+
+bool DivRenderServer::loadSong(const String& path) {
+  struct stat st;
+  if (stat(path.c_str(),&st)!=0) {
+    sendText(DIV_SERVER_FRAME_ERROR,fmt::sprintf("could not open file! (%s)",strerror(errno)));
+    return false;
+  }
+  long long size=st.st_size;
+  long long mtime=st.st_mtime;
+
+  seekOrder=0;
+  seekRow=0;
+
+  // already in the engine
+  if (!curPath.empty() && curPath==path && curSize==size && curMtime==mtime) {
+    e->stop();
+    e->changeSongP(0);
+    return true;
+  }
+
+  // look in the cache
+  for (size_t i=0; i<cache.size(); i++) {
+    DivServerSong* s=cache[i];
+    if (s->path!=path) continue;
+    if (s->size!=size || s->mtime!=mtime) {
+      // file changed
+      s->song.unload();
+      delete s;
+      cache.erase(cache.begin()+i);
+      break;
+    }
+    logD("%s is in the cache",path);
+    e->swapSong(s->song,true,true);
+    if (curPath.empty()) {
+      s->song.unload();
+      delete s;
+      cache.erase(cache.begin()+i);
+    } else {
+      // the entry now holds the previous song
+      s->path=curPath;
+      s->size=curSize;
+      s->mtime=curMtime;
+      s->lastUse=useCount++;
+    }
+    curPath=path;
+    curSize=size;
+    curMtime=mtime;
+    return true;
+  }
+
+  // not cached. read the file
+  FILE* f=ps_fopen(path.c_str(),"rb");
+  if (f==NULL) {
+    sendText(DIV_SERVER_FRAME_ERROR,fmt::sprintf("could not open file! (%s)",strerror(errno)));
+    return false;
+  }
+  if (size<1) {
+    fclose(f);
+    sendText(DIV_SERVER_FRAME_ERROR,"that file is empty!");
+    return false;
+  }
+  unsigned char* file=new unsigned char[size];
+  if (fread(file,1,(size_t)size,f)!=(size_t)size) {
+    fclose(f);
+    delete[] file;
+    sendText(DIV_SERVER_FRAME_ERROR,fmt::sprintf("could not read file! (%s)",strerror(errno)));
+    return false;
+  }
+  fclose(f);
+
+  // move the current song to the cache
+  DivServerSong* prev=NULL;
+  if (!curPath.empty() && cacheSize>0) {
+    prev=new DivServerSong;
+    e->swapSong(prev->song,true,true);
+    prev->path=curPath;
+    prev->size=curSize;
+    prev->mtime=curMtime;
+    prev->lastUse=useCount++;
+    cache.push_back(prev);
+    trimCache();
+  }
+  String prevPath=curPath;
+  curPath="";
+
+  if (!e->load(file,(size_t)size,path.c_str())) {
+    sendText(DIV_SERVER_FRAME_ERROR,fmt::sprintf("could not open file! (%s)",e->getLastError()));
+    // bring the previous song back (if it wasn't cached, it is still loaded)
+    if (prev==NULL) {
+      curPath=prevPath;
+    } else {
+      for (size_t i=0; i<cache.size(); i++) {
+        if (cache[i]!=prev) continue;
+        e->swapSong(prev->song,true,true);
+        curPath=prevPath;
+        curSize=prev->size;
+        curMtime=prev->mtime;
+        prev->song.unload();
+        delete prev;
+        cache.erase(cache.begin()+i);
+        break;
+      }
+    }
+    return false;
+  }
+  if (e->shallSwitchCores()) {
+    e->quitDispatch();
+    e->initDispatch(true);
+    e->renderSamplesP();
+  }
+
+  curPath=path;
+  curSize=size;
+  curMtime=mtime;
+  return true;
+}
+
+bool DivRenderServer::command(char* line, bool& endSession) {
+  // split command and arguments
+  char* args=line;
+  while (*args!=0 && *args!=' ') args++;
+  if (*args==' ') {
+    *args=0;
+    args++;
+    while (*args==' ') args++;
+  }
+  String cmd=line;
+  String arg=args;
+  std::vector<int> nums;
+  if (cmd!="load" && cmd!="format") {
+    char* next=args;
+    while (*next!=0) {
+      char* endPtr=NULL;
+      long val=strtol(next,&endPtr,10);
+      if (endPtr==next) {
+        return sendText(DIV_SERVER_FRAME_ERROR,"invalid argument");
+      }
+      nums.push_back((int)val);
+      next=endPtr;
+      while (*next==' ') next++;
+    }
+  }
+
+  if (cmd=="load") {
+    if (arg.empty()) return sendText(DIV_SERVER_FRAME_ERROR,"usage: load <path>");
+    if (!loadSong(arg)) return true;
+    return sendText(DIV_SERVER_FRAME_OK,e->song.name);
+  } else if (cmd=="subsong") {
+    if (nums.size()!=1) return sendText(DIV_SERVER_FRAME_ERROR,"usage: subsong <index>");
+    if (nums[0]<0 || nums[0]>=(int)e->song.subsong.size()) return sendText(DIV_SERVER_FRAME_ERROR,"invalid subsong");
+    e->stop();
+    e->changeSongP(nums[0]);
+    seekOrder=0;
+    seekRow=0;
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="format") {
+    if (arg=="s16") {
+      format=DIV_SERVER_FORMAT_S16;
+    } else if (arg=="f32") {
+      format=DIV_SERVER_FORMAT_F32;
+    } else {
+      return sendText(DIV_SERVER_FRAME_ERROR,"usage: format s16|f32");
+    }
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="channels") {
+    if (nums.size()!=1) return sendText(DIV_SERVER_FRAME_ERROR,"usage: channels <count>");
+    if (nums[0]<1 || nums[0]>DIV_MAX_OUTPUTS) return sendText(DIV_SERVER_FRAME_ERROR,"invalid channel count");
+    outChans=nums[0];
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="rate") {
+    if (nums.size()!=1) return sendText(DIV_SERVER_FRAME_ERROR,"usage: rate <hz>");
+    if (nums[0]<8000 || nums[0]>192000) return sendText(DIV_SERVER_FRAME_ERROR,"invalid rate");
+    e->stop();
+    e->got.rate=nums[0];
+    // like audio export, reinitialize the chips at the new rate.
+    // this also resizes the buffers (they depend on the rate).
+    e->quitDispatch();
+    e->initDispatch(true);
+    e->renderSamplesP();
+    seekOrder=0;
+    seekRow=0;
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="loops") {
+    if (nums.size()!=1 || nums[0]<0) return sendText(DIV_SERVER_FRAME_ERROR,"usage: loops <count>");
+    loops=nums[0];
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="seek") {
+    if (nums.size()<1 || nums.size()>2) return sendText(DIV_SERVER_FRAME_ERROR,"usage: seek <order> [row]");
+    int row=(nums.size()>1)?nums[1]:0;
+    if (!validPos(nums[0],row)) return sendText(DIV_SERVER_FRAME_ERROR,"invalid position");
+    seekOrder=nums[0];
+    seekRow=row;
+    start();
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="stop") {
+    e->stop();
+    seekOrder=0;
+    seekRow=0;
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="play") {
+    if (!nums.empty()) return sendText(DIV_SERVER_FRAME_ERROR,"usage: play");
+    return render(0,-1,-1);
+  } else if (cmd=="render") {
+    if (nums.size()!=1 || nums[0]<1) return sendText(DIV_SERVER_FRAME_ERROR,"usage: render <milliseconds>");
+    return render(((size_t)nums[0]*e->got.rate)/1000,-1,-1);
+  } else if (cmd=="range") {
+    if (nums.size()!=4) return sendText(DIV_SERVER_FRAME_ERROR,"usage: range <order> <row> <end order> <end row>");
+    if (!validPos(nums[0],nums[1]) || !validPos(nums[2],nums[3])) return sendText(DIV_SERVER_FRAME_ERROR,"invalid position");
+    if (nums[2]<nums[0] || (nums[2]==nums[0] && nums[3]<=nums[1])) return sendText(DIV_SERVER_FRAME_ERROR,"end position is not after start position");
+    seekOrder=nums[0];
+    seekRow=nums[1];
+    start();
+    return render(0,nums[2],nums[3]);
+  } else if (cmd=="info") {
+    String info=fmt::sprintf(
+      "name: %s\n"
+      "author: %s\n"
+      "rate: %d\n"
+      "subsongs: %d\n"
+      "orders: %d\n"
+      "chips:",
+      e->song.name,
+      e->song.author,
+      (int)e->got.rate,
+      (int)e->song.subsong.size(),
+      e->curSubSong->ordersLen
+    );
+    for (int i=0; i<e->song.systemLen; i++) {
+      info+=fmt::sprintf(" %s",e->getSystemName(e->song.system[i]));
+    }
+    return sendText(DIV_SERVER_FRAME_OK,info);
+  } else if (cmd=="cache") {
+    String list=curPath;
+    for (DivServerSong* i: cache) {
+      list+="\n";
+      list+=i->path;
+    }
+    return sendText(DIV_SERVER_FRAME_OK,list);
+  } else if (cmd=="quit") {
+    endSession=true;
+    return sendText(DIV_SERVER_FRAME_OK,"");
+  } else if (cmd=="shutdown") {
+    sendText(DIV_SERVER_FRAME_OK,"");
+    return false;
+  }
+  return sendText(DIV_SERVER_FRAME_ERROR,fmt::sprintf("unknown command: %s",cmd));
+}
+
+bool DivRenderServer::serve(FILE* i, FILE* o) {
+  char line[SERVER_LINE_SIZE];
+  bool endSession=false;
+  in=i;
+  out=o;
+
+  while (!endSession) {
+    if (fgets(line,SERVER_LINE_SIZE,in)==NULL) break;
+    // strip line ending
+    size_t len=strlen(line);
+    while (len>0 && (line[len-1]=='\n' || line[len-1]=='\r')) line[--len]=0;
+    if (len==0) continue;
+
+    logV("server: %s",line);
+    if (!command(line,endSession)) return false;
+    if (ferror(out)) {
+      logW("client went away");
+      break;
+    }
+  }
+  e->stop();
+  return true;
+}
+
+int DivRenderServer::run(const String& where) {
+  if (where=="stdio") {
+#ifdef _WIN32
+    _setmode(_fileno(stdin),_O_BINARY);
+    _setmode(_fileno(stdout),_O_BINARY);
+#endif
+    logI("render server ready.");
+    serve(stdin,stdout);
+    return 0;
+  }
+
+#ifdef _WIN32
+  logE("Unix sockets are not supported on Windows. use stdio instead.");
+  return 1;
+#else
+  struct sockaddr_un addr;
+  if (where.size()>=sizeof(addr.sun_path)) {
+    logE("socket path is too long!");
+    return 1;
+  }
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family=AF_UNIX;
+  strncpy(addr.sun_path,where.c_str(),sizeof(addr.sun_path)-1);
+
+  int sock=socket(AF_UNIX,SOCK_STREAM,0);
+  if (sock<0) {
+    logE("could not create socket! (%s)",strerror(errno));
+    return 1;
+  }
+  unlink(where.c_str());
+  if (bind(sock,(struct sockaddr*)&addr,sizeof(addr))<0) {
+    logE("could not bind socket! (%s)",strerror(errno));
+    close(sock);
+    return 1;
+  }
+  if (listen(sock,4)<0) {
+    logE("could not listen on socket! (%s)",strerror(errno));
+    close(sock);
+    unlink(where.c_str());
+    return 1;
+  }
+
+  // a client disconnecting shall not kill us
+  signal(SIGPIPE,SIG_IGN);
+
+  logI("render server listening on %s.",where);
+  bool keepRunning=true;
+  while (keepRunning) {
+    int client=accept(sock,NULL,NULL);
+    if (client<0) {
+      if (errno==EINTR) continue;
+      logE("could not accept connection! (%s)",strerror(errno));
+      break;
+    }
+    logD("client connected");
+    int clientOut=dup(client);
+    FILE* ci=fdopen(client,"rb");
+    FILE* co=(clientOut<0)?NULL:fdopen(clientOut,"wb");
+    if (ci==NULL || co==NULL) {
+      logE("could not open client streams!");
+      if (ci!=NULL) {
+        fclose(ci);
+      } else {
+        close(client);
+      }
+      if (clientOut>=0) close(clientOut);
+      continue;
+    }
+    keepRunning=serve(ci,co);
+    fclose(ci);
+    fclose(co);
+    logD("client disconnected");
+  }
+
+  close(sock);
+  unlink(where.c_str());
+  return 0;
+#endif
+}
+
+DivRenderServer::DivRenderServer(DivEngine* eng):
+  e(eng),
+  in(NULL),
+  out(NULL),
+  useCount(0),
+  curSize(0),
+  curMtime(0),
+  format(DIV_SERVER_FORMAT_S16),
+  outChans(2),
+  loops(0),
+  seekOrder(0),
+  seekRow(0) {
+  int size=e->getConfInt("serverCacheSize",8);
+  cacheSize=(size<0)?0:size;
+  for (int i=0; i<DIV_MAX_OUTPUTS; i++) {
+    outBuf[i]=new float[DIV_SERVER_BUFSIZE];
+  }
+  frameBuf=new unsigned char[DIV_SERVER_BUFSIZE*DIV_MAX_OUTPUTS*sizeof(float)];
+}
+
+DivRenderServer::~DivRenderServer() {
+  for (DivServerSong* i: cache) {
+    i->song.unload();
+    delete i;
+  }
+  cache.clear();
+  for (int i=0; i<DIV_MAX_OUTPUTS; i++) {
+    delete[] outBuf[i];
+  }
+  delete[] frameBuf;
+}
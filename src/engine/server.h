@@ -0,0 +1,114 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _SERVER_H
+#define _SERVER_H
+
+#include "engine.h"
+
+// every frame starts with a 12-byte header:
+// - "FURS" magic
+// - frame type (1 byte)
+// - sample format (1 byte, audio frames only)
+// - channel count (2 bytes, little-endian, audio frames only)
+// - payload length in bytes (4 bytes, little-endian)
+#define DIV_SERVER_HEADER_SIZE 12
+// maximum number of samples in an audio frame
+#define DIV_SERVER_BUFSIZE 2048
+
+enum DivServerFrameTypes {
+  // command succeeded. payload is text.
+  DIV_SERVER_FRAME_OK=0,
+  // command failed. payload is text.
+  DIV_SERVER_FRAME_ERROR,
+  // interleaved audio data.
+  DIV_SERVER_FRAME_AUDIO,
+  // end of a play/render/range command. payload is the number of samples as text.
+  DIV_SERVER_FRAME_END
+};
+
+enum DivServerFormats {
+  DIV_SERVER_FORMAT_S16=0,
+  DIV_SERVER_FORMAT_F32
+};
+
+// a song which has been loaded before, kept out of the engine until it's needed again
+struct DivServerSong {
+  String path;
+  long long size, mtime;
+  unsigned int lastUse;
+  DivSong song;
+  DivServerSong():
+    size(0),
+    mtime(0),
+    lastUse(0) {}
+};
+
+class DivRenderServer {
+  DivEngine* e;
+  FILE* in;
+  FILE* out;
+
+  std::vector<DivServerSong*> cache;
+  size_t cacheSize;
+  unsigned int useCount;
+  // the song currently in the engine
+  String curPath;
+  long long curSize, curMtime;
+
+  DivServerFormats format;
+  int outChans;
+  int loops;
+  int seekOrder, seekRow;
+
+  float* outBuf[DIV_MAX_OUTPUTS];
+  unsigned char* frameBuf;
+
+  bool sendFrame(DivServerFrameTypes type, const void* data, unsigned int len);
+  bool sendText(DivServerFrameTypes type, const String& text);
+  bool sendAudio(unsigned int len);
+
+  // whether order and row are inside the current subsong
+  bool validPos(int order, int row);
+  // start playback from the seek position
+  void start();
+  // render until the song ends (maxLen=0 and endOrder=-1), for maxLen samples or until endOrder/endRow
+  bool render(size_t maxLen, int endOrder, int endRow);
+
+  bool loadSong(const String& path);
+  void trimCache();
+
+  // returns false if the server shall quit
+  bool command(char* line, bool& endSession);
+  // returns false if the server shall quit
+  bool serve(FILE* i, FILE* o);
+
+  public:
+    /**
+     * run the server.
+     * @param where "stdio" to use standard input/output, or a Unix socket path.
+     * @return 0 on success, 1 on error.
+     */
+    int run(const String& where);
+
+    DivRenderServer(DivEngine* eng);
+    ~DivRenderServer();
+};
+
+#endif
@@ -43,6 +43,12 @@ void DivSubSong::optimizePatterns() {
   }
 }
 
+void DivSubSong::compactPatterns() {
+  for (int i=0; i<DIV_MAX_CHANS; i++) {
+    pat[i].compact();
+  }
+}
+
 void DivSubSong::rearrangePatterns() {
   for (int i=0; i<DIV_MAX_CHANS; i++) {
     logD("re-arranging channel %d...",i);
@@ -114,7 +120,7 @@ void DivSubSong::makePatUnique() {
           if (!used[k]) {
             // copy here
             DivPattern* dest=pat[i].getPattern(k,true);
-            DivPattern* src=pat[i].getPattern(orders.ord[i][j],false);
+            const DivPattern* src=pat[i].getPattern(orders.ord[i][j],false);
             src->copyOn(dest);
             used[k]=true;
             orders.ord[i][j]=k;
@@ -181,6 +181,7 @@ struct DivSubSong {
   void clearData();
   void optimizePatterns();
   void rearrangePatterns();
+  void compactPatterns();
   void sortOrders();
   void makePatUnique();
 
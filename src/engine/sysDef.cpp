@@ -422,6 +422,14 @@ template<const int bits, const int shift> int effectValLongShift(unsigned char c
 void DivEngine::registerSystems() {
   logD("registering systems...");
 
+  // these are static and shared by every engine instance, so they are
+  // cleared here rather than in the constructor
+  memset(sysDefs,0,DIV_MAX_CHIP_DEFS*sizeof(void*));
+  for (int i=0; i<DIV_MAX_CHIP_DEFS; i++) {
+    sysFileMapFur[i]=DIV_SYSTEM_NULL;
+    sysFileMapDMF[i]=DIV_SYSTEM_NULL;
+  }
+
   // Common effect handler maps
 
   EffectHandlerMap ayPostEffectHandlerMap={
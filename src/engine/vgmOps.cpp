@@ -19,12 +19,14 @@
 
 #include "engine.h"
 #include "../ta-log.h"
+#include "../fileutils.h"
+#include <errno.h>
 #include "../utfutils.h"
 #include "song.h"
 
 constexpr int MASTER_CLOCK_PREC=(sizeof(void*)==8)?8:0;
 
-void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, int* pendingFreq, int* playingSample, int* setPos, unsigned int* sampleOff8, unsigned int* sampleLen8, size_t bankOffset, bool directStream) {
+void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write, int streamOff, double* loopTimer, double* loopFreq, int* loopSample, bool* sampleDir, bool isSecond, int* pendingFreq, int* playingSample, int* setPos, unsigned int* sampleOff8, unsigned int* sampleLen8, int* sampleBlock, size_t bankOffset, bool directStream) {
   unsigned char baseAddr1=isSecond?0xa0:0x50;
   unsigned char baseAddr2=isSecond?0x80:0;
   unsigned short baseAddr2S=isSecond?0x8000:0;
@@ -671,7 +673,7 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
               } else {
                 w->writeC(0x95);
                 w->writeC(streamID);
-                w->writeS(write.val); // sample number
+                w->writeS(sampleBlock[write.val&0xff]); // data block
                 w->writeC((sample->getLoopStartPosition(DIV_SAMPLE_DEPTH_8BIT)==0 && sample->isLoopable())|(sampleDir[streamID]?0x10:0)); // flags
               }
 
@@ -713,7 +715,7 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
             } else {
               w->writeC(0x95);
               w->writeC(streamID);
-              w->writeS(pendingFreq[streamID]); // sample number
+              w->writeS(sampleBlock[pendingFreq[streamID]&0xff]); // data block
               w->writeC((sample->getLoopStartPosition(DIV_SAMPLE_DEPTH_8BIT)==0 && sample->isLoopable())|(sampleDir[streamID]?0x10:0)); // flags
             }
 
@@ -762,7 +764,7 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
             } else {
               w->writeC(0x95);
               w->writeC(streamID);
-              w->writeS(playingSample[streamID]); // sample number
+              w->writeS(sampleBlock[playingSample[streamID]&0xff]); // data block
               w->writeC((sample->getLoopStartPosition(DIV_SAMPLE_DEPTH_8BIT)==0 && sample->isLoopable())|(sampleDir[streamID]?0x10:0)); // flags
             }
 
@@ -1095,6 +1097,249 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
   }
 }
 
+// VGM register write optimizer (see saveVGM).
+// writes which do not change the state of a chip are removed, and the waits
+// in between are merged. only registers which simply hold a value are tracked,
+// as writing some registers has side effects even when the value is the same
+// (frequency latches, envelope restart, timers, FIFOs and so on).
+// key on registers are tracked per channel.
+
+#define VGM_SHADOW_CHIPS 32
+#define VGM_SHADOW_REGS 512
+
+// returns the length of the command at buf[0], or 0 if it is unknown.
+static size_t vgmCommandLen(const unsigned char* buf, size_t avail) {
+  unsigned char cmd=buf[0];
+  if (cmd==0x67) {
+    if (avail<7) return 0;
+    return 7+((buf[3]|(buf[4]<<8)|(buf[5]<<16)|((unsigned int)buf[6]<<24))&0x7fffffff);
+  }
+  if (cmd>=0x30 && cmd<=0x3f) return 2;
+  if (cmd>=0x40 && cmd<=0x4e) return 3;
+  if (cmd==0x4f || cmd==0x50) return 2;
+  if (cmd>=0x51 && cmd<=0x5f) return 3;
+  if (cmd==0x61) return 3;
+  if (cmd==0x62 || cmd==0x63 || cmd==0x66) return 1;
+  if (cmd==0x64) return 4;
+  if (cmd==0x68) return 12;
+  if (cmd>=0x70 && cmd<=0x8f) return 1;
+  switch (cmd) {
+    case 0x90: case 0x91: case 0x95:
+      return 5;
+    case 0x92:
+      return 6;
+    case 0x93:
+      return 11;
+    case 0x94:
+      return 2;
+  }
+  if (cmd>=0xa0 && cmd<=0xbf) return 3;
+  if (cmd>=0xc0 && cmd<=0xdf) return 4;
+  if (cmd>=0xe0) return 5;
+  return 0;
+}
+
+// returns the wait of a wait command, or -1 if it isn't one.
+static int vgmCommandWait(const unsigned char* buf) {
+  if (buf[0]==0x61) return buf[1]|(buf[2]<<8);
+  if (buf[0]==0x62) return 735;
+  if (buf[0]==0x63) return 882;
+  if (buf[0]>=0x70 && buf[0]<=0x7f) return (buf[0]&15)+1;
+  return -1;
+}
+
+// returns the shadow slot of a register write, or -1 if it has to be kept.
+// ayBank holds the register bank of each AY (AY8930 expanded mode), or -1 if unknown.
+static int vgmShadowSlot(const unsigned char* buf, int* ayBank) {
+  unsigned char cmd=buf[0];
+  unsigned char reg=buf[1];
+  unsigned char val=buf[2];
+  int chip;
+  if (cmd==0xa0) { // AY-3-8910
+    chip=(reg&0x80)?16:0;
+    reg&=0x7f;
+    if (reg==0x0d) {
+      // also selects the bank on AY8930
+      ayBank[chip>>4]=((val&0xf0)==0xb0)?1:0;
+      return -1;
+    }
+    if (reg>0x0c || ayBank[chip>>4]<0) return -1;
+    // AY8930 bank B registers 4 and 5 are envelope shapes. writing them retriggers
+    if (ayBank[chip>>4]==1 && (reg==0x04 || reg==0x05)) return -1;
+    return chip*VGM_SHADOW_REGS+reg+(ayBank[chip>>4]<<8);
+  }
+  if (cmd>0x50 && cmd<=0x5f) {
+    chip=cmd-0x50;
+  } else if (cmd>0xa0 && cmd<=0xaf) {
+    chip=16+cmd-0xa0;
+  } else {
+    return -1;
+  }
+  bool keep=true;
+  switch (cmd&15) {
+    case 0x1: // YM2413
+      keep=(reg==0x0f || (reg>0x07 && reg<0x0e) || reg>0x38);
+      break;
+    case 0x4: // YM2151
+      if (reg==0x08) return chip*VGM_SHADOW_REGS+256+(val&7);
+      keep=!(reg==0x0f || reg==0x18 || reg==0x1b || reg>=0x20);
+      break;
+    case 0x5: case 0x6: case 0x8: // YM2203/YM2608/YM2610 port 0
+      if (reg<=0x0c) {
+        keep=false;
+        break;
+      }
+      // fall through
+    case 0x2: // YM2612 port 0
+      if (reg==0x28) return chip*VGM_SHADOW_REGS+256+(val&7);
+      if (reg==0x22) {
+        keep=false;
+        break;
+      }
+      // fall through
+    case 0x3: case 0x7: case 0x9: // port 1
+      keep=!((reg>=0x30 && reg<0xa0) || (reg>=0xb0 && reg<=0xb6));
+      break;
+    case 0xa: case 0xb: case 0xc: case 0xe: case 0xf: // OPL family
+      keep=(reg<0x20);
+      break;
+  }
+  if (keep) return -1;
+  return chip*VGM_SHADOW_REGS+reg;
+}
+
+static void vgmWriteWait(SafeWriter* w, int wait) {
+  while (wait>0) {
+    if (wait==735) {
+      w->writeC(0x62);
+      wait=0;
+    } else if (wait==882) {
+      w->writeC(0x63);
+      wait=0;
+    } else if (wait<=16) {
+      w->writeC(0x70+wait-1);
+      wait=0;
+    } else {
+      int amount=MIN(wait,65535);
+      w->writeC(0x61);
+      w->writeS(amount);
+      wait-=amount;
+    }
+  }
+}
+
+// returns an optimized copy of a VGM file, or NULL if it could not be parsed.
+static SafeWriter* optimizeVGM(const unsigned char* buf, size_t len, int& removed) {
+  if (len<0x40) return NULL;
+  size_t dataPos=0x34+(buf[0x34]|(buf[0x35]<<8)|(buf[0x36]<<16)|((unsigned int)buf[0x37]<<24));
+  size_t gd3Rel=buf[0x14]|(buf[0x15]<<8)|(buf[0x16]<<16)|((unsigned int)buf[0x17]<<24);
+  size_t loopRel=buf[0x1c]|(buf[0x1d]<<8)|(buf[0x1e]<<16)|((unsigned int)buf[0x1f]<<24);
+  size_t loopPos=loopRel?(0x1c+loopRel):0;
+  if (dataPos>=len) return NULL;
+
+  std::vector<short> shadow(VGM_SHADOW_CHIPS*VGM_SHADOW_REGS,-1);
+  std::vector<short> loopShadow;
+  int ayBank[2]={-1,-1};
+  int loopAYBank[2]={-1,-1};
+  size_t endPos=0;
+
+  // first pass: find the state of every register at the loop point and at the end.
+  // when looping, a register is only known if it is the same in both.
+  for (size_t i=dataPos; i<len;) {
+    if (i==loopPos) {
+      loopShadow=shadow;
+      loopAYBank[0]=ayBank[0];
+      loopAYBank[1]=ayBank[1];
+    }
+    if (buf[i]==0x66) {
+      endPos=i;
+      break;
+    }
+    size_t cmdLen=vgmCommandLen(&buf[i],len-i);
+    if (cmdLen==0 || i+cmdLen>len) {
+      logW("VGM optimizer: unknown command %.2x at %x!",buf[i],(int)i);
+      return NULL;
+    }
+    if (cmdLen==3) {
+      int slot=vgmShadowSlot(&buf[i],ayBank);
+      if (slot>=0) shadow[slot]=buf[i+2];
+    }
+    i+=cmdLen;
+  }
+  if (endPos==0) return NULL;
+  if (loopPos) {
+    if (loopShadow.empty()) return NULL;
+    for (size_t i=0; i<shadow.size(); i++) {
+      if (loopShadow[i]!=shadow[i]) loopShadow[i]=-1;
+    }
+    for (int i=0; i<2; i++) {
+      if (loopAYBank[i]!=ayBank[i]) loopAYBank[i]=-1;
+    }
+  }
+
+  // second pass: write everything but the writes which don't change anything
+  SafeWriter* w=new SafeWriter;
+  w->init();
+  w->write(buf,dataPos);
+  std::fill(shadow.begin(),shadow.end(),-1);
+  ayBank[0]=-1;
+  ayBank[1]=-1;
+  int pendingWait=0;
+  size_t newLoopPos=0;
+  removed=0;
+  for (size_t i=dataPos; i<endPos;) {
+    if (i==loopPos) {
+      vgmWriteWait(w,pendingWait);
+      pendingWait=0;
+      newLoopPos=w->tell();
+      shadow=loopShadow;
+      ayBank[0]=loopAYBank[0];
+      ayBank[1]=loopAYBank[1];
+    }
+    size_t cmdLen=vgmCommandLen(&buf[i],len-i);
+    int wait=vgmCommandWait(&buf[i]);
+    if (wait>=0) {
+      pendingWait+=wait;
+      i+=cmdLen;
+      continue;
+    }
+    if (cmdLen==3) {
+      int slot=vgmShadowSlot(&buf[i],ayBank);
+      if (slot>=0) {
+        if (shadow[slot]==buf[i+2]) {
+          removed++;
+          i+=cmdLen;
+          continue;
+        }
+        shadow[slot]=buf[i+2];
+      }
+    }
+    vgmWriteWait(w,pendingWait);
+    pendingWait=0;
+    w->write(&buf[i],cmdLen);
+    i+=cmdLen;
+  }
+  vgmWriteWait(w,pendingWait);
+  if (loopPos==endPos) newLoopPos=w->tell();
+
+  // end of song and GD3 tag
+  size_t newGd3Pos=w->tell()+(gd3Rel?(0x14+gd3Rel-endPos):0);
+  w->write(&buf[endPos],len-endPos);
+
+  w->seek(4,SEEK_SET);
+  w->writeI(w->size()-4);
+  if (gd3Rel) {
+    w->seek(0x14,SEEK_SET);
+    w->writeI(newGd3Pos-0x14);
+  }
+  if (loopPos) {
+    w->seek(0x1c,SEEK_SET);
+    w->writeI(newLoopPos-0x1c);
+  }
+  w->seek(0,SEEK_END);
+  return w;
+}
+
 #define CHIP_VOL(_id,_mult) { \
   double _vol=fabs((float)song.systemVol[i])*256.0*_mult; \
   if (_vol<0.0) _vol=0.0; \
@@ -1113,11 +1358,26 @@ void DivEngine::performVGMWrite(SafeWriter* w, DivSystem sys, DivRegWrite& write
   chipVol.push_back((_id)|(0x80000100)|(((unsigned int)_vol)<<16)); \
 }
 
-SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool patternHints, bool directStream, int trailingTicks) {
+SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool patternHints, bool directStream, int trailingTicks, const char* path, bool optimize, bool compress) {
   if (version<0x150) {
     lastError="VGM version is too low";
     return NULL;
   }
+  if (compress && path==NULL) {
+    lastError="no path to write compressed VGM to";
+    return NULL;
+  }
+  SafeWriter* w=new SafeWriter;
+  // optimizing and compressing need the whole VGM in memory
+  if (path!=NULL && !optimize && !compress) {
+    if (!w->initFile(path)) {
+      lastError=fmt::sprintf("could not open file! (%s)",strerror(errno));
+      delete w;
+      return NULL;
+    }
+  } else {
+    w->init();
+  }
   stop();
   repeatPattern=false;
   setOrder(0);
@@ -1204,11 +1464,10 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
 
   unsigned int sampleOff8[256];
   unsigned int sampleLen8[256];
+  int sampleBlock[256];
+  bool sampleUnique[256];
   unsigned int sampleOffSegaPCM[256];
 
-  SafeWriter* w=new SafeWriter;
-  w->init();
-
   // write header
   w->write("Vgm ",4);
   w->writeI(0); // will be written later
@@ -2051,20 +2310,42 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
   // initialize sample offsets
   memset(sampleOff8,0,256*sizeof(unsigned int));
   memset(sampleLen8,0,256*sizeof(unsigned int));
+  memset(sampleBlock,0,256*sizeof(int));
   memset(sampleOffSegaPCM,0,256*sizeof(unsigned int));
 
   // write samples
   unsigned int sampleSeek=0;
+  int sampleBlocks=0;
   for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    sampleLen8[i]=sample->length8;
+    sampleUnique[i]=true;
+    if (optimize) {
+      // identical samples share a data block
+      for (int j=0; j<i; j++) {
+        DivSample* other=song.sample[j];
+        if (!sampleUnique[j]) continue;
+        if (other->depth!=sample->depth || other->dither!=sample->dither) continue;
+        if (other->getCurBufLen()!=sample->getCurBufLen()) continue;
+        if (sample->getCurBuf()==NULL || other->getCurBuf()==NULL) continue;
+        if (memcmp(other->getCurBuf(),sample->getCurBuf(),sample->getCurBufLen())!=0) continue;
+        logD("sample %d is the same as %d",i,j);
+        sampleUnique[i]=false;
+        sampleOff8[i]=sampleOff8[j];
+        sampleBlock[i]=sampleBlock[j];
+        break;
+      }
+      if (!sampleUnique[i]) continue;
+    }
     logI("setting seek to %d",sampleSeek);
     sampleOff8[i]=sampleSeek;
-    sampleLen8[i]=sample->length8;
+    sampleBlock[i]=sampleBlocks++;
     sampleSeek+=sample->length8;
   }
 
   if (writeDACSamples && !directStream) for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    if (!sampleUnique[i]) continue;
     w->writeC(0x67);
     w->writeC(0x66);
     w->writeC(0);
@@ -2076,6 +2357,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
 
   if (writeNESSamples && !directStream) for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    if (!sampleUnique[i]) continue;
     w->writeC(0x67);
     w->writeC(0x66);
     w->writeC(7);
@@ -2088,6 +2370,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
 
   if (writePCESamples && !directStream) for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    if (!sampleUnique[i]) continue;
     w->writeC(0x67);
     w->writeC(0x66);
     w->writeC(5);
@@ -2099,6 +2382,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
 
   if (writeVOXSamples && !directStream) for (int i=0; i<song.sampleLen; i++) {
     DivSample* sample=song.sample[i];
+    if (!sampleUnique[i]) continue;
     w->writeC(0x67);
     w->writeC(0x66);
     w->writeC(4);
@@ -2514,7 +2798,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
     for (int i=0; i<song.systemLen; i++) {
       std::vector<DivRegWrite>& writes=disCont[i].dispatch->getRegisterWrites();
       for (DivRegWrite& j: writes) {
-        performVGMWrite(w,song.system[i],j,streamIDs[i],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i],pendingFreq,playingSample,setPos,sampleOff8,sampleLen8,bankOffset[i],directStream);
+        performVGMWrite(w,song.system[i],j,streamIDs[i],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i],pendingFreq,playingSample,setPos,sampleOff8,sampleLen8,sampleBlock,bankOffset[i],directStream);
         writeCount++;
       }
       writes.clear();
@@ -2554,7 +2838,7 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
             lastOne=i.second.time;
           }
           // write write
-          performVGMWrite(w,song.system[i.first],i.second.write,streamIDs[i.first],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i.first],pendingFreq,playingSample,setPos,sampleOff8,sampleLen8,bankOffset[i.first],directStream);
+          performVGMWrite(w,song.system[i.first],i.second.write,streamIDs[i.first],loopTimer,loopFreq,loopSample,sampleDir,isSecond[i.first],pendingFreq,playingSample,setPos,sampleOff8,sampleLen8,sampleBlock,bankOffset[i.first],directStream);
           // handle global Furnace commands
 
           writeCount++;
@@ -2721,5 +3005,41 @@ SafeWriter* DivEngine::saveVGM(bool* sysToExport, bool loop, int version, bool p
   logI("%d register writes total.",writeCount);
 
   BUSY_END;
+
+  if (optimize) {
+    int removed=0;
+    SafeWriter* optimized=optimizeVGM(w->getFinalBuf(),w->size(),removed);
+    if (optimized!=NULL) {
+      logI("optimizer removed %d writes (%d -> %d bytes).",removed,(int)w->size(),(int)optimized->size());
+      w->finish();
+      delete w;
+      w=optimized;
+    } else {
+      logW("could not optimize VGM!");
+    }
+  }
+
+  if (path!=NULL && (optimize || compress)) {
+    FILE* f=ps_fopen(path,"wb");
+    if (f==NULL) {
+      lastError=fmt::sprintf("could not open file! (%s)",strerror(errno));
+      w->finish();
+      delete w;
+      return NULL;
+    }
+    bool failed=false;
+    if (compress) {
+      failed=(w->writeCompressed(f,9,true)!=0);
+    } else {
+      failed=(fwrite(w->getFinalBuf(),1,w->size(),f)!=w->size());
+    }
+    if (fclose(f)!=0) failed=true;
+    if (failed) {
+      lastError=fmt::sprintf("could not write file! (%s)",strerror(errno));
+      w->finish();
+      delete w;
+      return NULL;
+    }
+  }
   return w;
 }
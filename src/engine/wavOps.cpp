@@ -29,6 +29,10 @@ void _runExportThread(DivEngine* caller) {
   caller->runExportThread();
 }
 
+void _runStemExport(DivEngine* caller, DivStemQueue* queue) {
+  caller->runStemExport(queue);
+}
+
 bool DivEngine::isExporting() {
   return exporting;
 }
@@ -68,6 +72,7 @@ void DivEngine::runExportThread() {
 
       // take control of audio output
       deinitAudioBackend();
+      prepareBuffers(EXPORT_BUFSIZE);
       playSub(false);
 
       logI("rendering to file...");
@@ -167,6 +172,7 @@ void DivEngine::runExportThread() {
 
       // take control of audio output
       deinitAudioBackend();
+      prepareBuffers(EXPORT_BUFSIZE);
       playSub(false);
 
       logI("rendering to files...");
@@ -246,102 +252,15 @@ void DivEngine::runExportThread() {
     case DIV_EXPORT_MODE_MANY_CHAN: {
       // take control of audio output
       deinitAudioBackend();
+      prepareBuffers(EXPORT_BUFSIZE);
 
-      float* outBuf[DIV_MAX_OUTPUTS];
-      float* outBufFinal;
-      for (int i=0; i<exportOutputs; i++) {
-        outBuf[i]=new float[EXPORT_BUFSIZE];
-      }
-      outBufFinal=new float[EXPORT_BUFSIZE*exportOutputs];
-
-      logI("rendering to files...");
-      
+      // each entry is a channel (or a group of FM operator channels)
+      DivStemQueue queue;
+      queue.halt=&stopExport;
+      queue.owner=this;
       for (int i=0; i<chans; i++) {
         if (!exportChannelMask[i]) continue;
-        SNDFILE* sf;
-        SF_INFO si;
-        SFWrapper sfWrap;
-        String fname=fmt::sprintf("%s_c%02d.wav",exportPath,i+1);
-        logI("- %s",fname.c_str());
-        si.samplerate=got.rate;
-        si.channels=exportOutputs;
-        if (exportFormat==DIV_EXPORT_FORMAT_S16) {
-          si.format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
-        } else {
-          si.format=SF_FORMAT_WAV|SF_FORMAT_FLOAT;
-        }
-
-        sf=sfWrap.doOpen(fname.c_str(),SFM_WRITE,&si);
-        if (sf==NULL) {
-          logE("could not open file for writing! (%s)",sf_strerror(NULL));
-          break;
-        }
-
-        for (int j=0; j<chans; j++) {
-          bool mute=(j!=i);
-          isMuted[j]=mute;
-        }
-        if (getChannelType(i)==5) {
-          for (int j=i; j<chans; j++) {
-            if (getChannelType(j)!=5) break;
-            isMuted[j]=false;
-          }
-        }
-        for (int j=0; j<chans; j++) {
-          if (disCont[dispatchOfChan[j]].dispatch!=NULL) {
-            disCont[dispatchOfChan[j]].dispatch->muteChannel(dispatchChanOfChan[j],isMuted[j]);
-          }
-        }
-        
-        curOrder=0;
-        prevOrder=0;
-        curFadeOutSample=0;
-        lastLoopPos=-1;
-        totalLoops=0;
-        isFadingOut=false;
-        remainingLoops=-1;
-        playSub(false);
-
-        while (playing) {
-          size_t total=0;
-          nextBuf(NULL,outBuf,0,exportOutputs,EXPORT_BUFSIZE);
-          if (totalProcessed>EXPORT_BUFSIZE) {
-            logE("error: total processed is bigger than export bufsize! %d>%d",totalProcessed,EXPORT_BUFSIZE);
-            totalProcessed=EXPORT_BUFSIZE;
-          }
-          int fi=0;
-          for (int j=0; j<(int)totalProcessed; j++) {
-            total++;
-            if (isFadingOut) {
-              double mul=(1.0-((double)curFadeOutSample/(double)fadeOutSamples));
-              for (int k=0; k<exportOutputs; k++) {
-                outBufFinal[fi++]=MAX(-1.0f,MIN(1.0f,outBuf[k][j]))*mul;
-              }
-              if (++curFadeOutSample>=fadeOutSamples) {
-                playing=false;
-                break;
-              }
-            } else {
-              for (int k=0; k<exportOutputs; k++) {
-                outBufFinal[fi++]=MAX(-1.0f,MIN(1.0f,outBuf[k][j]));
-              }
-              if (lastLoopPos>-1 && j>=lastLoopPos && totalLoops>=exportLoopCount) {
-                logD("start fading out...");
-                isFadingOut=true;
-                if (fadeOutSamples==0) break;
-              }
-            }
-          }
-          if (sf_writef_float(sf,outBufFinal,total)!=(int)total) {
-            logE("error: failed to write entire buffer!");
-            break;
-          }
-        }
-
-        if (sfWrap.doClose()!=0) {
-          logE("could not close audio file!");
-        }
-
+        queue.stems.push_back(i);
         if (getChannelType(i)==5) {
           i++;
           while (true) {
@@ -351,13 +270,64 @@ void DivEngine::runExportThread() {
           }
           i--;
         }
+      }
 
-        if (stopExport) break;
+      queue.hashes.resize(queue.stems.size(),0);
+      queue.byWorker.resize(queue.stems.size(),0);
+
+      unsigned int threadCount=exportThreads;
+      if (threadCount<1) threadCount=std::thread::hardware_concurrency();
+      if (threadCount<1) threadCount=1;
+      if (threadCount>queue.stems.size()) threadCount=queue.stems.size();
+
+      // every worker is an independent copy of this engine, so stems
+      // render exactly as if they were exported one after another
+      std::vector<DivEngine*> workers;
+      std::vector<std::thread*> threads;
+      for (unsigned int i=1; i<threadCount; i++) {
+        DivEngine* w=createStemWorker();
+        if (w==NULL) break;
+        workers.push_back(w);
       }
 
-      delete[] outBufFinal;
-      for (int i=0; i<exportOutputs; i++) {
-        delete[] outBuf[i];
+      logI("rendering to files (%d threads)...",(int)workers.size()+1);
+
+      for (DivEngine* i: workers) {
+        threads.push_back(new std::thread(_runStemExport,i,&queue));
+      }
+      runStemExport(&queue);
+      for (std::thread* i: threads) {
+        i->join();
+        delete i;
+      }
+      for (DivEngine* i: workers) {
+        destroyStemWorker(i);
+      }
+
+      // render the first stem a worker made again here, and compare
+      if (exportVerify && !queue.failed && !stopExport) {
+        for (size_t i=0; i<queue.stems.size(); i++) {
+          if (!queue.byWorker[i]) continue;
+          logI("verifying channel %d...",queue.stems[i]+1);
+          float* outBuf[DIV_MAX_OUTPUTS];
+          for (int j=0; j<exportOutputs; j++) {
+            outBuf[j]=new float[EXPORT_BUFSIZE];
+          }
+          float* outBufFinal=new float[EXPORT_BUFSIZE*exportOutputs];
+          uint64_t serialHash=0;
+          if (exportStem(queue.stems[i],outBuf,outBufFinal,stopExport,serialHash,false) && !stopExport) {
+            if (serialHash==queue.hashes[i]) {
+              logI("channel %d is identical to the one rendered in a separate thread.",queue.stems[i]+1);
+            } else {
+              logE("channel %d differs from the one rendered in a separate thread! (%.16x != %.16x)",queue.stems[i]+1,serialHash,queue.hashes[i]);
+            }
+          }
+          delete[] outBufFinal;
+          for (int j=0; j<exportOutputs; j++) {
+            delete[] outBuf[j];
+          }
+          break;
+        }
       }
 
       for (int i=0; i<chans; i++) {
@@ -384,9 +354,206 @@ void DivEngine::runExportThread() {
 
   stopExport=false;
 }
+
+void DivEngine::runStemExport(DivStemQueue* queue) {
+  float* outBuf[DIV_MAX_OUTPUTS];
+  float* outBufFinal;
+  for (int i=0; i<exportOutputs; i++) {
+    outBuf[i]=new float[EXPORT_BUFSIZE];
+  }
+  outBufFinal=new float[EXPORT_BUFSIZE*exportOutputs];
+
+  while (!queue->failed && !(*queue->halt)) {
+    size_t index=queue->next++;
+    if (index>=queue->stems.size()) break;
+    uint64_t hash=0;
+    if (!exportStem(queue->stems[index],outBuf,outBufFinal,*queue->halt,hash)) {
+      queue->failed=true;
+      break;
+    }
+    queue->hashes[index]=hash;
+    queue->byWorker[index]=(queue->owner!=this);
+  }
+
+  delete[] outBufFinal;
+  for (int i=0; i<exportOutputs; i++) {
+    delete[] outBuf[i];
+  }
+}
+
+bool DivEngine::exportStem(int ch, float** outBuf, float* outBufFinal, const bool& halt, uint64_t& hash, bool toFile) {
+  size_t fadeOutSamples=got.rate*exportFadeOut;
+  size_t curFadeOutSample=0;
+  bool isFadingOut=false;
+
+  SNDFILE* sf;
+  SF_INFO si;
+  SFWrapper sfWrap;
+  String fname=fmt::sprintf("%s_c%02d.wav",exportPath,ch+1);
+  logI("- %s",fname.c_str());
+  si.samplerate=got.rate;
+  si.channels=exportOutputs;
+  if (exportFormat==DIV_EXPORT_FORMAT_S16) {
+    si.format=SF_FORMAT_WAV|SF_FORMAT_PCM_16;
+  } else {
+    si.format=SF_FORMAT_WAV|SF_FORMAT_FLOAT;
+  }
+
+  if (toFile) {
+    sf=sfWrap.doOpen(fname.c_str(),SFM_WRITE,&si);
+    if (sf==NULL) {
+      logE("could not open file for writing! (%s)",sf_strerror(NULL));
+      return false;
+    }
+  }
+  hash=DivBackupJournal::hash(NULL,0);
+
+  for (int j=0; j<chans; j++) {
+    bool mute=(j!=ch);
+    isMuted[j]=mute;
+  }
+  if (getChannelType(ch)==5) {
+    for (int j=ch; j<chans; j++) {
+      if (getChannelType(j)!=5) break;
+      isMuted[j]=false;
+    }
+  }
+  for (int j=0; j<chans; j++) {
+    if (disCont[dispatchOfChan[j]].dispatch!=NULL) {
+      disCont[dispatchOfChan[j]].dispatch->muteChannel(dispatchChanOfChan[j],isMuted[j]);
+    }
+  }
+  
+  curOrder=0;
+  prevOrder=0;
+  lastLoopPos=-1;
+  totalLoops=0;
+  remainingLoops=-1;
+  playSub(false);
+
+  bool ret=true;
+  while (playing && !halt) {
+    size_t total=0;
+    nextBuf(NULL,outBuf,0,exportOutputs,EXPORT_BUFSIZE);
+    if (totalProcessed>EXPORT_BUFSIZE) {
+      logE("error: total processed is bigger than export bufsize! %d>%d",totalProcessed,EXPORT_BUFSIZE);
+      totalProcessed=EXPORT_BUFSIZE;
+    }
+    int fi=0;
+    for (int j=0; j<(int)totalProcessed; j++) {
+      total++;
+      if (isFadingOut) {
+        double mul=(1.0-((double)curFadeOutSample/(double)fadeOutSamples));
+        for (int k=0; k<exportOutputs; k++) {
+          outBufFinal[fi++]=MAX(-1.0f,MIN(1.0f,outBuf[k][j]))*mul;
+        }
+        if (++curFadeOutSample>=fadeOutSamples) {
+          playing=false;
+          break;
+        }
+      } else {
+        for (int k=0; k<exportOutputs; k++) {
+          outBufFinal[fi++]=MAX(-1.0f,MIN(1.0f,outBuf[k][j]));
+        }
+        if (lastLoopPos>-1 && j>=lastLoopPos && totalLoops>=exportLoopCount) {
+          logD("start fading out...");
+          isFadingOut=true;
+          if (fadeOutSamples==0) break;
+        }
+      }
+    }
+    hash=DivBackupJournal::hash((const unsigned char*)outBufFinal,total*exportOutputs*sizeof(float),hash);
+    if (!toFile) continue;
+    if (sf_writef_float(sf,outBufFinal,total)!=(int)total) {
+      logE("error: failed to write entire buffer!");
+      ret=false;
+      break;
+    }
+  }
+
+  if (toFile && sfWrap.doClose()!=0) {
+    logE("could not close audio file!");
+    ret=false;
+  }
+  return ret;
+}
+
+DivEngine* DivEngine::createStemWorker() {
+  DivEngine* w=new DivEngine;
+
+  // song data is not modified during export, so it is shared with the worker.
+  // the current subsong is copied though, as playback writes to it (arpLen).
+  for (DivSubSong* i: w->song.subsong) {
+    delete i;
+  }
+  w->song=song;
+  w->song.subsong[curSubSongIndex]=new DivSubSong(*curSubSong);
+  w->changeSong(curSubSongIndex);
+
+  w->conf=conf;
+  w->got=got;
+  w->yrw801ROM=yrw801ROM;
+  w->tg100ROM=tg100ROM;
+  w->mu5ROM=mu5ROM;
+  w->forceMono=forceMono;
+  w->clampSamples=clampSamples;
+  w->lowLatency=lowLatency;
+  w->metronome=metronome;
+  w->metroVol=metroVol;
+  w->repeatPattern=false;
+  w->remainingLoops=-1;
+
+  w->exportPath=exportPath;
+  w->exportMode=exportMode;
+  w->exportFormat=exportFormat;
+  w->exportFadeOut=exportFadeOut;
+  w->exportOutputs=exportOutputs;
+  w->exportLoopCount=exportLoopCount;
+  memcpy(w->exportChannelMask,exportChannelMask,DIV_MAX_CHANS*sizeof(bool));
+
+  for (int i=0; i<got.outChans; i++) {
+    w->oscBuf[i]=new float[32768];
+    memset(w->oscBuf[i],0,32768*sizeof(float));
+  }
+
+  if (!w->initBuffers()) {
+    logE("could not create export worker!");
+    destroyStemWorker(w);
+    return NULL;
+  }
+
+  w->initDispatch(true);
+  w->prepareBuffers(EXPORT_BUFSIZE);
+  // samples were rendered already by saveAudio()
+  for (int i=0; i<w->song.systemLen; i++) {
+    if (w->disCont[i].dispatch!=NULL) {
+      w->disCont[i].dispatch->renderSamples(i);
+    }
+  }
+  w->reset();
+  return w;
+}
+
+void DivEngine::destroyStemWorker(DivEngine* w) {
+  w->quitDispatch();
+  delete w->song.subsong[curSubSongIndex];
+  // the rest of the song belongs to us. do not unload it.
+  w->song.subsong.clear();
+
+  for (int i=0; i<DIV_MAX_OUTPUTS; i++) {
+    if (w->oscBuf[i]!=NULL) delete[] w->oscBuf[i];
+  }
+  if (w->samp_bbOut!=NULL) delete[] w->samp_bbOut;
+  if (w->samp_bbIn!=NULL) delete[] w->samp_bbIn;
+  if (w->samp_bb!=NULL) blip_delete(w->samp_bb);
+  delete w;
+}
 #else
 void DivEngine::runExportThread() {
 }
+
+void DivEngine::runStemExport(DivStemQueue* queue) {
+}
 #endif
 
 bool DivEngine::shallSwitchCores() {
@@ -402,6 +569,8 @@ bool DivEngine::saveAudio(const char* path, DivAudioExportOptions options) {
   exportMode=options.mode;
   exportFormat=options.format;
   exportFadeOut=options.fadeOut;
+  exportThreads=options.threads;
+  exportVerify=options.verify;
   memcpy(exportChannelMask,options.channelMask,DIV_MAX_CHANS*sizeof(bool));
   if (exportMode!=DIV_EXPORT_MODE_ONE) {
     // remove extension
@@ -18,6 +18,7 @@
  */
 
 #include "workPool.h"
+#include "scratch.h"
 #include "../ta-log.h"
 #include <thread>
 
@@ -26,86 +27,77 @@ void* _workThread(void* inst) {
   return NULL;
 }
 
-void DivWorkThread::run() {
-  //std::unique_lock<std::mutex> unique(selfLock);
-  DivPendingTask task;
-  bool setFuckingPromise=false;
+bool DivWorkQueue::put(void (*what)(void*), void* arg) {
+  unsigned int t=tail.load(std::memory_order_relaxed);
+  unsigned int h=head.load(std::memory_order_acquire);
+  if (t-h>=DIV_WORK_QUEUE_SIZE) return false;
 
-  logV("running work thread");
+  func[t&(DIV_WORK_QUEUE_SIZE-1)].store(what,std::memory_order_relaxed);
+  funcArg[t&(DIV_WORK_QUEUE_SIZE-1)].store(arg,std::memory_order_relaxed);
+  tail.store(t+1,std::memory_order_release);
+  return true;
+}
 
+bool DivWorkQueue::take(DivPendingTask& task) {
+  unsigned int h=head.load(std::memory_order_acquire);
   while (true) {
-    lock.lock();
-    if (tasks.empty()) {
-      lock.unlock();
-      isBusy=false;
-      if (setFuckingPromise) {
-        parent->notify.set_value();
-        setFuckingPromise=false;
-        //std::this_thread::yield();
-      }
-      if (terminate) {
-        break;
-      }
-      std::future<void> future=notify.get_future();
-      future.wait();
-      lock.lock();
-      notify=std::promise<void>();
-      promiseAlreadySet=false;
-      lock.unlock();
-      continue;
-    } else {
-      task=tasks.front();
-      tasks.pop();
-      lock.unlock();
+    unsigned int t=tail.load(std::memory_order_acquire);
+    if ((int)(t-h)<=0) return false;
 
-      task.func(task.funcArg);
-
-      int busyCount=--parent->busyCount;
-      if (busyCount<0) {
-        logE("oh no PROBLEM...");
-      }
-      if (busyCount==0) {
-        setFuckingPromise=true;
-      }
+    // the slot may be overwritten as soon as head moves, so read it first.
+    // if another thread took this task before us, the exchange fails and
+    // we try again with the new head.
+    task.func=func[h&(DIV_WORK_QUEUE_SIZE-1)].load(std::memory_order_relaxed);
+    task.funcArg=funcArg[h&(DIV_WORK_QUEUE_SIZE-1)].load(std::memory_order_relaxed);
+    if (head.compare_exchange_weak(h,h+1,std::memory_order_acq_rel,std::memory_order_acquire)) {
+      return true;
     }
   }
 }
 
-bool DivWorkThread::assign(void (*what)(void*), void* arg) {
-  lock.lock();
-  if (tasks.size()>=30) {
-    lock.unlock();
-    return false;
-  }
-  tasks.push(DivPendingTask(what,arg));
-  parent->busyCount++;
-  isBusy=true;
-  lock.unlock();
-  return true;
+unsigned int DivWorkQueue::size() {
+  unsigned int h=head.load(std::memory_order_acquire);
+  unsigned int t=tail.load(std::memory_order_acquire);
+  if ((int)(t-h)<=0) return 0;
+  return t-h;
 }
 
-void DivWorkThread::wait() {
-  if (!isBusy) return;
-}
+void DivWorkThread::run() {
+  unsigned int spin=0;
 
-bool DivWorkThread::busy() {
-  return isBusy;
-}
+  logV("running work thread");
 
-void DivWorkThread::finish() {
-  lock.lock();
-  terminate=true;
-  try {
-    notify.set_value();
-  } catch (std::future_error& e) {
-    logE("future error! beware!");
+  while (!parent->terminate) {
+    if (parent->runOne(index)) {
+      spin=0;
+      continue;
+    }
+    if (++spin<DIV_WORK_SPIN_COUNT) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // nothing to do. go to sleep until more work arrives.
+    // the epoch is read before checking the queues one last time, so that a
+    // push happening in between is not missed.
+    unsigned int e=parent->epoch;
+    if (parent->runOne(index)) {
+      spin=0;
+      continue;
+    }
+    std::unique_lock<std::mutex> unique(parent->parkLock);
+    parent->parked++;
+    while (parent->epoch==e && !parent->terminate) {
+      parent->parkCond.wait(unique);
+    }
+    parent->parked--;
+    spin=0;
   }
-  lock.unlock();
-  thread->join();
 }
 
-bool DivWorkThread::init(DivWorkPool* p) {
+bool DivWorkThread::init(DivWorkPool* p, unsigned int i) {
   parent=p;
+  index=i;
   try {
     thread=new std::thread(_workThread,this);
   } catch (std::system_error& e) {
@@ -116,6 +108,51 @@ bool DivWorkThread::init(DivWorkPool* p) {
   return true;
 }
 
+bool DivWorkPool::runOne(unsigned int first) {
+  DivPendingTask task;
+  if (!threaded) return false;
+  for (unsigned int i=0; i<count; i++) {
+    unsigned int which=first+i;
+    if (which>=count) which-=count;
+    if (workThreads[which].tasks.take(task)) {
+      if (noAlloc) divNoAllocBegin();
+      task.func(task.funcArg);
+      if (noAlloc) divNoAllocEnd();
+
+      int busyCountNow=--busyCount;
+      if (busyCountNow<0) {
+        logE("DivWorkPool: busy count is negative!");
+      }
+      if (busyCountNow==0 && waiterParked) {
+        std::lock_guard<std::mutex> lockGuard(parkLock);
+        doneCond.notify_one();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DivWorkPool::enqueue(void (*what)(void*), void* arg) {
+  // count the task before it becomes visible, so that busyCount never
+  // drops below zero
+  busyCount++;
+  for (unsigned int tryCount=0; tryCount<count; tryCount++) {
+    if (pos>=count) pos=0;
+    if (workThreads[pos++].tasks.put(what,arg)) return true;
+  }
+  busyCount--;
+  return false;
+}
+
+void DivWorkPool::wake() {
+  epoch++;
+  if (parked>0) {
+    std::lock_guard<std::mutex> lockGuard(parkLock);
+    parkCond.notify_all();
+  }
+}
+
 void DivWorkPool::push(void (*what)(void*), void* arg) {
   // if no work threads, just execute
   if (!threaded) {
@@ -123,66 +160,82 @@ void DivWorkPool::push(void (*what)(void*), void* arg) {
     return;
   }
 
-  for (unsigned int tryCount=0; tryCount<count; tryCount++) {
-    if (pos>=count) pos=0;
-    if (workThreads[pos++].assign(what,arg)) return;
+  if (!enqueue(what,arg)) {
+    // all queues are full
+    logW("DivWorkPool: all work threads busy!");
+    what(arg);
+    return;
   }
+  wake();
+}
 
-  // all threads are busy
-  logW("DivWorkPool: all work threads busy!");
-  what(arg);
+void DivWorkPool::pushBatch(void (*what)(void*), void* args, size_t stride, size_t num) {
+  unsigned char* arg=(unsigned char*)args;
+  if (!threaded) {
+    for (size_t i=0; i<num; i++) {
+      what(arg+i*stride);
+    }
+    return;
+  }
+
+  bool queued=false;
+  for (size_t i=0; i<num; i++) {
+    if (enqueue(what,arg+i*stride)) {
+      queued=true;
+    } else {
+      logW("DivWorkPool: all work threads busy!");
+      what(arg+i*stride);
+    }
+  }
+  if (queued) wake();
 }
 
 bool DivWorkPool::busy() {
   if (!threaded) return false;
-  for (unsigned int i=0; i<count; i++) {
-    if (workThreads[i].busy()) return true;
-  }
-  return false;
+  return busyCount>0;
 }
 
 void DivWorkPool::wait() {
   if (!threaded) return;
 
-  if (busyCount==0) {
-    return;
-  }
-
-  std::future<void> future=notify.get_future();
+  unsigned int spin=0;
+  while (busyCount>0) {
+    // help out
+    if (runOne(0)) {
+      spin=0;
+      continue;
+    }
+    if (++spin<DIV_WORK_SPIN_COUNT) {
+      std::this_thread::yield();
+      continue;
+    }
 
-  // start running
-  for (unsigned int i=0; i<count; i++) {
-    if (!workThreads[i].promiseAlreadySet && !workThreads[i].tasks.empty()) {
-      try {
-        workThreads[i].lock.lock();
-        workThreads[i].promiseAlreadySet=true;
-        workThreads[i].notify.set_value();
-        workThreads[i].lock.unlock();
-      } catch (std::exception& e) {
-        logE("ERROR IN THREAD SYNC! %s",e.what());
-        abort();
-      }
+    // the remaining tasks are running. sleep until they finish.
+    std::unique_lock<std::mutex> unique(parkLock);
+    waiterParked=true;
+    while (busyCount>0) {
+      doneCond.wait(unique);
     }
+    waiterParked=false;
   }
-  //std::this_thread::yield();
-
-  // wait
-  future.wait();
-
-  notify=std::promise<void>();
 
   pos=0;
 }
 
-DivWorkPool::DivWorkPool(unsigned int threads):
+DivWorkPool::DivWorkPool(unsigned int threads, bool na):
   threaded(threads>0),
+  noAlloc(na),
   count(threads),
   pos(0),
+  epoch(0),
+  parked(0),
+  waiterParked(false),
+  terminate(false),
   busyCount(0) {
   if (threaded) {
     workThreads=new DivWorkThread[threads];
     for (unsigned int i=0; i<count; i++) {
-      if (!workThreads[i].init(this)) { 
+      if (!workThreads[i].init(this,i)) { 
         count=i;
         break;
       }
@@ -201,8 +254,17 @@ DivWorkPool::DivWorkPool(unsigned int threads):
 DivWorkPool::~DivWorkPool() {
   if (threaded) {
     if (workThreads!=NULL) {
+      wait();
+      {
+        std::lock_guard<std::mutex> lockGuard(parkLock);
+        terminate=true;
+        parkCond.notify_all();
+      }
       for (unsigned int i=0; i<count; i++) {
-        workThreads[i].finish();
+        if (workThreads[i].thread!=NULL) {
+          workThreads[i].thread->join();
+          delete workThreads[i].thread;
+        }
       }
       delete[] workThreads;
     }
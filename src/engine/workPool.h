@@ -22,10 +22,13 @@
 
 #include <thread>
 #include <atomic>
-#include <functional>
-#include <future>
+#include <mutex>
+#include <condition_variable>
 
-#include "../fixedQueue.h"
+// must be a power of two
+#define DIV_WORK_QUEUE_SIZE 256
+// number of times an idle thread checks for work before going to sleep
+#define DIV_WORK_SPIN_COUNT 256
 
 class DivWorkPool;
 
@@ -40,48 +43,103 @@ struct DivPendingTask {
     funcArg(NULL) {}
 };
 
+/**
+ * lock-free task queue owned by a work thread.
+ * only one thread (the one submitting jobs to the pool) may put tasks in it,
+ * but any thread may take them out (this is how work stealing happens).
+ */
+struct DivWorkQueue {
+  std::atomic<unsigned int> head;
+  std::atomic<unsigned int> tail;
+  std::atomic<void (*)(void*)> func[DIV_WORK_QUEUE_SIZE];
+  std::atomic<void*> funcArg[DIV_WORK_QUEUE_SIZE];
+
+  /**
+   * add a task. returns false if the queue is full.
+   */
+  bool put(void (*what)(void*), void* arg);
+
+  /**
+   * take the oldest task. returns false if the queue is empty.
+   */
+  bool take(DivPendingTask& task);
+
+  /**
+   * get the number of tasks in this queue.
+   */
+  unsigned int size();
+
+  DivWorkQueue():
+    head(0),
+    tail(0) {}
+};
+
 struct DivWorkThread {
   DivWorkPool* parent;
-  std::mutex lock;
   std::thread* thread;
-  std::promise<void> notify;
-  FixedQueue<DivPendingTask,32> tasks;
-  std::atomic<bool> isBusy;
-  bool terminate;
-  bool promiseAlreadySet;
+  DivWorkQueue tasks;
+  unsigned int index;
 
   void run();
-  bool assign(void (*what)(void*), void* arg);
-  void wait();
-  bool busy();
-  void finish();
-
-  bool init(DivWorkPool* p);
+  bool init(DivWorkPool* p, unsigned int i);
   DivWorkThread():
     parent(NULL),
-    isBusy(false),
-    terminate(false),
-    promiseAlreadySet(false) {}
+    thread(NULL),
+    index(0) {}
 };
 
 /**
  * this class provides an implementation of a "thread pool" for executing tasks in parallel.
  * it is highly recommended to use `new` when allocating a DivWorkPool.
+ *
+ * tasks are distributed round-robin among the work threads. an idle thread will
+ * steal tasks from the others, and the thread calling wait() runs tasks too.
+ * push(), pushBatch() and wait() must be called from a single thread.
  */
 class DivWorkPool {
   bool threaded;
+  // run tasks in a no-allocation section (see divNoAllocBegin())
+  bool noAlloc;
   unsigned int count;
   unsigned int pos;
   DivWorkThread* workThreads;
+
+  // sleeping
+  std::mutex parkLock;
+  std::condition_variable parkCond;
+  std::condition_variable doneCond;
+  std::atomic<unsigned int> epoch;
+  std::atomic<int> parked;
+  std::atomic<bool> waiterParked;
+  std::atomic<bool> terminate;
+
+  // put a task in the next free queue. returns false if all of them are full.
+  bool enqueue(void (*what)(void*), void* arg);
+  // wake up sleeping work threads after tasks have been queued.
+  void wake();
+
+  friend struct DivWorkThread;
   public:
-    std::promise<void> notify;
     std::atomic<int> busyCount;
+
+    /**
+     * run one pending task (starting with the queue of work thread `first`).
+     * returns false if there is nothing to run.
+     */
+    bool runOne(unsigned int first);
     
     /**
      * push a new job to this work pool.
-     * if all work threads are busy, this will block until one is free.
+     * if all queues are full, the job is executed immediately.
      */
     void push(void (*what)(void*), void* arg);
+
+    /**
+     * push several jobs at once (one per element of an array).
+     * the job for element i gets `(char*)args+i*stride` as argument.
+     * work threads are only woken up once, after all jobs have been queued.
+     */
+    void pushBatch(void (*what)(void*), void* args, size_t stride, size_t num);
     
     /**
      * check whether this work pool is busy.
@@ -89,11 +147,16 @@ class DivWorkPool {
     bool busy();
 
     /**
-     * wait for all work threads to finish.
+     * wait for all jobs to finish.
+     * the calling thread will help with pending jobs in the meantime.
      */
     void wait();
 
-    DivWorkPool(unsigned int threads=0);
+    /**
+     * create a work pool.
+     * if noAlloc is true, allocating memory in a task aborts when built with DIV_DEBUG_ALLOC.
+     */
+    DivWorkPool(unsigned int threads=0, bool noAlloc=false);
     ~DivWorkPool();
 };
 
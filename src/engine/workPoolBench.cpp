@@ -0,0 +1,252 @@
+/**
+ * Furnace Tracker - multi-system chiptune tracker
+ * Copyright (C) 2021-2024 tildearrow and contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// -benchmark pool: the work pool against the one it replaced.
+
+#include "engine.h"
+#include "workPool.h"
+#include "../fixedQueue.h"
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#define POOL_BENCH_JOBS 8
+#define POOL_BENCH_ROUNDS 20000
+
+struct DivPoolBenchJob {
+  unsigned int seed;
+  unsigned int result;
+};
+
+static void _poolBenchJob(void* j) {
+  DivPoolBenchJob* job=(DivPoolBenchJob*)j;
+  // roughly the cost of a small chip acquire() call
+  unsigned int x=job->seed;
+  for (int i=0; i<2000; i++) {
+    x=x*1103515245+12345;
+  }
+  job->result=x;
+}
+
+// the previous work pool (one mutex-protected queue per thread, woken up
+// through a new std::promise on every wait()), kept as a baseline for
+// -benchmark pool.
+struct DivPoolBenchLegacy;
+
+struct DivPoolBenchLegacyThread {
+  DivPoolBenchLegacy* parent;
+  std::mutex lock;
+  std::thread* thread;
+  std::promise<void> notify;
+  FixedQueue<DivPendingTask,32> tasks;
+  bool terminate;
+  bool promiseAlreadySet;
+
+  void run();
+  DivPoolBenchLegacyThread():
+    parent(NULL),
+    thread(NULL),
+    terminate(false),
+    promiseAlreadySet(false) {}
+};
+
+struct DivPoolBenchLegacy {
+  unsigned int count;
+  unsigned int pos;
+  DivPoolBenchLegacyThread* workThreads;
+  std::promise<void> notify;
+  std::atomic<int> busyCount;
+
+  void push(void (*what)(void*), void* arg);
+  void wait();
+  DivPoolBenchLegacy(unsigned int threads);
+  ~DivPoolBenchLegacy();
+};
+
+void DivPoolBenchLegacyThread::run() {
+  DivPendingTask task;
+  bool setPromise=false;
+  while (true) {
+    lock.lock();
+    if (tasks.empty()) {
+      lock.unlock();
+      if (setPromise) {
+        // the old pool could reach zero twice in a round if a thread was still awake
+        try {
+          parent->notify.set_value();
+        } catch (std::future_error& e) {
+        }
+        setPromise=false;
+      }
+      if (terminate) break;
+      std::future<void> future=notify.get_future();
+      future.wait();
+      lock.lock();
+      notify=std::promise<void>();
+      promiseAlreadySet=false;
+      lock.unlock();
+      continue;
+    }
+    task=tasks.front();
+    tasks.pop();
+    lock.unlock();
+
+    task.func(task.funcArg);
+    if (--parent->busyCount==0) setPromise=true;
+  }
+}
+
+void DivPoolBenchLegacy::push(void (*what)(void*), void* arg) {
+  if (count==0) {
+    what(arg);
+    return;
+  }
+  for (unsigned int tryCount=0; tryCount<count; tryCount++) {
+    if (pos>=count) pos=0;
+    DivPoolBenchLegacyThread& t=workThreads[pos++];
+    t.lock.lock();
+    if (t.tasks.size()<30) {
+      t.tasks.push(DivPendingTask(what,arg));
+      busyCount++;
+      t.lock.unlock();
+      return;
+    }
+    t.lock.unlock();
+  }
+  what(arg);
+}
+
+void DivPoolBenchLegacy::wait() {
+  if (count==0 || busyCount==0) return;
+  std::future<void> future=notify.get_future();
+  for (unsigned int i=0; i<count; i++) {
+    workThreads[i].lock.lock();
+    if (!workThreads[i].promiseAlreadySet && !workThreads[i].tasks.empty()) {
+      workThreads[i].promiseAlreadySet=true;
+      workThreads[i].notify.set_value();
+    }
+    workThreads[i].lock.unlock();
+  }
+  future.wait();
+  notify=std::promise<void>();
+  pos=0;
+}
+
+DivPoolBenchLegacy::DivPoolBenchLegacy(unsigned int threads):
+  count(threads),
+  pos(0),
+  workThreads(NULL),
+  busyCount(0) {
+  if (count==0) return;
+  workThreads=new DivPoolBenchLegacyThread[count];
+  for (unsigned int i=0; i<count; i++) {
+    workThreads[i].parent=this;
+    workThreads[i].thread=new std::thread(&DivPoolBenchLegacyThread::run,&workThreads[i]);
+  }
+}
+
+DivPoolBenchLegacy::~DivPoolBenchLegacy() {
+  for (unsigned int i=0; i<count; i++) {
+    workThreads[i].lock.lock();
+    workThreads[i].terminate=true;
+    if (!workThreads[i].promiseAlreadySet) {
+      workThreads[i].promiseAlreadySet=true;
+      workThreads[i].notify.set_value();
+    }
+    workThreads[i].lock.unlock();
+    workThreads[i].thread->join();
+    delete workThreads[i].thread;
+  }
+  if (workThreads!=NULL) delete[] workThreads;
+}
+
+double DivEngine::benchmarkPool() {
+  DivPoolBenchJob jobs[POOL_BENCH_JOBS];
+  unsigned int threadCounts[4]={0,2,4,std::thread::hardware_concurrency()};
+  double ret=0;
+
+  for (int i=0; i<POOL_BENCH_JOBS; i++) {
+    jobs[i].seed=i;
+    jobs[i].result=0;
+  }
+
+  for (int i=0; i<4; i++) {
+    if (i==3 && (threadCounts[3]<=4 || threadCounts[3]>DIV_MAX_CHIPS)) break;
+    // baseline: the previous pool
+    DivPoolBenchLegacy* legacy=new DivPoolBenchLegacy(threadCounts[i]);
+    std::chrono::high_resolution_clock::time_point timeStart=std::chrono::high_resolution_clock::now();
+    for (int j=0; j<POOL_BENCH_ROUNDS; j++) {
+      for (int k=0; k<POOL_BENCH_JOBS; k++) {
+        legacy->push(_poolBenchJob,&jobs[k]);
+      }
+      legacy->wait();
+    }
+    std::chrono::high_resolution_clock::time_point timeEnd=std::chrono::high_resolution_clock::now();
+    double tOldPush=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/(1000.0*POOL_BENCH_ROUNDS);
+
+    timeStart=std::chrono::high_resolution_clock::now();
+    for (int j=0; j<POOL_BENCH_ROUNDS; j++) {
+      for (int k=0; k<POOL_BENCH_JOBS; k++) {
+        legacy->push([](void*) {},&jobs[k]);
+      }
+      legacy->wait();
+    }
+    timeEnd=std::chrono::high_resolution_clock::now();
+    double tOldEmpty=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/(1000.0*POOL_BENCH_ROUNDS);
+    delete legacy;
+
+    DivWorkPool* pool=new DivWorkPool(threadCounts[i]);
+
+    // one job at a time (like nextBuf used to do)
+    timeStart=std::chrono::high_resolution_clock::now();
+    for (int j=0; j<POOL_BENCH_ROUNDS; j++) {
+      for (int k=0; k<POOL_BENCH_JOBS; k++) {
+        pool->push(_poolBenchJob,&jobs[k]);
+      }
+      pool->wait();
+    }
+    timeEnd=std::chrono::high_resolution_clock::now();
+    double tPush=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/(1000.0*POOL_BENCH_ROUNDS);
+
+    // batch
+    timeStart=std::chrono::high_resolution_clock::now();
+    for (int j=0; j<POOL_BENCH_ROUNDS; j++) {
+      pool->pushBatch(_poolBenchJob,jobs,sizeof(DivPoolBenchJob),POOL_BENCH_JOBS);
+      pool->wait();
+    }
+    timeEnd=std::chrono::high_resolution_clock::now();
+    double tBatch=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/(1000.0*POOL_BENCH_ROUNDS);
+
+    // empty round trip (synchronization cost only)
+    timeStart=std::chrono::high_resolution_clock::now();
+    for (int j=0; j<POOL_BENCH_ROUNDS; j++) {
+      pool->pushBatch([](void*) {},jobs,sizeof(DivPoolBenchJob),POOL_BENCH_JOBS);
+      pool->wait();
+    }
+    timeEnd=std::chrono::high_resolution_clock::now();
+    double tEmpty=(double)(std::chrono::duration_cast<std::chrono::nanoseconds>(timeEnd-timeStart).count())/(1000.0*POOL_BENCH_ROUNDS);
+
+    delete pool;
+
+    printf("[RESULT] %d threads: old pool: push %fus empty %fus - new pool: push %fus batch %fus empty %fus per round (%d jobs)\n",threadCounts[i],tOldPush,tOldEmpty,tPush,tBatch,tEmpty,POOL_BENCH_JOBS);
+    if (i==0) ret=tBatch;
+  }
+  return ret;
+}
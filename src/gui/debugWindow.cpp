@@ -736,6 +736,7 @@ void FurnaceGUI::drawDebug() {
     if (ImGui::TreeNode("Performance")) {
       double perfFreq=SDL_GetPerformanceFrequency()/1000000.0;
       int lastProcTime=(int)e->processTime/1000;
+      int lastMixTime=(int)e->processTimeMix/1000;
       TAAudioDesc& audioGot=e->getAudioDescGot();
 
       ImGui::Text("video frame: %.0fµs",ImGui::GetIO().DeltaTime*1000000.0);
@@ -743,6 +744,8 @@ void FurnaceGUI::drawDebug() {
       ImGui::Separator();
 
       ImGui::Text("audio: %dµs",lastProcTime);
+      ImGui::Text("- chips: %dµs",lastProcTime-lastMixTime);
+      ImGui::Text("- mix: %dµs",lastMixTime);
       ImGui::Text("render: %.0fµs",(double)renderTimeDelta/perfFreq);
       ImGui::Text("draw: %.0fµs",(double)drawTimeDelta/perfFreq);
       ImGui::Text("swap: %.0fµs",(double)swapTimeDelta/perfFreq);
@@ -754,6 +757,53 @@ void FurnaceGUI::drawDebug() {
       for (int i=0; i<perfMetricsLastLen; i++) {
         ImGui::Text("%s: %.0fµs",perfMetricsLast[i].name,(double)perfMetricsLast[i].elapsed/perfFreq);
       }
+      ImGui::Separator();
+
+      bool profiling=e->getProfiling();
+      if (ImGui::Checkbox("Measure audio phases",&profiling)) e->setProfiling(profiling);
+      ImGui::Text("audio (last %d buffers):",DIV_PERF_HISTORY);
+      ImGui::SameLine();
+      if (ImGui::SmallButton("Reset")) e->resetPerfStats();
+      if (ImGui::BeginTable("AudioPerfTable",4,ImGuiTableFlags_Borders)) {
+        ImGui::TableNextRow(ImGuiTableRowFlags_Headers);
+        ImGui::TableNextColumn();
+        ImGui::Text("phase");
+        ImGui::TableNextColumn();
+        ImGui::Text("min");
+        ImGui::TableNextColumn();
+        ImGui::Text("avg");
+        ImGui::TableNextColumn();
+        ImGui::Text("p99");
+
+        for (int i=0; i<DIV_PERF_MAX; i++) {
+          DivPerfStats stats=e->getPerfStats((DivPerfPhases)i);
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::Text("%s",getPerfPhaseName((DivPerfPhases)i));
+          ImGui::TableNextColumn();
+          ImGui::Text("%.1fµs",stats.min/1000.0);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.1fµs",stats.avg/1000.0);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.1fµs",stats.p99/1000.0);
+        }
+        for (int i=0; i<e->song.systemLen; i++) {
+          for (int j=0; j<2; j++) {
+            DivPerfPhases phase=j?DIV_PERF_FILLBUF:DIV_PERF_ACQUIRE;
+            DivPerfStats stats=e->getPerfStats(phase,i);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%d: %s (%s)",i,getSystemName(e->song.system[i]),getPerfPhaseName(phase));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1fµs",stats.min/1000.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1fµs",stats.avg/1000.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1fµs",stats.p99/1000.0);
+          }
+        }
+        ImGui::EndTable();
+      }
       ImGui::TreePop();
     }
     if (ImGui::TreeNode("Settings")) {
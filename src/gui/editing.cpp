@@ -109,7 +109,15 @@ void FurnaceGUI::prepareUndo(ActionType action, UndoRegion region) {
             p=it->second;
           }
 
-          e->curPat[i].getPattern(e->curOrders->ord[i][h],false)->copyOn(p);
+          // only the blocks within the region are copied
+          int jBegin=0;
+          int jEnd=e->curSubSong->patLen-1;
+
+          if (h==region.begin.ord) jBegin=region.begin.y;
+          if (h==region.end.ord) jEnd=region.end.y;
+
+          const DivPattern* src=e->curPat[i].getPattern(e->curOrders->ord[i][h],false);
+          src->data.copyRowsOn(p->data,jBegin,jEnd);
         }
       }
       break;
@@ -191,8 +199,8 @@ void FurnaceGUI::makeUndo(ActionType action, UndoRegion region) {
     case GUI_UNDO_PATTERN_DRAG:
       for (int h=region.begin.ord; h<=region.end.ord; h++) {
         for (int i=region.begin.x; i<=region.end.x; i++) {
-          DivPattern* p=e->curPat[i].getPattern(e->curOrders->ord[i][h],false);
-          DivPattern* op=NULL;
+          const DivPattern* p=e->curPat[i].getPattern(e->curOrders->ord[i][h],false);
+          const DivPattern* op=NULL;
           unsigned short id=h|(i<<8);
 
           auto it=oldPatMap.find(id);
@@ -210,6 +218,8 @@ void FurnaceGUI::makeUndo(ActionType action, UndoRegion region) {
           if (h==region.end.ord) jEnd=region.end.y;
 
           for (int j=jBegin; j<=jEnd; j++) {
+            // skip unchanged rows
+            if (memcmp(p->data[j],op->data[j],DIV_MAX_COLS*sizeof(short))==0) continue;
             for (int k=0; k<DIV_MAX_COLS; k++) {
               if (p->data[j][k]!=op->data[j][k]) {
                 s.pat.push_back(UndoPatternData(subSong,i,e->curOrders->ord[i][h],j,k,op->data[j][k],p->data[j][k]));
@@ -242,9 +252,7 @@ void FurnaceGUI::makeUndo(ActionType action, UndoRegion region) {
   }
   if (doPush) {
     MARK_MODIFIED;
-    undoHist.push_back(s);
-    redoHist.clear();
-    if (undoHist.size()>settings.maxUndoSteps) undoHist.pop_front();
+    pushUndo(s);
   }
   if (shallWalk) {
     e->walkSong(loopOrder,loopRow,loopEnd);
@@ -257,6 +265,52 @@ void FurnaceGUI::makeUndo(ActionType action, UndoRegion region) {
   oldPatMap.clear();
 }
 
+void FurnaceGUI::pushUndo(UndoStep& s) {
+  s.ord.shrink_to_fit();
+  s.pat.shrink_to_fit();
+  s.other.shrink_to_fit();
+
+  for (UndoStep& i: redoHist) {
+    undoHistMem-=i.getMemUsage();
+  }
+  redoHist.clear();
+
+  undoHistMem+=s.getMemUsage();
+  undoHist.push_back(std::move(s));
+
+  // drop the oldest steps when over the limits (but always keep the last one)
+  while (undoHist.size()>1 && (undoHist.size()>settings.maxUndoSteps || undoHistMem>settings.maxUndoMemory)) {
+    undoHistMem-=undoHist.front().getMemUsage();
+    undoHist.pop_front();
+  }
+}
+
+void FurnaceGUI::clearUndoHist() {
+  undoHist.clear();
+  redoHist.clear();
+  undoHistMem=0;
+}
+
+void FurnaceGUI::applyUndoPatternData(const std::vector<UndoPatternData>& data, bool redo) {
+  DivPattern* p=NULL;
+  int lastSubSong=-1;
+  int lastChan=-1;
+  int lastPat=-1;
+  for (const UndoPatternData& i: data) {
+    if (i.subSong!=lastSubSong) {
+      e->changeSongP(i.subSong);
+      lastSubSong=i.subSong;
+      p=NULL;
+    }
+    if (p==NULL || i.chan!=lastChan || i.pat!=lastPat) {
+      p=e->curPat[i.chan].getPattern(i.pat,true);
+      lastChan=i.chan;
+      lastPat=i.pat;
+    }
+    p->data[i.row][i.col]=redo?i.newVal:i.oldVal;
+  }
+}
+
 void FurnaceGUI::doSelectAll() {
   finishSelection();
   curNibble=false;
@@ -1685,7 +1739,7 @@ void FurnaceGUI::doCollapseSong(int divider) {
       pat->copyOn(&patCopy);
       pat->clear();
       for (int k=0; k<DIV_MAX_ROWS; k++) {
-        for (int l=0; l<DIV_MAX_COLS; l++) {
+        for (int l=0; l<DIV_MAX_COLS-1; l++) {
           if (l==0) {
             if (!(pat->data[k/divider][0]==0 && pat->data[k/divider][1]==0)) continue;
           } else {
@@ -1711,10 +1765,12 @@ void FurnaceGUI::doCollapseSong(int divider) {
       }
 
       // put undo
+      const DivPattern* newPat=pat;
+      const DivPattern* oldPat=&patCopy;
       for (int k=0; k<DIV_MAX_ROWS; k++) {
         for (int l=0; l<DIV_MAX_COLS; l++) {
-          if (pat->data[k][l]!=patCopy.data[k][l]) {
-            us.pat.push_back(UndoPatternData(subSong,i,j,k,l,patCopy.data[k][l],pat->data[k][l]));
+          if (newPat->data[k][l]!=oldPat->data[k][l]) {
+            us.pat.push_back(UndoPatternData(subSong,i,j,k,l,oldPat->data[k][l],newPat->data[k][l]));
           }
         }
       }
@@ -1735,9 +1791,7 @@ void FurnaceGUI::doCollapseSong(int divider) {
   }
 
   if (!us.pat.empty()) {
-    undoHist.push_back(us);
-    redoHist.clear();
-    if (undoHist.size()>settings.maxUndoSteps) undoHist.pop_front();
+    pushUndo(us);
   }
   
   if (e->isPlaying()) e->play();
@@ -1765,7 +1819,7 @@ void FurnaceGUI::doExpandSong(int multiplier) {
       pat->copyOn(&patCopy);
       pat->clear();
       for (int k=0; k<(256/multiplier); k++) {
-        for (int l=0; l<DIV_MAX_COLS; l++) {
+        for (int l=0; l<DIV_MAX_COLS-1; l++) {
           if (l==0) {
             if (!(pat->data[k*multiplier][0]==0 && pat->data[k*multiplier][1]==0)) continue;
           } else {
@@ -1791,10 +1845,12 @@ void FurnaceGUI::doExpandSong(int multiplier) {
       }
 
       // put undo
+      const DivPattern* newPat=pat;
+      const DivPattern* oldPat=&patCopy;
       for (int k=0; k<DIV_MAX_ROWS; k++) {
         for (int l=0; l<DIV_MAX_COLS; l++) {
-          if (pat->data[k][l]!=patCopy.data[k][l]) {
-            us.pat.push_back(UndoPatternData(subSong,i,j,k,l,patCopy.data[k][l],pat->data[k][l]));
+          if (newPat->data[k][l]!=oldPat->data[k][l]) {
+            us.pat.push_back(UndoPatternData(subSong,i,j,k,l,oldPat->data[k][l],newPat->data[k][l]));
           }
         }
       }
@@ -1815,9 +1871,7 @@ void FurnaceGUI::doExpandSong(int multiplier) {
   }
 
   if (!us.pat.empty()) {
-    undoHist.push_back(us);
-    redoHist.clear();
-    if (undoHist.size()>settings.maxUndoSteps) undoHist.pop_front();
+    pushUndo(us);
   }
 
   if (e->isPlaying()) e->play();
@@ -1863,8 +1917,9 @@ void FurnaceGUI::moveSelected(int x, int y) {
 
 void FurnaceGUI::doUndo() {
   if (undoHist.empty()) return;
-  UndoStep& us=undoHist.back();
-  redoHist.push_back(us);
+  redoHist.push_back(std::move(undoHist.back()));
+  undoHist.pop_back();
+  UndoStep& us=redoHist.back();
   MARK_MODIFIED;
 
   switch (us.type) {
@@ -1894,11 +1949,7 @@ void FurnaceGUI::doUndo() {
     case GUI_UNDO_PATTERN_EXPAND_SONG:
     case GUI_UNDO_PATTERN_DRAG:
     case GUI_UNDO_REPLACE:
-      for (UndoPatternData& i: us.pat) {
-        e->changeSongP(i.subSong);
-        DivPattern* p=e->curPat[i.chan].getPattern(i.pat,true);
-        p->data[i.row][i.col]=i.oldVal;
-      }
+      applyUndoPatternData(us.pat,false);
       if (us.type!=GUI_UNDO_REPLACE) {
         if (!e->isPlaying() || !followPattern) {
           cursor=us.cursor;
@@ -1933,14 +1984,13 @@ void FurnaceGUI::doUndo() {
     curOrder=e->curSubSong->ordersLen-1;
     e->setOrder(curOrder);
   }
-
-  undoHist.pop_back();
 }
 
 void FurnaceGUI::doRedo() {
   if (redoHist.empty()) return;
-  UndoStep& us=redoHist.back();
-  undoHist.push_back(us);
+  undoHist.push_back(std::move(redoHist.back()));
+  redoHist.pop_back();
+  UndoStep& us=undoHist.back();
   MARK_MODIFIED;
 
   switch (us.type) {
@@ -1970,11 +2020,7 @@ void FurnaceGUI::doRedo() {
     case GUI_UNDO_PATTERN_COLLAPSE_SONG:
     case GUI_UNDO_PATTERN_EXPAND_SONG:
     case GUI_UNDO_REPLACE:
-      for (UndoPatternData& i: us.pat) {
-        e->changeSongP(i.subSong);
-        DivPattern* p=e->curPat[i.chan].getPattern(i.pat,true);
-        p->data[i.row][i.col]=i.newVal;
-      }
+      applyUndoPatternData(us.pat,true);
       if (us.type!=GUI_UNDO_REPLACE) {
         if (!e->isPlaying() || !followPattern) {
           cursor=us.cursor;
@@ -2009,6 +2055,4 @@ void FurnaceGUI::doRedo() {
     curOrder=e->curSubSong->ordersLen-1;
     e->setOrder(curOrder);
   }
-
-  redoHist.pop_back();
 }
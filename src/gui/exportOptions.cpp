@@ -73,6 +73,14 @@ void FurnaceGUI::drawExportAudio(bool onWindow) {
 
   bool isOneOn=false;
   if (audioExportOptions.mode==DIV_EXPORT_MODE_MANY_CHAN) {
+    if (ImGui::InputInt(_("Threads"),&audioExportOptions.threads,1,1)) {
+      if (audioExportOptions.threads<0) audioExportOptions.threads=0;
+      if (audioExportOptions.threads>64) audioExportOptions.threads=64;
+    }
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip(_("number of channels to render at once.\n0 uses one thread per core."));
+    }
+
     ImGui::Text(_("Channels to export:"));
     ImGui::SameLine();
     if (ImGui::SmallButton(_("All"))) {
@@ -188,6 +196,15 @@ void FurnaceGUI::drawExportVGM(bool onWindow) {
       "at the cost of a massive increase in file size."
     ));
   }
+  ImGui::Checkbox(_("optimize register writes"),&vgmExportOptimize);
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip(_(
+      "removes register writes which don't change anything, merges waits\n"
+      "and stores identical samples only once.\n"
+      "the file sounds the same but is smaller and faster to play."
+    ));
+  }
+  ImGui::Checkbox(_("compress (.vgz)"),&vgmExportCompress);
   ImGui::Text(_("chips to export:"));
   bool hasOneAtLeast=false;
   for (int i=0; i<e->song.systemLen; i++) {
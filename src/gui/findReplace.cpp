@@ -124,7 +124,7 @@ void FurnaceGUI::doFind() {
   for (int i=firstOrder; i<=lastOrder; i++) {
     for (int j=firstRow; j<=lastRow; j++) {
       for (int k=firstChan; k<=lastChan; k++) {
-        DivPattern* p=e->curPat[k].getPattern(e->curOrders->ord[k][i],false);
+        const DivPattern* p=e->curPat[k].getPattern(e->curOrders->ord[k][i],false);
         bool matched=false;
         memset(effectPos,-1,8);
         for (FurnaceGUIFindQuery& l: curQuery) {
@@ -492,9 +492,7 @@ void FurnaceGUI::doReplace() {
   }
 
   if (!us.pat.empty()) {
-    undoHist.push_back(us);
-    redoHist.clear();
-    if (undoHist.size()>settings.maxUndoSteps) undoHist.pop_front();
+    pushUndo(us);
   }
 }
 
@@ -59,6 +59,9 @@
 #define BACKUPS_DIR "/backups"
 #endif
 
+// a backup journal is started again once it holds this much more than twice the song
+#define BACKUP_JOURNAL_SLACK (4<<20)
+
 #ifdef IS_MOBILE
 #define MOBILE_UI_DEFAULT true
 #else
@@ -1682,7 +1685,7 @@ void FurnaceGUI::openFileDialog(FurnaceGUIFileDialogs type) {
       }
       hasOpened=fileDialog->openLoad(
         _("Restore Backup"),
-        {_("Furnace song"), "*.fur"},
+        {_("Furnace backup"), "*.furj *.fur"},
         backupPath+String(DIR_SEPARATOR_STR),
         dpiScale
       );
@@ -1759,7 +1762,9 @@ void FurnaceGUI::openFileDialog(FurnaceGUIFileDialogs type) {
                 prevIns=curIns;
               }
               if (prevIns>=0 && prevIns<=(int)e->song.ins.size()) {
-                *e->song.ins[prevIns]=*instruments[0];
+                e->lockEngine([this,&instruments]() {
+                  *e->song.ins[prevIns]=*instruments[0];
+                });
               }
             } else {
               e->loadTempIns(instruments[0]);
@@ -1908,13 +1913,23 @@ void FurnaceGUI::openFileDialog(FurnaceGUIFileDialogs type) {
       break;
     case GUI_FILE_EXPORT_VGM:
       if (!dirExists(workingDirVGMExport)) workingDirVGMExport=getHomeDir();
-      hasOpened=fileDialog->openSave(
-        _("Export VGM"),
-        {_("VGM file"), "*.vgm"},
-        workingDirVGMExport,
-        dpiScale,
-        (settings.autoFillSave)?shortName:""
-      );
+      if (vgmExportCompress) {
+        hasOpened=fileDialog->openSave(
+          _("Export VGM"),
+          {_("compressed VGM file"), "*.vgz"},
+          workingDirVGMExport,
+          dpiScale,
+          (settings.autoFillSave)?shortName:""
+        );
+      } else {
+        hasOpened=fileDialog->openSave(
+          _("Export VGM"),
+          {_("VGM file"), "*.vgm"},
+          workingDirVGMExport,
+          dpiScale,
+          (settings.autoFillSave)?shortName:""
+        );
+      }
       break;
     case GUI_FILE_EXPORT_ZSM:
       if (!dirExists(workingDirZSMExport)) workingDirZSMExport=getHomeDir();
@@ -2173,64 +2188,18 @@ int FurnaceGUI::save(String path, int dmfVersion) {
     return 1;
   }
   if (settings.compress) {
-    unsigned char zbuf[131072];
-    int ret;
-    z_stream zl;
-    memset(&zl,0,sizeof(z_stream));
-    ret=deflateInit(&zl,Z_DEFAULT_COMPRESSION);
-    if (ret!=Z_OK) {
-      logE("zlib error!");
+    int ret=w->writeCompressed(outFile,settings.compressLevel);
+    if (ret==2) {
       lastError=_("compression error");
       fclose(outFile);
       w->finish();
       return 2;
-    }
-    zl.avail_in=w->size();
-    zl.next_in=w->getFinalBuf();
-    while (zl.avail_in>0) {
-      zl.avail_out=131072;
-      zl.next_out=zbuf;
-      if ((ret=deflate(&zl,Z_NO_FLUSH))==Z_STREAM_ERROR) {
-        logE("zlib stream error!");
-        lastError=_("zlib stream error");
-        deflateEnd(&zl);
-        fclose(outFile);
-        w->finish();
-        return 2;
-      }
-      size_t amount=131072-zl.avail_out;
-      if (amount>0) {
-        if (fwrite(zbuf,1,amount,outFile)!=amount) {
-          logE("did not write entirely: %s!",strerror(errno));
-          lastError=strerror(errno);
-          deflateEnd(&zl);
-          fclose(outFile);
-          w->finish();
-          return 1;
-        }
-      }
-    }
-    zl.avail_out=131072;
-    zl.next_out=zbuf;
-    if ((ret=deflate(&zl,Z_FINISH))==Z_STREAM_ERROR) {
-      logE("zlib finish stream error!");
-      lastError=_("zlib finish stream error");
-      deflateEnd(&zl);
+    } else if (ret!=0) {
+      lastError=strerror(errno);
       fclose(outFile);
       w->finish();
-      return 2;
-    }
-    if (131072-zl.avail_out>0) {
-      if (fwrite(zbuf,1,131072-zl.avail_out,outFile)!=(131072-zl.avail_out)) {
-        logE("did not write entirely: %s!",strerror(errno));
-        lastError=strerror(errno);
-        deflateEnd(&zl);
-        fclose(outFile);
-        w->finish();
-        return 1;
-      }
+      return 1;
     }
-    deflateEnd(&zl);
   } else {
     if (fwrite(w->getFinalBuf(),1,w->size(),outFile)!=w->size()) {
       logE("did not write entirely: %s!",strerror(errno));
@@ -2258,6 +2227,8 @@ int FurnaceGUI::save(String path, int dmfVersion) {
 
 int FurnaceGUI::load(String path) {
   bool wasPlaying=e->isPlaying();
+  // e->load() discards a background load
+  if (asyncLoading) asyncLoadCancelled=true;
   if (!path.empty()) {
     logI("loading module...");
     FILE* f=ps_fopen(path.c_str(),"rb");
@@ -2311,6 +2282,29 @@ int FurnaceGUI::load(String path) {
       return 1;
     }
   }
+  postLoad(path,wasPlaying);
+  return 0;
+}
+
+int FurnaceGUI::loadAsync(String path) {
+  if (asyncLoading) {
+    lastError=_("a file is already being loaded");
+    return 1;
+  }
+  logI("loading module in the background...");
+  if (!e->loadAsync(path)) {
+    lastError=e->getLastError();
+    return 1;
+  }
+  asyncLoading=true;
+  asyncLoadCancelled=false;
+  asyncLoadWasPlaying=e->isPlaying();
+  asyncLoadPath=path;
+  displayLoading=true;
+  return 0;
+}
+
+void FurnaceGUI::postLoad(String path, bool wasPlaying) {
   backupLock.lock();
   curFileName=path;
   backupLock.unlock();
@@ -2326,8 +2320,7 @@ int FurnaceGUI::load(String path) {
   selEnd=SelectionPoint();
   cursor=SelectionPoint();
   lastError=_("everything OK");
-  undoHist.clear();
-  redoHist.clear();
+  clearUndoHist();
   updateWindowTitle();
   updateScroll(0);
   if (!e->getWarnings().empty()) {
@@ -2345,7 +2338,6 @@ int FurnaceGUI::load(String path) {
     // warn the user
     showWarning(_("you have loaded a backup!\nif you need to, please save it somewhere.\n\nDO NOT RELY ON THE BACKUP SYSTEM FOR AUTO-SAVE!\nFurnace will not save backups of backups."),GUI_WARN_GENERIC);
   }
-  return 0;
 }
 
 void FurnaceGUI::openRecentFile(String path) {
@@ -2353,7 +2345,7 @@ void FurnaceGUI::openRecentFile(String path) {
     nextFile=path;
     showWarning(_("Unsaved changes! Save changes before opening file?"),GUI_WARN_OPEN_DROP);
   } else {
-    if (load(path)>0) {
+    if (loadAsync(path)>0) {
       showError(fmt::sprintf(_("Error while loading file! (%s)"),lastError));
     }
   }
@@ -2385,7 +2377,7 @@ void FurnaceGUI::pushRecentSys(const char* path) {
 void FurnaceGUI::delFirstBackup(String name) {
   std::vector<String> listOfFiles;
 #ifdef _WIN32
-  String findPath=backupPath+String(DIR_SEPARATOR_STR)+name+String("*.fur");
+  String findPath=backupPath+String(DIR_SEPARATOR_STR)+name+String("*.fur*");
   WIN32_FIND_DATAW next;
   HANDLE backDir=FindFirstFileW(utf8To16(findPath.c_str()).c_str(),&next);
   if (backDir!=INVALID_HANDLE_VALUE) {
@@ -2656,6 +2648,9 @@ void FurnaceGUI::processDrags(int dragX, int dragY) {
           if (val>127) val=127;
           for (int i=x; i<=x1; i++) ((signed char*)sampleDragTarget)[i]=val;
         }
+        if (curSample>=0 && curSample<(int)e->song.sample.size()) {
+          e->song.sample[curSample]->invalidatePeaks(x,x1+1);
+        }
         updateSampleTex=true;
       }
     } else { // select
@@ -3754,7 +3749,7 @@ bool FurnaceGUI::loop() {
               nextFile=ev.drop.file;
               showWarning(_("Unsaved changes! Save changes before opening file?"),GUI_WARN_OPEN_DROP);
             } else {
-              if (load(ev.drop.file)>0) {
+              if (loadAsync(ev.drop.file)>0) {
                 showError(fmt::sprintf(_("Error while loading file! (%s)"),lastError));
               }
             }
@@ -4613,7 +4608,7 @@ bool FurnaceGUI::loop() {
         bool hasInfo=false;
         String info;
         if (cursor.xCoarse>=0 && cursor.xCoarse<e->getTotalChannelCount()) {
-          DivPattern* p=e->curPat[cursor.xCoarse].getPattern(e->curOrders->ord[cursor.xCoarse][curOrder],false);
+          const DivPattern* p=e->curPat[cursor.xCoarse].getPattern(e->curOrders->ord[cursor.xCoarse][curOrder],false);
           if (cursor.xFine>=0) switch (cursor.xFine) {
             case 0: // note
               if (p->data[cursor.y][0]>0) {
@@ -4854,7 +4849,9 @@ bool FurnaceGUI::loop() {
         if (curFileDialog==GUI_FILE_INS_OPEN_REPLACE) {
           if (prevInsData!=NULL) {
             if (prevIns>=0 && prevIns<(int)e->song.ins.size()) {
-              *e->song.ins[prevIns]=*prevInsData;
+              e->lockEngine([this]() {
+                *e->song.ins[prevIns]=*prevInsData;
+              });
             }
           }
         } else {
@@ -4998,7 +4995,7 @@ bool FurnaceGUI::loop() {
             checkExtension(".raw");
           }
           if (curFileDialog==GUI_FILE_EXPORT_VGM) {
-            checkExtension(".vgm");
+            checkExtension(vgmExportCompress?".vgz":".vgm");
           }
           if (curFileDialog==GUI_FILE_EXPORT_ZSM) {
             checkExtension(".zsm");
@@ -5028,7 +5025,7 @@ bool FurnaceGUI::loop() {
           switch (curFileDialog) {
             case GUI_FILE_OPEN:
             case GUI_FILE_OPEN_BACKUP:
-              if (load(copyOfName)>0) {
+              if (loadAsync(copyOfName)>0) {
                 showError(fmt::sprintf(_("Error while loading file! (%s)"),lastError));
               }
               break;
@@ -5050,7 +5047,7 @@ bool FurnaceGUI::loop() {
                     openOpen=true;
                     break;
                   case GUI_WARN_OPEN_DROP:
-                    if (load(nextFile)>0) {
+                    if (loadAsync(nextFile)>0) {
                       showError(fmt::sprintf(_("Error while loading file! (%s)"),lastError));
                     }
                     nextFile="";
@@ -5277,7 +5274,9 @@ bool FurnaceGUI::loop() {
                   pendingInsSingle=true;
                 } else { // replace with the only instrument
                   if (curIns>=0 && curIns<(int)e->song.ins.size()) {
-                    *e->song.ins[curIns]=*instruments[0];
+                    e->lockEngine([this,&instruments]() {
+                      *e->song.ins[curIns]=*instruments[0];
+                    });
                   } else {
                     showError(_("...but you haven't selected an instrument!"));
                   }
@@ -5344,17 +5343,13 @@ bool FurnaceGUI::loop() {
               break;
             }
             case GUI_FILE_EXPORT_VGM: {
-              SafeWriter* w=e->saveVGM(willExport,vgmExportLoop,vgmExportVersion,vgmExportPatternHints,vgmExportDirectStream,vgmExportTrailingTicks);
+              SafeWriter* w=e->saveVGM(willExport,vgmExportLoop,vgmExportVersion,vgmExportPatternHints,vgmExportDirectStream,vgmExportTrailingTicks,copyOfName.c_str(),vgmExportOptimize,vgmExportCompress);
               if (w!=NULL) {
-                FILE* f=ps_fopen(copyOfName.c_str(),"wb");
-                if (f!=NULL) {
-                  fwrite(w->getFinalBuf(),1,w->size(),f);
-                  fclose(f);
+                if (w->finish()) {
                   pushRecentSys(copyOfName.c_str());
                 } else {
-                  showError(_("could not open file!"));
+                  showError(_("could not write VGM!"));
                 }
-                w->finish();
                 delete w;
                 if (!e->getWarnings().empty()) {
                   showWarning(e->getWarnings(),GUI_WARN_GENERIC);
@@ -5431,17 +5426,13 @@ bool FurnaceGUI::loop() {
               break;
             }
             case GUI_FILE_EXPORT_CMDSTREAM: {
-              SafeWriter* w=e->saveCommand();
+              SafeWriter* w=e->saveCommand(copyOfName.c_str());
               if (w!=NULL) {
-                FILE* f=ps_fopen(copyOfName.c_str(),"wb");
-                if (f!=NULL) {
-                  fwrite(w->getFinalBuf(),1,w->size(),f);
-                  fclose(f);
+                if (w->finish()) {
                   pushRecentSys(copyOfName.c_str());
                 } else {
-                  showError(_("could not open file!"));
+                  showError(_("could not write command stream!"));
                 }
-                w->finish();
                 delete w;
                 if (!e->getWarnings().empty()) {
                   showWarning(e->getWarnings(),GUI_WARN_GENERIC);
@@ -5574,14 +5565,30 @@ bool FurnaceGUI::loop() {
       ImGui::OpenPopup(_("Rendering..."));
     }
 
+    if (displayLoading) {
+      displayLoading=false;
+      ImGui::OpenPopup(_("Loading..."));
+    }
+
+    if (asyncLoading && !e->isLoading()) {
+      asyncLoading=false;
+      if (e->finishLoadAsync()) {
+        postLoad(asyncLoadPath,asyncLoadWasPlaying);
+      } else if (!asyncLoadCancelled) {
+        lastError=e->getLastError();
+        logE("could not open file!");
+        showError(fmt::sprintf(_("Error while loading file! (%s)"),lastError));
+      }
+      asyncLoadPath="";
+    }
+
     if (displayNew) {
       newSongQuery="";
       newSongFirstFrame=true;
       displayNew=false;
       if (settings.newSongBehavior==1) {
         e->createNewFromDefaults();
-        undoHist.clear();
-        redoHist.clear();
+        clearUndoHist();
         curFileName="";
         modified=false;
         curNibble=false;
@@ -5639,6 +5646,52 @@ bool FurnaceGUI::loop() {
       ImGui::EndPopup();
     }
 
+    centerNextWindow(_("Loading..."),canvasW,canvasH);
+    if (ImGui::BeginPopupModal(_("Loading..."),NULL,ImGuiWindowFlags_AlwaysAutoResize)) {
+      float loadProgress=0.0f;
+      const char* stageName=_("Please wait...");
+      switch (e->getLoadStage(&loadProgress)) {
+        case DIV_LOAD_READ:
+          stageName=_("Reading file...");
+          break;
+        case DIV_LOAD_DECOMPRESS:
+          stageName=_("Decompressing...");
+          break;
+        case DIV_LOAD_PARSE:
+          stageName=_("Reading song...");
+          break;
+        case DIV_LOAD_INSTRUMENTS:
+          stageName=_("Reading instruments...");
+          break;
+        case DIV_LOAD_WAVETABLES:
+          stageName=_("Reading wavetables...");
+          break;
+        case DIV_LOAD_SAMPLES:
+          stageName=_("Reading samples...");
+          break;
+        case DIV_LOAD_PATTERNS:
+          stageName=_("Reading patterns...");
+          break;
+        case DIV_LOAD_RENDER_SAMPLES:
+          stageName=_("Preparing samples...");
+          break;
+        default:
+          break;
+      }
+      ImGui::Text("%s",stageName);
+      ImGui::ProgressBar(loadProgress,ImVec2(300.0f*dpiScale,0));
+      ImGui::BeginDisabled(asyncLoadCancelled);
+      if (ImGui::Button(_("Cancel"))) {
+        asyncLoadCancelled=true;
+        e->cancelLoad();
+      }
+      ImGui::EndDisabled();
+      if (!asyncLoading) {
+        ImGui::CloseCurrentPopup();
+      }
+      ImGui::EndPopup();
+    }
+
     drawTutorial();
 
     ImVec2 newSongMinSize=mobileUI?ImVec2(canvasW-(portrait?0:(60.0*dpiScale)),canvasH-60.0*dpiScale):ImVec2(400.0f*dpiScale,200.0f*dpiScale);
@@ -5811,7 +5864,7 @@ bool FurnaceGUI::loop() {
                 showError(fmt::sprintf(_("Error while saving file! (%s)"),lastError));
                 nextFile="";
               } else {
-                if (load(nextFile)>0) {
+                if (loadAsync(nextFile)>0) {
                   showError(fmt::sprintf(_("Error while loading file! (%s)"),lastError));
                 }
                 nextFile="";
@@ -5821,7 +5874,7 @@ bool FurnaceGUI::loop() {
           ImGui::SameLine();
           if (ImGui::Button(_("No"))) {
             ImGui::CloseCurrentPopup();
-            if (load(nextFile)>0) {
+            if (loadAsync(nextFile)>0) {
               showError(fmt::sprintf(_("Error while loading file! (%s)"),lastError));
             }
             nextFile="";
@@ -5935,11 +5988,8 @@ bool FurnaceGUI::loop() {
               e->lockEngine([this]() {
                 for (int i=0; i<e->getTotalChannelCount(); i++) {
                   DivPattern* pat=e->curPat[i].getPattern(e->curOrders->ord[i][curOrder],true);
-                  memset(pat->data,-1,DIV_MAX_ROWS*DIV_MAX_COLS*sizeof(short));
-                  for (int j=0; j<DIV_MAX_ROWS; j++) {
-                    pat->data[j][0]=0;
-                    pat->data[j][1]=0;
-                  }
+                  pat->clear();
+                  pat->compact();
                 }
               });
               MARK_MODIFIED;
@@ -6028,8 +6078,7 @@ bool FurnaceGUI::loop() {
         case GUI_WARN_SUBSONG_DEL:
           if (ImGui::Button(_("Yes"))) {
             if (e->removeSubSong(e->getCurrentSubSong())) {
-              undoHist.clear();
-              redoHist.clear();
+              clearUndoHist();
               updateScroll(0);
               oldRow=0;
               cursor.xCoarse=0;
@@ -6272,7 +6321,9 @@ bool FurnaceGUI::loop() {
           if (!i.second || pendingInsSingle) {
             if (i.second) {
               if (curIns>=0 && curIns<(int)e->song.ins.size()) {
-                *e->song.ins[curIns]=*i.first;
+                e->lockEngine([this,&i]() {
+                  *e->song.ins[curIns]=*i.first;
+                });
               } else {
                 showError(_("...but you haven't selected an instrument!"));
               }
@@ -6475,32 +6526,33 @@ bool FurnaceGUI::loop() {
               }
             }
             logD("saving backup...");
-            SafeWriter* w=e->saveFur(true,true);
-            logV("writing file...");
-
-            if (w!=NULL) {
-              size_t sepPos=curFileName.rfind(DIR_SEPARATOR);
-              String backupPreBaseName;
-              String backupBaseName;
-              String backupFileName;
-              if (sepPos==String::npos) {
-                backupPreBaseName=curFileName;
-              } else {
-                backupPreBaseName=curFileName.substr(sepPos+1);
-              }
+            size_t sepPos=curFileName.rfind(DIR_SEPARATOR);
+            String backupPreBaseName;
+            String backupBaseName;
+            String backupFileName;
+            String journalError;
+            bool newJournal=false;
+            if (sepPos==String::npos) {
+              backupPreBaseName=curFileName;
+            } else {
+              backupPreBaseName=curFileName.substr(sepPos+1);
+            }
 
-              size_t dotPos=backupPreBaseName.rfind('.');
-              if (dotPos!=String::npos) {
-                backupPreBaseName=backupPreBaseName.substr(0,dotPos);
-              }
+            size_t dotPos=backupPreBaseName.rfind('.');
+            if (dotPos!=String::npos) {
+              backupPreBaseName=backupPreBaseName.substr(0,dotPos);
+            }
 
-              for (char i: backupPreBaseName) {
-                if (backupBaseName.size()>=48) break;
-                if ((i>='0' && i<='9') || (i>='A' && i<='Z') || (i>='a' && i<='z') || i=='_' || i=='-' || i==' ') backupBaseName+=i;
-              }
+            for (char i: backupPreBaseName) {
+              if (backupBaseName.size()>=48) break;
+              if ((i>='0' && i<='9') || (i>='A' && i<='Z') || (i>='a' && i<='z') || i=='_' || i=='-' || i==' ') backupBaseName+=i;
+            }
 
-              if (backupBaseName.empty()) backupBaseName="untitled";
+            if (backupBaseName.empty()) backupBaseName="untitled";
 
+            // backups go into a journal, which only receives what changed since the last backup.
+            // start a new one for another song, or once it's mostly made of old data.
+            if (!backupJournal.isOpen() || backupJournalName!=backupBaseName || backupJournal.size()>(backupJournal.getLiveSize()*2+BACKUP_JOURNAL_SLACK)) {
               backupFileName=backupBaseName;
 
               time_t curTime=time(NULL);
@@ -6508,35 +6560,45 @@ bool FurnaceGUI::loop() {
 #ifdef _WIN32
               struct tm* tempTM=localtime(&curTime);
               if (tempTM==NULL) {
-                backupFileName+="-unknownTime.fur";
+                backupFileName+="-unknownTime.furj";
               } else {
                 curTM=*tempTM;
-                backupFileName+=fmt::sprintf("-%d%.2d%.2d-%.2d%.2d%.2d.fur",curTM.tm_year+1900,curTM.tm_mon+1,curTM.tm_mday,curTM.tm_hour,curTM.tm_min,curTM.tm_sec);
+                backupFileName+=fmt::sprintf("-%d%.2d%.2d-%.2d%.2d%.2d.furj",curTM.tm_year+1900,curTM.tm_mon+1,curTM.tm_mday,curTM.tm_hour,curTM.tm_min,curTM.tm_sec);
               }
 #else
               if (localtime_r(&curTime,&curTM)==NULL) {
-                backupFileName+="-unknownTime.fur";
+                backupFileName+="-unknownTime.furj";
               } else {
-                backupFileName+=fmt::sprintf("-%d%.2d%.2d-%.2d%.2d%.2d.fur",curTM.tm_year+1900,curTM.tm_mon+1,curTM.tm_mday,curTM.tm_hour,curTM.tm_min,curTM.tm_sec);
+                backupFileName+=fmt::sprintf("-%d%.2d%.2d-%.2d%.2d%.2d.furj",curTM.tm_year+1900,curTM.tm_mon+1,curTM.tm_mday,curTM.tm_hour,curTM.tm_min,curTM.tm_sec);
               }
 #endif
 
               String finalPath=backupPath+String(DIR_SEPARATOR_STR)+backupFileName;
-              
-              FILE* outFile=ps_fopen(finalPath.c_str(),"wb");
-              if (outFile!=NULL) {
-                if (fwrite(w->getFinalBuf(),1,w->size(),outFile)!=w->size()) {
-                  logW("did not write backup entirely: %s!",strerror(errno));
-                }
-                fclose(outFile);
-              } else {
-                logW("could not save backup: %s!",strerror(errno));
+              if (!backupJournal.open(finalPath.c_str(),journalError)) {
+                logW("could not create backup journal: %s!",journalError);
+                backupTimer=settings.backupInterval;
+                backupLock.unlock();
+                return false;
               }
-              w->finish();
+              backupJournalName=backupBaseName;
+              newJournal=true;
+            }
 
-              // delete previous backup if there are too many
-              delFirstBackup(backupBaseName);
+            // this holds the engine while serializing the song, except for samples which did not change.
+            // writing happens afterwards.
+            DivFurSnapshot snap(&backupJournal);
+            if (e->saveFur(true,true,&snap)==NULL) {
+              logW("could not save backup: %s!",e->getLastError());
+            } else {
+              logV("writing file...");
+              if (!backupJournal.append(snap,journalError)) {
+                logW("could not save backup: %s!",journalError);
+              }
             }
+            snap.clear();
+
+            // delete previous backup if there are too many
+            if (newJournal) delFirstBackup(backupBaseName);
             logD("backup saved.");
             backupTimer=settings.backupInterval;
             backupLock.unlock();
@@ -7677,11 +7739,17 @@ FurnaceGUI::FurnaceGUI():
   modified(false),
   displayError(false),
   displayExporting(false),
+  displayLoading(false),
+  asyncLoading(false),
+  asyncLoadWasPlaying(false),
+  asyncLoadCancelled(false),
   vgmExportLoop(true),
   zsmExportLoop(true),
   zsmExportOptimize(true),
   vgmExportPatternHints(false),
   vgmExportDirectStream(false),
+  vgmExportOptimize(false),
+  vgmExportCompress(false),
   displayInsTypeList(false),
   portrait(false),
   injectBackUp(false),
@@ -8050,6 +8118,7 @@ FurnaceGUI::FurnaceGUI():
   haveHitBounds(false),
   pendingStepUpdate(0),
   oldOrdersLen(0),
+  undoHistMem(0),
   sampleZoom(1.0),
   prevSampleZoom(1.0),
   minSampleZoom(1.0),
@@ -30,6 +30,7 @@
 #include <stdint.h>
 #include <initializer_list>
 #include <future>
+#include <deque>
 #include <memory>
 #include <tuple>
 #include "../pch.h"
@@ -44,7 +45,7 @@
 #define handleUnimportant if (settings.insFocusesPattern && patternOpen) {nextWindow=GUI_WINDOW_PATTERN;}
 #define unimportant(x) if (x) {handleUnimportant}
 
-#define MARK_MODIFIED modified=true;
+#define MARK_MODIFIED modified=true; e->invalidateSeekCache();
 #define WAKE_UP drawHalt=5;
 
 #define RESET_WAVE_MACRO_ZOOM \
@@ -1031,8 +1032,9 @@ enum UndoOtherTarget {
   GUI_UNDO_TARGET_SUBSONG
 };
 
+// kept small as large operations may produce many of these
 struct UndoPatternData {
-  int subSong, chan, pat, row, col;
+  unsigned char subSong, chan, pat, row, col;
   short oldVal, newVal;
   UndoPatternData(int s, int c, int p, int r, int co, short v1, short v2):
     subSong(s),
@@ -1090,6 +1092,14 @@ struct UndoStep {
     newOrdersLen(0),
     oldPatLen(0),
     newPatLen(0) {}
+
+  // approximate memory used by this step
+  size_t getMemUsage() const {
+    return sizeof(UndoStep)+
+      ord.capacity()*sizeof(UndoOrderData)+
+      pat.capacity()*sizeof(UndoPatternData)+
+      other.capacity()*sizeof(UndoOtherData);
+  }
 };
 
 // -1 = any
@@ -1579,9 +1589,10 @@ class FurnaceGUI {
 
   FurnaceGUITexture* sampleTex;
   int sampleTexW, sampleTexH;
+  std::vector<unsigned int> sampleTexData;
   bool updateSampleTex;
 
-  String workingDir, fileName, clipboard, warnString, errorString, lastError, curFileName, nextFile, sysSearchQuery, newSongQuery, paletteQuery;
+  String workingDir, fileName, clipboard, warnString, errorString, lastError, curFileName, nextFile, asyncLoadPath, sysSearchQuery, newSongQuery, paletteQuery;
   String workingDirSong, workingDirIns, workingDirWave, workingDirSample, workingDirAudioExport;
   String workingDirVGMExport, workingDirZSMExport, workingDirROMExport;
   String workingDirFont, workingDirColors, workingDirKeybinds;
@@ -1601,8 +1612,8 @@ class FurnaceGUI {
   std::vector<String> availRenderDrivers;
   std::vector<String> availAudioDrivers;
 
-  bool quit, warnQuit, willCommit, edit, editClone, isPatUnique, modified, displayError, displayExporting, vgmExportLoop, zsmExportLoop, zsmExportOptimize, vgmExportPatternHints;
-  bool vgmExportDirectStream, displayInsTypeList, displayWaveSizeList;
+  bool quit, warnQuit, willCommit, edit, editClone, isPatUnique, modified, displayError, displayExporting, displayLoading, asyncLoading, asyncLoadWasPlaying, asyncLoadCancelled, vgmExportLoop, zsmExportLoop, zsmExportOptimize, vgmExportPatternHints;
+  bool vgmExportDirectStream, vgmExportOptimize, vgmExportCompress, displayInsTypeList, displayWaveSizeList;
   bool portrait, injectBackUp, mobileMenuOpen, warnColorPushed;
   bool wantCaptureKeyboard, oldWantCaptureKeyboard, displayMacroMenu;
   bool displayNew, displayExport, displayPalette, fullScreen, preserveChanPos, sysDupCloneChannels, sysDupEnd, noteInputPoly, notifyWaveChange;
@@ -1676,6 +1687,8 @@ class FurnaceGUI {
   std::future<bool> backupTask;
   std::mutex backupLock;
   String backupPath;
+  DivBackupJournal backupJournal;
+  String backupJournalName;
 
   std::vector<FurnaceGUIBackupEntry> backupEntries;
   std::future<bool> backupEntryTask;
@@ -1845,6 +1858,8 @@ class FurnaceGUI {
     int oplStandardWaveNames;
     int cursorMoveNoScroll;
     int lowLatency;
+    int seekCache;
+    int sampleMemMap;
     int notePreviewBehavior;
     int powerSave;
     int absorbInsInput;
@@ -1896,6 +1911,7 @@ class FurnaceGUI {
     int iCannotWait;
     int orderButtonPos;
     int compress;
+    int compressLevel;
     int newPatternFormat;
     int renderClearPos;
     int insertBehavior;
@@ -1916,6 +1932,7 @@ class FurnaceGUI {
     int wasapiEx;
     int chanOscThreads;
     int renderPoolThreads;
+    int renderPipeline;
     int showPool;
     int writeInsNames;
     int readInsNames;
@@ -1942,11 +1959,13 @@ class FurnaceGUI {
     int glStencilSize;
     int glBufferSize;
     int glDoubleBuffer;
+    int renderSoftwareThreads;
     int backupEnable;
     int backupInterval;
     int backupMaxCopies;
     int autoFillSave;
     unsigned int maxUndoSteps;
+    size_t maxUndoMemory;
     float vibrationStrength;
     int vibrationLength;
     String mainFontPath;
@@ -2102,6 +2121,8 @@ class FurnaceGUI {
       oplStandardWaveNames(0),
       cursorMoveNoScroll(0),
       lowLatency(0),
+      seekCache(0),
+      sampleMemMap(0),
       notePreviewBehavior(1),
       powerSave(1),
       absorbInsInput(0),
@@ -2152,6 +2173,7 @@ class FurnaceGUI {
       iCannotWait(0),
       orderButtonPos(2),
       compress(1),
+      compressLevel(6),
       newPatternFormat(1),
       renderClearPos(0),
       insertBehavior(1),
@@ -2172,6 +2194,7 @@ class FurnaceGUI {
       wasapiEx(0),
       chanOscThreads(0),
       renderPoolThreads(0),
+      renderPipeline(0),
       showPool(0),
       writeInsNames(0),
       readInsNames(1),
@@ -2198,11 +2221,13 @@ class FurnaceGUI {
       glStencilSize(0),
       glBufferSize(32),
       glDoubleBuffer(1),
+      renderSoftwareThreads(0),
       backupEnable(1),
       backupInterval(30),
       backupMaxCopies(5),
       autoFillSave(0),
-      maxUndoSteps(100),
+      maxUndoSteps(1000),
+      maxUndoMemory(32*1024*1024),
       vibrationStrength(0.5f),
       vibrationLength(20),
       mainFontPath(""),
@@ -2471,8 +2496,9 @@ class FurnaceGUI {
   int oldOrdersLen;
   DivOrders oldOrders;
   std::map<unsigned short,DivPattern*> oldPatMap;
-  FixedQueue<UndoStep,256> undoHist;
-  FixedQueue<UndoStep,256> redoHist;
+  std::deque<UndoStep> undoHist;
+  std::deque<UndoStep> redoHist;
+  size_t undoHistMem;
 
   // sample editor specific
   double sampleZoom;
@@ -2863,6 +2889,9 @@ class FurnaceGUI {
   void editAdvance();
   void prepareUndo(ActionType action, UndoRegion region=UndoRegion());
   void makeUndo(ActionType action, UndoRegion region=UndoRegion());
+  void pushUndo(UndoStep& s);
+  void clearUndoHist();
+  void applyUndoPatternData(const std::vector<UndoPatternData>& data, bool redo);
   void doSelectAll();
   void doDelete();
   void doPullDelete();
@@ -2918,6 +2947,8 @@ class FurnaceGUI {
   void openFileDialog(FurnaceGUIFileDialogs type);
   int save(String path, int dmfVersion);
   int load(String path);
+  int loadAsync(String path);
+  void postLoad(String path, bool wasPlaying);
   int loadStream(String path);
   void openRecentFile(String path);
   void pushRecentFile(String path);
@@ -219,7 +219,10 @@ const char* resampleStrats[]={
   _N("cubic spline"),
   _N("blep synthesis"),
   _N("sinc"),
-  _N("best possible")
+  _N("best possible"),
+  _N("polyphase (fast)"),
+  _N("polyphase"),
+  _N("polyphase (high quality)")
 };
 
 const char* fxColorsNames[]={
@@ -2077,9 +2077,9 @@ void FurnaceGUI::drawMacroEdit(FurnaceGUIMacroDesc& i, int totalFit, float avail
       i.macro->len^=i.macro->lenMemory; \
 \
       for (int j=0; j<16; j++) { \
-        i.macro->val[j]^=i.macro->typeMemory[j]; \
-        i.macro->typeMemory[j]^=i.macro->val[j]; \
-        i.macro->val[j]^=i.macro->typeMemory[j]; \
+        i.macro->val[j]^=i.macro->val.typeMemory()[j]; \
+        i.macro->val.typeMemory()[j]^=i.macro->val[j]; \
+        i.macro->val[j]^=i.macro->val.typeMemory()[j]; \
       } \
 \
       /* if ADSR/LFO, populate min/max */ \
@@ -91,8 +91,7 @@ void FurnaceGUI::endIntroTune() {
       e->createNewFromDefaults();
     }
   }
-  undoHist.clear();
-  redoHist.clear();
+  clearUndoHist();
   modified=false;
   curNibble=false;
   orderNibble=false;
@@ -276,8 +276,7 @@ void FurnaceGUI::drawNewSong() {
 
   if (accepted) {
     e->createNew(nextDesc.c_str(),nextDescName,false);
-    undoHist.clear();
-    redoHist.clear();
+    clearUndoHist();
     curFileName="";
     modified=false;
     curNibble=false;
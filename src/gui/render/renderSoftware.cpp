@@ -30,6 +30,12 @@ class FurnaceSoftwareTexture: public FurnaceGUITexture {
     format(GUI_TEXFORMAT_UNKNOWN) {}
 };
 
+static void _paintTiles(void (*func)(void*), void* args, size_t stride, size_t count, void* user) {
+  DivWorkPool* pool=(DivWorkPool*)user;
+  pool->pushBatch(func,args,stride,count);
+  pool->wait();
+}
+
 ImTextureID FurnaceGUIRenderSoftware::getTextureID(FurnaceGUITexture* which) {
   FurnaceSoftwareTexture* t=(FurnaceSoftwareTexture*)which;
   return t->tex;
@@ -49,6 +55,8 @@ bool FurnaceGUIRenderSoftware::lockTexture(FurnaceGUITexture* which, void** data
 }
 
 bool FurnaceGUIRenderSoftware::unlockTexture(FurnaceGUITexture* which) {
+  FurnaceSoftwareTexture* t=(FurnaceSoftwareTexture*)which;
+  t->tex->revision++;
   return true;
 }
 
@@ -56,6 +64,7 @@ bool FurnaceGUIRenderSoftware::updateTexture(FurnaceGUITexture* which, void* dat
   FurnaceSoftwareTexture* t=(FurnaceSoftwareTexture*)which;
   if (!t->tex->managed) return false;
   memcpy(t->tex->pixels,data,pitch*t->tex->height);
+  t->tex->revision++;
   return true;
 }
 
@@ -87,11 +96,20 @@ void FurnaceGUIRenderSoftware::setBlendMode(FurnaceGUIBlendMode mode) {
 }
 
 void FurnaceGUIRenderSoftware::clear(ImVec4 color) {
-  SDL_Surface* surf=SDL_GetWindowSurface(sdlWin);
-  if (!surf) return;
   ImU32 clearToWhat=ImGui::ColorConvertFloat4ToU32(color);
   clearToWhat=(clearToWhat&0xff00ff00)|((clearToWhat&0xff)<<16)|((clearToWhat&0xff0000)>>16);
 
+  // the renderer clears tiles as it paints them, so that unchanged ones can be skipped.
+  // only clear the surface now if we already painted this frame, or if there is no renderer yet
+  // (it would not paint anything).
+  if (!rendered && guiInit) {
+    ImGui_ImplSW_SetClearColor(clearToWhat);
+    return;
+  }
+
+  SDL_Surface* surf=SDL_GetWindowSurface(sdlWin);
+  if (!surf) return;
+
   bool mustLock=SDL_MUSTLOCK(surf);
   if (mustLock) {
     if (SDL_LockSurface(surf)!=0) return;
@@ -103,6 +121,7 @@ void FurnaceGUIRenderSoftware::clear(ImVec4 color) {
   if (mustLock) {
     SDL_UnlockSurface(surf);
   }
+  ImGui_ImplSW_Invalidate();
 }
 
 bool FurnaceGUIRenderSoftware::newFrame() {
@@ -123,6 +142,7 @@ void FurnaceGUIRenderSoftware::destroyFontsTexture() {
 
 void FurnaceGUIRenderSoftware::renderGUI() {
   ImGui_ImplSW_RenderDrawData(ImGui::GetDrawData());
+  rendered=true;
 }
 
 void FurnaceGUIRenderSoftware::wipe(float alpha) {
@@ -131,6 +151,7 @@ void FurnaceGUIRenderSoftware::wipe(float alpha) {
 
 void FurnaceGUIRenderSoftware::present() {
   SDL_UpdateWindowSurface(sdlWin);
+  rendered=false;
 }
 
 bool FurnaceGUIRenderSoftware::getOutputSize(int& w, int& h) {
@@ -177,6 +198,7 @@ void FurnaceGUIRenderSoftware::setSwapInterval(int swapInterval) {
 }
 
 void FurnaceGUIRenderSoftware::preInit(const DivConfig& conf) {
+  renderThreads=conf.getInt("renderSoftwareThreads",0);
 }
 
 bool FurnaceGUIRenderSoftware::init(SDL_Window* win, int swapInterval) {
@@ -187,11 +209,22 @@ bool FurnaceGUIRenderSoftware::init(SDL_Window* win, int swapInterval) {
 void FurnaceGUIRenderSoftware::initGUI(SDL_Window* win) {
   // hack
   ImGui_ImplSDL2_InitForMetal(win);
-  ImGui_ImplSW_Init(win);
+  guiInit=ImGui_ImplSW_Init(win);
+
+  if (renderThreads>0) {
+    logV("software renderer: painting with %d threads",renderThreads);
+    renderPool=new DivWorkPool(renderThreads);
+    ImGui_ImplSW_SetParallelFor(_paintTiles,renderPool);
+  }
 }
 
 void FurnaceGUIRenderSoftware::quitGUI() {
   ImGui_ImplSW_Shutdown();
+  guiInit=false;
+  if (renderPool!=NULL) {
+    delete renderPool;
+    renderPool=NULL;
+  }
 }
 
 bool FurnaceGUIRenderSoftware::quit() {
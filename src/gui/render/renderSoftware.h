@@ -21,6 +21,10 @@
 
 class FurnaceGUIRenderSoftware: public FurnaceGUIRender {
   SDL_Window* sdlWin;
+  DivWorkPool* renderPool;
+  int renderThreads;
+  bool rendered;
+  bool guiInit;
   public:
     ImTextureID getTextureID(FurnaceGUITexture* which);
     FurnaceGUITextureFormat getTextureFormat(FurnaceGUITexture* which);
@@ -55,5 +59,9 @@ class FurnaceGUIRenderSoftware: public FurnaceGUIRender {
     void quitGUI();
     bool quit();
     FurnaceGUIRenderSoftware():
-      sdlWin(NULL) {}
+      sdlWin(NULL),
+      renderPool(NULL),
+      renderThreads(0),
+      rendered(false),
+      guiInit(false) {}
 };
@@ -966,7 +966,7 @@ void FurnaceGUI::drawSampleEdit() {
           if (resampleTarget<0) resampleTarget=0;
           if (resampleTarget>96000) resampleTarget=96000;
         }
-        ImGui::Combo(_("Filter"),&resampleStrat,LocalizedComboGetter,resampleStrats,6);
+        ImGui::Combo(_("Filter"),&resampleStrat,LocalizedComboGetter,resampleStrats,9);
         if (ImGui::Button(_("Resample"))) {
           sample->prepareUndo(true);
           e->lockEngine([this,sample,targetRate]() {
@@ -1517,7 +1517,11 @@ void FurnaceGUI::drawSampleEdit() {
           if (!rend->lockTexture(sampleTex,(void**)&dataT,&pitch)) {
             logE("error while locking sample texture! %s",SDL_GetError());
           } else {
-            unsigned int* data=new unsigned int[sampleTexW*sampleTexH];
+            // reuse the buffer between updates
+            if (sampleTexData.size()<(size_t)(sampleTexW*sampleTexH)) {
+              sampleTexData.resize(sampleTexW*sampleTexH);
+            }
+            unsigned int* data=sampleTexData.data();
 
             ImU32 bgColor=ImGui::GetColorU32(uiColors[GUI_COLOR_SAMPLE_BG]);
             ImU32 bgColorLoop=ImGui::GetColorU32(uiColors[GUI_COLOR_SAMPLE_LOOP]);
@@ -1563,41 +1567,16 @@ void FurnaceGUI::drawSampleEdit() {
                 data[i]=centerLineColor;
               }
             }
-            unsigned int xCoarse=samplePos;
-            unsigned int xFine=0;
-            unsigned int xAdvanceCoarse=sampleZoom;
-            unsigned int xAdvanceFine=fmod(sampleZoom,1.0)*16777216;
+            // each column covers the samples up to the first one of the next column.
+            // the peak cache makes this independent of the zoom level
             for (unsigned int i=0; i<(unsigned int)availX; i++) {
-              if (xCoarse>=sample->samples) break;
+              unsigned int xBegin=samplePos+(unsigned int)(i*sampleZoom);
+              unsigned int xEnd=samplePos+(unsigned int)((i+1)*sampleZoom)+1;
+              if (xBegin>=sample->samples) break;
               int y1, y2;
-              int candMin=INT_MAX;
-              int candMax=INT_MIN;
-              int totalAdvance=0;
-              if (sample->depth==DIV_SAMPLE_DEPTH_8BIT) {
-                if (candMin>sample->data8[xCoarse]) candMin=sample->data8[xCoarse];
-                if (candMax<sample->data8[xCoarse]) candMax=sample->data8[xCoarse];
-              } else {
-                if (candMin>sample->data16[xCoarse]) candMin=sample->data16[xCoarse];
-                if (candMax<sample->data16[xCoarse]) candMax=sample->data16[xCoarse];
-              }
-              xFine+=xAdvanceFine;
-              if (xFine>=16777216) {
-                xFine-=16777216;
-                totalAdvance++;
-              }
-              totalAdvance+=xAdvanceCoarse;
-              if (xCoarse>=sample->samples) break;
-              do {
-                if (xCoarse>=sample->samples) break;
-                if (sample->depth==DIV_SAMPLE_DEPTH_8BIT) {
-                  if (candMin>sample->data8[xCoarse]) candMin=sample->data8[xCoarse];
-                  if (candMax<sample->data8[xCoarse]) candMax=sample->data8[xCoarse];
-                } else {
-                  if (candMin>sample->data16[xCoarse]) candMin=sample->data16[xCoarse];
-                  if (candMax<sample->data16[xCoarse]) candMax=sample->data16[xCoarse];
-                }
-                if (totalAdvance>0) xCoarse++;
-              } while ((totalAdvance--)>0);
+              int candMin=0;
+              int candMax=0;
+              if (!sample->getPeaks(xBegin,xEnd,candMin,candMax)) break;
               if (sample->depth==DIV_SAMPLE_DEPTH_8BIT) {
                 y1=(((unsigned char)candMin^0x80)*availY)>>8;
                 y2=(((unsigned char)candMax^0x80)*availY)>>8;
@@ -1635,7 +1614,6 @@ void FurnaceGUI::drawSampleEdit() {
               }
             }
             rend->unlockTexture(sampleTex);
-            delete[] data;
           }
           updateSampleTex=false;
         }
@@ -374,8 +374,8 @@ bool FurnaceGUI::splitBackupName(const char* input, String& backupName, struct t
   const char* secondHyphen=NULL;
   bool whichHyphen=false;
   bool isDateValid=true;
-  // -YYYYMMDD-hhmmss.fur
-  if (strcmp(&input[len-4],".fur")!=0) return false;
+  // -YYYYMMDD-hhmmss.fur (or .furj for journals)
+  if (strcmp(&input[len-4],".fur")!=0 && (len<5 || strcmp(&input[len-5],".furj")!=0)) return false;
   // find two hyphens
   for (const char* i=input+len; i!=input; i--) {
     if ((*i)=='-') {
@@ -463,7 +463,7 @@ bool FurnaceGUI::splitBackupName(const char* input, String& backupName, struct t
 
 void FurnaceGUI::purgeBackups(int year, int month, int day) {
 #ifdef _WIN32
-  String findPath=backupPath+String(DIR_SEPARATOR_STR)+String("*.fur");
+  String findPath=backupPath+String(DIR_SEPARATOR_STR)+String("*.fur*");
   WString findPathW=utf8To16(findPath.c_str());
   WIN32_FIND_DATAW next;
   HANDLE backDir=FindFirstFileW(findPathW.c_str(),&next);
@@ -727,6 +727,18 @@ void FurnaceGUI::drawSettings() {
             }
 
             ImGui::TextWrapped(_("the following values are common (in red, green, blue, alpha order):\n- 24 bits: 8, 8, 8, 0\n- 16 bits: 5, 6, 5, 0\n- 32 bits (with alpha): 8, 8, 8, 8\n- 30 bits (deep): 10, 10, 10, 0"));
+          } else if (curRenderBackend=="Software") {
+            pushWarningColor(settings.renderSoftwareThreads>cpuCores,settings.renderSoftwareThreads>(cpuCores*2));
+            if (ImGui::InputInt(_("Render threads"),&settings.renderSoftwareThreads)) {
+              if (settings.renderSoftwareThreads<0) settings.renderSoftwareThreads=0;
+              if (settings.renderSoftwareThreads>(cpuCores*3)) settings.renderSoftwareThreads=cpuCores*3;
+              if (settings.renderSoftwareThreads>256) settings.renderSoftwareThreads=256;
+              settingsChanged=true;
+            }
+            if (ImGui::IsItemHovered()) {
+              ImGui::SetTooltip(_("number of threads which paint the screen in tiles (0 to paint on the main thread only).\nyou may need to restart Furnace for this setting to take effect."));
+            }
+            popWarningColor();
           } else {
             ImGui::Text(_("nothing to configure"));
           }
@@ -885,6 +897,19 @@ void FurnaceGUI::drawSettings() {
           ImGui::SetTooltip(_("use zlib to compress saved songs."));
         }
 
+        if (settings.compress) {
+          ImGui::Indent();
+          if (ImGui::SliderInt(_("Compression level"),&settings.compressLevel,1,9)) {
+            if (settings.compressLevel<1) settings.compressLevel=1;
+            if (settings.compressLevel>9) settings.compressLevel=9;
+            settingsChanged=true;
+          }
+          if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip(_("higher levels produce smaller files but take longer to save."));
+          }
+          ImGui::Unindent();
+        }
+
         bool saveUnusedPatternsB=settings.saveUnusedPatterns;
         if (ImGui::Checkbox(_("Save unused patterns"),&saveUnusedPatternsB)) {
           settings.saveUnusedPatterns=saveUnusedPatternsB;
@@ -1434,6 +1459,15 @@ void FurnaceGUI::drawSettings() {
               }
             }
             popWarningColor();
+
+            bool renderPipelineB=settings.renderPipeline;
+            if (ImGui::Checkbox(_("Pipelined rendering (some chips only)"),&renderPipelineB)) {
+              settings.renderPipeline=renderPipelineB;
+              settingsChanged=true;
+            }
+            if (ImGui::IsItemHovered()) {
+              ImGui::SetTooltip(_("runs the sequencer for the whole buffer before emulating chips, so that each chip renders the buffer in one go.\nreduces thread synchronization, especially with small buffer sizes or high tick rates.\n\nonly works if every chip in the song supports it (currently PC Engine, SN76489, Game Boy, YM2151, YM2612 and OPL/OPL2/OPL3).\nsongs with any other chip are rendered normally."));
+            }
           }
         }
 
@@ -1446,6 +1480,24 @@ void FurnaceGUI::drawSettings() {
           ImGui::SetTooltip(_("reduces latency by running the engine faster than the tick rate.\nuseful for live playback/jam mode.\n\nwarning: only enable if your buffer size is small (10ms or less)."));
         }
 
+        bool seekCacheB=settings.seekCache;
+        if (ImGui::Checkbox(_("Cache playback state for faster seeking"),&seekCacheB)) {
+          settings.seekCache=seekCacheB;
+          settingsChanged=true;
+        }
+        if (ImGui::IsItemHovered()) {
+          ImGui::SetTooltip(_("saves the playback state at every order while seeking, so that jumping to a position later in the song is faster.\nonly works if all chips in the song support it.\n\nwarning: uses more memory."));
+        }
+
+        bool sampleMemMapB=settings.sampleMemMap;
+        if (ImGui::Checkbox(_("Keep large samples in memory-mapped files"),&sampleMemMapB)) {
+          settings.sampleMemMap=sampleMemMapB;
+          settingsChanged=true;
+        }
+        if (ImGui::IsItemHovered()) {
+          ImGui::SetTooltip(_("stores sample data and undo history in a temporary file in the settings directory, which the system loads into memory as needed.\nreduces memory usage with big sample-based songs.\n\nonly affects samples which are loaded or edited afterwards."));
+        }
+
         bool forceMonoB=settings.forceMono;
         if (ImGui::Checkbox(_("Force mono audio"),&forceMonoB)) {
           settings.forceMono=forceMonoB;
@@ -4427,7 +4479,7 @@ void FurnaceGUI::drawSettings() {
             backupEntryLock.unlock();
 
 #ifdef _WIN32
-            String findPath=backupPath+String(DIR_SEPARATOR_STR)+String("*.fur");
+            String findPath=backupPath+String(DIR_SEPARATOR_STR)+String("*.fur*");
             WString findPathW=utf8To16(findPath.c_str());
             WIN32_FIND_DATAW next;
             HANDLE backDir=FindFirstFileW(findPathW.c_str(),&next);
@@ -4681,6 +4733,7 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
     settings.glStencilSize=conf.getInt("glStencilSize",0);
     settings.glBufferSize=conf.getInt("glBufferSize",32);
     settings.glDoubleBuffer=conf.getInt("glDoubleBuffer",1);
+    settings.renderSoftwareThreads=conf.getInt("renderSoftwareThreads",0);
 
     settings.vsync=conf.getInt("vsync",1);
     settings.frameRateLimit=conf.getInt("frameRateLimit",100);
@@ -4688,6 +4741,7 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
 
     settings.chanOscThreads=conf.getInt("chanOscThreads",0);
     settings.renderPoolThreads=conf.getInt("renderPoolThreads",0);
+    settings.renderPipeline=conf.getInt("renderPipeline",0);
     settings.shaderOsc=conf.getInt("shaderOsc",0);
     settings.showPool=conf.getInt("showPool",0);
     settings.writeInsNames=conf.getInt("writeInsNames",0);
@@ -4717,6 +4771,7 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
     settings.iCannotWait=conf.getInt("iCannotWait",0);
 
     settings.compress=conf.getInt("compress",1);
+    settings.compressLevel=conf.getInt("compressLevel",6);
     settings.newPatternFormat=conf.getInt("newPatternFormat",1);
     settings.newSongBehavior=conf.getInt("newSongBehavior",0);
     settings.playOnLoad=conf.getInt("playOnLoad",0);
@@ -4752,6 +4807,8 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
     settings.audioChans=conf.getInt("audioChans",2);
 
     settings.lowLatency=conf.getInt("lowLatency",0);
+    settings.seekCache=conf.getInt("seekCache",0);
+    settings.sampleMemMap=conf.getInt("sampleMemMap",0);
 
     settings.metroVol=conf.getInt("metroVol",100);
     settings.sampleVol=conf.getInt("sampleVol",50);
@@ -5134,6 +5191,8 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
   clampSetting(settings.oplStandardWaveNames,0,1);
   clampSetting(settings.cursorMoveNoScroll,0,1);
   clampSetting(settings.lowLatency,0,1);
+  clampSetting(settings.seekCache,0,1);
+  clampSetting(settings.sampleMemMap,0,1);
   clampSetting(settings.notePreviewBehavior,0,3);
   clampSetting(settings.powerSave,0,1);
   clampSetting(settings.absorbInsInput,0,1);
@@ -5183,6 +5242,7 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
   clampSetting(settings.iCannotWait,0,1);
   clampSetting(settings.orderButtonPos,0,2);
   clampSetting(settings.compress,0,1);
+  clampSetting(settings.compressLevel,1,9);
   clampSetting(settings.newPatternFormat,0,1);
   clampSetting(settings.renderClearPos,0,1);
   clampSetting(settings.insertBehavior,0,1);
@@ -5203,6 +5263,7 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
   clampSetting(settings.wasapiEx,0,1);
   clampSetting(settings.chanOscThreads,0,256);
   clampSetting(settings.renderPoolThreads,0,DIV_MAX_CHIPS);
+  clampSetting(settings.renderPipeline,0,1);
   clampSetting(settings.showPool,0,1);
   clampSetting(settings.writeInsNames,0,1);
   clampSetting(settings.readInsNames,0,1);
@@ -5231,6 +5292,7 @@ void FurnaceGUI::readConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
   clampSetting(settings.glDepthSize,0,128);
   clampSetting(settings.glStencilSize,0,32);
   clampSetting(settings.glDoubleBuffer,0,1);
+  clampSetting(settings.renderSoftwareThreads,0,256);
   clampSetting(settings.backupEnable,0,1);
   clampSetting(settings.backupInterval,10,86400);
   clampSetting(settings.backupMaxCopies,1,100);
@@ -5265,6 +5327,7 @@ void FurnaceGUI::writeConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
     conf.set("glDepthSize",settings.glDepthSize);
     conf.set("glStencilSize",settings.glStencilSize);
     conf.set("glDoubleBuffer",settings.glDoubleBuffer);
+    conf.set("renderSoftwareThreads",settings.renderSoftwareThreads);
 
     conf.set("vsync",settings.vsync);
     conf.set("frameRateLimit",settings.frameRateLimit);
@@ -5272,6 +5335,7 @@ void FurnaceGUI::writeConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
 
     conf.set("chanOscThreads",settings.chanOscThreads);
     conf.set("renderPoolThreads",settings.renderPoolThreads);
+    conf.set("renderPipeline",settings.renderPipeline);
     conf.set("shaderOsc",settings.shaderOsc);
     conf.set("showPool",settings.showPool);
     conf.set("writeInsNames",settings.writeInsNames);
@@ -5301,6 +5365,7 @@ void FurnaceGUI::writeConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
     conf.set("iCannotWait",settings.iCannotWait);
 
     conf.set("compress",settings.compress);
+    conf.set("compressLevel",settings.compressLevel);
     conf.set("newPatternFormat",settings.newPatternFormat);
     conf.set("newSongBehavior",settings.newSongBehavior);
     conf.set("playOnLoad",settings.playOnLoad);
@@ -5330,6 +5395,8 @@ void FurnaceGUI::writeConfig(DivConfig& conf, FurnaceGUISettingGroups groups) {
     conf.set("audioChans",settings.audioChans);
 
     conf.set("lowLatency",settings.lowLatency);
+    conf.set("seekCache",settings.seekCache);
+    conf.set("sampleMemMap",settings.sampleMemMap);
 
     conf.set("metroVol",settings.metroVol);
     conf.set("sampleVol",settings.sampleVol);
@@ -5626,6 +5693,7 @@ void FurnaceGUI::commitSettings() {
     settings.mu5Path!=e->getConfString("mu5Path","");
 
   bool coresChanged=(
+    settings.renderPipeline!=e->getConfInt("renderPipeline",0) ||
     settings.arcadeCore!=e->getConfInt("arcadeCore",0) ||
     settings.ym2612Core!=e->getConfInt("ym2612Core",0) ||
     settings.snCore!=e->getConfInt("snCore",0) ||
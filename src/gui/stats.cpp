@@ -36,6 +36,10 @@ void FurnaceGUI::drawStats() {
     ImGui::Text(_("Audio load"));
     ImGui::SameLine();
     ImGui::ProgressBar((double)lastProcTime/maxGot,ImVec2(-FLT_MIN,0),procStr.c_str());
+    size_t mappedSize=sampleStoreGetMappedSize();
+    if (mappedSize>0) {
+      ImGui::Text(_("Memory-mapped sample data: %.1fMB"),(double)mappedSize/1048576.0);
+    }
   }
   if (ImGui::IsWindowFocused(ImGuiFocusedFlags_ChildWindows)) curWindow=GUI_WINDOW_STATS;
   ImGui::End();
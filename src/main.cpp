@@ -26,6 +26,7 @@
 #include "ta-log.h"
 #include "fileutils.h"
 #include "engine/engine.h"
+#include "engine/server.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -87,6 +88,9 @@ String outName;
 String vgmOutName;
 String zsmOutName;
 String cmdOutName;
+String profileOutName;
+String benchOutName;
+String serverWhere;
 int benchMode=0;
 int subsong=-1;
 DivAudioExportOptions exportOptions;
@@ -103,6 +107,7 @@ bool consoleNoControls=false;
 bool displayEngineFailError=false;
 bool displayLocaleFailError=false;
 bool vgmOutDirect=false;
+bool vgmOutOptimize=false;
 
 bool safeMode=false;
 bool safeModeWithAudio=false;
@@ -208,6 +213,11 @@ TAParamResult pNoControls(String val) {
   return TA_PARAM_SUCCESS;
 }
 
+TAParamResult pOutVerify(String val) {
+  exportOptions.verify=true;
+  return TA_PARAM_SUCCESS;
+}
+
 TAParamResult pSafeMode(String val) {
 #ifdef HAVE_GUI
   safeMode=true;
@@ -234,6 +244,11 @@ TAParamResult pDirect(String val) {
   return TA_PARAM_SUCCESS;
 }
 
+TAParamResult pVGMOptimize(String val) {
+  vgmOutOptimize=true;
+  return TA_PARAM_SUCCESS;
+}
+
 TAParamResult pInfo(String val) {
   infoMode=true;
   return TA_PARAM_SUCCESS;
@@ -395,13 +410,57 @@ TAParamResult pOutMode(String val) {
   return TA_PARAM_SUCCESS;
 }
 
+TAParamResult pOutThreads(String val) {
+  try {
+    int count=std::stoi(val);
+    if (count<0) {
+      exportOptions.threads=0;
+    } else {
+      exportOptions.threads=count;
+    }
+  } catch (std::exception& e) {
+    logE("thread count shall be a number.");
+    return TA_PARAM_ERROR;
+  }
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pProfile(String val) {
+  profileOutName=val;
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pServer(String val) {
+  if (val.empty()) {
+    logE("provide stdio or a socket path.");
+    return TA_PARAM_ERROR;
+  }
+  serverWhere=val;
+  if (val=="stdio") changeLogOutput(stderr);
+  e.setAudio(DIV_AUDIO_DUMMY);
+  return TA_PARAM_SUCCESS;
+}
+
+TAParamResult pBenchOut(String val) {
+  benchOutName=val;
+  return TA_PARAM_SUCCESS;
+}
+
 TAParamResult pBenchmark(String val) {
   if (val=="render") {
     benchMode=1;
   } else if (val=="seek") {
     benchMode=2;
+  } else if (val=="pool") {
+    benchMode=3;
+  } else if (val=="blip") {
+    benchMode=4;
+  } else if (val=="cores") {
+    benchMode=5;
+  } else if (val=="resample") {
+    benchMode=6;
   } else {
-    logE("invalid value for benchmark! valid values are: render and seek.");
+    logE("invalid value for benchmark! valid values are: render, seek, pool, blip, cores and resample.");
     return TA_PARAM_ERROR;
   }
   e.setAudio(DIV_AUDIO_DUMMY);
@@ -446,8 +505,9 @@ void initParams() {
 
   params.push_back(TAParam("a","audio",true,pAudio,"jack|sdl|portaudio|pipe","set audio engine (SDL by default)"));
   params.push_back(TAParam("o","output",true,pOutput,"<filename>","output audio to file"));
-  params.push_back(TAParam("O","vgmout",true,pVGMOut,"<filename>","output .vgm data"));
+  params.push_back(TAParam("O","vgmout",true,pVGMOut,"<filename>","output .vgm data (compressed if the file name ends in .vgz)"));
   params.push_back(TAParam("D","direct",false,pDirect,"","set VGM export direct stream mode"));
+  params.push_back(TAParam("G","vgmopt",false,pVGMOptimize,"","optimize VGM export (remove redundant register writes)"));
   params.push_back(TAParam("Z","zsmout",true,pZSMOut,"<filename>","output .zsm data for Commander X16 Zsound"));
   params.push_back(TAParam("C","cmdout",true,pCmdOut,"<filename>","output command stream"));
   params.push_back(TAParam("L","loglevel",true,pLogLevel,"debug|info|warning|error","set the log level (info by default)"));
@@ -460,10 +520,16 @@ void initParams() {
   params.push_back(TAParam("l","loops",true,pLoops,"<count>","set number of loops"));
   params.push_back(TAParam("s","subsong",true,pSubSong,"<number>","set sub-song"));
   params.push_back(TAParam("o","outmode",true,pOutMode,"one|persys|perchan","set file output mode"));
+  params.push_back(TAParam("t","outthreads",true,pOutThreads,"<count>","set number of threads for per-channel export (0 = one per core)"));
+  params.push_back(TAParam("Y","outverify",false,pOutVerify,"","check that a channel exported in a separate thread matches one exported in the main thread"));
   params.push_back(TAParam("S","safemode",false,pSafeMode,"","enable safe mode (software rendering and no audio)"));
   params.push_back(TAParam("A","safeaudio",false,pSafeModeAudio,"","enable safe mode (with audio"));
 
-  params.push_back(TAParam("B","benchmark",true,pBenchmark,"render|seek","run performance test"));
+  params.push_back(TAParam("B","benchmark",true,pBenchmark,"render|seek|pool|blip|cores|resample","run performance test"));
+  params.push_back(TAParam("J","benchout",true,pBenchOut,"<filename>","write results of -benchmark cores to a JSON file"));
+  params.push_back(TAParam("P","profile",true,pProfile,"<filename>","write render times to a .csv or .json file (with -output or -benchmark render)"));
+
+  params.push_back(TAParam("R","server",true,pServer,"stdio|<socket path>","run headless render server"));
 
   params.push_back(TAParam("V","version",false,pVersion,"","view information about Furnace."));
   params.push_back(TAParam("W","warranty",false,pWarranty,"","view warranty disclaimer."));
@@ -704,14 +770,35 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  if (fileName.empty() && (benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="")) {
+  if (benchMode==3) {
+    logI("starting benchmark!");
+    e.benchmarkPool();
+    finishLogFile();
+    return 0;
+  }
+
+  if (benchMode==4) {
+    logI("starting benchmark!");
+    e.benchmarkBlip();
+    finishLogFile();
+    return 0;
+  }
+
+  if (benchMode==6) {
+    logI("starting benchmark!");
+    e.benchmarkResample();
+    finishLogFile();
+    return 0;
+  }
+
+  if (fileName.empty() && ((benchMode && benchMode!=5) || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="")) {
     logE("provide a file!");
     return 1;
   }
 
 #ifdef HAVE_GUI
-  if (e.preInit(consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="")) {
-    if (consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="") {
+  if (e.preInit(consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="" || serverWhere!="")) {
+    if (consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="" || serverWhere!="") {
       logW("engine wants safe mode, but Furnace GUI is not going to start.");
     } else {
       safeMode=true;
@@ -723,7 +810,7 @@ int main(int argc, char** argv) {
   }
 #endif
 
-  if (safeMode && (consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="")) {
+  if (safeMode && (consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="" || serverWhere!="")) {
     logE("you can't use safe mode and console/export mode together.");
     return 1;
   }
@@ -732,7 +819,7 @@ int main(int argc, char** argv) {
     e.setAudio(DIV_AUDIO_DUMMY);
   }
 
-  if (!fileName.empty() && ((!e.getConfBool("tutIntroPlayed",TUT_INTRO_PLAYED)) || e.getConfInt("alwaysPlayIntro",0)!=3 || consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="")) {
+  if (!fileName.empty() && ((!e.getConfBool("tutIntroPlayed",TUT_INTRO_PLAYED)) || e.getConfInt("alwaysPlayIntro",0)!=3 || consoleMode || benchMode || infoMode || outName!="" || vgmOutName!="" || cmdOutName!="" || serverWhere!="")) {
     logI("loading module...");
     FILE* f=ps_fopen(fileName.c_str(),"rb");
     if (f==NULL) {
@@ -813,54 +900,67 @@ int main(int argc, char** argv) {
     e.changeSongP(subsong);
   }
 
+  if (!profileOutName.empty()) {
+    e.setPerfTrace(true);
+  }
+
+  if (serverWhere!="") {
+    DivRenderServer server(&e);
+    int ret=server.run(serverWhere);
+    finishLogFile();
+    return ret;
+  }
+
   if (benchMode) {
     logI("starting benchmark!");
-    if (benchMode==2) {
+    if (benchMode==5) {
+      if (!e.benchmarkCores(benchOutName.empty()?NULL:benchOutName.c_str())) {
+        finishLogFile();
+        return 1;
+      }
+    } else if (benchMode==2) {
       e.benchmarkSeek();
     } else {
       e.benchmarkPlayback();
     }
+    if (!profileOutName.empty()) {
+      e.writePerfTrace(profileOutName.c_str());
+    }
     finishLogFile();
     return 0;
   }
 
   if (outName!="" || vgmOutName!="" || cmdOutName!="") {
     if (cmdOutName!="") {
-      SafeWriter* w=e.saveCommand();
+      SafeWriter* w=e.saveCommand(cmdOutName.c_str());
       if (w!=NULL) {
-        FILE* f=fopen(cmdOutName.c_str(),"wb");
-        if (f!=NULL) {
-          fwrite(w->getFinalBuf(),1,w->size(),f);
-          fclose(f);
-        } else {
-          reportError(fmt::sprintf("could not open file! (%s)",e.getLastError()));
+        if (!w->finish()) {
+          reportError("could not write command stream!");
         }
-        w->finish();
         delete w;
       } else {
-        reportError("could not write command stream!");
+        reportError(fmt::sprintf("could not write command stream! (%s)",e.getLastError()));
       }
     }
     if (vgmOutName!="") {
-      SafeWriter* w=e.saveVGM(NULL,true,0x171,false,vgmOutDirect);
+      bool vgmOutCompress=(vgmOutName.size()>=4 && vgmOutName.compare(vgmOutName.size()-4,4,".vgz")==0);
+      SafeWriter* w=e.saveVGM(NULL,true,0x171,false,vgmOutDirect,-1,vgmOutName.c_str(),vgmOutOptimize,vgmOutCompress);
       if (w!=NULL) {
-        FILE* f=fopen(vgmOutName.c_str(),"wb");
-        if (f!=NULL) {
-          fwrite(w->getFinalBuf(),1,w->size(),f);
-          fclose(f);
-        } else {
-          reportError(fmt::sprintf("could not open file! (%s)",e.getLastError()));
+        if (!w->finish()) {
+          reportError("could not write VGM!");
         }
-        w->finish();
         delete w;
       } else {
-        reportError("could not write VGM!");
+        reportError(fmt::sprintf("could not write VGM! (%s)",e.getLastError()));
       }
     }
     if (outName!="") {
       e.setConsoleMode(true);
       e.saveAudio(outName.c_str(),exportOptions);
       e.waitAudioFile();
+      if (!profileOutName.empty()) {
+        e.writePerfTrace(profileOutName.c_str());
+      }
     }
     finishLogFile();
     return 0;